@@ -10,9 +10,13 @@ InstrumentationSession* session = nullptr;
 // The following macros simplify the declaration of an instrumentation timer.
 // The token pasting stuff allows to declare multiple timers with
 // different names in the same function.
+// Names and categories are interned once per call site, so the timers only handle integer IDs.
 #define CONCAT_IMPL(first, second) first##second
 #define CONCAT(first, second) CONCAT_IMPL(first, second)
-#define PROFILE_SCOPE(name, category) InstrumentationTimer CONCAT(timer_, __LINE__)(session, name, category)
+#define PROFILE_SCOPE(name, category)                                                                                  \
+    static const uint32_t CONCAT(name_, __LINE__) = InstrumentationSession::intern(name);                           \
+    static const uint32_t CONCAT(category_, __LINE__) = InstrumentationSession::intern(category);                   \
+    InstrumentationTimer CONCAT(timer_, __LINE__)(session, CONCAT(name_, __LINE__), CONCAT(category_, __LINE__))
 #define PROFILE_FUNCTION() PROFILE_SCOPE(__PRETTY_FUNCTION__, "function")
 
 // This function will be profiled
@@ -59,16 +63,18 @@ void test_func_02()
 /**
  * @brief The following program shows basic instrumentation timer usage.
  * Two functions with different profiling granularities are executed sequentially,
- * and their execution time is recorded in a json file that you can open
- * with the chrome::tracing tool. This tool allow to easily visualize what
- * happens and when in your program.
+ * and their execution time is streamed to a binary trace file. At the end, the trace
+ * is also exported to a json file that you can open with the chrome::tracing tool
+ * or Perfetto UI. These tools allow to easily visualize what happens and when in your program.
+ * The binary trace can be converted later on with the ktrace utility:
+ *     ktrace example_profile.ktrace -o example_profile.pftrace --perfetto
  *
  * @return int
  */
 int main(int, char**)
 {
-    // Create an instrumentation session
-    session = new InstrumentationSession();
+    // Create an instrumentation session, streaming to a binary trace file
+    session = new InstrumentationSession("example_profile.ktrace");
 
     // Call the test functions multiple times
     for (size_t ii = 0; ii < 10; ++ii)
@@ -0,0 +1,79 @@
+#include "harness/job_example.h"
+#include "kibble/thread/job/co_task.h"
+
+#include "fmt/color.h"
+
+using namespace kb;
+
+class JobExampleImpl : public JobExample
+{
+public:
+    int impl(size_t nexp, size_t njobs, kb::th::JobSystem& js, const kb::log::Channel& chan) override;
+};
+
+JOB_MAIN(JobExampleImpl);
+
+// Decoding is CPU-bound, it runs on the worker that awaits it
+static th::co_task<size_t> decode(size_t asset_id, long load_time)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(load_time * 10));
+    co_return asset_id * 2;
+}
+
+// Reading the file is I/O-bound, the coroutine is suspended meanwhile and the worker is free to do something else
+static th::co_task<size_t> load_asset(th::DaemonScheduler& ds, size_t asset_id, long load_time,
+                                      const kb::log::Channel& chan)
+{
+    co_await th::delay(ds, std::chrono::milliseconds(load_time));
+    klog(chan).debug("{} #{}", fmt::styled("Loaded", fmt::fg(fmt::color::yellow)), asset_id);
+    size_t result = co_await decode(asset_id, load_time);
+    klog(chan).debug("{} #{}", fmt::styled("Decoded", fmt::fg(fmt::color::green)), asset_id);
+    co_return result;
+}
+
+/**
+ * @brief In this example we demonstrate the use of coroutines to overlap many waits on a few workers.
+ * Each asset is loaded by a coroutine that waits for some simulated I/O, then decodes the data. Way more assets than
+ * workers are loaded at the same time, the total loading time is close to the longest I/O wait.
+ *
+ * @param nexp number of experiments
+ * @param njobs number of jobs
+ * @param js job system instance
+ * @param chan logger channel
+ * @return int
+ */
+int JobExampleImpl::impl(size_t nexp, size_t njobs, kb::th::JobSystem& js, const kb::log::Channel& chan)
+{
+    klog(chan).info("[JobSystem Example] coroutines");
+
+    // The timer thread resumes the coroutines waiting for I/O
+    th::DaemonScheduler::Config config;
+    config.timer_thread = true;
+    th::DaemonScheduler ds(js, config);
+
+    std::vector<long> load_time(njobs, 0l);
+    random_fill(load_time.begin(), load_time.end(), 1l, 50l, 42);
+
+    for (size_t kk = 0; kk < nexp; ++kk)
+    {
+        klog(chan).info("Round #{}", kk);
+        microClock clk;
+
+        std::vector<th::co_task<size_t>> tasks;
+        for (size_t ii = 0; ii < njobs; ++ii)
+        {
+            tasks.push_back(load_asset(ds, ii, load_time[ii], chan));
+            tasks.back().schedule(js, th::JobMetadata(th::WORKER_AFFINITY_ANY, "Load"));
+        }
+
+        size_t checksum = 0;
+        for (auto& task : tasks)
+        {
+            checksum += task.wait();
+        }
+        klog(chan).info("Loaded {} assets in {}ms, checksum: {}", njobs, clk.get_elapsed_time().count() / 1000,
+                        checksum);
+    }
+
+    return 0;
+}
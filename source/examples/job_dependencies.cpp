@@ -43,7 +43,7 @@ int JobExampleImpl::impl(size_t nexp, size_t nloads, kb::th::JobSystem& js, cons
     for (size_t kk = 0; kk < nexp; ++kk)
     {
         klog(chan).verbose("Round #", kk);
-        std::vector<std::shared_future<float>> stage_futs;
+        std::vector<th::Future<float>> stage_futs;
         milliClock clk;
         for (size_t ii = 0; ii < nloads; ++ii)
         {
@@ -68,7 +68,7 @@ int JobExampleImpl::impl(size_t nexp, size_t nloads, kb::th::JobSystem& js, cons
             // We could also use lambda capture for that, see the next example
             auto&& [stage_task, stage_fut] = js.create_task(
                 th::JobMetadata(th::WORKER_AFFINITY_MAIN, "Stage"),
-                [&stage_time, ii](std::shared_future<int> fut) {
+                [&stage_time, ii](th::Future<int> fut) {
                     // Simulate staging time
                     std::this_thread::sleep_for(std::chrono::milliseconds(stage_time[ii]));
                     // For this example, we just multiply by some arbitrary float...
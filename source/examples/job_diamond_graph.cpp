@@ -36,7 +36,7 @@ int JobExampleImpl::impl(size_t nexp, size_t ngraphs, kb::th::JobSystem& js, con
     for (size_t kk = 0; kk < nexp; ++kk)
     {
         klog(chan).info("Round #{}", kk);
-        std::vector<std::shared_future<bool>> end_futs;
+        std::vector<th::Future<bool>> end_futs;
         milliClock clk;
         for (size_t ii = 0; ii < ngraphs; ++ii)
         {
@@ -26,7 +26,7 @@ int JobExampleImpl::impl(size_t nexp, size_t ntasks, kb::th::JobSystem& js, cons
 
     // Create as many tasks as needed
     // Some of these tasks will throw an exception
-    std::vector<std::shared_future<void>> futs;
+    std::vector<th::Future<void>> futs;
     for (size_t ii = 0; ii < ntasks; ++ii)
     {
         auto&& [tsk, fut] = js.create_task(th::JobMetadata(th::WORKER_AFFINITY_ANY, "MyTask"), [ii]() {
@@ -191,7 +191,7 @@ int main(int argc, char** argv)
     // We create a task on thread 2 that will spam messages every millisecond or so
     // In asynchronous mode, the logger is able to tell which thread issued the log entry
     // These messages will mention "T2" at the beginning
-    auto&& [task, future] = js->create_task({kb::th::force_worker(2), "Task"}, [&chan_sound]() {
+    auto task = js->create_task(kb::th::detached, {kb::th::force_worker(2), "Task"}, [&chan_sound]() {
         for (size_t ii = 0; ii < 8; ++ii)
         {
             klog(chan_sound).warn("Hello from sound thread #{}", ii);
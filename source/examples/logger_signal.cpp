@@ -94,7 +94,7 @@ int main(int argc, char** argv)
     // Only a few of these should show up
     for (size_t ii = 0; ii < 100; ++ii)
     {
-        auto&& [task, future] = js->create_task({kb::th::force_worker(2), "Task"}, [ii, &chan_secondary]() {
+        auto task = js->create_task(kb::th::detached, {kb::th::force_worker(2), "Task"}, [ii, &chan_secondary]() {
             klog(chan_secondary).info("Unimportant task #{}", ii);
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         });
@@ -113,7 +113,7 @@ int main(int argc, char** argv)
     // that called std::raise(). If the signal was not due to a call to std::raise(),
     // the signal handler can be called from any thread.
     // In an attempt to simulate this, I call std::raise() from another thread.
-    auto&& [task, future] = js->create_task({kb::th::force_worker(3), "BadTask"}, []() { std::raise(SIGSEGV); });
+    auto task = js->create_task(kb::th::detached, {kb::th::force_worker(3), "BadTask"}, []() { std::raise(SIGSEGV); });
     task.schedule();
 
     // We shouldn't reach this line
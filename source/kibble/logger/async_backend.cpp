@@ -0,0 +1,245 @@
+#include "kibble/logger/async_backend.h"
+#include "kibble/assert/assert.h"
+#include "kibble/logger/channel.h"
+
+namespace kb::log
+{
+
+namespace
+{
+// The backend thread wakes up on its own at this interval when idle, in case a wake-up call was missed
+constexpr auto k_idle_timeout = std::chrono::milliseconds(100);
+} // namespace
+
+AsyncBackend::AsyncBackend(size_t capacity, OverflowPolicy policy, size_t message_capacity)
+    : capacity_(capacity), mask_(capacity - 1), records_(std::make_unique<Record[]>(capacity)), policy_(policy)
+{
+    K_ASSERT(capacity_ >= 2 && (capacity_ & mask_) == 0, "Ring capacity must be a power of 2, got {}", capacity_);
+
+    for (size_t ii = 0; ii < capacity_; ++ii)
+    {
+        records_[ii].sequence.store(ii, std::memory_order_relaxed);
+        records_[ii].entry.message.reserve(message_capacity);
+    }
+    scratch_.message.reserve(message_capacity);
+
+    backend_ = std::thread(&AsyncBackend::backend_loop, this);
+}
+
+AsyncBackend::~AsyncBackend()
+{
+    if (Channel::get_backend() == this)
+    {
+        Channel::set_backend(nullptr);
+    }
+
+    stop_.store(true, std::memory_order_release);
+    wake_up();
+    backend_.join();
+}
+
+bool AsyncBackend::push(const Channel& channel, LogEntry& entry)
+{
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Record* record = nullptr;
+    while (true)
+    {
+        record = &records_[pos & mask_];
+        size_t sequence = record->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The record still holds an entry from the previous lap: the ring is full
+            switch (get_overflow_policy())
+            {
+            case OverflowPolicy::Block:
+                if (sleeping_.load(std::memory_order_relaxed))
+                {
+                    wake_up();
+                }
+                std::this_thread::yield();
+                break;
+            case OverflowPolicy::DropNewest:
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            case OverflowPolicy::DropOldest:
+                // Only the entry standing in the way can be evicted. If the backend thread already took it, it will
+                // be available shortly
+                if (Record* victim = try_claim(pos - capacity_); victim != nullptr)
+                {
+                    victim->entry.stack_trace.reset();
+                    release(*victim, pos - capacity_);
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+                break;
+            }
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            // Another producer claimed this record
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Strings are assigned so that they reuse the capacity of the record
+    auto& dst = record->entry;
+    dst.severity = entry.severity;
+    dst.source_location = entry.source_location;
+    dst.timestamp = entry.timestamp;
+    dst.message.assign(entry.message);
+    dst.uid_text = entry.uid_text;
+    dst.uid_hash = entry.uid_hash;
+    dst.thread_id = entry.thread_id;
+    dst.raw_text = entry.raw_text;
+    dst.stack_trace = std::move(entry.stack_trace);
+    if (entry.deferred != nullptr)
+    {
+        record->args.assign(*entry.deferred);
+    }
+    else
+    {
+        record->args.format_fn = nullptr;
+    }
+    record->channel = &channel;
+    record->sequence.store(pos + 1, std::memory_order_release);
+
+    // Pairs with the fence in backend_loop(): either the backend thread sees this record, or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed))
+    {
+        wake_up();
+    }
+    return true;
+}
+
+void AsyncBackend::flush()
+{
+    // A sink or a policy logging from the backend thread would wait for itself
+    if (std::this_thread::get_id() == backend_.get_id())
+    {
+        return;
+    }
+
+    size_t target = tail_.load(std::memory_order_acquire);
+    while (head_.load(std::memory_order_acquire) < target || in_flight_.load(std::memory_order_acquire) < target)
+    {
+        if (sleeping_.load(std::memory_order_relaxed))
+        {
+            wake_up();
+        }
+        std::this_thread::yield();
+    }
+}
+
+AsyncBackend::Record* AsyncBackend::try_claim(size_t pos)
+{
+    Record& record = records_[pos & mask_];
+    if (record.sequence.load(std::memory_order_acquire) != pos + 1)
+    {
+        // Empty, or the producer has not published this record yet
+        return nullptr;
+    }
+    // Fails if the record was claimed by the backend thread or by another producer evicting it
+    if (!head_.compare_exchange_strong(pos, pos + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return &record;
+}
+
+void AsyncBackend::release(Record& record, size_t pos)
+{
+    record.sequence.store(pos + capacity_, std::memory_order_release);
+}
+
+size_t AsyncBackend::drain()
+{
+    size_t count = 0;
+    while (true)
+    {
+        // Published before the claim, so that flush() cannot miss the entry being dispatched
+        size_t pos = head_.load(std::memory_order_relaxed);
+        in_flight_.store(pos, std::memory_order_seq_cst);
+        Record* record = try_claim(pos);
+        if (record == nullptr)
+        {
+            if (head_.load(std::memory_order_relaxed) != pos)
+            {
+                // Evicted by a producer, try the next one
+                continue;
+            }
+            break;
+        }
+
+        if (record->args.format_fn != nullptr)
+        {
+            record->entry.message.clear();
+            record->args.format_to(record->entry.message);
+        }
+
+        // Swap the entry with the scratch entry, so that the record goes back to the producers before the sinks are
+        // called. Strings are swapped along with their capacity.
+        std::swap(record->entry, scratch_);
+        const Channel* channel = record->channel;
+        release(*record, pos);
+
+        channel->dispatch(scratch_);
+        scratch_.stack_trace.reset();
+        dispatched_.fetch_add(1, std::memory_order_relaxed);
+        ++count;
+    }
+    in_flight_.store(k_no_position, std::memory_order_release);
+    return count;
+}
+
+void AsyncBackend::wake_up()
+{
+    // Taking the mutex guarantees the backend thread is either waiting or has not checked the ring yet
+    {
+        std::scoped_lock lock(mutex_);
+    }
+    cv_.notify_one();
+}
+
+void AsyncBackend::backend_loop()
+{
+    while (true)
+    {
+        if (drain() > 0)
+        {
+            continue;
+        }
+
+        if (stop_.load(std::memory_order_acquire))
+        {
+            // Producers are done, catch the entries published right before the stop signal
+            drain();
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        size_t head = head_.load(std::memory_order_relaxed);
+        bool published = records_[head & mask_].sequence.load(std::memory_order_acquire) == head + 1;
+        if (!published && !stop_.load(std::memory_order_relaxed))
+        {
+            cv_.wait_for(lock, k_idle_timeout);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+}
+
+} // namespace kb::log
@@ -0,0 +1,153 @@
+#pragma once
+#include "kibble/logger/deferred_format.h"
+#include "kibble/logger/entry.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace kb::log
+{
+
+class Channel;
+
+/**
+ * @brief What a producer does when the ring of an AsyncBackend is full
+ *
+ */
+enum class OverflowPolicy : uint8_t
+{
+    /// Wait for the backend thread to make room. Nothing is lost, but a flood of log entries slows the producers down
+    Block,
+    /// Discard the entry being submitted
+    DropNewest,
+    /// Discard the oldest pending entry to make room for the one being submitted
+    DropOldest
+};
+
+/**
+ * @brief Logging backend that dispatches log entries to the sinks on a dedicated thread.
+ *
+ * Producers copy their entries into a preallocated ring of fixed-size records, which is drained by a single background
+ * thread. Submission is lock-free and does not allocate as long as the message and UID fit in the capacity reserved
+ * for each record: a longer string grows the record once, and the record keeps this capacity afterwards. Entries
+ * submitted in deferred formatting mode (see Channel::set_deferred_formatting()) only copy their serialized
+ * arguments, and are formatted by the backend thread.
+ *
+ * @details The ring is a bounded multi-producer queue where each record carries a sequence number (D. Vyukov's
+ * design). A producer claims a record by advancing the tail, fills it, and publishes it by bumping its sequence. The
+ * backend thread claims records in order from the head, swaps their entry with a scratch entry, hands them back to
+ * the producers and only then dispatches the entry to the sinks of its channel, so a slow sink does not hold a record.
+ * Under the DropOldest policy, a producer that finds the ring full claims the record standing in its way like the
+ * backend thread would, and discards it. The backend thread sleeps when the ring is empty, and producers only wake it
+ * up when they know it is asleep.
+ *
+ * This backend does not depend on the JobSystem. It is enabled with Channel::set_backend().
+ *
+ * @note All channels that submit entries to this backend must outlive it.
+ *
+ */
+class AsyncBackend
+{
+public:
+    /**
+     * @brief Create the ring and start the backend thread
+     *
+     * @param capacity number of records in the ring, must be a power of 2
+     * @param policy what to do when the ring is full
+     * @param message_capacity bytes reserved for the message of each record
+     */
+    AsyncBackend(size_t capacity = 4096, OverflowPolicy policy = OverflowPolicy::Block, size_t message_capacity = 256);
+
+    /// @brief Dispatch all pending entries, then stop the backend thread
+    ~AsyncBackend();
+
+    AsyncBackend(const AsyncBackend&) = delete;
+    AsyncBackend& operator=(const AsyncBackend&) = delete;
+
+    /**
+     * @brief Copy a log entry into the ring, it will be dispatched to the sinks of the channel later on.
+     *
+     * @param channel channel the entry was submitted to
+     * @param entry only the stack trace is moved from, strings and deferred arguments are copied into the record
+     * @return true if the entry was queued
+     * @return false if it was dropped because the ring was full and the policy is DropNewest
+     */
+    bool push(const Channel& channel, LogEntry& entry);
+
+    /**
+     * @brief Wait until all the entries queued before this call have been dispatched to the sinks (or dropped).
+     * This does not flush the sinks themselves.
+     *
+     */
+    void flush();
+
+    /// @brief Change the overflow policy dynamically
+    inline void set_overflow_policy(OverflowPolicy policy)
+    {
+        policy_.store(policy, std::memory_order_relaxed);
+    }
+
+    // clang-format off
+    /// @brief Get the current overflow policy
+    inline OverflowPolicy get_overflow_policy() const { return policy_.load(std::memory_order_relaxed); }
+    /// @brief Get the number of records in the ring
+    inline size_t get_capacity() const { return capacity_; }
+    /// @brief Get the number of entries dropped so far because the ring was full
+    inline uint64_t get_dropped_count() const { return dropped_.load(std::memory_order_relaxed); }
+    /// @brief Get the number of entries dispatched to the sinks so far
+    inline uint64_t get_dispatched_count() const { return dispatched_.load(std::memory_order_relaxed); }
+    // clang-format on
+
+private:
+    /**
+     * @internal
+     * @brief Ring element.
+     * The sequence number tells which lap of the ring the record belongs to, and whether it is free or published.
+     *
+     */
+    struct alignas(64) Record
+    {
+        std::atomic<size_t> sequence{0};
+        const Channel* channel = nullptr;
+        LogEntry entry;
+        // Only meaningful if args.format_fn is set
+        DeferredArgs args;
+    };
+
+    /// @internal Claim the published record at this position if it is the oldest, return nullptr otherwise
+    Record* try_claim(size_t pos);
+    /// @internal Hand a claimed record back to the producers
+    void release(Record& record, size_t pos);
+    /// @internal Dispatch all published records, return how many were processed
+    size_t drain();
+    void wake_up();
+    void backend_loop();
+
+private:
+    static constexpr size_t k_no_position = ~size_t(0);
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Record[]> records_;
+    std::atomic<OverflowPolicy> policy_;
+    // Only touched by the backend thread
+    LogEntry scratch_;
+
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<size_t> head_{0};
+    // Position of the record being dispatched by the backend thread, used by flush()
+    std::atomic<size_t> in_flight_{k_no_position};
+    std::atomic<uint64_t> dispatched_{0};
+    alignas(64) std::atomic<uint64_t> dropped_{0};
+
+    std::atomic<bool> sleeping_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<bool> stop_{false};
+    std::thread backend_;
+};
+
+} // namespace kb::log
@@ -0,0 +1,455 @@
+#include "kibble/logger/binary_log.h"
+#include "kibble/util/pod_io.h"
+
+#include "fmt/format.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kb::log::binlog
+{
+
+static_assert(sizeof(FileHeader) == 16, "FileHeader must not be padded");
+static_assert(sizeof(EntryHeader) == 40, "EntryHeader must not be padded");
+static_assert(sizeof(IndexBlock) == 32, "IndexBlock must not be padded");
+static_assert(sizeof(Trailer) == 40, "Trailer must not be padded");
+
+SegmentWriter::SegmentWriter(std::ostream& os, uint32_t segment) : os_(os)
+{
+    FileHeader header;
+    header.segment = segment;
+    write_bytes(&header, sizeof(FileHeader));
+}
+
+void SegmentWriter::write_entry(EntryHeader header, int location_line, const char* file_name,
+                                const char* function_name, std::string_view uid_text, std::string_view channel_name,
+                                std::string_view channel_tag, uint32_t channel_color, std::string_view message)
+{
+    if (closed_)
+    {
+        return;
+    }
+
+    if (block_.count == 0)
+    {
+        block_.offset = size_;
+        block_.min_ns = header.timestamp_ns;
+        block_.max_ns = header.timestamp_ns;
+    }
+
+    // Definitions first, so that a linear scan always knows them when it reaches the entry
+    header.location = define_location(location_line, file_name, function_name);
+    if (header.uid != 0)
+    {
+        define_string(header.uid, uid_text);
+    }
+    if (auto [it, inserted] = channels_.try_emplace(header.channel); inserted)
+    {
+        it->second = {channel_color, std::string(channel_name), std::string(channel_tag)};
+        write_channel_record(header.channel, it->second);
+    }
+
+    write_prefix(RecordType::Entry, sizeof(EntryHeader) + message.size());
+    write_bytes(&header, sizeof(EntryHeader));
+    write_bytes(message.data(), message.size());
+
+    block_.min_ns = std::min(block_.min_ns, header.timestamp_ns);
+    block_.max_ns = std::max(block_.max_ns, header.timestamp_ns);
+    min_ns_ = std::min(min_ns_, header.timestamp_ns);
+    max_ns_ = std::max(max_ns_, header.timestamp_ns);
+    if (++block_.count == k_index_block_size)
+    {
+        index_.push_back(block_);
+        block_.count = 0;
+    }
+}
+
+void SegmentWriter::close()
+{
+    if (closed_)
+    {
+        return;
+    }
+    if (block_.count > 0)
+    {
+        index_.push_back(block_);
+    }
+
+    Trailer trailer;
+    trailer.dictionary_offset = size_;
+    for (const auto& [hash, str] : strings_)
+    {
+        write_string_record(hash, str);
+    }
+    for (const auto& [hash, channel] : channels_)
+    {
+        write_channel_record(hash, channel);
+    }
+    for (size_t ii = 0; ii < locations_.size(); ++ii)
+    {
+        write_location_record(uint32_t(ii + 1), locations_[ii]);
+    }
+
+    trailer.index_offset = size_;
+    write_prefix(RecordType::Index, index_.size() * sizeof(IndexBlock));
+    write_bytes(index_.data(), index_.size() * sizeof(IndexBlock));
+
+    trailer.min_ns = min_ns_;
+    trailer.max_ns = max_ns_;
+    write_bytes(&trailer, sizeof(Trailer));
+    os_.flush();
+    closed_ = true;
+}
+
+uint64_t SegmentWriter::LocationKeyHash::operator()(const LocationKey& key) const noexcept
+{
+    hash_t hash = HCOMBINE_(reinterpret_cast<uintptr_t>(key.file_name), reinterpret_cast<uintptr_t>(key.function_name));
+    return HCOMBINE_(hash, uint64_t(key.line));
+}
+
+uint64_t SegmentWriter::define_string(const char* str)
+{
+    if (str == nullptr)
+    {
+        return 0;
+    }
+    hash_t hash = H_(str);
+    define_string(hash, str);
+    return hash;
+}
+
+void SegmentWriter::define_string(hash_t hash, std::string_view str)
+{
+    if (auto [it, inserted] = strings_.try_emplace(hash); inserted)
+    {
+        it->second = str;
+        write_string_record(hash, str);
+    }
+}
+
+uint32_t SegmentWriter::define_location(int line, const char* file_name, const char* function_name)
+{
+    if (file_name == nullptr)
+    {
+        return 0;
+    }
+
+    // Source location strings are literals, so the pointers identify them, no need to hash the strings every time
+    auto [it, inserted] = location_ids_.try_emplace(LocationKey{file_name, function_name, line});
+    if (inserted)
+    {
+        LocationDef location{line, define_string(file_name), define_string(function_name)};
+        locations_.push_back(location);
+        it->second = uint32_t(locations_.size());
+        write_location_record(it->second, location);
+    }
+    return it->second;
+}
+
+void SegmentWriter::write_prefix(RecordType type, size_t payload_size)
+{
+    auto size = static_cast<uint32_t>(payload_size);
+    write_bytes(&type, sizeof(RecordType));
+    write_bytes(&size, sizeof(uint32_t));
+}
+
+void SegmentWriter::write_bytes(const void* data, size_t size)
+{
+    os_.write(static_cast<const char*>(data), std::streamsize(size));
+    size_ += size;
+}
+
+void SegmentWriter::write_string_record(hash_t hash, std::string_view str)
+{
+    write_prefix(RecordType::String, sizeof(hash_t) + str.size());
+    write_bytes(&hash, sizeof(hash_t));
+    write_bytes(str.data(), str.size());
+}
+
+void SegmentWriter::write_channel_record(hash_t hash, const ChannelInfo& channel)
+{
+    auto name_size = static_cast<uint32_t>(channel.name.size());
+    write_prefix(RecordType::Channel, sizeof(hash_t) + 2 * sizeof(uint32_t) + channel.name.size() + channel.tag.size());
+    write_bytes(&hash, sizeof(hash_t));
+    write_bytes(&channel.color, sizeof(uint32_t));
+    write_bytes(&name_size, sizeof(uint32_t));
+    write_bytes(channel.name.data(), channel.name.size());
+    write_bytes(channel.tag.data(), channel.tag.size());
+}
+
+void SegmentWriter::write_location_record(uint32_t id, const LocationDef& location)
+{
+    write_prefix(RecordType::Location, 2 * sizeof(uint32_t) + 2 * sizeof(hash_t));
+    write_bytes(&id, sizeof(uint32_t));
+    write_bytes(&location.line, sizeof(int32_t));
+    write_bytes(&location.file, sizeof(hash_t));
+    write_bytes(&location.function, sizeof(hash_t));
+}
+
+bool Query::matches(const EntryHeader& header) const
+{
+    return header.timestamp_ns >= min_ns && header.timestamp_ns <= max_ns && header.severity <= level &&
+           (channel == 0 || header.channel == channel) && (uid == 0 || header.uid == uid);
+}
+
+SegmentReader::~SegmentReader()
+{
+    close();
+}
+
+bool SegmentReader::open(const fs::path& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(FileHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+    void* ptr = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(ptr);
+    size_ = size_t(st.st_size);
+
+    header_ = read_pod<FileHeader>(data_);
+    if (header_.magic != k_magic || header_.version != k_version || header_.entry_header_size != sizeof(EntryHeader))
+    {
+        close();
+        return false;
+    }
+
+    Record record;
+    if (size_ >= sizeof(FileHeader) + sizeof(Trailer))
+    {
+        auto trailer = read_pod<Trailer>(data_ + size_ - sizeof(Trailer));
+        has_trailer_ = trailer.magic == k_trailer_magic && trailer.dictionary_offset >= sizeof(FileHeader) &&
+                       trailer.dictionary_offset <= trailer.index_offset &&
+                       trailer.index_offset < size_ - sizeof(Trailer);
+        if (has_trailer_)
+        {
+            // Only the dictionary and index are read, entries are parsed lazily by queries
+            size_t offset = trailer.dictionary_offset;
+            while (next_record(offset, size_ - sizeof(Trailer), record))
+            {
+                parse_definition(record);
+            }
+            entries_end_ = trailer.dictionary_offset;
+            min_ns_ = trailer.min_ns;
+            max_ns_ = trailer.max_ns;
+
+            // Queries scan the entries between consecutive block offsets
+            size_t previous = sizeof(FileHeader);
+            for (const auto& block : index_)
+            {
+                if (block.offset < previous || block.offset > entries_end_)
+                {
+                    corrupt_ = true;
+                    break;
+                }
+                previous = block.offset;
+            }
+        }
+    }
+
+    if (!has_trailer_)
+    {
+        size_t offset = sizeof(FileHeader);
+        EntryView entry;
+        while (next_record(offset, size_, record))
+        {
+            if (!parse_definition(record) && decode_entry(record, entry))
+            {
+                min_ns_ = std::min(min_ns_, entry.header.timestamp_ns);
+                max_ns_ = std::max(max_ns_, entry.header.timestamp_ns);
+            }
+        }
+        // Anything past the last complete record is a truncated write
+        entries_end_ = offset;
+    }
+
+    if (corrupt_)
+    {
+        close();
+        return false;
+    }
+
+    // The dictionary is complete, string addresses will not change anymore
+    for (auto& location : locations_)
+    {
+        auto file_it = strings_.find(location.file);
+        auto func_it = strings_.find(location.function);
+        location.file_name = (file_it != strings_.end()) ? file_it->second.c_str() : nullptr;
+        location.function_name = (func_it != strings_.end()) ? func_it->second.c_str() : nullptr;
+    }
+
+    return true;
+}
+
+std::string_view SegmentReader::string(hash_t hash) const
+{
+    auto it = strings_.find(hash);
+    return (it != strings_.end()) ? std::string_view(it->second) : std::string_view{};
+}
+
+const ChannelInfo* SegmentReader::channel(hash_t hash) const
+{
+    auto it = channels_.find(hash);
+    return (it != channels_.end()) ? &it->second : nullptr;
+}
+
+const LocationInfo* SegmentReader::location(uint32_t id) const
+{
+    return (id > 0 && id <= locations_.size()) ? &locations_[id - 1] : nullptr;
+}
+
+bool SegmentReader::next_record(size_t& offset, size_t end, Record& record) const
+{
+    if (offset + k_record_prefix_size > end)
+    {
+        return false;
+    }
+    record.type = read_pod<RecordType>(data_ + offset);
+    record.size = read_pod<uint32_t>(data_ + offset + sizeof(RecordType));
+    if (offset + k_record_prefix_size + record.size > end)
+    {
+        return false;
+    }
+    record.payload = data_ + offset + k_record_prefix_size;
+    offset += k_record_prefix_size + record.size;
+    return true;
+}
+
+bool SegmentReader::parse_definition(const Record& record)
+{
+    const uint8_t* src = record.payload;
+    switch (record.type)
+    {
+    case RecordType::String: {
+        if (record.size < sizeof(hash_t))
+        {
+            return true;
+        }
+        auto hash = read_pod<hash_t>(src);
+        strings_.try_emplace(hash, reinterpret_cast<const char*>(src + sizeof(hash_t)), record.size - sizeof(hash_t));
+        return true;
+    }
+    case RecordType::Channel: {
+        constexpr size_t k_fixed_size = sizeof(hash_t) + 2 * sizeof(uint32_t);
+        if (record.size < k_fixed_size)
+        {
+            return true;
+        }
+        auto hash = read_pod<hash_t>(src);
+        auto color = read_pod<uint32_t>(src + sizeof(hash_t));
+        auto name_size = read_pod<uint32_t>(src + sizeof(hash_t) + sizeof(uint32_t));
+        if (name_size > record.size - k_fixed_size)
+        {
+            return true;
+        }
+        const char* name = reinterpret_cast<const char*>(src + k_fixed_size);
+        channels_.try_emplace(hash, ChannelInfo{color, std::string(name, name_size),
+                                                std::string(name + name_size, record.size - k_fixed_size - name_size)});
+        return true;
+    }
+    case RecordType::Location: {
+        constexpr size_t k_location_size = 2 * sizeof(uint32_t) + 2 * sizeof(hash_t);
+        if (record.size < k_location_size)
+        {
+            return true;
+        }
+        auto id = read_pod<uint32_t>(src);
+        if (id == 0)
+        {
+            return true;
+        }
+        // Ids are assigned sequentially, the segment cannot hold more location records than this
+        if (id > size_ / (k_record_prefix_size + k_location_size))
+        {
+            corrupt_ = true;
+            return true;
+        }
+        if (id > locations_.size())
+        {
+            locations_.resize(id, LocationInfo{-1, 0, 0, nullptr, nullptr});
+        }
+        auto& location = locations_[id - 1];
+        location.line = read_pod<int32_t>(src + sizeof(uint32_t));
+        location.file = read_pod<hash_t>(src + 2 * sizeof(uint32_t));
+        location.function = read_pod<hash_t>(src + 2 * sizeof(uint32_t) + sizeof(hash_t));
+        return true;
+    }
+    case RecordType::Index: {
+        index_.resize(record.size / sizeof(IndexBlock));
+        std::memcpy(index_.data(), src, index_.size() * sizeof(IndexBlock));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool SegmentReader::decode_entry(const Record& record, EntryView& entry) const
+{
+    if (record.type != RecordType::Entry || record.size < sizeof(EntryHeader))
+    {
+        return false;
+    }
+    entry.header = read_pod<EntryHeader>(record.payload);
+    entry.message = std::string_view(reinterpret_cast<const char*>(record.payload + sizeof(EntryHeader)),
+                                     record.size - sizeof(EntryHeader));
+    return true;
+}
+
+void SegmentReader::close()
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    has_trailer_ = false;
+    corrupt_ = false;
+    entries_end_ = 0;
+    min_ns_ = std::numeric_limits<int64_t>::max();
+    max_ns_ = std::numeric_limits<int64_t>::min();
+    strings_.clear();
+    channels_.clear();
+    locations_.clear();
+    index_.clear();
+}
+
+fs::path segment_path(const fs::path& directory, const std::string& base_name, uint32_t segment)
+{
+    return directory / fmt::format("{}.{:06}.klog", base_name, segment);
+}
+
+std::vector<fs::path> list_segments(const fs::path& directory)
+{
+    std::vector<fs::path> segments;
+    for (const auto& file : fs::directory_iterator(directory))
+    {
+        if (file.is_regular_file() && file.path().extension() == ".klog")
+        {
+            segments.push_back(file.path());
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+} // namespace kb::log::binlog
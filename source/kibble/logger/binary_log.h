@@ -0,0 +1,395 @@
+#pragma once
+
+#include "kibble/hash/hash.h"
+#include "kibble/logger/severity.h"
+#include "kibble/util/unordered_dense.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace kb::log
+{
+
+/**
+ * @brief Compact binary log format, written by BinaryFileSink.
+ *
+ * Logs are split into segment files. A segment starts with a FileHeader, followed by a sequence of length-prefixed
+ * records: a RecordType tag (uint8), the payload size (uint32), then the payload:
+ * - String: uint64 hash, then the string bytes. Defines an interned string (UID, file or function name).
+ * - Channel: uint64 hash of the channel full name, uint32 color, uint32 full name length, full name, then tag.
+ * - Location: uint32 id, int32 line, uint64 file name hash, uint64 function name hash.
+ * - Entry: an EntryHeader, then the message bytes.
+ * - Index: a sequence of IndexBlock structs.
+ *
+ * The size prefix allows to skip records without parsing them. Each segment is self-contained: a string, channel or
+ * location is always defined in a segment before the first entry that refers to it, so old segments can be deleted
+ * independently.
+ *
+ * When a segment is closed, all the definitions are written again in a contiguous dictionary, followed by an Index
+ * record and a Trailer at the very end of the file. The index splits the entries in blocks and gives the time span
+ * of each block, so a reader can skip to the entries of a time range without scanning the whole segment. A segment
+ * without a trailer (for instance, if the application crashed) is still readable by a linear scan, up to the last
+ * complete record. All values are in native byte order.
+ *
+ */
+namespace binlog
+{
+
+/// "KLOG" in little endian
+constexpr uint32_t k_magic = 0x474f4c4b;
+/// "KIDX" in little endian
+constexpr uint32_t k_trailer_magic = 0x5844494b;
+constexpr uint16_t k_version = 1;
+/// Number of entries per index block
+constexpr uint32_t k_index_block_size = 256;
+
+enum class RecordType : uint8_t
+{
+    String = 1,
+    Channel = 2,
+    Location = 3,
+    Entry = 4,
+    Index = 5
+};
+
+/// Size of the type tag and size prefix of a record
+constexpr size_t k_record_prefix_size = sizeof(uint8_t) + sizeof(uint32_t);
+
+enum EntryFlags : uint8_t
+{
+    /// See LogEntry::raw_text
+    k_raw_text = 1
+};
+
+struct EntryHeader
+{
+    /// Timestamp in ns since the TimeBase start
+    int64_t timestamp_ns;
+    /// Hash of the channel full name
+    uint64_t channel;
+    /// Hash of the UID text, 0 if no UID
+    uint64_t uid;
+    uint32_t thread_id;
+    /// ID of the Location record, 0 if the entry has no source location
+    uint32_t location;
+    Severity severity;
+    uint8_t flags;
+    uint16_t reserved_0 = 0;
+    uint32_t reserved_1 = 0;
+};
+
+struct FileHeader
+{
+    uint32_t magic = k_magic;
+    uint16_t version = k_version;
+    uint16_t entry_header_size = sizeof(EntryHeader);
+    /// Index of this segment in the sequence
+    uint32_t segment = 0;
+    uint32_t reserved = 0;
+};
+
+struct IndexBlock
+{
+    /// Offset of the first record of this block in the segment
+    uint64_t offset;
+    int64_t min_ns;
+    int64_t max_ns;
+    uint32_t count;
+    uint32_t reserved = 0;
+};
+
+struct Trailer
+{
+    /// Offset of the dictionary
+    uint64_t dictionary_offset;
+    /// Offset of the Index record
+    uint64_t index_offset;
+    int64_t min_ns;
+    int64_t max_ns;
+    uint32_t magic = k_trailer_magic;
+    uint32_t reserved = 0;
+};
+
+/**
+ * @brief Presentation of a channel, as stored in a segment
+ *
+ */
+struct ChannelInfo
+{
+    uint32_t color;
+    std::string name;
+    std::string tag;
+};
+
+/**
+ * @brief Incremental writer for a single segment, see BinaryFileSink.
+ * Definitions are emitted on first use. Not thread-safe.
+ *
+ */
+class SegmentWriter
+{
+public:
+    /**
+     * @brief Start a segment
+     *
+     * @param os output stream, opened in binary mode
+     * @param segment index of the segment
+     */
+    SegmentWriter(std::ostream& os, uint32_t segment);
+
+    /**
+     * @brief Write an entry record, along with the definitions it needs
+     *
+     * @param header entry header, the location field is ignored
+     * @param location_line source line
+     * @param file_name source file name, or nullptr
+     * @param function_name source function name, or nullptr
+     * @param uid_text UID text, empty if no UID
+     * @param channel_name channel full name, must hash to header.channel
+     * @param channel_tag channel tag
+     * @param channel_color channel color
+     * @param message
+     */
+    void write_entry(EntryHeader header, int location_line, const char* file_name, const char* function_name,
+                     std::string_view uid_text, std::string_view channel_name, std::string_view channel_tag,
+                     uint32_t channel_color, std::string_view message);
+
+    /// @brief Write the dictionary, the index and the trailer. Nothing can be written afterwards.
+    void close();
+
+    /// @brief Get the number of bytes written so far
+    inline uint64_t get_size() const
+    {
+        return size_;
+    }
+
+private:
+    struct LocationKey
+    {
+        const char* file_name;
+        const char* function_name;
+        int line;
+
+        bool operator==(const LocationKey&) const = default;
+    };
+
+    struct LocationKeyHash
+    {
+        uint64_t operator()(const LocationKey& key) const noexcept;
+    };
+
+    struct LocationDef
+    {
+        int32_t line;
+        uint64_t file;
+        uint64_t function;
+    };
+
+    uint64_t define_string(const char* str);
+    void define_string(hash_t hash, std::string_view str);
+    uint32_t define_location(int line, const char* file_name, const char* function_name);
+    void write_prefix(RecordType type, size_t payload_size);
+    void write_bytes(const void* data, size_t size);
+    void write_string_record(hash_t hash, std::string_view str);
+    void write_channel_record(hash_t hash, const ChannelInfo& channel);
+    void write_location_record(uint32_t id, const LocationDef& location);
+
+private:
+    std::ostream& os_;
+    uint64_t size_ = 0;
+    bool closed_ = false;
+    ankerl::unordered_dense::map<hash_t, std::string> strings_;
+    ankerl::unordered_dense::map<hash_t, ChannelInfo> channels_;
+    ankerl::unordered_dense::map<LocationKey, uint32_t, LocationKeyHash> location_ids_;
+    std::vector<LocationDef> locations_;
+    std::vector<IndexBlock> index_;
+    IndexBlock block_{};
+    int64_t min_ns_ = std::numeric_limits<int64_t>::max();
+    int64_t max_ns_ = std::numeric_limits<int64_t>::min();
+};
+
+/**
+ * @brief Entry criteria of a query on a binary log
+ *
+ */
+struct Query
+{
+    /// Time range in ns since the TimeBase start, inclusive
+    int64_t min_ns = std::numeric_limits<int64_t>::min();
+    int64_t max_ns = std::numeric_limits<int64_t>::max();
+    /// Least severe level to accept
+    Severity level = Severity::Verbose;
+    /// Channel full name hash, 0 for all channels
+    hash_t channel = 0;
+    /// UID hash, 0 for all UIDs
+    hash_t uid = 0;
+
+    /// @brief Check if an entry matches
+    bool matches(const EntryHeader& header) const;
+};
+
+/**
+ * @brief Decoded entry, strings are views on the mapped segment or on the reader's dictionary
+ *
+ */
+struct EntryView
+{
+    EntryHeader header;
+    std::string_view message;
+};
+
+struct LocationInfo
+{
+    int32_t line;
+    hash_t file;
+    hash_t function;
+    /// Null-terminated names, or nullptr if not defined
+    const char* file_name;
+    const char* function_name;
+};
+
+/**
+ * @brief Read-only view on a segment file, mapped in memory.
+ *
+ * When the segment has a trailer, the dictionary and index are loaded when the segment is opened, and queries only
+ * touch the index blocks that intersect their time range. Otherwise, the whole segment is scanned once when opened.
+ *
+ */
+class SegmentReader
+{
+public:
+    SegmentReader() = default;
+    ~SegmentReader();
+
+    SegmentReader(const SegmentReader&) = delete;
+    SegmentReader& operator=(const SegmentReader&) = delete;
+
+    /**
+     * @brief Map a segment file
+     *
+     * @param path
+     * @return false if the file cannot be mapped, or is not a valid segment, or contains corrupt definitions or index
+     * blocks
+     */
+    bool open(const fs::path& path);
+
+    /**
+     * @brief Visit all the entries that match a query, in file order
+     *
+     * @param query
+     * @param visitor callable with signature void(const EntryView&)
+     */
+    template <typename VisitorT>
+    void for_each(const Query& query, VisitorT&& visitor) const;
+
+    /// @brief Get an interned string from its hash, or an empty view if it was not defined
+    std::string_view string(hash_t hash) const;
+    /// @brief Get a channel definition, or nullptr if it was not defined
+    const ChannelInfo* channel(hash_t hash) const;
+    /// @brief Get a source location, or nullptr if it was not defined
+    const LocationInfo* location(uint32_t id) const;
+
+    // clang-format off
+    inline const FileHeader& get_header() const { return header_; }
+    inline bool has_index() const { return has_trailer_; }
+    inline size_t get_block_count() const { return index_.size(); }
+    inline int64_t get_min_ns() const { return min_ns_; }
+    inline int64_t get_max_ns() const { return max_ns_; }
+    // clang-format on
+
+private:
+    struct Record
+    {
+        RecordType type;
+        const uint8_t* payload;
+        uint32_t size;
+    };
+
+    bool next_record(size_t& offset, size_t end, Record& record) const;
+    bool parse_definition(const Record& record);
+    bool decode_entry(const Record& record, EntryView& entry) const;
+    void close();
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    FileHeader header_;
+    bool has_trailer_ = false;
+    /// Set when a definition record is inconsistent with the segment
+    bool corrupt_ = false;
+    /// End of the entry records
+    size_t entries_end_ = 0;
+    int64_t min_ns_ = std::numeric_limits<int64_t>::max();
+    int64_t max_ns_ = std::numeric_limits<int64_t>::min();
+    ankerl::unordered_dense::map<hash_t, std::string> strings_;
+    ankerl::unordered_dense::map<hash_t, ChannelInfo> channels_;
+    std::vector<LocationInfo> locations_;
+    std::vector<IndexBlock> index_;
+};
+
+/**
+ * @brief Get the path of a segment file
+ *
+ * @param directory
+ * @param base_name
+ * @param segment
+ * @return fs::path "directory/base_name.NNNNNN.klog"
+ */
+fs::path segment_path(const fs::path& directory, const std::string& base_name, uint32_t segment);
+
+/**
+ * @brief List the segment files in a directory, sorted by name
+ *
+ * @param directory
+ * @return std::vector<fs::path>
+ */
+std::vector<fs::path> list_segments(const fs::path& directory);
+
+template <typename VisitorT>
+void SegmentReader::for_each(const Query& query, VisitorT&& visitor) const
+{
+    if (data_ == nullptr || query.max_ns < min_ns_ || query.min_ns > max_ns_)
+    {
+        return;
+    }
+
+    auto scan = [this, &query, &visitor](size_t offset, size_t end) {
+        Record record;
+        EntryView entry;
+        while (next_record(offset, end, record))
+        {
+            if (record.type == RecordType::Entry && decode_entry(record, entry) && query.matches(entry.header))
+            {
+                visitor(entry);
+            }
+        }
+    };
+
+    if (!has_trailer_)
+    {
+        scan(sizeof(FileHeader), entries_end_);
+        return;
+    }
+
+    for (size_t ii = 0; ii < index_.size(); ++ii)
+    {
+        const auto& block = index_[ii];
+        if (block.max_ns < query.min_ns || block.min_ns > query.max_ns)
+        {
+            continue;
+        }
+        size_t end = (ii + 1 < index_.size()) ? std::min<size_t>(index_[ii + 1].offset, entries_end_) : entries_end_;
+        scan(block.offset, end);
+    }
+}
+
+} // namespace binlog
+} // namespace kb::log
@@ -1,4 +1,6 @@
 #include "kibble/logger/channel.h"
+#include "kibble/logger/async_backend.h"
+#include "kibble/logger/deferred_format.h"
 #include "kibble/logger/entry.h"
 #include "kibble/thread/job/job_system.h"
 
@@ -8,9 +10,11 @@ namespace kb::log
 {
 
 th::JobSystem* Channel::s_js_ = nullptr;
+AsyncBackend* Channel::s_backend_ = nullptr;
 uint32_t Channel::s_worker_ = 1;
 bool Channel::s_exit_on_fatal_error_ = true;
 bool Channel::s_intercept_signals_ = false;
+bool Channel::s_deferred_formatting_ = false;
 
 namespace
 {
@@ -20,6 +24,17 @@ void panic_handler(int signal)
 {
     g_panic_handler(signal);
 }
+
+// Format the message of an entry submitted in deferred formatting mode, on the calling thread
+void format_message(LogEntry& entry)
+{
+    if (entry.deferred != nullptr)
+    {
+        entry.message.clear();
+        entry.deferred->format_to(entry.message);
+        entry.deferred = nullptr;
+    }
+}
 } // namespace
 
 Channel::Channel(Severity level, const std::string& full_name, const std::string& short_name, math::argb32_t tag_color)
@@ -40,6 +55,28 @@ void Channel::detach_sink(std::shared_ptr<Sink> psink)
     sinks_.erase(std::remove(sinks_.begin(), sinks_.end(), psink), sinks_.end());
 }
 
+void Channel::set_uid_filter(hash_t uid, bool in_list)
+{
+    size_t bit = uid_bit(uid);
+    uint64_t mask = uint64_t(1) << (bit % 64);
+    if (in_list)
+    {
+        uid_filter_[bit / 64].fetch_or(mask, std::memory_order_relaxed);
+    }
+    else
+    {
+        uid_filter_[bit / 64].fetch_and(~mask, std::memory_order_relaxed);
+    }
+}
+
+void Channel::clear_uid_filter()
+{
+    for (auto& word : uid_filter_)
+    {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
 void Channel::attach_policy(std::shared_ptr<Policy> ppolicy)
 {
     policies_.push_back(ppolicy);
@@ -47,8 +84,8 @@ void Channel::attach_policy(std::shared_ptr<Policy> ppolicy)
 
 void Channel::submit(LogEntry&& entry) const
 {
-    // Check if the severity level is high enough
-    if (entry.severity > level_)
+    // Check if the severity level is high enough, and if the UID passes the filter
+    if (!accepts(entry.severity, entry.uid_hash))
     {
         return;
     }
@@ -65,8 +102,17 @@ void Channel::submit(LogEntry&& entry) const
     }
 
     // Send to all attached sinks
-    if (s_js_ == nullptr)
+    if (s_backend_ != nullptr)
+    {
+        if (s_js_ != nullptr)
+        {
+            entry.thread_id = s_js_->this_thread_id();
+        }
+        s_backend_->push(*this, entry);
+    }
+    else if (s_js_ == nullptr)
     {
+        format_message(entry);
         for (auto& psink : sinks_)
         {
             // psink->submit_lock(entry, presentation_);
@@ -77,21 +123,21 @@ void Channel::submit(LogEntry&& entry) const
     {
         // Set thread id
         entry.thread_id = s_js_->this_thread_id();
+        format_message(entry);
         th::JobMetadata meta(th::force_worker(s_worker_), "Log");
         meta.essential__ = true;
-        // Schedule logging task. Log entry is moved.
-        auto&& [task, future] = s_js_->create_task(std::move(meta), [this, entry = std::move(entry)]() {
-            std::lock_guard<std::mutex> lock(sink_mutex_);
-            for (auto& psink : sinks_)
-            {
-                psink->submit(entry, presentation_);
-            }
-        });
+        // Schedule logging task. Log entry is moved, and fits inline in the job kernel.
+        auto task = s_js_->create_task(th::detached, std::move(meta),
+                                       [this, entry = std::move(entry)]() { dispatch(entry); });
         task.schedule();
     }
 
     if (s_exit_on_fatal_error_ && fatal)
     {
+        if (s_backend_)
+        {
+            s_backend_->flush();
+        }
         if (s_js_)
         {
             s_js_->shutdown();
@@ -106,8 +152,22 @@ void Channel::submit(LogEntry&& entry) const
     }
 }
 
+void Channel::dispatch(const LogEntry& entry) const
+{
+    std::lock_guard<std::mutex> lock(sink_mutex_);
+    for (auto& psink : sinks_)
+    {
+        psink->submit(entry, presentation_);
+    }
+}
+
 void Channel::flush() const
 {
+    if (s_backend_)
+    {
+        s_backend_->flush();
+    }
+
     for (const auto& psink : sinks_)
     {
         psink->flush();
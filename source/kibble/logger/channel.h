@@ -1,9 +1,13 @@
 #pragma once
+#include "kibble/hash/hash.h"
 #include "kibble/logger/policy.h"
 #include "kibble/logger/severity.h"
 #include "kibble/logger/sink.h"
 #include "kibble/math/color.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -16,6 +20,8 @@ class JobSystem;
 namespace kb::log
 {
 
+class AsyncBackend;
+
 /**
  * @brief Textual and visual information about a channel that can be used by formatters for styling
  *
@@ -27,6 +33,20 @@ struct ChannelPresentation
     math::argb32_t color;
 };
 
+/**
+ * @brief How a channel filters log entries by UID, see Channel::set_uid_filter_mode()
+ *
+ */
+enum class UIDFilterMode : uint8_t
+{
+    /// All UIDs pass
+    Disabled,
+    /// Only the UIDs in the list pass
+    Whitelist,
+    /// The UIDs in the list are rejected
+    Blacklist
+};
+
 /**
  * @brief Decentralized message broker that directs all submitted log entries to the subscribed sinks
  *
@@ -76,7 +96,73 @@ public:
      */
     inline void set_severity_level(Severity level)
     {
-        level_ = level;
+        level_.store(level, std::memory_order_relaxed);
+    }
+
+    /// @brief Get the current severity threshold
+    inline Severity get_severity_level() const
+    {
+        return level_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Change the UID filtering mode dynamically
+     *
+     * UID filtering is checked before the message is formatted, by testing a single bit of a bitset indexed by the
+     * hash of the UID. Two UIDs may share a bit, in which case they are filtered together: with 4096 bits, this is
+     * unlikely for the few dozen UIDs of a program. Entries without UID, and entries more severe than Info, always pass.
+     *
+     * @param mode
+     */
+    inline void set_uid_filter_mode(UIDFilterMode mode)
+    {
+        uid_filter_mode_.store(mode, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Add a UID to the filter list, or remove it
+     *
+     * @param uid hash of the UID string, for instance "Memory"_h
+     * @param in_list true to add the UID to the list, false to remove it
+     */
+    void set_uid_filter(hash_t uid, bool in_list = true);
+
+    /// @brief Remove all UIDs from the filter list
+    void clear_uid_filter();
+
+    /**
+     * @brief Check whether an entry would pass the severity threshold and the UID filter.
+     * This is lock-free and cheap, the klog_* macros call it before any argument is evaluated.
+     *
+     * @param severity
+     * @param uid hash of the UID, or 0 if the entry has no UID
+     * @return true if the entry would pass
+     */
+    inline bool accepts(Severity severity, hash_t uid = 0) const
+    {
+        if (severity > level_.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        auto mode = uid_filter_mode_.load(std::memory_order_relaxed);
+        if (mode == UIDFilterMode::Disabled || uid == 0 || severity <= Severity::Warn)
+        {
+            return true;
+        }
+        return in_uid_filter(uid) == (mode == UIDFilterMode::Whitelist);
+    }
+
+    /**
+     * @brief Run the early checks of the attached policies, before the message of an entry is formatted.
+     * See Policy::accepts().
+     *
+     * @param entry entry without message
+     * @return true if all the policies accept the entry
+     */
+    inline bool policies_accept(const struct LogEntry& entry) const
+    {
+        return std::all_of(policies_.begin(), policies_.end(),
+                           [&entry](const auto& ppolicy) { return ppolicy->accepts(entry); });
     }
 
     inline const ChannelPresentation& get_presentation() const
@@ -96,11 +182,58 @@ public:
      * perform faster. Speed is only constrained by how fast we can push tasks
      * in a worker's queue, which is fast enough.
      *
+     * @note Each log entry becomes a job, so a burst of log entries competes with real work for the worker queue.
+     * Prefer set_backend() which does not depend on the JobSystem. If both are set, the backend is used, and the
+     * JobSystem only provides thread IDs.
+     *
      * @param js JobSystem instance. If set to nullptr, the logger will go back to synchronous mode.
      * @param worker thread ID of the worker that will get the logging tasks
      */
     static void set_async(th::JobSystem* js, uint32_t worker = 1);
 
+    /**
+     * @brief Dispatch the log entries of all channels through a dedicated asynchronous backend
+     *
+     * Entries are queued in a lock-free ring and dispatched to the sinks by the backend thread. See AsyncBackend.
+     *
+     * @param backend backend instance. If set to nullptr, the logger will go back to synchronous mode (or to the
+     * JobSystem mode if set_async() was called).
+     */
+    static inline void set_backend(AsyncBackend* backend)
+    {
+        s_backend_ = backend;
+    }
+
+    /// @brief Get the current asynchronous backend, or nullptr
+    static inline AsyncBackend* get_backend()
+    {
+        return s_backend_;
+    }
+
+    /**
+     * @brief Postpone formatting to the thread that dispatches log entries to the sinks
+     *
+     * In this mode, a logging call whose arguments are all arithmetic types, strings or void pointers does not format
+     * its message. The format string pointer and the arguments are serialized into a compact binary record
+     * (DeferredArgs), and the message is only formatted once the entry has passed the policies, right before it is
+     * dispatched. Combined with an AsyncBackend, this moves most of the logging cost off the calling threads.
+     * Other calls are formatted right away, as usual.
+     *
+     * @warning Policies see an empty message for deferred entries.
+     *
+     * @param value
+     */
+    static inline void set_deferred_formatting(bool value = true)
+    {
+        s_deferred_formatting_ = value;
+    }
+
+    /// @brief Check whether deferred formatting is enabled
+    static inline bool get_deferred_formatting()
+    {
+        return s_deferred_formatting_;
+    }
+
     /**
      * @brief Configure logging system to exit after a log entry with Fatal severity is dispatched
      *
@@ -137,6 +270,7 @@ public:
      * Policies are executed first. If the entry passes the filter, it is propagated to the sinks.
      * - In synchronous mode, an entry is submitted to each sink sequentially on the caller thread.
      * Sink access is synchronized by a mutex.
+     * - With an AsyncBackend, the entry is copied into the backend ring and dispatched on the backend thread.
      * - In asynchronous mode, sink dispatch is deferred to a worker thread. Task submission is lock-free.
      *
      * @param entry
@@ -146,19 +280,47 @@ public:
     /**
      * @brief Force sinks to flush
      *
+     * With an AsyncBackend, the entries queued so far are dispatched first.
+     *
      */
     void flush() const;
 
+private:
+    friend class AsyncBackend;
+
+    static constexpr size_t k_uid_filter_bits = 4096;
+    static constexpr size_t k_uid_filter_words = k_uid_filter_bits / 64;
+
+    /// @internal Index of the bit of a UID in the filter bitset
+    static inline size_t uid_bit(hash_t uid)
+    {
+        return (uid ^ (uid >> 32)) & (k_uid_filter_bits - 1);
+    }
+
+    /// @internal Test the bit of a UID in the filter bitset
+    inline bool in_uid_filter(hash_t uid) const
+    {
+        size_t bit = uid_bit(uid);
+        return (uid_filter_[bit / 64].load(std::memory_order_relaxed) >> (bit % 64)) & 1;
+    }
+
+    /// @internal Send an entry that passed the filters to all attached sinks
+    void dispatch(const struct LogEntry& entry) const;
+
 private:
     ChannelPresentation presentation_;
     std::vector<std::shared_ptr<Sink>> sinks_;
     std::vector<std::shared_ptr<Policy>> policies_;
-    Severity level_;
+    std::atomic<Severity> level_;
+    std::atomic<UIDFilterMode> uid_filter_mode_{UIDFilterMode::Disabled};
+    std::array<std::atomic<uint64_t>, k_uid_filter_words> uid_filter_{};
     mutable std::mutex sink_mutex_;
 
     static th::JobSystem* s_js_;
+    static AsyncBackend* s_backend_;
     static uint32_t s_worker_;
     static bool s_exit_on_fatal_error_;
+    static bool s_deferred_formatting_;
     static bool s_intercept_signals_;
 };
 
@@ -0,0 +1,280 @@
+#pragma once
+
+#include "fmt/format.h"
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace kb::log::detail
+{
+
+/**
+ * @internal
+ * @brief Decoded C string argument.
+ * A C string formats as a string, or as a pointer with the 'p' presentation type, so both are kept.
+ *
+ */
+struct CStringArg
+{
+    const void* ptr;
+    std::string_view str;
+};
+
+} // namespace kb::log::detail
+
+template <>
+struct fmt::formatter<kb::log::detail::CStringArg>
+{
+    constexpr auto parse(fmt::format_parse_context& ctx)
+    {
+        // The presentation type is the last character of the spec, skip nested replacement fields
+        auto it = ctx.begin();
+        for (int depth = 0; it != ctx.end() && (*it != '}' || depth > 0); ++it)
+        {
+            depth += (*it == '{') ? 1 : (*it == '}') ? -1 : 0;
+        }
+        pointer_ = it != ctx.begin() && *(it - 1) == 'p';
+        return pointer_ ? pointer_formatter_.parse(ctx) : string_formatter_.parse(ctx);
+    }
+
+    auto format(const kb::log::detail::CStringArg& arg, fmt::format_context& ctx) const
+    {
+        return pointer_ ? pointer_formatter_.format(arg.ptr, ctx) : string_formatter_.format(arg.str, ctx);
+    }
+
+private:
+    bool pointer_ = false;
+    fmt::formatter<const void*> pointer_formatter_;
+    fmt::formatter<fmt::string_view> string_formatter_;
+};
+
+namespace kb::log
+{
+
+namespace detail
+{
+
+/**
+ * @internal
+ * @brief Binary serialization of a formatting argument.
+ * Only types that can be stored by value without changing the formatted output are supported: arithmetic types,
+ * strings (serialized as their bytes), C strings (serialized as their address and bytes) and void pointers.
+ * A codec can refuse a value with accepts(), the call is then formatted right away.
+ *
+ * @tparam T decayed argument type
+ */
+template <typename T>
+struct ArgCodec
+{
+    static constexpr bool k_supported = false;
+};
+
+template <typename T>
+struct TrivialCodec
+{
+    static constexpr bool k_supported = true;
+    using Decoded = T;
+
+    static inline bool accepts(const T&)
+    {
+        return true;
+    }
+
+    static inline size_t size(const T&)
+    {
+        return sizeof(T);
+    }
+
+    static inline uint8_t* encode(uint8_t* dst, const T& value)
+    {
+        std::memcpy(dst, &value, sizeof(T));
+        return dst + sizeof(T);
+    }
+
+    static inline T decode(const uint8_t*& src)
+    {
+        T value;
+        std::memcpy(&value, src, sizeof(T));
+        src += sizeof(T);
+        return value;
+    }
+};
+
+struct StringCodec
+{
+    static constexpr bool k_supported = true;
+    using Decoded = std::string_view;
+
+    static inline bool accepts(std::string_view)
+    {
+        return true;
+    }
+
+    static inline size_t size(std::string_view str)
+    {
+        return sizeof(uint32_t) + str.size();
+    }
+
+    static inline uint8_t* encode(uint8_t* dst, std::string_view str)
+    {
+        auto length = static_cast<uint32_t>(str.size());
+        std::memcpy(dst, &length, sizeof(uint32_t));
+        std::memcpy(dst + sizeof(uint32_t), str.data(), str.size());
+        return dst + sizeof(uint32_t) + str.size();
+    }
+
+    static inline std::string_view decode(const uint8_t*& src)
+    {
+        uint32_t length = 0;
+        std::memcpy(&length, src, sizeof(uint32_t));
+        std::string_view str(reinterpret_cast<const char*>(src + sizeof(uint32_t)), length);
+        src += sizeof(uint32_t) + length;
+        return str;
+    }
+};
+
+struct CStringCodec
+{
+    static constexpr bool k_supported = true;
+    using Decoded = CStringArg;
+
+    // A null C string is a formatting error, it must be reported by the caller
+    static inline bool accepts(const char* str)
+    {
+        return str != nullptr;
+    }
+
+    static inline size_t size(const char* str)
+    {
+        return sizeof(const void*) + StringCodec::size(str);
+    }
+
+    static inline uint8_t* encode(uint8_t* dst, const char* str)
+    {
+        const void* ptr = str;
+        std::memcpy(dst, &ptr, sizeof(const void*));
+        return StringCodec::encode(dst + sizeof(const void*), str);
+    }
+
+    static inline CStringArg decode(const uint8_t*& src)
+    {
+        CStringArg arg;
+        std::memcpy(&arg.ptr, src, sizeof(const void*));
+        src += sizeof(const void*);
+        arg.str = StringCodec::decode(src);
+        return arg;
+    }
+};
+
+template <typename T>
+    requires std::is_arithmetic_v<T>
+struct ArgCodec<T> : TrivialCodec<T>
+{
+};
+
+template <typename T>
+    requires std::is_void_v<T>
+struct ArgCodec<T*> : TrivialCodec<T*>
+{
+};
+
+// clang-format off
+template <> struct ArgCodec<std::string> : StringCodec {};
+template <> struct ArgCodec<std::string_view> : StringCodec {};
+template <> struct ArgCodec<const char*> : CStringCodec {};
+template <> struct ArgCodec<char*> : CStringCodec {};
+template <size_t N> struct ArgCodec<char[N]> : StringCodec {};
+template <size_t N> struct ArgCodec<const char[N]> : StringCodec {};
+// clang-format on
+
+template <typename... ArgsT>
+void format_decoded(std::string& out, fmt::string_view format, const uint8_t* data)
+{
+    // Braced initialization evaluates the decoders from left to right
+    std::tuple<typename ArgCodec<ArgsT>::Decoded...> args{ArgCodec<ArgsT>::decode(data)...};
+    std::apply(
+        [&out, format](const auto&... values) {
+            fmt::vformat_to(std::back_inserter(out), format, fmt::make_format_args(values...));
+        },
+        args);
+}
+
+} // namespace detail
+
+/// @brief True if all the arguments of a logging call can be serialized for deferred formatting
+template <typename... ArgsT>
+constexpr bool k_deferrable = (detail::ArgCodec<std::remove_cvref_t<ArgsT>>::k_supported && ...);
+
+/**
+ * @brief Compact binary record of a formatting call: a pointer to the format string, and the serialized arguments.
+ *
+ * This allows to postpone formatting to the thread that dispatches log entries to the sinks, see
+ * Channel::set_deferred_formatting(). Arguments are copied by value, strings are copied byte for byte, so the record
+ * does not reference the caller's data. The format string is not copied however, it must have static storage duration
+ * (a string literal, which is the case for compile-time checked format strings). EntryBuilder never defers calls made
+ * with a runtime format string (fmt::runtime()), they are formatted right away.
+ *
+ */
+struct DeferredArgs
+{
+    using FormatFn = void (*)(std::string& out, fmt::string_view format, const uint8_t* data);
+
+    /// Maximum size of the serialized arguments, larger argument lists are formatted right away
+    static constexpr size_t k_capacity = 128;
+
+    /// Type-erased decoding and formatting function, nullptr if nothing is recorded
+    FormatFn format_fn = nullptr;
+    fmt::string_view format;
+    uint32_t size = 0;
+    uint8_t data[k_capacity];
+
+    /**
+     * @brief Record a formatting call
+     *
+     * @param fstr format string, must outlive the record
+     * @param args arguments, all must be deferrable (see k_deferrable)
+     * @return false if an argument cannot be recorded, or if the serialized arguments do not fit
+     */
+    template <typename... ArgsT>
+    bool encode(fmt::string_view fstr, const ArgsT&... args)
+    {
+        if (!(detail::ArgCodec<std::remove_cvref_t<ArgsT>>::accepts(args) && ...))
+        {
+            return false;
+        }
+
+        size_t total = (detail::ArgCodec<std::remove_cvref_t<ArgsT>>::size(args) + ... + size_t(0));
+        if (total > k_capacity)
+        {
+            return false;
+        }
+
+        [[maybe_unused]] uint8_t* dst = data;
+        ((dst = detail::ArgCodec<std::remove_cvref_t<ArgsT>>::encode(dst, args)), ...);
+        format_fn = &detail::format_decoded<std::remove_cvref_t<ArgsT>...>;
+        format = fstr;
+        size = static_cast<uint32_t>(total);
+        return true;
+    }
+
+    /// @brief Copy another record, only the used part of the buffer is copied
+    inline void assign(const DeferredArgs& other)
+    {
+        format_fn = other.format_fn;
+        format = other.format;
+        size = other.size;
+        std::memcpy(data, other.data, other.size);
+    }
+
+    /// @brief Append the formatted message to a string
+    inline void format_to(std::string& out) const
+    {
+        format_fn(out, format, data);
+    }
+};
+
+} // namespace kb::log
@@ -1,10 +1,12 @@
 #pragma once
+#include "kibble/hash/hash.h"
 #include "kibble/logger/severity.h"
 #include "kibble/time/clock.h"
 #include "kibble/util/stack_trace.h"
 
 #include <optional>
 #include <string>
+#include <string_view>
 
 namespace kb::log
 {
@@ -16,16 +18,24 @@ struct SourceLocation
     const char* function_name = nullptr;
 };
 
+struct DeferredArgs;
+
 struct LogEntry
 {
     Severity severity = Severity::Info;
     SourceLocation source_location;
     TimeBase::TimeStamp timestamp;
     std::string message;
-    std::string uid_text;
+    /// Interned UID text (see intern()), empty if no UID
+    std::string_view uid_text;
+    /// Hash of the UID text, 0 if no UID
+    hash_t uid_hash = 0;
     uint32_t thread_id = 0xffffffff;
     bool raw_text = false;
     std::optional<StackTrace> stack_trace = {};
+    /// Formatting call recorded for deferred formatting. Only set while the entry goes through the policies, in which
+    /// case the message is still empty. Sinks always receive formatted entries.
+    const DeferredArgs* deferred = nullptr;
 };
 
 } // namespace kb::log
\ No newline at end of file
@@ -25,7 +25,7 @@ EntryBuilder::EntryBuilder(const Channel* channel, int source_line, const char*
 
 void EntryBuilder::log(std::string_view m)
 {
-    if (channel_)
+    if (channel_ && channel_->accepts(severity, uid_hash) && channel_->policies_accept(*this))
     {
         message = m;
         channel_->submit(std::move(*this));
@@ -41,4 +41,10 @@ void EntryBuilder::log(std::string&& m)
     }
 }
 
+void EntryBuilder::log_deferred()
+{
+    deferred = &deferred_args_;
+    channel_->submit(std::move(*this));
+}
+
 } // namespace kb::log
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "kibble/logger/channel.h"
+#include "kibble/logger/deferred_format.h"
 #include "kibble/logger/entry.h"
+#include "kibble/logger/intern.h"
 #include "kibble/logger/severity.h"
 
 #include "fmt/core.h"
@@ -10,6 +12,20 @@
 namespace kb::log
 {
 
+namespace detail
+{
+// Severity threshold check of the klog_* macros, which accept a channel reference or pointer like klog()
+inline bool accepts(const Channel& channel, Severity severity)
+{
+    return channel.accepts(severity);
+}
+
+inline bool accepts(const Channel* channel, Severity severity)
+{
+    return channel != nullptr && channel->accepts(severity);
+}
+} // namespace detail
+
 /**
  * @brief Helper class to generate a log entry
  *
@@ -17,6 +33,9 @@ namespace kb::log
 struct EntryBuilder : private LogEntry
 {
 public:
+    /// Type returned by fmt::runtime()
+    using RuntimeFormat = decltype(fmt::runtime(fmt::string_view{}));
+
     EntryBuilder(const Channel& channel, int source_line, const char* source_file, const char* source_function);
     EntryBuilder(const Channel* channel, int source_line, const char* source_file, const char* source_function);
 
@@ -43,14 +62,18 @@ public:
      * @brief Attach a UID to this log entry.
      *
      * UIDs help better understand what subsystem issued this particular logging call.
-     * They can also be whitelisted / blacklisted by policies.
+     * They can also be filtered by the channel (see Channel::set_uid_filter_mode()), or whitelisted / blacklisted by
+     * policies.
+     * The UID string is interned, entries only carry a view on the interned text and its hash.
      *
      * @param uid_str
      * @return EntryBuilder&
      */
-    inline EntryBuilder& uid(std::string&& uid_str)
+    inline EntryBuilder& uid(std::string_view uid_str)
     {
-        uid_text = std::move(uid_str);
+        auto interned = intern(uid_str);
+        uid_text = interned.text;
+        uid_hash = interned.hash;
         return *this;
     }
 
@@ -61,80 +84,203 @@ public:
     }
     inline void verbose([[maybe_unused]] std::string_view sv)
     {
-#ifdef K_DEBUG
-        level(Severity::Verbose).log(sv);
-#endif
+        if constexpr (is_compiled(Severity::Verbose))
+        {
+            level(Severity::Verbose).log(sv);
+        }
     }
     inline void debug([[maybe_unused]] std::string_view sv)
     {
-#ifdef K_DEBUG
-        level(Severity::Debug).log(sv);
-#endif
+        if constexpr (is_compiled(Severity::Debug))
+        {
+            level(Severity::Debug).log(sv);
+        }
     }
-    inline void info(std::string_view sv)
+    inline void info([[maybe_unused]] std::string_view sv)
     {
-        level(Severity::Info).log(sv);
+        if constexpr (is_compiled(Severity::Info))
+        {
+            level(Severity::Info).log(sv);
+        }
     }
-    inline void warn(std::string_view sv)
+    inline void warn([[maybe_unused]] std::string_view sv)
     {
-        level(Severity::Warn).log(sv);
+        if constexpr (is_compiled(Severity::Warn))
+        {
+            level(Severity::Warn).log(sv);
+        }
     }
-    inline void error(std::string_view sv)
+    inline void error([[maybe_unused]] std::string_view sv)
     {
-        level(Severity::Error).log(sv);
+        if constexpr (is_compiled(Severity::Error))
+        {
+            level(Severity::Error).log(sv);
+        }
     }
-    inline void fatal(std::string_view sv)
+    inline void fatal([[maybe_unused]] std::string_view sv)
     {
-        level(Severity::Fatal).log(sv);
+        if constexpr (is_compiled(Severity::Fatal))
+        {
+            level(Severity::Fatal).log(sv);
+        }
     }
 
     // Compile-time
     template <typename... ArgsT>
     inline void msg(fmt::format_string<ArgsT...> fstr, ArgsT&&... args)
     {
-        log(fmt::format(fstr, std::forward<ArgsT>(args)...));
+        log_format(fstr, std::forward<ArgsT>(args)...);
     }
     template <typename... ArgsT>
     inline void verbose([[maybe_unused]] fmt::format_string<ArgsT...> fstr, [[maybe_unused]] ArgsT&&... args)
     {
-#ifdef K_DEBUG
-        level(Severity::Verbose).log(fmt::format(fstr, std::forward<ArgsT>(args)...));
-#endif
+        if constexpr (is_compiled(Severity::Verbose))
+        {
+            level(Severity::Verbose).log_format(fstr, std::forward<ArgsT>(args)...);
+        }
     }
     template <typename... ArgsT>
     inline void debug([[maybe_unused]] fmt::format_string<ArgsT...> fstr, [[maybe_unused]] ArgsT&&... args)
     {
-#ifdef K_DEBUG
-        level(Severity::Debug).log(fmt::format(fstr, std::forward<ArgsT>(args)...));
-#endif
+        if constexpr (is_compiled(Severity::Debug))
+        {
+            level(Severity::Debug).log_format(fstr, std::forward<ArgsT>(args)...);
+        }
+    }
+    template <typename... ArgsT>
+    inline void info([[maybe_unused]] fmt::format_string<ArgsT...> fstr, [[maybe_unused]] ArgsT&&... args)
+    {
+        if constexpr (is_compiled(Severity::Info))
+        {
+            level(Severity::Info).log_format(fstr, std::forward<ArgsT>(args)...);
+        }
+    }
+    template <typename... ArgsT>
+    inline void warn([[maybe_unused]] fmt::format_string<ArgsT...> fstr, [[maybe_unused]] ArgsT&&... args)
+    {
+        if constexpr (is_compiled(Severity::Warn))
+        {
+            level(Severity::Warn).log_format(fstr, std::forward<ArgsT>(args)...);
+        }
+    }
+    template <typename... ArgsT>
+    inline void error([[maybe_unused]] fmt::format_string<ArgsT...> fstr, [[maybe_unused]] ArgsT&&... args)
+    {
+        if constexpr (is_compiled(Severity::Error))
+        {
+            level(Severity::Error).log_format(fstr, std::forward<ArgsT>(args)...);
+        }
+    }
+    template <typename... ArgsT>
+    inline void fatal([[maybe_unused]] fmt::format_string<ArgsT...> fstr, [[maybe_unused]] ArgsT&&... args)
+    {
+        if constexpr (is_compiled(Severity::Fatal))
+        {
+            level(Severity::Fatal).log_format(fstr, std::forward<ArgsT>(args)...);
+        }
+    }
+
+    // Runtime format strings are formatted right away: the deferred record only keeps a pointer to the format string,
+    // which may not outlive the call
+    template <typename... ArgsT>
+    inline void msg(RuntimeFormat fstr, ArgsT&&... args)
+    {
+        log_runtime(fstr, std::forward<ArgsT>(args)...);
+    }
+    template <typename... ArgsT>
+    inline void verbose([[maybe_unused]] RuntimeFormat fstr, [[maybe_unused]] ArgsT&&... args)
+    {
+        if constexpr (is_compiled(Severity::Verbose))
+        {
+            level(Severity::Verbose).log_runtime(fstr, std::forward<ArgsT>(args)...);
+        }
     }
     template <typename... ArgsT>
-    inline void info(fmt::format_string<ArgsT...> fstr, ArgsT&&... args)
+    inline void debug([[maybe_unused]] RuntimeFormat fstr, [[maybe_unused]] ArgsT&&... args)
     {
-        level(Severity::Info).log(fmt::format(fstr, std::forward<ArgsT>(args)...));
+        if constexpr (is_compiled(Severity::Debug))
+        {
+            level(Severity::Debug).log_runtime(fstr, std::forward<ArgsT>(args)...);
+        }
     }
     template <typename... ArgsT>
-    inline void warn(fmt::format_string<ArgsT...> fstr, ArgsT&&... args)
+    inline void info([[maybe_unused]] RuntimeFormat fstr, [[maybe_unused]] ArgsT&&... args)
     {
-        level(Severity::Warn).log(fmt::format(fstr, std::forward<ArgsT>(args)...));
+        if constexpr (is_compiled(Severity::Info))
+        {
+            level(Severity::Info).log_runtime(fstr, std::forward<ArgsT>(args)...);
+        }
     }
     template <typename... ArgsT>
-    inline void error(fmt::format_string<ArgsT...> fstr, ArgsT&&... args)
+    inline void warn([[maybe_unused]] RuntimeFormat fstr, [[maybe_unused]] ArgsT&&... args)
     {
-        level(Severity::Error).log(fmt::format(fstr, std::forward<ArgsT>(args)...));
+        if constexpr (is_compiled(Severity::Warn))
+        {
+            level(Severity::Warn).log_runtime(fstr, std::forward<ArgsT>(args)...);
+        }
     }
     template <typename... ArgsT>
-    inline void fatal(fmt::format_string<ArgsT...> fstr, ArgsT&&... args)
+    inline void error([[maybe_unused]] RuntimeFormat fstr, [[maybe_unused]] ArgsT&&... args)
     {
-        level(Severity::Fatal).log(fmt::format(fstr, std::forward<ArgsT>(args)...));
+        if constexpr (is_compiled(Severity::Error))
+        {
+            level(Severity::Error).log_runtime(fstr, std::forward<ArgsT>(args)...);
+        }
+    }
+    template <typename... ArgsT>
+    inline void fatal([[maybe_unused]] RuntimeFormat fstr, [[maybe_unused]] ArgsT&&... args)
+    {
+        if constexpr (is_compiled(Severity::Fatal))
+        {
+            level(Severity::Fatal).log_runtime(fstr, std::forward<ArgsT>(args)...);
+        }
     }
 
 private:
+    /**
+     * @internal
+     * @brief Format the message and submit the entry.
+     * Nothing is formatted if the channel would reject the entry because of its severity or UID, or if a policy
+     * rejects it early (see Policy::accepts()). In deferred formatting mode, the formatting call is recorded instead
+     * when all the arguments support it.
+     *
+     */
+    template <typename... ArgsT>
+    inline void log_format(fmt::format_string<ArgsT...> fstr, ArgsT&&... args)
+    {
+        if (channel_ == nullptr || !channel_->accepts(severity, uid_hash) || !channel_->policies_accept(*this))
+        {
+            return;
+        }
+        if constexpr (k_deferrable<ArgsT...>)
+        {
+            if (Channel::get_deferred_formatting() && deferred_args_.encode(fmt::string_view(fstr), args...))
+            {
+                log_deferred();
+                return;
+            }
+        }
+        log(fmt::format(fstr, std::forward<ArgsT>(args)...));
+    }
+
+    /// @internal Format a message from a runtime format string and submit the entry, never deferred
+    template <typename... ArgsT>
+    inline void log_runtime(RuntimeFormat fstr, ArgsT&&... args)
+    {
+        if (channel_ == nullptr || !channel_->accepts(severity, uid_hash) || !channel_->policies_accept(*this))
+        {
+            return;
+        }
+        log(fmt::format(fstr, std::forward<ArgsT>(args)...));
+    }
+
     void log(std::string_view m);
     void log(std::string&& m);
+    void log_deferred();
 
 private:
     const Channel* channel_ = nullptr;
+    DeferredArgs deferred_args_;
 };
 
 } // namespace kb::log
@@ -26,6 +26,16 @@ public:
         return "";
     }
 
+    /**
+     * @brief Append a formatted entry to a string.
+     * Sinks that batch entries call this with a reused string, override it to avoid an allocation per entry.
+     *
+     */
+    virtual void format_to(std::string& out, const LogEntry& e, const ChannelPresentation& p)
+    {
+        out += format_string(e, p);
+    }
+
     /**
      * @brief Override this with code that produces a formatted console print
      *
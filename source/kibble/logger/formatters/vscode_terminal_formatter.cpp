@@ -32,7 +32,7 @@ inline auto to_rgb(math::argb32_t color)
     return fmt::rgb{uint8_t(color.r()), uint8_t(color.g()), uint8_t(color.b())};
 }
 
-inline std::string format_uid(const std::string& input)
+inline std::string format_uid(std::string_view input)
 {
     if (input.size() == 0)
     {
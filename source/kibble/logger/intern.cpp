@@ -0,0 +1,68 @@
+#include "kibble/logger/intern.h"
+#include "kibble/util/unordered_dense.h"
+
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace kb::log
+{
+
+namespace
+{
+
+struct InternRegistry
+{
+    std::mutex mutex;
+    // Elements of a deque never move, views on the strings stay valid
+    std::deque<std::string> strings;
+    ankerl::unordered_dense::map<hash_t, std::string_view> views;
+};
+
+InternRegistry& registry()
+{
+    // Leaked on purpose: entries can be logged during static destruction
+    static auto* reg = new InternRegistry;
+    return *reg;
+}
+
+} // namespace
+
+InternedString intern(std::string_view str)
+{
+    hash_t hash = H_(str);
+
+    thread_local ankerl::unordered_dense::map<hash_t, std::string_view> cache;
+    if (auto it = cache.find(hash); it != cache.end())
+    {
+        return {hash, it->second};
+    }
+
+    auto& reg = registry();
+    std::string_view view;
+    {
+        std::scoped_lock lock(reg.mutex);
+        auto [it, inserted] = reg.views.try_emplace(hash);
+        if (inserted)
+        {
+            it->second = reg.strings.emplace_back(str);
+        }
+        view = it->second;
+    }
+
+    cache.emplace(hash, view);
+    return {hash, view};
+}
+
+std::string_view find_interned(hash_t hash)
+{
+    auto& reg = registry();
+    std::scoped_lock lock(reg.mutex);
+    if (auto it = reg.views.find(hash); it != reg.views.end())
+    {
+        return it->second;
+    }
+    return {};
+}
+
+} // namespace kb::log
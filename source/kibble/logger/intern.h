@@ -0,0 +1,40 @@
+#pragma once
+
+#include "kibble/hash/hash.h"
+
+#include <string_view>
+
+namespace kb::log
+{
+
+/**
+ * @brief String stored once for the whole process, identified by its hash
+ *
+ */
+struct InternedString
+{
+    /// FNV-1a hash of the text, same as H_()
+    hash_t hash = 0;
+    /// View on the interned text, never dangles
+    std::string_view text;
+};
+
+/**
+ * @brief Intern a string used by log entries (UIDs).
+ * Each thread caches the strings it has already seen, so the global registry is only locked the first time a thread
+ * interns a given string.
+ *
+ * @param str
+ * @return InternedString
+ */
+InternedString intern(std::string_view str);
+
+/**
+ * @brief Get the text of an interned string from its hash
+ *
+ * @param hash
+ * @return std::string_view the text, or an empty view if no string with this hash was interned
+ */
+std::string_view find_interned(hash_t hash);
+
+} // namespace kb::log
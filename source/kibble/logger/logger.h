@@ -3,4 +3,27 @@
 /// Constructs an EntryBuilder in place, and feeds it contextual information
 #define klog(CHANNEL) kb::log::EntryBuilder(CHANNEL, __LINE__, __FILE__, __PRETTY_FUNCTION__)
 /// For printf-debugging. It's lame, but everybody does it.
-#define kbang(CHANNEL) kb::log::EntryBuilder(CHANNEL, __LINE__, __FILE__, __PRETTY_FUNCTION__).warn("  \u0489")
\ No newline at end of file
+#define kbang(CHANNEL) kb::log::EntryBuilder(CHANNEL, __LINE__, __FILE__, __PRETTY_FUNCTION__).warn("  \u0489")
+
+/*
+    Severity-scoped logging macros. The channel severity threshold is checked before the EntryBuilder is created, so
+    when the entry is rejected, the arguments are not even evaluated. Call sites below KB_LOG_MIN_SEVERITY are removed
+    at compile time. The builder can be chained as usual, the message is submitted by msg():
+        klog_debug(chan).uid("Physics").msg("Contacts: {}", count_contacts());
+*/
+#define KB_LOG_IF_(CHANNEL, SEVERITY)                                                                                  \
+    if constexpr (!kb::log::is_compiled(kb::log::Severity::SEVERITY))                                                  \
+    {                                                                                                                  \
+    }                                                                                                                  \
+    else if (!kb::log::detail::accepts(CHANNEL, kb::log::Severity::SEVERITY))                                          \
+    {                                                                                                                  \
+    }                                                                                                                  \
+    else                                                                                                               \
+        klog(CHANNEL).level(kb::log::Severity::SEVERITY)
+
+#define klog_verbose(CHANNEL) KB_LOG_IF_(CHANNEL, Verbose)
+#define klog_debug(CHANNEL) KB_LOG_IF_(CHANNEL, Debug)
+#define klog_info(CHANNEL) KB_LOG_IF_(CHANNEL, Info)
+#define klog_warn(CHANNEL) KB_LOG_IF_(CHANNEL, Warn)
+#define klog_error(CHANNEL) KB_LOG_IF_(CHANNEL, Error)
+#define klog_fatal(CHANNEL) KB_LOG_IF_(CHANNEL, Fatal)
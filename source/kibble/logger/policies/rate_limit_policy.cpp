@@ -0,0 +1,224 @@
+#include "kibble/logger/policies/rate_limit_policy.h"
+#include "kibble/hash/hash.h"
+#include "kibble/logger/channel.h"
+#include "kibble/logger/deferred_format.h"
+#include "kibble/logger/entry.h"
+
+#include "fmt/format.h"
+#include <algorithm>
+#include <bit>
+
+namespace kb::log
+{
+
+namespace
+{
+// Maximum number of slots visited when looking for a call site
+constexpr size_t k_max_probes = 16;
+
+// Set while a summary is submitted, so that it is not filtered by the policy itself
+thread_local bool t_emitting = false;
+
+inline int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Identify the content of an entry. Deferred entries are not formatted yet, the format string pointer and the
+// serialized arguments identify the message just as well.
+uint64_t content_hash(const LogEntry& entry)
+{
+    if (entry.deferred != nullptr)
+    {
+        std::string_view args(reinterpret_cast<const char*>(entry.deferred->data), entry.deferred->size);
+        return HCOMBINE_(reinterpret_cast<uintptr_t>(entry.deferred->format.data()), H_(args));
+    }
+    return H_(entry.message);
+}
+} // namespace
+
+struct RateLimitPolicy::Site
+{
+    // Hash of the source location, 0 if the slot is free
+    std::atomic<uint64_t> key{0};
+    std::atomic<int> line{-1};
+    std::atomic<const char*> file_name{nullptr};
+    std::atomic<const char*> function_name{nullptr};
+    // Severity of the last suppressed or repeated entry, used by the summaries
+    std::atomic<Severity> severity{Severity::Info};
+    // Theoretical arrival time of the next entry, the bucket is empty when it is too far in the future
+    std::atomic<int64_t> tat{0};
+    std::atomic<uint32_t> suppressed{0};
+    std::atomic<uint64_t> last_content{0};
+    std::atomic<uint32_t> repeats{0};
+};
+
+RateLimitPolicy::RateLimitPolicy(const Channel& channel, const Config& config)
+    : channel_(channel), config_(config),
+      interval_ns_(int64_t(1'000'000'000) / std::max(config.rate, uint32_t(1))),
+      tolerance_ns_(interval_ns_ * (int64_t(std::max(config.burst, uint32_t(1))) - 1)),
+      mask_(std::bit_ceil(std::max(config.max_sites, size_t(1))) - 1),
+      sites_(std::make_unique<Site[]>(mask_ + 1)),
+      next_summary_ns_(now_ns() + std::chrono::nanoseconds(config.summary_interval).count())
+{
+}
+
+RateLimitPolicy::RateLimitPolicy(const Channel& channel) : RateLimitPolicy(channel, Config{})
+{
+}
+
+RateLimitPolicy::~RateLimitPolicy() = default;
+
+bool RateLimitPolicy::accepts(const LogEntry& entry) const
+{
+    if (t_emitting || entry.severity == Severity::Fatal)
+    {
+        return true;
+    }
+
+    Site* site = find_site(entry);
+    if (site == nullptr)
+    {
+        return true;
+    }
+
+    // GCRA: each entry pushes the theoretical arrival time one interval further, the site is over its rate when this
+    // time is more than a burst ahead of now
+    int64_t now = now_ns();
+    int64_t tat = site->tat.load(std::memory_order_relaxed);
+    while (true)
+    {
+        int64_t base = std::max(tat, now);
+        if (base - now > tolerance_ns_)
+        {
+            site->severity.store(entry.severity, std::memory_order_relaxed);
+            site->suppressed.fetch_add(1, std::memory_order_relaxed);
+            suppressed_total_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (site->tat.compare_exchange_weak(tat, base + interval_ns_, std::memory_order_relaxed))
+        {
+            return true;
+        }
+    }
+}
+
+bool RateLimitPolicy::transform_filter(LogEntry& entry) const
+{
+    if (t_emitting)
+    {
+        return true;
+    }
+
+    if (config_.summary_interval.count() > 0)
+    {
+        // Only one thread wins the exchange and reports
+        int64_t now = now_ns();
+        int64_t next = next_summary_ns_.load(std::memory_order_relaxed);
+        int64_t interval = std::chrono::nanoseconds(config_.summary_interval).count();
+        if (now >= next && next_summary_ns_.compare_exchange_strong(next, now + interval, std::memory_order_relaxed))
+        {
+            emit_summaries();
+        }
+    }
+
+    if (!config_.deduplicate || entry.severity == Severity::Fatal)
+    {
+        return true;
+    }
+
+    Site* site = find_site(entry);
+    if (site == nullptr)
+    {
+        return true;
+    }
+
+    uint64_t content = content_hash(entry);
+    if (site->last_content.exchange(content, std::memory_order_relaxed) == content)
+    {
+        site->severity.store(entry.severity, std::memory_order_relaxed);
+        site->repeats.fetch_add(1, std::memory_order_relaxed);
+        repeat_total_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // A different message, the repeats of the previous one are reported first
+    if (uint32_t count = site->repeats.exchange(0, std::memory_order_relaxed); count > 0)
+    {
+        submit_summary(*site, fmt::format("last message repeated {} times", count));
+    }
+    return true;
+}
+
+void RateLimitPolicy::emit_summaries() const
+{
+    for (size_t ii = 0; ii <= mask_; ++ii)
+    {
+        Site& site = sites_[ii];
+        // The location of a slot is stored right after it is claimed, skip it until then
+        if (site.file_name.load(std::memory_order_acquire) == nullptr)
+        {
+            continue;
+        }
+        if (uint32_t count = site.repeats.exchange(0, std::memory_order_relaxed); count > 0)
+        {
+            submit_summary(site, fmt::format("last message repeated {} times", count));
+        }
+        if (uint32_t count = site.suppressed.exchange(0, std::memory_order_relaxed); count > 0)
+        {
+            submit_summary(site, fmt::format("{} entries suppressed by rate limiting", count));
+        }
+    }
+}
+
+RateLimitPolicy::Site* RateLimitPolicy::find_site(const LogEntry& entry) const
+{
+    const auto& location = entry.source_location;
+    if (location.file_name == nullptr)
+    {
+        return nullptr;
+    }
+
+    // File names are string literals, their address identifies them
+    uint64_t hash = HCOMBINE_(hakz::rev_hash_64(reinterpret_cast<uintptr_t>(location.file_name)),
+                              uint64_t(uint32_t(location.line)));
+    uint64_t key = hash | 1;
+    size_t index = hash >> 32;
+
+    // Open addressing with linear probing, slots are never released
+    for (size_t probe = 0; probe < k_max_probes; ++probe)
+    {
+        Site& site = sites_[(index + probe) & mask_];
+        uint64_t current = site.key.load(std::memory_order_acquire);
+        if (current == 0 && site.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+        {
+            site.line.store(location.line, std::memory_order_relaxed);
+            site.function_name.store(location.function_name, std::memory_order_relaxed);
+            site.file_name.store(location.file_name, std::memory_order_release);
+            return &site;
+        }
+        if (current == key)
+        {
+            return &site;
+        }
+    }
+    return nullptr;
+}
+
+void RateLimitPolicy::submit_summary(const Site& site, std::string&& message) const
+{
+    LogEntry entry;
+    entry.severity = site.severity.load(std::memory_order_relaxed);
+    entry.source_location.line = site.line.load(std::memory_order_relaxed);
+    entry.source_location.file_name = site.file_name.load(std::memory_order_acquire);
+    entry.source_location.function_name = site.function_name.load(std::memory_order_relaxed);
+    entry.timestamp = TimeBase::timestamp();
+    entry.message = std::move(message);
+
+    t_emitting = true;
+    channel_.submit(std::move(entry));
+    t_emitting = false;
+}
+
+} // namespace kb::log
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "kibble/logger/policy.h"
+#include "kibble/logger/severity.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace kb::log
+{
+
+class Channel;
+
+/**
+ * @brief Limits the rate of log entries per call site, and collapses repeated messages
+ *
+ * Each call site (source file and line) has its own token bucket, implemented as a single atomic "theoretical arrival
+ * time" (GCRA): a site may log a burst of entries, then at most a fixed number of entries per second. The bucket is
+ * checked before the message is formatted (see Policy::accepts()), so a suppressed entry only costs a hash table
+ * lookup and a compare-and-swap. Everything is lock-free.
+ *
+ * An entry identical to the previous entry of the same call site is not dispatched, it is counted instead. The count
+ * is reported as a "last message repeated N times" entry as soon as the site logs a different message. Entries are
+ * compared by their message, or by their format string and serialized arguments in deferred formatting mode (see
+ * Channel::set_deferred_formatting()), so deferred entries are still compared before they are formatted.
+ *
+ * Suppressed entries and pending repeats are also reported periodically, by the first entry that goes through the
+ * policy once the summary interval has elapsed, or on demand with emit_summaries(). Summaries are submitted to the
+ * channel passed to the constructor, which should be the channel this policy is attached to.
+ *
+ * Fatal entries are never suppressed. Entries submitted directly with Channel::submit() instead of the klog() macros
+ * are only deduplicated. When the table of call sites is full, new sites are not rate limited.
+ *
+ */
+class RateLimitPolicy : public Policy
+{
+public:
+    struct Config
+    {
+        /// Sustained number of entries per second allowed for each call site
+        uint32_t rate = 10;
+        /// Number of entries a call site can log at once before the rate applies
+        uint32_t burst = 50;
+        /// Collapse identical consecutive messages of a call site
+        bool deduplicate = true;
+        /// Interval between two suppression summaries, 0 to disable periodic summaries
+        std::chrono::milliseconds summary_interval{5000};
+        /// Capacity of the call site table, rounded up to a power of 2
+        size_t max_sites = 1024;
+    };
+
+    /**
+     * @brief Construct a new rate limiting policy
+     *
+     * @param channel channel the summaries are submitted to
+     * @param config
+     */
+    RateLimitPolicy(const Channel& channel, const Config& config);
+    RateLimitPolicy(const Channel& channel);
+    ~RateLimitPolicy();
+
+    /**
+     * @brief Check the token bucket of the entry's call site
+     *
+     * @param entry entry without message
+     * @return false if the call site exceeded its rate
+     */
+    bool accepts(const struct LogEntry& entry) const override;
+
+    /**
+     * @brief Reject repeated messages, and submit the pending summaries when it is time
+     *
+     * @param entry
+     * @return false if the entry repeats the previous entry of its call site
+     */
+    bool transform_filter(struct LogEntry& entry) const override;
+
+    /// @brief Submit summaries for all call sites with suppressed entries or pending repeats
+    void emit_summaries() const;
+
+    // clang-format off
+    /// Number of entries rejected by the token buckets
+    inline size_t get_suppressed_count() const { return suppressed_total_.load(std::memory_order_relaxed); }
+    /// Number of entries collapsed as repeats
+    inline size_t get_repeat_count() const { return repeat_total_.load(std::memory_order_relaxed); }
+    // clang-format on
+
+private:
+    struct Site;
+
+    Site* find_site(const struct LogEntry& entry) const;
+    void submit_summary(const Site& site, std::string&& message) const;
+
+private:
+    const Channel& channel_;
+    Config config_;
+    int64_t interval_ns_;
+    int64_t tolerance_ns_;
+    size_t mask_;
+    std::unique_ptr<Site[]> sites_;
+    mutable std::atomic<int64_t> next_summary_ns_;
+    mutable std::atomic<size_t> suppressed_total_{0};
+    mutable std::atomic<size_t> repeat_total_{0};
+};
+
+} // namespace kb::log
@@ -10,7 +10,7 @@ UIDWhitelist::UIDWhitelist(ankerl::unordered_dense::set<hash_t> enabled) : enabl
 
 bool UIDWhitelist::transform_filter(LogEntry& entry) const
 {
-    return entry.uid_text.empty() || int8_t(entry.severity) <= 2 || contains(H_(entry.uid_text));
+    return entry.uid_text.empty() || int8_t(entry.severity) <= 2 || contains(entry.uid_hash);
 }
 
 UIDBlacklist::UIDBlacklist(ankerl::unordered_dense::set<hash_t> disabled) : disabled_(disabled)
@@ -19,7 +19,7 @@ UIDBlacklist::UIDBlacklist(ankerl::unordered_dense::set<hash_t> disabled) : disa
 
 bool UIDBlacklist::transform_filter(LogEntry& entry) const
 {
-    return entry.uid_text.empty() || int8_t(entry.severity) <= 2 || !contains(H_(entry.uid_text));
+    return entry.uid_text.empty() || int8_t(entry.severity) <= 2 || !contains(entry.uid_hash);
 }
 
 } // namespace kb::log
\ No newline at end of file
@@ -23,6 +23,22 @@ public:
      * @return false
      */
     virtual bool transform_filter(struct LogEntry& entry) const = 0;
+
+    /**
+     * @brief Override this to reject entries before their message is formatted
+     *
+     * Called by the klog() entry builder once the entry passed the channel's severity and UID checks, before the
+     * message is formatted. The entry has no message yet. Entries submitted directly to Channel::submit() skip this
+     * check. Keep it cheap, it runs on the calling thread for every entry.
+     *
+     * @param entry
+     * @return true if the entry can proceed
+     * @return false if the entry should be discarded
+     */
+    virtual bool accepts([[maybe_unused]] const struct LogEntry& entry) const
+    {
+        return true;
+    }
 };
 
 } // namespace kb::log
\ No newline at end of file
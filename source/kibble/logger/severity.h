@@ -2,6 +2,19 @@
 #include <cstdint>
 #include <string_view>
 
+/*
+    KB_LOG_MIN_SEVERITY is the least severe level that is compiled in, one of Fatal, Error, Warn, Info, Debug, Verbose.
+    Logging calls below this level are removed at compile time, see the klog_* macros in logger.h.
+    By default, Debug and Verbose entries are only compiled in debug builds.
+*/
+#ifndef KB_LOG_MIN_SEVERITY
+#ifdef K_DEBUG
+#define KB_LOG_MIN_SEVERITY Verbose
+#else
+#define KB_LOG_MIN_SEVERITY Info
+#endif
+#endif
+
 namespace kb::log
 {
 
@@ -15,6 +28,15 @@ enum class Severity : int8_t
     Verbose
 };
 
+/// Least severe level compiled in, see KB_LOG_MIN_SEVERITY
+constexpr Severity k_min_severity = Severity::KB_LOG_MIN_SEVERITY;
+
+/// @brief Check if log entries of a given severity are compiled in
+constexpr bool is_compiled(Severity severity)
+{
+    return severity <= k_min_severity;
+}
+
 constexpr std::string_view to_str(Severity severity)
 {
     // clang-format off
@@ -0,0 +1,73 @@
+#include "kibble/logger/sinks/binary_file_sink.h"
+#include "kibble/logger/channel.h"
+#include "kibble/logger/entry.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace kb::log
+{
+
+BinaryFileSink::BinaryFileSink(const fs::path& directory, const std::string& base_name, uint64_t segment_size)
+    : directory_(directory), base_name_(base_name), segment_size_(segment_size)
+{
+    fs::create_directories(directory_);
+    for (const auto& path : binlog::list_segments(directory_))
+    {
+        // "base_name.NNNNNN.klog"
+        auto index = path.stem().extension().string();
+        if (path.stem().stem() == base_name_ && index.size() > 1)
+        {
+            segment_ = std::max(segment_, uint32_t(std::strtoul(index.c_str() + 1, nullptr, 10)) + 1);
+        }
+    }
+    open_segment();
+}
+
+BinaryFileSink::~BinaryFileSink()
+{
+    close_segment();
+}
+
+void BinaryFileSink::submit(const LogEntry& e, const ChannelPresentation& p)
+{
+    binlog::EntryHeader header;
+    header.timestamp_ns = e.timestamp.count();
+    header.channel = H_(p.full_name);
+    header.uid = e.uid_hash;
+    header.thread_id = e.thread_id;
+    header.location = 0;
+    header.severity = e.severity;
+    header.flags = e.raw_text ? binlog::k_raw_text : 0;
+
+    std::scoped_lock lock(mutex_);
+    writer_->write_entry(header, e.source_location.line, e.source_location.file_name,
+                         e.source_location.function_name, e.uid_text, p.full_name, p.tag, p.color.value, e.message);
+
+    if (writer_->get_size() >= segment_size_)
+    {
+        close_segment();
+        ++segment_;
+        open_segment();
+    }
+}
+
+void BinaryFileSink::flush() const
+{
+    out_.flush();
+}
+
+void BinaryFileSink::open_segment()
+{
+    out_.open(binlog::segment_path(directory_, base_name_, segment_), std::ios::binary | std::ios::trunc);
+    writer_ = std::make_unique<binlog::SegmentWriter>(out_, segment_);
+}
+
+void BinaryFileSink::close_segment()
+{
+    writer_->close();
+    writer_.reset();
+    out_.close();
+}
+
+} // namespace kb::log
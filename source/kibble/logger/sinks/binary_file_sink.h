@@ -0,0 +1,72 @@
+#pragma once
+
+#include "kibble/logger/binary_log.h"
+#include "kibble/logger/sink.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace kb::log
+{
+
+/**
+ * @brief Write log entries as structured binary records, in segmented files.
+ *
+ * Entries are not formatted: the timestamp, thread, channel, severity, UID, source location and message are stored
+ * as is (see binlog for the file format), which is much faster to write and to filter than text. Segments are
+ * rotated when they exceed a given size. The klogq utility can filter segments and render them with any Formatter.
+ *
+ * Stack traces are not recorded.
+ *
+ */
+class BinaryFileSink : public Sink
+{
+public:
+    /// Default segment size above which a new segment is started
+    static constexpr uint64_t k_default_segment_size = 64ull * 1024ull * 1024ull;
+
+    /**
+     * @brief Construct a new binary file sink.
+     * Segments are named "base_name.NNNNNN.klog". If the directory already contains segments with this base name,
+     * numbering continues after the last one.
+     *
+     * @param directory output directory, created if it does not exist
+     * @param base_name base name of the segment files
+     * @param segment_size segment size above which a new segment is started
+     */
+    BinaryFileSink(const fs::path& directory, const std::string& base_name,
+                   uint64_t segment_size = k_default_segment_size);
+
+    ~BinaryFileSink();
+
+    void submit(const struct LogEntry&, const struct ChannelPresentation&) override;
+
+    void flush() const override;
+
+    /// @brief Index of the segment being written
+    inline uint32_t get_segment() const
+    {
+        return segment_;
+    }
+
+private:
+    void open_segment();
+    void close_segment();
+
+private:
+    fs::path directory_;
+    std::string base_name_;
+    uint64_t segment_size_;
+    uint32_t segment_ = 0;
+    mutable std::ofstream out_;
+    std::unique_ptr<binlog::SegmentWriter> writer_;
+    // A single sink is usually shared by multiple channels
+    std::mutex mutex_;
+};
+
+} // namespace kb::log
@@ -1,35 +1,310 @@
 #include "kibble/logger/sinks/net_sink.h"
+#include "kibble/logger/entry.h"
 #include "kibble/logger/formatter.h"
 #include "kibble/net/tcp_connector.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/uio.h>
+
 namespace kb::log
 {
+
+namespace
+{
+// Maximum time the I/O thread waits for a full socket buffer to drain, before checking for shutdown again
+constexpr int k_poll_timeout_ms = 100;
+} // namespace
+
+NetSink::NetSink() : NetSink(Config{})
+{
+}
+
+NetSink::NetSink(const Config& config) : config_(config), ring_(std::max(config.buffer_size, size_t(1)))
+{
+}
+
 NetSink::~NetSink()
 {
-    if (stream_)
+    if (on_destroy_)
     {
         // Notify server before closing connection
-        on_destroy_(*stream_);
-        delete stream_;
+        auto message = on_destroy_();
+        std::scoped_lock lock(mutex_);
+        enqueue(message.data(), message.size());
     }
+
+    if (io_thread_.joinable())
+    {
+        shutdown_deadline_ = std::chrono::steady_clock::now() + config_.flush_timeout;
+        {
+            std::scoped_lock lock(mutex_);
+            stop_.store(true, std::memory_order_release);
+        }
+        cv_.notify_all();
+        io_thread_.join();
+    }
+
+    // Whatever could not be sent is lost
+    dropped_bytes_.fetch_add(head_ - tail_, std::memory_order_relaxed);
 }
 
 void NetSink::submit(const LogEntry& e, const ChannelPresentation& p)
 {
-    stream_->send(formatter_->format_string(e, p));
+    std::scoped_lock lock(mutex_);
+    line_.clear();
+    if (formatter_)
+    {
+        formatter_->format_to(line_, e, p);
+    }
+    else
+    {
+        line_ += e.message;
+        line_ += '\n';
+    }
+
+    if (enqueue(line_.data(), line_.size()) && head_ - tail_ >= config_.batch_size)
+    {
+        cv_.notify_one();
+    }
+}
+
+void NetSink::flush() const
+{
+    std::unique_lock lock(mutex_);
+    if (!io_thread_.joinable())
+    {
+        return;
+    }
+
+    uint64_t target = head_;
+    flush_requested_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait_for(lock, config_.flush_timeout,
+                         [this, target]() { return tail_ >= target || !connected_.load(std::memory_order_acquire); });
+    flush_requested_ = false;
 }
 
 void NetSink::on_attach(const Channel& chan)
 {
-    on_attach_(*stream_, chan);
+    if (!on_attach_)
+    {
+        return;
+    }
+
+    auto message = on_attach_(chan);
+    {
+        std::scoped_lock lock(mutex_);
+        handshake_.push_back(std::move(message));
+    }
+    cv_.notify_one();
 }
 
 bool NetSink::connect(const std::string& server, uint16_t port)
 {
+    if (io_thread_.joinable())
+    {
+        return is_connected();
+    }
+
     port_ = port;
     server_ = server;
-    stream_ = net::TCPConnector::connect(server_, port_);
-    return (stream_ != nullptr);
+    stream_.reset(net::TCPConnector::connect(server_, port_, int(config_.connect_timeout.count())));
+    bool success = (stream_ != nullptr);
+    if (success)
+    {
+        connection_count_.fetch_add(1, std::memory_order_relaxed);
+        connected_.store(true, std::memory_order_release);
+    }
+
+    io_thread_ = std::thread(&NetSink::io_loop, this);
+    return success;
+}
+
+bool NetSink::enqueue(const char* data, size_t size)
+{
+    // Entries are never truncated, an entry that does not fit is dropped as a whole
+    if (size > ring_.size() - (head_ - tail_))
+    {
+        dropped_bytes_.fetch_add(size, std::memory_order_relaxed);
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t begin = head_ % ring_.size();
+    size_t first = std::min(size, ring_.size() - begin);
+    std::memcpy(ring_.data() + begin, data, first);
+    std::memcpy(ring_.data(), data + first, size - first);
+    head_ += size;
+    queued_bytes_.store(head_ - tail_, std::memory_order_relaxed);
+    return true;
+}
+
+void NetSink::io_loop()
+{
+    auto backoff = config_.min_backoff;
+    while (true)
+    {
+        if (stream_ == nullptr)
+        {
+            if (stop_.load(std::memory_order_acquire))
+            {
+                return;
+            }
+
+            stream_.reset(net::TCPConnector::connect(server_, port_, int(config_.connect_timeout.count())));
+            if (stream_ == nullptr)
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait_for(lock, backoff, [this]() { return stop_.load(std::memory_order_relaxed); });
+                backoff = std::min(backoff * 2, config_.max_backoff);
+                continue;
+            }
+
+            backoff = config_.min_backoff;
+            connection_count_.fetch_add(1, std::memory_order_relaxed);
+            connected_.store(true, std::memory_order_release);
+            std::scoped_lock lock(mutex_);
+            handshake_sent_ = 0;
+        }
+
+        uint64_t head = 0;
+        uint64_t tail = 0;
+        bool stopping = false;
+        {
+            // Sleep until a batch is ready, or the flush interval elapses
+            std::unique_lock lock(mutex_);
+            cv_.wait_for(lock, config_.flush_interval, [this]() {
+                return stop_.load(std::memory_order_relaxed) || flush_requested_ ||
+                       head_ - tail_ >= config_.batch_size || handshake_sent_ < handshake_.size();
+            });
+            head = head_;
+            tail = tail_;
+            stopping = stop_.load(std::memory_order_relaxed);
+        }
+
+        // Handshake messages go first, on a new connection or when a channel was attached during the wait
+        if (!send_handshake() || (head > tail && !send_range(tail, head)))
+        {
+            disconnect();
+            continue;
+        }
+
+        if (stopping)
+        {
+            std::scoped_lock lock(mutex_);
+            if (head_ == tail_)
+            {
+                return;
+            }
+        }
+    }
+}
+
+bool NetSink::send_handshake()
+{
+    while (true)
+    {
+        std::string message;
+        {
+            std::scoped_lock lock(mutex_);
+            if (handshake_sent_ == handshake_.size())
+            {
+                return true;
+            }
+            message = handshake_[handshake_sent_];
+        }
+
+        if (!send_all(message.data(), message.size()))
+        {
+            return false;
+        }
+
+        std::scoped_lock lock(mutex_);
+        ++handshake_sent_;
+    }
+}
+
+bool NetSink::send_range(uint64_t tail, uint64_t head)
+{
+    size_t capacity = ring_.size();
+    while (tail < head)
+    {
+        // The queued data may wrap around the end of the ring, send both parts at once
+        size_t begin = tail % capacity;
+        size_t count = head - tail;
+        size_t first = std::min(count, capacity - begin);
+        iovec buffers[2] = {{ring_.data() + begin, first}, {ring_.data(), count - first}};
+
+        ssize_t sent = stream_->send_nonblocking(buffers, (count > first) ? 2 : 1);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN && !shutdown_expired())
+            {
+                stream_->wait_writable(k_poll_timeout_ms);
+                continue;
+            }
+            return false;
+        }
+
+        tail += uint64_t(sent);
+        sent_bytes_.fetch_add(size_t(sent), std::memory_order_relaxed);
+        {
+            std::scoped_lock lock(mutex_);
+            tail_ = tail;
+            queued_bytes_.store(head_ - tail_, std::memory_order_relaxed);
+        }
+        flushed_cv_.notify_all();
+    }
+    return true;
+}
+
+bool NetSink::send_all(const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        iovec buffer{const_cast<char*>(data), size};
+        ssize_t sent = stream_->send_nonblocking(&buffer, 1);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN && !shutdown_expired())
+            {
+                stream_->wait_writable(k_poll_timeout_ms);
+                continue;
+            }
+            return false;
+        }
+
+        data += sent;
+        size -= size_t(sent);
+        sent_bytes_.fetch_add(size_t(sent), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool NetSink::shutdown_expired() const
+{
+    return stop_.load(std::memory_order_acquire) && std::chrono::steady_clock::now() >= shutdown_deadline_;
+}
+
+void NetSink::disconnect()
+{
+    stream_.reset();
+    connected_.store(false, std::memory_order_release);
+    {
+        // Wake up flush() callers, the data will not be sent before a reconnection
+        std::scoped_lock lock(mutex_);
+    }
+    flushed_cv_.notify_all();
 }
 
-} // namespace kb::log
\ No newline at end of file
+} // namespace kb::log
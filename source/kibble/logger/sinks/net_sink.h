@@ -3,8 +3,15 @@
 #include "kibble/logger/sink.h"
 #include "kibble/net/tcp_stream.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace kb::log
 {
@@ -12,27 +19,59 @@ namespace kb::log
 /**
  * @brief Direct all input log entries to a TCP socket
  *
- * The formatter will decide how exactly the logs are structured
+ * The formatter will decide how exactly the logs are structured.
+ *
+ * Submitting an entry only formats it into a bounded ring buffer, it never touches the socket. A dedicated I/O thread
+ * sends the buffered data in large batches, with non-blocking sends and poll(), so a slow collector cannot stall the
+ * logging threads. When the buffer is full, new entries are dropped (entries are never truncated). If the connection
+ * is lost, the I/O thread reconnects with an exponential backoff, and the buffered entries are sent to the new
+ * connection. An entry that was being sent when the connection dropped may arrive truncated.
  *
  */
 class NetSink : public Sink
 {
 public:
-    using AttachCallback = std::function<void(net::TCPStream&, const Channel&)>;
-    using DestroyCallback = std::function<void(net::TCPStream&)>;
+    /// Produces data to send to the server when a channel is attached. It is sent again after each reconnection.
+    using AttachCallback = std::function<std::string(const Channel&)>;
+    /// Produces data to send to the server when the sink is destroyed
+    using DestroyCallback = std::function<std::string()>;
+
+    struct Config
+    {
+        /// Capacity of the ring buffer, in bytes
+        size_t buffer_size = 1024 * 1024;
+        /// The I/O thread is woken up when this many bytes are queued
+        size_t batch_size = 64 * 1024;
+        /// Queued data is sent at least this often
+        std::chrono::milliseconds flush_interval{50};
+        std::chrono::milliseconds connect_timeout{1000};
+        /// Delay before the first reconnection attempt, doubled after each failure up to max_backoff
+        std::chrono::milliseconds min_backoff{100};
+        std::chrono::milliseconds max_backoff{5000};
+        /// Maximum time flush() and the destructor wait for the queued data to be sent
+        std::chrono::milliseconds flush_timeout{1000};
+    };
 
+    NetSink();
+    NetSink(const Config& config);
+
+    /// @brief Send what remains in the buffer (within the flush timeout), then disconnect
     ~NetSink();
 
     void submit(const LogEntry&, const ChannelPresentation&) override;
 
+    /// @brief Wait until the queued data is sent, the connection is lost, or the flush timeout expires
+    void flush() const override;
+
     void on_attach(const Channel&) override;
 
     /**
-     * @brief Connect to a remote machine.
+     * @brief Connect to a remote machine, and start the I/O thread.
+     * If the first connection attempt fails, the I/O thread keeps trying in the background.
      *
      * @param server IP address of the server
      * @param port TCP port to use
-     * @return true if the connection was successful
+     * @return true if the first connection attempt was successful
      * @return false otherwise
      */
     bool connect(const std::string& server, uint16_t port);
@@ -57,12 +96,63 @@ public:
         on_destroy_ = v;
     }
 
+    // clang-format off
+    /// Number of bytes waiting to be sent
+    inline size_t get_queued_bytes() const { return queued_bytes_.load(std::memory_order_relaxed); }
+    /// Number of bytes dropped because the buffer was full, or still queued when the sink was destroyed
+    inline size_t get_dropped_bytes() const { return dropped_bytes_.load(std::memory_order_relaxed); }
+    /// Number of entries dropped because the buffer was full
+    inline size_t get_dropped_count() const { return dropped_count_.load(std::memory_order_relaxed); }
+    /// Number of bytes sent to the server
+    inline size_t get_sent_bytes() const { return sent_bytes_.load(std::memory_order_relaxed); }
+    /// Number of successful connections, including reconnections
+    inline size_t get_connection_count() const { return connection_count_.load(std::memory_order_relaxed); }
+    inline bool is_connected() const { return connected_.load(std::memory_order_acquire); }
+    // clang-format on
+
 private:
-    uint16_t port_;
+    bool enqueue(const char* data, size_t size);
+    void io_loop();
+    bool send_handshake();
+    bool send_range(uint64_t tail, uint64_t head);
+    bool send_all(const char* data, size_t size);
+    bool shutdown_expired() const;
+    void disconnect();
+
+private:
+    Config config_;
+    uint16_t port_ = 0;
     std::string server_;
-    net::TCPStream* stream_ = nullptr;
-    AttachCallback on_attach_ = [](net::TCPStream&, const Channel&) {};
-    DestroyCallback on_destroy_ = [](net::TCPStream&) {};
+    AttachCallback on_attach_ = nullptr;
+    DestroyCallback on_destroy_ = nullptr;
+
+    // Ring buffer. Producers write in [head, tail + size) under the mutex, the I/O thread sends [tail, head) without
+    // holding it. Positions grow monotonically, the index in the buffer is position % size.
+    std::vector<char> ring_;
+    uint64_t head_ = 0;
+    uint64_t tail_ = 0;
+    std::string line_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable cv_;
+    mutable std::condition_variable flushed_cv_;
+    mutable bool flush_requested_ = false;
+
+    // Handshake messages from the attach callback, and how many were sent on the current connection
+    std::vector<std::string> handshake_;
+    size_t handshake_sent_ = 0;
+
+    // Only accessed by the I/O thread, or before it is started
+    std::unique_ptr<net::TCPStream> stream_;
+    std::thread io_thread_;
+    std::atomic<bool> stop_{false};
+    std::chrono::steady_clock::time_point shutdown_deadline_;
+
+    std::atomic<bool> connected_{false};
+    std::atomic<size_t> queued_bytes_{0};
+    std::atomic<size_t> dropped_bytes_{0};
+    std::atomic<size_t> dropped_count_{0};
+    std::atomic<size_t> sent_bytes_{0};
+    std::atomic<size_t> connection_count_{0};
 };
 
-} // namespace kb::log
\ No newline at end of file
+} // namespace kb::log
@@ -0,0 +1,425 @@
+#include "kibble/logger/sinks/rotating_file_sink.h"
+#include "kibble/logger/channel.h"
+#include "kibble/logger/entry.h"
+#include "kibble/logger/severity.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef KB_LOG_ZSTD
+#include <zstd.h>
+#endif
+
+namespace kb::log
+{
+
+namespace
+{
+
+bool compress_zstd([[maybe_unused]] const fs::path& source, [[maybe_unused]] const fs::path& destination,
+                   [[maybe_unused]] int level)
+{
+#ifdef KB_LOG_ZSTD
+    std::ifstream ifs(source, std::ios::binary);
+    std::ofstream ofs(destination, std::ios::binary);
+    if (!ifs || !ofs)
+    {
+        return false;
+    }
+
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+    std::vector<char> in(ZSTD_CStreamInSize());
+    std::vector<char> out(ZSTD_CStreamOutSize());
+
+    bool success = true;
+    bool last = false;
+    while (success && !last)
+    {
+        ifs.read(in.data(), std::streamsize(in.size()));
+        auto read = size_t(ifs.gcount());
+        last = read < in.size();
+        ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+        ZSTD_inBuffer input{in.data(), read, 0};
+
+        // In end mode, the frame is complete when nothing remains to be flushed. Otherwise, all the input must be
+        // consumed before reading more.
+        bool finished = false;
+        while (!finished)
+        {
+            ZSTD_outBuffer output{out.data(), out.size(), 0};
+            size_t remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+            if (ZSTD_isError(remaining))
+            {
+                success = false;
+                break;
+            }
+            ofs.write(out.data(), std::streamsize(output.pos));
+            finished = last ? (remaining == 0) : (input.pos == input.size);
+        }
+    }
+
+    ZSTD_freeCCtx(cctx);
+    return success && bool(ofs);
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+RotatingFileSink::RotatingFileSink(const fs::path& directory, const std::string& base_name, const Config& config)
+    : directory_(directory), base_name_(base_name), config_(config)
+{
+    config_.buffer_size = std::max(config_.buffer_size, size_t(1));
+    config_.buffer_count = std::min(std::max(config_.buffer_count, size_t(1)), size_t(IOV_MAX));
+    storage_.resize(config_.buffer_size * config_.buffer_count);
+    fill_.resize(config_.buffer_count, 0);
+
+    fs::create_directories(directory_);
+    for (const auto& file : fs::directory_iterator(directory_))
+    {
+        // "base_name.NNNNNN.log", possibly followed by a compression extension
+        auto stem = file.path().filename().string();
+        size_t prefix_size = base_name_.size() + 1;
+        if (stem.size() > prefix_size && stem.starts_with(base_name_ + ".") &&
+            std::isdigit(static_cast<unsigned char>(stem[prefix_size])))
+        {
+            auto index = std::strtoul(stem.c_str() + prefix_size, nullptr, 10);
+            file_index_ = std::max(file_index_, uint32_t(index) + 1);
+        }
+    }
+
+    if (config_.compression != Compression::None && is_supported(config_.compression))
+    {
+        compression_thread_ = std::thread(&RotatingFileSink::compression_loop, this);
+    }
+
+    open_file();
+    timer_thread_ = std::thread(&RotatingFileSink::timer_loop, this);
+}
+
+RotatingFileSink::RotatingFileSink(const fs::path& directory, const std::string& base_name)
+    : RotatingFileSink(directory, base_name, Config{})
+{
+}
+
+RotatingFileSink::~RotatingFileSink()
+{
+    {
+        std::scoped_lock lock(mutex_);
+        timer_stop_ = true;
+    }
+    timer_cv_.notify_one();
+    timer_thread_.join();
+
+    {
+        std::scoped_lock lock(mutex_);
+        close_file();
+    }
+
+    if (compression_thread_.joinable())
+    {
+        {
+            std::scoped_lock lock(compression_mutex_);
+            stop_ = true;
+        }
+        compression_cv_.notify_one();
+        compression_thread_.join();
+    }
+}
+
+void RotatingFileSink::submit(const LogEntry& e, const ChannelPresentation& p)
+{
+    std::scoped_lock lock(mutex_);
+
+    // Same layout as FileSink
+    line_.clear();
+    float ts = std::chrono::duration_cast<std::chrono::duration<float>>(e.timestamp).count();
+    fmt::format_to(std::back_inserter(line_), fmt::runtime("T{}:{:6.6f} [{}] [{}] {}\n"), e.thread_id, ts,
+                   p.full_name, to_str(e.severity), e.message);
+    if (uint8_t(e.severity) <= 2)
+    {
+        fmt::format_to(std::back_inserter(line_), "@ {}\n{}:{}\n", e.source_location.function_name,
+                       e.source_location.file_name, e.source_location.line);
+    }
+    if (e.stack_trace.has_value())
+    {
+        fmt::format_to(std::back_inserter(line_), "{}", e.stack_trace->format());
+    }
+
+    auto now = Clock::now();
+    uint64_t pending = 0;
+    for (size_t ii = 0; ii <= current_buffer_; ++ii)
+    {
+        pending += fill_[ii];
+    }
+    bool too_large = config_.max_file_size > 0 && file_size_ + pending > 0 &&
+                     file_size_ + pending + line_.size() > config_.max_file_size;
+    bool too_old = config_.max_file_age.count() > 0 && now - file_opened_ >= config_.max_file_age;
+    if (too_large || too_old)
+    {
+        close_file();
+        ++file_index_;
+        open_file();
+    }
+
+    append(line_.data(), line_.size());
+    bytes_written_.fetch_add(line_.size(), std::memory_order_relaxed);
+
+    if (config_.durability == Durability::OnError && e.severity <= Severity::Error)
+    {
+        write_buffers();
+        sync(true);
+    }
+    else if (now - last_flush_ >= config_.flush_interval)
+    {
+        write_buffers();
+    }
+
+    if (config_.durability == Durability::Periodic && now - last_sync_ >= config_.sync_interval)
+    {
+        write_buffers();
+        sync(false);
+    }
+}
+
+void RotatingFileSink::flush() const
+{
+    std::scoped_lock lock(mutex_);
+    write_buffers();
+}
+
+void RotatingFileSink::rotate()
+{
+    std::scoped_lock lock(mutex_);
+    close_file();
+    ++file_index_;
+    open_file();
+}
+
+bool RotatingFileSink::is_supported(Compression compression)
+{
+    switch (compression)
+    {
+    case Compression::None:
+        return true;
+    case Compression::Zstd:
+#ifdef KB_LOG_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+fs::path RotatingFileSink::file_path(uint32_t index) const
+{
+    return directory_ / fmt::format("{}.{:06}.log", base_name_, index);
+}
+
+void RotatingFileSink::open_file()
+{
+    fd_ = ::open(file_path(file_index_).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+    {
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    file_size_ = 0;
+    file_opened_ = Clock::now();
+    last_flush_ = file_opened_;
+    last_sync_ = file_opened_;
+}
+
+void RotatingFileSink::close_file()
+{
+    write_buffers();
+    if (fd_ < 0)
+    {
+        return;
+    }
+    if (config_.durability != Durability::None)
+    {
+        sync(true);
+    }
+    ::close(fd_);
+    fd_ = -1;
+
+    if (compression_thread_.joinable())
+    {
+        {
+            std::scoped_lock lock(compression_mutex_);
+            compression_queue_.push_back(file_path(file_index_));
+        }
+        compression_cv_.notify_one();
+    }
+}
+
+void RotatingFileSink::append(const char* data, size_t size) const
+{
+    // Entries larger than a buffer are split across consecutive buffers, writev() puts them back together
+    while (size > 0)
+    {
+        size_t available = config_.buffer_size - fill_[current_buffer_];
+        if (available == 0)
+        {
+            if (current_buffer_ + 1 == config_.buffer_count)
+            {
+                write_buffers();
+            }
+            else
+            {
+                ++current_buffer_;
+            }
+            continue;
+        }
+
+        size_t count = std::min(available, size);
+        std::copy_n(data, count, storage_.data() + current_buffer_ * config_.buffer_size + fill_[current_buffer_]);
+        fill_[current_buffer_] += count;
+        data += count;
+        size -= count;
+    }
+}
+
+void RotatingFileSink::write_buffers() const
+{
+    last_flush_ = Clock::now();
+
+    std::vector<iovec> iov;
+    iov.reserve(current_buffer_ + 1);
+    for (size_t ii = 0; ii <= current_buffer_; ++ii)
+    {
+        if (fill_[ii] > 0)
+        {
+            iov.push_back({storage_.data() + ii * config_.buffer_size, fill_[ii]});
+        }
+        fill_[ii] = 0;
+    }
+    current_buffer_ = 0;
+
+    if (iov.empty() || fd_ < 0)
+    {
+        return;
+    }
+
+    // writev() may write less than requested, resume where it stopped
+    size_t first = 0;
+    while (first < iov.size())
+    {
+        ssize_t written = ::writev(fd_, iov.data() + first, int(iov.size() - first));
+        write_calls_.fetch_add(1, std::memory_order_relaxed);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto remaining = size_t(written);
+        file_size_ += remaining;
+        unsynced_ = true;
+        while (first < iov.size() && remaining >= iov[first].iov_len)
+        {
+            remaining -= iov[first].iov_len;
+            ++first;
+        }
+        if (first < iov.size())
+        {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+    }
+}
+
+void RotatingFileSink::sync(bool full) const
+{
+    last_sync_ = Clock::now();
+    unsynced_ = false;
+    if (fd_ < 0)
+    {
+        return;
+    }
+    if ((full ? ::fsync(fd_) : ::fdatasync(fd_)) != 0)
+    {
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void RotatingFileSink::timer_loop()
+{
+    auto period = config_.flush_interval;
+    if (config_.durability == Durability::Periodic)
+    {
+        period = std::min(period, config_.sync_interval);
+    }
+    period = std::max(period, std::chrono::milliseconds(1));
+
+    std::unique_lock lock(mutex_);
+    while (!timer_stop_)
+    {
+        timer_cv_.wait_for(lock, period, [this]() { return timer_stop_; });
+        if (timer_stop_)
+        {
+            return;
+        }
+
+        // submit() already handles these when entries keep arriving, this only catches an idle sink
+        auto now = Clock::now();
+        if (now - last_flush_ >= config_.flush_interval)
+        {
+            write_buffers();
+        }
+        if (config_.durability == Durability::Periodic && unsynced_ && now - last_sync_ >= config_.sync_interval)
+        {
+            write_buffers();
+            sync(false);
+        }
+    }
+}
+
+void RotatingFileSink::compression_loop()
+{
+    while (true)
+    {
+        fs::path path;
+        {
+            std::unique_lock lock(compression_mutex_);
+            compression_cv_.wait(lock, [this]() { return stop_ || !compression_queue_.empty(); });
+            // Pending files are compressed before stopping
+            if (compression_queue_.empty())
+            {
+                return;
+            }
+            path = std::move(compression_queue_.front());
+            compression_queue_.pop_front();
+        }
+
+        auto compressed = path;
+        compressed += ".zst";
+        if (compress_zstd(path, compressed, config_.compression_level))
+        {
+            std::error_code ec;
+            fs::remove(path, ec);
+        }
+        else
+        {
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+            std::error_code ec;
+            fs::remove(compressed, ec);
+        }
+    }
+}
+
+} // namespace kb::log
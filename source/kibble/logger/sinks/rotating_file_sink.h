@@ -0,0 +1,166 @@
+#pragma once
+
+#include "kibble/logger/sink.h"
+
+#include "fmt/format.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace kb::log
+{
+
+/**
+ * @brief When a RotatingFileSink forces its data to the storage device
+ *
+ */
+enum class Durability : uint8_t
+{
+    /// Leave it to the OS
+    None,
+    /// fdatasync() at a fixed interval, see RotatingFileSink::Config::sync_interval
+    Periodic,
+    /// Write and fsync() as soon as an entry of severity Error or Fatal is submitted
+    OnError
+};
+
+/**
+ * @brief How closed log files are compressed by a RotatingFileSink
+ *
+ */
+enum class Compression : uint8_t
+{
+    None,
+    /// Requires kibble to be built with zstd support (KB_LOG_ZSTD CMake option), otherwise files are left as is
+    Zstd
+};
+
+/**
+ * @brief Production file sink: batched writes, rotation and compression of closed files.
+ *
+ * Entries are formatted with the same layout as FileSink into a set of large buffers. When all the buffers are full,
+ * or when the flush interval has elapsed, they are written with a single writev() call, on the thread that submits
+ * the entries (the AsyncBackend thread, if one is used). A timer thread enforces the flush interval and the periodic
+ * sync when no entries are submitted, so an idle sink does not keep data in memory. Files are named
+ * "base_name.NNNNNN.log" and rotated when they exceed a maximum size or age. Closed files can be compressed on a
+ * background thread.
+ *
+ * Write errors do not interrupt the application, they are counted (see get_write_error_count()).
+ *
+ */
+class RotatingFileSink : public Sink
+{
+public:
+    struct Config
+    {
+        /// Size of each batching buffer
+        size_t buffer_size = 256 * 1024;
+        /// Number of batching buffers, all of them are written at once
+        size_t buffer_count = 4;
+        /// Buffers are written at least this often, even when no entries are submitted
+        std::chrono::milliseconds flush_interval{200};
+        /// Size above which a new file is started, 0 to disable
+        uint64_t max_file_size = 64ull * 1024ull * 1024ull;
+        /// Age above which a new file is started, 0 to disable
+        std::chrono::seconds max_file_age{0};
+        Durability durability = Durability::None;
+        /// Interval between two fdatasync() calls, for Durability::Periodic
+        std::chrono::milliseconds sync_interval{1000};
+        Compression compression = Compression::None;
+        int compression_level = 3;
+    };
+
+    /**
+     * @brief Construct a new rotating file sink.
+     * If the directory already contains files with this base name, numbering continues after the last one.
+     *
+     * @param directory output directory, created if it does not exist
+     * @param base_name base name of the log files
+     * @param config
+     */
+    RotatingFileSink(const fs::path& directory, const std::string& base_name, const Config& config);
+    RotatingFileSink(const fs::path& directory, const std::string& base_name);
+
+    /// @brief Write the remaining entries, close the file and wait for all pending compressions
+    ~RotatingFileSink();
+
+    void submit(const struct LogEntry&, const struct ChannelPresentation&) override;
+
+    /// @brief Write the buffered entries to the file
+    void flush() const override;
+
+    /// @brief Close the current file and start a new one
+    void rotate();
+
+    /// @brief Check if a compression format is available in this build
+    static bool is_supported(Compression compression);
+
+    // clang-format off
+    /// Path of the file being written
+    inline fs::path get_current_path() const { return file_path(file_index_); }
+    /// Total number of bytes submitted
+    inline uint64_t get_bytes_written() const { return bytes_written_.load(std::memory_order_relaxed); }
+    /// Number of failed open / write / sync / compression operations
+    inline size_t get_write_error_count() const { return write_errors_.load(std::memory_order_relaxed); }
+    /// Number of writev() calls
+    inline size_t get_write_count() const { return write_calls_.load(std::memory_order_relaxed); }
+    // clang-format on
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    fs::path file_path(uint32_t index) const;
+    void open_file();
+    void close_file();
+    void append(const char* data, size_t size) const;
+    void write_buffers() const;
+    void sync(bool full) const;
+    void timer_loop();
+    void compression_loop();
+
+private:
+    fs::path directory_;
+    std::string base_name_;
+    Config config_;
+
+    uint32_t file_index_ = 0;
+    int fd_ = -1;
+    mutable uint64_t file_size_ = 0;
+    Clock::time_point file_opened_;
+
+    // Batching, mutable because flush() is const
+    mutable std::mutex mutex_;
+    mutable std::vector<char> storage_;
+    mutable std::vector<size_t> fill_;
+    mutable size_t current_buffer_ = 0;
+    mutable Clock::time_point last_flush_;
+    mutable Clock::time_point last_sync_;
+    mutable bool unsynced_ = false;
+    fmt::memory_buffer line_;
+
+    // Flushes and syncs an idle sink, woken up for the destruction
+    std::thread timer_thread_;
+    std::condition_variable timer_cv_;
+    bool timer_stop_ = false;
+
+    std::atomic<uint64_t> bytes_written_{0};
+    mutable std::atomic<size_t> write_errors_{0};
+    mutable std::atomic<size_t> write_calls_{0};
+
+    // Background compression of closed files
+    std::thread compression_thread_;
+    std::mutex compression_mutex_;
+    std::condition_variable compression_cv_;
+    std::deque<fs::path> compression_queue_;
+    bool stop_ = false;
+};
+
+} // namespace kb::log
@@ -115,6 +115,8 @@ public:
     inline size_t total_size() const{ return static_cast<size_t>(end() - begin()); }
     /// @brief Get used size in bytes
     inline size_t used_size() const{ return head_; }
+    /// @brief Get the size of the largest chunk that could be allocated, in bytes
+    inline size_t largest_free_block() const{ return total_size() - head_; }
     // clang-format on
 
 private:
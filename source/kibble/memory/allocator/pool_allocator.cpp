@@ -11,8 +11,10 @@ namespace kb
 namespace memory
 {
 
-PoolAllocator::PoolAllocator(const MemoryArenaBase* arena, HeapArea& area, uint32_t decoration_size,
-                             std::size_t max_nodes, std::size_t user_size, std::size_t max_alignment)
+template <typename FreeListT>
+BasicPoolAllocator<FreeListT>::BasicPoolAllocator(const MemoryArenaBase* arena, HeapArea& area,
+                                                  uint32_t decoration_size, std::size_t max_nodes,
+                                                  std::size_t user_size, std::size_t max_alignment)
 {
     node_size_ = math::round_up_pow2(int32_t(user_size + decoration_size + max_alignment), int32_t(max_alignment));
     max_nodes_ = max_nodes;
@@ -22,7 +24,9 @@ PoolAllocator::PoolAllocator(const MemoryArenaBase* arena, HeapArea& area, uint3
     free_list_.init(begin_, node_size_, max_nodes_, 0, 0);
 }
 
-void* PoolAllocator::allocate([[maybe_unused]] std::size_t size, std::size_t alignment, std::size_t offset)
+template <typename FreeListT>
+void* BasicPoolAllocator<FreeListT>::allocate([[maybe_unused]] std::size_t size, std::size_t alignment,
+                                              std::size_t offset)
 {
     uint8_t* next = static_cast<uint8_t*>(free_list_.acquire());
 
@@ -45,19 +49,37 @@ void* PoolAllocator::allocate([[maybe_unused]] std::size_t size, std::size_t ali
     std::fill(next, next + padding, k_alignment_padding_mark);
 #endif
 
-    ++node_count_;
+    if constexpr (k_thread_safe)
+    {
+        node_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        ++node_count_;
+    }
     return next + padding;
 }
 
-void PoolAllocator::deallocate(void* ptr)
+template <typename FreeListT>
+void BasicPoolAllocator<FreeListT>::deallocate(void* ptr)
 {
     // Get unaligned address
     size_t offset = size_t(static_cast<uint8_t*>(ptr) - begin_); // Distance in bytes to beginning of the block
     size_t padding = offset % node_size_;                        // Distance in bytes to beginning of the node = padding
 
-    --node_count_;
+    if constexpr (k_thread_safe)
+    {
+        node_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        --node_count_;
+    }
     free_list_.release(static_cast<uint8_t*>(ptr) - padding);
 }
 
+template class BasicPoolAllocator<Freelist>;
+template class BasicPoolAllocator<AtomicFreelist>;
+
 } // namespace memory
 } // namespace kb
\ No newline at end of file
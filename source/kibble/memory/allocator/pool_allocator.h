@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <type_traits>
 
+#include "kibble/memory/util/atomic_free_list.h"
 #include "kibble/memory/util/free_list.h"
 
 namespace kb
@@ -21,11 +24,18 @@ class MemoryArenaBase;
  * size of the largest object. So in this configuration, some memory is just wasted, plain and simple.
  *
  * This allocator uses a FreeList data structure at its core to easily locate the next available chunk of memory.
+ * With a thread-safe free list (see AtomicFreelist), the allocator can be shared by multiple threads without any lock,
+ * and the arena will skip its thread guard for allocator calls.
  *
+ * @tparam FreeListT free list implementation
  */
-class PoolAllocator
+template <typename FreeListT>
+class BasicPoolAllocator
 {
 public:
+    /// @brief Tells the arena whether this allocator needs the thread guard
+    static constexpr bool k_thread_safe = FreeListT::k_thread_safe;
+
     /**
      * @brief Reserve a block of a given size on a HeapArea and use it for pool allocation.
      *
@@ -36,8 +46,8 @@ public:
      * @param user_size maximum size of object allocated by the user
      * @param max_alignment maximum alignment requirement
      */
-    PoolAllocator(const MemoryArenaBase* arena, HeapArea& area, uint32_t decoration_size, std::size_t max_nodes,
-                  std::size_t user_size, std::size_t max_alignment);
+    BasicPoolAllocator(const MemoryArenaBase* arena, HeapArea& area, uint32_t decoration_size, std::size_t max_nodes,
+                       std::size_t user_size, std::size_t max_alignment);
 
     /**
      * @brief Return a pointer to the beginning of the block.
@@ -120,18 +130,37 @@ public:
     // clang-format off
     /// @brief Get total size in bytes
     inline size_t total_size() const{ return static_cast<size_t>(end() - begin()); }
-    /// @brief Get used size in bytes
-    inline size_t used_size() const{ return node_count_ * node_size_; }
     // clang-format on
 
+    /// @brief Get used size in bytes
+    inline size_t used_size() const
+    {
+        if constexpr (k_thread_safe)
+        {
+            return node_count_.load(std::memory_order_relaxed) * node_size_;
+        }
+        else
+        {
+            return node_count_ * node_size_;
+        }
+    }
+
 private:
+    // Only thread-safe free lists need an atomic counter
+    using CounterT = std::conditional_t<k_thread_safe, std::atomic<size_t>, size_t>;
+
     size_t node_size_{0};
     size_t max_nodes_{0};
-    size_t node_count_{0};
+    CounterT node_count_{0};
     uint8_t* begin_;
     uint8_t* end_;
-    Freelist free_list_;
+    FreeListT free_list_;
 };
 
+/// @brief Single-threaded pool allocator
+using PoolAllocator = BasicPoolAllocator<Freelist>;
+/// @brief Lock-free pool allocator, with a runtime capacity and LIFO node reuse
+using LockFreePoolAllocator = BasicPoolAllocator<AtomicFreelist>;
+
 } // namespace memory
 } // namespace kb
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "kibble/memory/allocator/slab_allocator.h"
+#include "kibble/assert/assert.h"
+#include "kibble/memory/arena_base.h"
+#include "kibble/memory/heap_area.h"
+#include "kibble/memory/util/alignment.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace kb::memory
+{
+
+namespace
+{
+
+// Blocks sit at multiples of their size from a page boundary, pages are at least k_max_size aligned
+constexpr size_t class_alignment(uint32_t cls)
+{
+    return size_t(1) << std::countr_zero(SlabAllocator::k_class_sizes[cls]);
+}
+
+// Largest padding needed in front of a block of a class, so that (block + padding + offset) % alignment == 0
+constexpr size_t max_padding(uint32_t cls, size_t alignment, size_t offset)
+{
+    // Blocks are only known to be aligned to the smallest of both
+    size_t known = std::min(class_alignment(cls), alignment);
+    return alignment - known + (known - offset % known) % known;
+}
+
+} // namespace
+
+SlabAllocator::SlabAllocator(const MemoryArenaBase* arena, HeapArea& area, uint32_t decoration_size,
+                             size_t slab_size, size_t large_pool_size)
+    : page_count_(slab_size / k_page_size)
+{
+    K_ASSERT(page_count_ > 0, "[SlabAllocator] Slab size must be at least one page ({}B), got {}B", k_page_size,
+             slab_size);
+
+    // Page descriptors come first, then the pages, aligned so that every class is naturally aligned
+    size_t info_size = page_count_ * sizeof(PageInfo);
+    auto range = area.require_slab(info_size + k_max_size + page_count_ * k_page_size, arena);
+    auto* begin = static_cast<uint8_t*>(range.first);
+    pages_ = reinterpret_cast<PageInfo*>(begin);
+    for (size_t ii = 0; ii < page_count_; ++ii)
+    {
+        ::new (pages_ + ii) PageInfo();
+    }
+    pages_begin_ = begin + info_size;
+    pages_begin_ += alignment_padding(pages_begin_, k_max_size);
+    pages_end_ = pages_begin_ + page_count_ * k_page_size;
+
+    // Free page stack, lower addresses first
+    for (size_t ii = page_count_; ii > 0; --ii)
+    {
+        release_page(uint32_t(ii - 1));
+    }
+    partial_.fill(k_none);
+
+    if (large_pool_size > 0)
+    {
+        large_.emplace(arena, area, decoration_size, large_pool_size);
+    }
+}
+
+void* SlabAllocator::allocate(size_t size, size_t alignment, size_t offset)
+{
+    alignment = std::max(alignment, size_t(1));
+    // A zero-byte block shifted by the alignment padding could start at the next block
+    size = std::max(size, size_t(1));
+
+    // The returned pointer is shifted inside the block so that the user pointer is aligned. Move up to the first class
+    // that can hold the size plus the worst case padding.
+    uint32_t cls = size_class(size);
+    while (cls < k_class_count && size + max_padding(cls, alignment, offset) > k_class_sizes[cls])
+    {
+        ++cls;
+    }
+
+    if (cls < k_class_count)
+    {
+        if (auto* block = static_cast<uint8_t*>(allocate_block(cls)); block != nullptr)
+        {
+            return block + alignment_padding(block + offset, alignment);
+        }
+    }
+
+    if (large_)
+    {
+        return large_->allocate(size, alignment, offset);
+    }
+
+    K_ASSERT(false, "[SlabAllocator] Out of memory!\n  -> size: {}, alignment: {}, offset: {}", size, alignment,
+             offset);
+    return nullptr;
+}
+
+void SlabAllocator::deallocate(void* ptr)
+{
+    auto* bytes = static_cast<uint8_t*>(ptr);
+    if (bytes >= pages_begin_ && bytes < pages_end_)
+    {
+        deallocate_block(uint32_t(size_t(bytes - pages_begin_) / k_page_size), bytes);
+        return;
+    }
+
+    K_ASSERT(large_.has_value(), "[SlabAllocator] Pointer does not belong to this allocator: {}", ptr);
+    large_->deallocate(ptr);
+}
+
+void* SlabAllocator::allocate_block(uint32_t cls)
+{
+    uint32_t page_index = partial_[cls];
+    if (page_index == k_none)
+    {
+        page_index = acquire_page(cls);
+        if (page_index == k_none)
+        {
+            return nullptr;
+        }
+    }
+
+    // Pages in the partial list have at least one free block
+    auto& page = pages_[page_index];
+    uint32_t word = page.hint;
+    while (page.free_bits[word] == 0)
+    {
+        ++word;
+    }
+    uint32_t bit = uint32_t(std::countr_zero(page.free_bits[word]));
+    page.free_bits[word] &= page.free_bits[word] - 1;
+    page.hint = word;
+
+    if (++page.used == page.capacity)
+    {
+        unlink_partial(page_index);
+    }
+
+    used_size_ += k_class_sizes[cls];
+    return page_begin(page_index) + (size_t(word) * 64 + bit) * k_class_sizes[cls];
+}
+
+void SlabAllocator::deallocate_block(uint32_t page_index, uint8_t* ptr)
+{
+    auto& page = pages_[page_index];
+    K_ASSERT(page.size_class != k_none, "[SlabAllocator] Pointer belongs to a free page: {}", static_cast<void*>(ptr));
+
+    uint32_t block = uint32_t(size_t(ptr - page_begin(page_index)) / k_class_sizes[page.size_class]);
+    uint32_t word = block / 64;
+    uint64_t mask = uint64_t(1) << (block % 64);
+    K_ASSERT((page.free_bits[word] & mask) == 0, "[SlabAllocator] Double free: {}", static_cast<void*>(ptr));
+
+    page.free_bits[word] |= mask;
+    page.hint = std::min(page.hint, word);
+    used_size_ -= k_class_sizes[page.size_class];
+
+    if (page.used-- == page.capacity)
+    {
+        link_partial(page_index);
+    }
+
+    // Keep a single empty page around per class, so that alternating allocations do not recycle the page each time
+    if (page.used == 0 && (page.prev != k_none || page.next != k_none))
+    {
+        unlink_partial(page_index);
+        release_page(page_index);
+    }
+}
+
+uint32_t SlabAllocator::acquire_page(uint32_t cls)
+{
+    uint32_t page_index = free_pages_;
+    if (page_index == k_none)
+    {
+        return k_none;
+    }
+
+    auto& page = pages_[page_index];
+    free_pages_ = page.next;
+    --free_page_count_;
+
+    page.size_class = cls;
+    page.used = 0;
+    page.capacity = uint32_t(k_page_size / k_class_sizes[cls]);
+    page.hint = 0;
+    page.free_bits.fill(0);
+    for (uint32_t word = 0; word < page.capacity / 64; ++word)
+    {
+        page.free_bits[word] = ~uint64_t(0);
+    }
+    if (uint32_t rem = page.capacity % 64; rem != 0)
+    {
+        page.free_bits[page.capacity / 64] = (uint64_t(1) << rem) - 1;
+    }
+
+    link_partial(page_index);
+    return page_index;
+}
+
+void SlabAllocator::release_page(uint32_t page_index)
+{
+    auto& page = pages_[page_index];
+    page.size_class = k_none;
+    page.prev = k_none;
+    page.next = free_pages_;
+    free_pages_ = page_index;
+    ++free_page_count_;
+}
+
+void SlabAllocator::link_partial(uint32_t page_index)
+{
+    auto& page = pages_[page_index];
+    uint32_t& head = partial_[page.size_class];
+    page.prev = k_none;
+    page.next = head;
+    if (head != k_none)
+    {
+        pages_[head].prev = page_index;
+    }
+    head = page_index;
+}
+
+void SlabAllocator::unlink_partial(uint32_t page_index)
+{
+    auto& page = pages_[page_index];
+    if (page.prev != k_none)
+    {
+        pages_[page.prev].next = page.next;
+    }
+    else
+    {
+        partial_[page.size_class] = page.next;
+    }
+    if (page.next != k_none)
+    {
+        pages_[page.next].prev = page.prev;
+    }
+    page.prev = k_none;
+    page.next = k_none;
+}
+
+} // namespace kb::memory
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "kibble/memory/allocator/tlsf_allocator.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace kb::memory
+{
+
+class HeapArea;
+class MemoryArenaBase;
+
+/**
+ * @brief Multi-pool allocator for small objects of mixed sizes.
+ *
+ * The slab is split into fixed-size pages. A page is assigned to a size class when the class needs more room, and
+ * returns to the free page stack when it becomes empty, so memory is shared between classes. Size classes are
+ * geometric (8B to 4kB, two classes per power of 2), the size to class lookup is a table access, and the page and
+ * block of a pointer are found by address arithmetic, so there is no per-block header. Each page tracks its free
+ * blocks with a bitmap.
+ *
+ * Requests that do not fit a size class are forwarded to an optional TLSFAllocator fallback.
+ *
+ * This replaces hand-built sets of PoolAllocator arenas, one per object size.
+ *
+ */
+class SlabAllocator
+{
+public:
+    /// @brief Size of a slab page, all blocks of a page share the same size class
+    static constexpr size_t k_page_size = 64 * 1024;
+    /// @brief Largest size served by the slab, larger requests go to the TLSF fallback
+    static constexpr size_t k_max_size = 4096;
+    /// @brief Number of size classes
+    static constexpr uint32_t k_class_count = 18;
+    /// @brief Block sizes of each size class
+    static constexpr std::array<uint32_t, k_class_count> k_class_sizes = {
+        8, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096};
+
+    /**
+     * @brief Reserve a block on a HeapArea and use it for slab allocation.
+     *
+     * @param arena arena base pointer
+     * @param area reference to the memory resource the allocator will reserve a block from
+     * @param decoration_size allocation overhead
+     * @param slab_size size of the slab, rounded down to a multiple of the page size
+     * @param large_pool_size size of the TLSF pool used for large requests, 0 to disable the fallback
+     */
+    SlabAllocator(const MemoryArenaBase* arena, HeapArea& area, uint32_t decoration_size, std::size_t slab_size,
+                  std::size_t large_pool_size = 0);
+
+    /**
+     * @brief Allocate a block of memory of a given size.
+     * The block comes from the smallest size class that fits the size plus the padding needed to satisfy the
+     * alignment requirement, or from the TLSF fallback. The returned pointer may be shifted from the start of the
+     * block by this padding.
+     *
+     * @param size Minimum size to allocate
+     * @param alignment Alignment constraint, such that `(returned_pointer + offset) % alignment == 0`
+     * @param offset Offset to the user pointer
+     * @return void* Pointer to the allocated memory, or nullptr if the allocator is out of memory
+     */
+    void* allocate(std::size_t size, std::size_t alignment, std::size_t offset);
+
+    /**
+     * @brief Free a memory block.
+     * A page that becomes empty is given back to the free page stack, unless it is the last one of its size class
+     * with free blocks.
+     *
+     * @param ptr
+     */
+    void deallocate(void* ptr);
+
+    /**
+     * @brief Get the size class of a given size.
+     *
+     * @param size
+     * @return uint32_t a class index, k_class_count if the size is too large
+     */
+    static inline uint32_t size_class(std::size_t size)
+    {
+        return (size <= k_max_size) ? k_class_table[(size + 7) / 8] : k_class_count;
+    }
+
+    // * Debug
+
+    // clang-format off
+    /// @brief Get total size in bytes
+    inline size_t total_size() const{ return page_count_ * k_page_size + (large_ ? large_->total_size() : 0); }
+    /// @brief Get used size in bytes
+    inline size_t used_size() const{ return used_size_ + (large_ ? large_->used_size() : 0); }
+    /// @brief Get the number of pages that are not assigned to a size class
+    inline size_t free_page_count() const{ return free_page_count_; }
+    // clang-format on
+
+    /// @brief Get the size of the largest free chunk: a whole page, or a block of the fallback pool
+    inline size_t largest_free_block() const
+    {
+        size_t largest = free_page_count_ > 0 ? k_page_size : 0;
+        return large_ ? std::max(largest, large_->largest_free_block()) : largest;
+    }
+
+private:
+    static constexpr uint32_t k_none = 0xffffffff;
+    static constexpr size_t k_bitmap_words = k_page_size / 8 / 64;
+
+    /// @internal Maps (size + 7) / 8 to a size class
+    static constexpr std::array<uint8_t, k_max_size / 8 + 1> k_class_table = []() {
+        std::array<uint8_t, k_max_size / 8 + 1> table{};
+        uint8_t cls = 0;
+        for (size_t ii = 0; ii < table.size(); ++ii)
+        {
+            while (k_class_sizes[cls] < ii * 8)
+            {
+                ++cls;
+            }
+            table[ii] = cls;
+        }
+        return table;
+    }();
+
+    /**
+     * @internal
+     * @brief Out of band page descriptor.
+     * Pages of a size class that have free blocks are kept in a doubly linked list, free pages in a stack.
+     *
+     */
+    struct PageInfo
+    {
+        uint32_t next = k_none;
+        uint32_t prev = k_none;
+        uint32_t size_class = k_none;
+        uint32_t used = 0;
+        uint32_t capacity = 0;
+        uint32_t hint = 0; // No free block before this bitmap word
+        std::array<uint64_t, k_bitmap_words> free_bits;
+    };
+
+    void* allocate_block(uint32_t cls);
+    void deallocate_block(uint32_t page_index, uint8_t* ptr);
+    uint32_t acquire_page(uint32_t cls);
+    void release_page(uint32_t page_index);
+    void link_partial(uint32_t page_index);
+    void unlink_partial(uint32_t page_index);
+
+    inline uint8_t* page_begin(uint32_t page_index) const
+    {
+        return pages_begin_ + size_t(page_index) * k_page_size;
+    }
+
+private:
+    PageInfo* pages_{nullptr};
+    uint8_t* pages_begin_{nullptr};
+    uint8_t* pages_end_{nullptr};
+    size_t page_count_{0};
+    size_t used_size_{0};
+    uint32_t free_pages_{k_none};
+    size_t free_page_count_{0};
+    std::array<uint32_t, k_class_count> partial_;
+    std::optional<TLSFAllocator> large_;
+};
+
+} // namespace kb::memory
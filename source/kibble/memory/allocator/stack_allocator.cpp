@@ -0,0 +1,57 @@
+#include "kibble/memory/allocator/stack_allocator.h"
+#include "config.h"
+#include "kibble/assert/assert.h"
+#include "kibble/memory/arena_base.h"
+#include "kibble/memory/heap_area.h"
+#include "kibble/memory/util/alignment.h"
+
+namespace kb
+{
+namespace memory
+{
+
+StackAllocator::StackAllocator(const MemoryArenaBase* arena, HeapArea& area, uint32_t, std::size_t size)
+{
+    std::pair<void*, void*> range = area.require_slab(size, arena);
+
+    begin_ = static_cast<uint8_t*>(range.first);
+    end_ = static_cast<uint8_t*>(range.second);
+}
+
+StackAllocator::StackAllocator(void* begin, void* end)
+    : begin_(static_cast<uint8_t*>(begin)), end_(static_cast<uint8_t*>(end))
+{
+}
+
+void* StackAllocator::allocate(std::size_t size, std::size_t alignment, std::size_t offset)
+{
+    uint8_t* current = begin_ + head_;
+
+    // We want the user pointer (at current+offset) to be aligned.
+    std::size_t padding = alignment_padding(current + offset, alignment);
+
+    // Out of memory
+    if (current + padding + size > end_)
+    {
+        K_ASSERT(false, "[StackAllocator] Out of memory!\n  -> padded size: {}, exceeded by: {}", padding + size,
+                 (std::size_t(current) + padding + size) - std::size_t(end_));
+        return nullptr;
+    }
+
+    // Mark padding area
+#ifdef K_USE_MEM_MARK_PADDING
+    std::fill(current, current + padding, k_alignment_padding_mark);
+#endif
+
+    head_ += padding + size;
+    return current + padding;
+}
+
+void StackAllocator::rewind(Marker marker)
+{
+    K_ASSERT(marker <= head_, "[StackAllocator] Cannot rewind forward.\n  -> marker: {}, head: {}", marker, head_);
+    head_ = marker;
+}
+
+} // namespace memory
+} // namespace kb
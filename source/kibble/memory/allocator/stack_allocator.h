@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kb
+{
+namespace memory
+{
+
+class HeapArea;
+class MemoryArenaBase;
+
+/**
+ * @brief Linear allocator that can be rewound to a previous position.
+ * Like LinearAllocator, chunks are allocated one after the other and deallocate() does nothing. On top of that, the
+ * current position can be saved as a marker, and everything allocated after a marker can be freed at once by rewinding
+ * to it. This makes it possible to nest scopes of scratch memory, see StackScope.
+ *
+ * @note Rewinding bypasses the arena deallocation path, so memory tracking policies will see the rewound allocations
+ * as leaks.
+ *
+ */
+class StackAllocator
+{
+public:
+    /// @brief Position in the stack
+    using Marker = std::size_t;
+
+    /**
+     * @brief Reserve a block of a given size on a HeapArea and use it for stack allocation.
+     *
+     * @param arena arena base pointer
+     * @param area reference to the memory resource the allocator will reserve a block from
+     * @param decoration_size allocation overhead
+     * @param size size of the block to reserve
+     */
+    StackAllocator(const MemoryArenaBase* arena, HeapArea& area, uint32_t decoration_size, std::size_t size);
+
+    /**
+     * @brief Use an existing memory range for stack allocation.
+     *
+     * @param begin beginning of the range
+     * @param end end of the range
+     */
+    StackAllocator(void* begin, void* end);
+
+    /**
+     * @brief Allocate a chunk of a given size next to the last one.
+     * This function supports alignment constraints, the user pointer (returned_pointer + offset) will be aligned.
+     *
+     * If the symbol K_USE_MEM_MARK_PADDING is defined, padded zones will be memset to a fixed magic number.
+     *
+     * @param size size of the chunk to allocate
+     * @param alignment alignment constraint, such that `(returned_pointer + offset) % alignment == 0`
+     * @param offset offset to the user pointer
+     * @return the returned pointer, at the beginning of the chunk, or nullptr if the allocator reached the end of the
+     * block
+     */
+    void* allocate(std::size_t size, std::size_t alignment, std::size_t offset);
+
+    /**
+     * @brief Does nothing, use rewind() or reset() to free memory.
+     *
+     */
+    inline void deallocate(void*)
+    {
+    }
+
+    /// @brief Get the current position, to rewind to later
+    inline Marker get_marker() const
+    {
+        return head_;
+    }
+
+    /**
+     * @brief Free everything that was allocated after a marker.
+     *
+     * @param marker a position obtained with get_marker(), lower or equal to the current position
+     */
+    void rewind(Marker marker);
+
+    /// @brief Free everything
+    inline void reset()
+    {
+        head_ = 0;
+    }
+
+    // clang-format off
+    /// @brief Return a pointer to the beginning of the block
+    inline uint8_t* begin() { return begin_; }
+    /// @brief Return a pointer to the end of the block
+    inline uint8_t* end() { return end_; }
+    /// @brief Get total size in bytes
+    inline size_t total_size() const{ return static_cast<size_t>(end_ - begin_); }
+    /// @brief Get used size in bytes
+    inline size_t used_size() const{ return head_; }
+    /// @brief Get the size of the largest chunk that could be allocated, in bytes
+    inline size_t largest_free_block() const{ return total_size() - head_; }
+    // clang-format on
+
+private:
+    uint8_t* begin_;
+    uint8_t* end_;
+    std::size_t head_{0};
+};
+
+/**
+ * @brief RAII scope on a stack allocator.
+ * The position of the stack is saved on construction, and everything allocated during the lifetime of the scope is
+ * freed on destruction. Scopes can be nested.
+ *
+ * @note Objects allocated in the scope are not destroyed, only use it with trivially destructible data or destroy
+ * them manually.
+ *
+ * @tparam StackT any type that exposes get_marker() and rewind(), like StackAllocator
+ */
+template <typename StackT>
+class StackScope
+{
+public:
+    explicit StackScope(StackT& stack) : stack_(stack), marker_(stack.get_marker())
+    {
+    }
+
+    ~StackScope()
+    {
+        stack_.rewind(marker_);
+    }
+
+    StackScope(const StackScope&) = delete;
+    StackScope& operator=(const StackScope&) = delete;
+
+private:
+    StackT& stack_;
+    typename StackT::Marker marker_;
+};
+
+} // namespace memory
+} // namespace kb
@@ -0,0 +1,407 @@
+#include "kibble/memory/allocator/thread_cached_tlsf_allocator.h"
+#include "kibble/assert/assert.h"
+#include "kibble/util/unordered_dense.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+namespace kb::memory
+{
+
+namespace
+{
+
+// * Size classes
+
+constexpr size_t k_header_size = sizeof(uintptr_t);
+constexpr uint32_t k_class_count = 24;
+
+/*
+    16B steps up to 256B, then 64B steps up to 512B and 128B steps up to 1kB.
+    Owner caches are 64B aligned, so a class index and a shift flag fit in the low bits of a block header.
+*/
+constexpr std::array<uint32_t, k_class_count> k_class_sizes = {16,  32,  48,  64,  80,  96,  112, 128,
+                                                               144, 160, 176, 192, 208, 224, 240, 256,
+                                                               320, 384, 448, 512, 640, 768, 896, 1024};
+constexpr uintptr_t k_tag_mask = 63;
+constexpr uintptr_t k_class_mask = 31;
+// Set in the header of a block returned one header past its start, to satisfy the offset of the request
+constexpr uintptr_t k_shifted = 32;
+
+static_assert(k_class_sizes.back() == ThreadCachedTLSFAllocator::k_max_cached_size);
+static_assert(k_class_count <= k_class_mask);
+
+inline uint32_t size_class(size_t size)
+{
+    if (size <= 256)
+    {
+        return (size > 0) ? uint32_t((size - 1) / 16) : 0;
+    }
+    if (size <= 512)
+    {
+        return 16 + uint32_t((size - 257) / 64);
+    }
+    return 20 + uint32_t((size - 513) / 128);
+}
+
+// Number of blocks moved between a thread cache and the TLSF pool at once, about 4kB worth of blocks
+constexpr size_t batch_size(uint32_t cls)
+{
+    return std::clamp(size_t(4096 / k_class_sizes[cls]), size_t(4), size_t(32));
+}
+
+// A free list holding more than this gives a batch back
+constexpr size_t max_cached(uint32_t cls)
+{
+    return 2 * batch_size(cls);
+}
+
+inline uintptr_t& header(void* ptr)
+{
+    return *reinterpret_cast<uintptr_t*>(static_cast<uint8_t*>(ptr) - k_header_size);
+}
+
+// Allocators are identified by a unique ID rather than their address, so a thread never mistakes a new allocator for
+// a destroyed one that lived at the same address
+std::atomic<uint64_t> s_next_allocator_id{1};
+
+// Threads are identified the same way, std::thread::id values can be reused once a thread has exited
+std::atomic<uint64_t> s_next_thread_token{1};
+thread_local uint64_t t_thread_token = 0;
+
+inline uint64_t thread_token()
+{
+    if (t_thread_token == 0)
+    {
+        t_thread_token = s_next_thread_token.fetch_add(1);
+    }
+    return t_thread_token;
+}
+
+// Live allocators, so that an exiting thread only drains the caches of allocators that were not destroyed yet
+struct Registry
+{
+    std::mutex mutex;
+    ankerl::unordered_dense::map<uint64_t, ThreadCachedTLSFAllocator*> allocators;
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+} // namespace
+
+/**
+ * @internal
+ * @brief Per-thread free lists.
+ * Only the owner thread touches the local lists, other threads push to the remote list.
+ *
+ */
+struct alignas(64) ThreadCachedTLSFAllocator::ThreadCache
+{
+    struct FreeNode
+    {
+        FreeNode* next;
+    };
+
+    struct FreeList
+    {
+        FreeNode* head = nullptr;
+        size_t count = 0;
+
+        inline void push(void* ptr)
+        {
+            auto* node = static_cast<FreeNode*>(ptr);
+            node->next = head;
+            head = node;
+            ++count;
+        }
+
+        inline void* pop()
+        {
+            FreeNode* node = head;
+            head = node->next;
+            --count;
+            return node;
+        }
+    };
+
+    // Remote list of a retired cache, blocks freed by other threads go straight back to the pool
+    static inline FreeNode retired{nullptr};
+
+    uint64_t owner;
+    std::array<FreeList, k_class_count> lists;
+    alignas(64) std::atomic<FreeNode*> remote{nullptr};
+};
+
+namespace
+{
+
+struct CacheRef
+{
+    uint64_t allocator_id = 0;
+    void* cache = nullptr;
+};
+
+// Most threads use a single allocator, so the last lookup is memoized in front of the map
+thread_local CacheRef t_last_cache;
+
+} // namespace
+
+/**
+ * @internal
+ * @brief Caches of a thread, by allocator ID.
+ * Destroyed when the thread exits, which retires the caches of the allocators still alive.
+ *
+ */
+struct ThreadCachedTLSFAllocator::LocalCaches
+{
+    ankerl::unordered_dense::map<uint64_t, ThreadCache*> caches;
+
+    ~LocalCaches()
+    {
+        t_last_cache = {};
+        auto& reg = registry();
+        std::scoped_lock lock(reg.mutex);
+        for (auto [allocator_id, cache] : caches)
+        {
+            if (auto it = reg.allocators.find(allocator_id); it != reg.allocators.end())
+            {
+                it->second->retire(*cache);
+            }
+        }
+    }
+};
+
+ThreadCachedTLSFAllocator::ThreadCachedTLSFAllocator(const MemoryArenaBase* arena, HeapArea& area,
+                                                     uint32_t decoration_size, std::size_t pool_size)
+    : tlsf_(arena, area, decoration_size, pool_size), id_(s_next_allocator_id.fetch_add(1))
+{
+    auto& reg = registry();
+    std::scoped_lock lock(reg.mutex);
+    reg.allocators.emplace(id_, this);
+}
+
+ThreadCachedTLSFAllocator::~ThreadCachedTLSFAllocator()
+{
+    // An exiting thread retires its caches under the registry lock, so this waits for it to finish
+    auto& reg = registry();
+    std::scoped_lock lock(reg.mutex);
+    reg.allocators.erase(id_);
+}
+
+ThreadCachedTLSFAllocator::LocalCaches& ThreadCachedTLSFAllocator::local_caches()
+{
+    thread_local LocalCaches instance;
+    return instance;
+}
+
+ThreadCachedTLSFAllocator::ThreadCache& ThreadCachedTLSFAllocator::local_cache()
+{
+    if (t_last_cache.allocator_id == id_)
+    {
+        return *static_cast<ThreadCache*>(t_last_cache.cache);
+    }
+
+    auto& caches = local_caches().caches;
+    ThreadCache* cache = nullptr;
+    if (auto it = caches.find(id_); it != caches.end())
+    {
+        cache = it->second;
+    }
+    else
+    {
+        auto new_cache = std::make_unique<ThreadCache>();
+        new_cache->owner = thread_token();
+        cache = new_cache.get();
+        {
+            std::scoped_lock lock(mutex_);
+            caches_.push_back(std::move(new_cache));
+        }
+        caches.emplace(id_, cache);
+    }
+
+    t_last_cache = {id_, cache};
+    return *cache;
+}
+
+void* ThreadCachedTLSFAllocator::allocate(size_t size, size_t alignment, size_t offset)
+{
+    // Cached blocks are 16B aligned, so they satisfy any weaker alignment once shifted by the padding the offset
+    // requires. The shifted pointer needs a header of its own, so the offset must keep the padding a multiple of 8B.
+    const bool cacheable = alignment <= k_cache_alignment && offset % k_header_size == 0;
+    const size_t shift = cacheable ? (alignment - offset % alignment) % alignment : 0;
+    if (cacheable && size + shift <= k_max_cached_size)
+    {
+        ThreadCache& cache = local_cache();
+        uint32_t cls = size_class(size + shift);
+        auto& list = cache.lists[cls];
+        if (list.head == nullptr)
+        {
+            collect_remote(cache);
+            if (list.head == nullptr)
+            {
+                refill(cache, cls);
+                if (list.head == nullptr)
+                {
+                    return nullptr;
+                }
+            }
+        }
+        auto* block = static_cast<uint8_t*>(list.pop());
+        if (shift > 0)
+        {
+            block += shift;
+            header(block) = header(block - shift) | k_shifted;
+        }
+        return block;
+    }
+
+    std::scoped_lock lock(mutex_);
+    auto* block = static_cast<uint8_t*>(tlsf_.allocate(size + k_header_size, alignment, offset + k_header_size));
+    if (block == nullptr)
+    {
+        return nullptr;
+    }
+    block += k_header_size;
+    header(block) = 0;
+    return block;
+}
+
+void ThreadCachedTLSFAllocator::deallocate(void* ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    uintptr_t tag = header(ptr);
+    if (tag == 0)
+    {
+        std::scoped_lock lock(mutex_);
+        tlsf_.deallocate(&header(ptr));
+        return;
+    }
+
+    if (tag & k_shifted)
+    {
+        ptr = static_cast<uint8_t*>(ptr) - k_header_size;
+        tag = header(ptr);
+    }
+
+    auto* owner = reinterpret_cast<ThreadCache*>(tag & ~k_tag_mask);
+    uint32_t cls = uint32_t(tag & k_class_mask);
+    if (owner->owner == thread_token())
+    {
+        auto& list = owner->lists[cls];
+        list.push(ptr);
+        if (list.count > max_cached(cls))
+        {
+            release(*owner, cls, batch_size(cls));
+        }
+        return;
+    }
+
+    // Treiber push, the owner is the only consumer and takes the whole stack at once, so there is no ABA problem
+    auto* node = static_cast<ThreadCache::FreeNode*>(ptr);
+    node->next = owner->remote.load(std::memory_order_relaxed);
+    do
+    {
+        if (node->next == &ThreadCache::retired)
+        {
+            std::scoped_lock lock(mutex_);
+            tlsf_.deallocate(&header(ptr));
+            return;
+        }
+    } while (
+        !owner->remote.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void ThreadCachedTLSFAllocator::collect_remote(ThreadCache& cache)
+{
+    auto* node = cache.remote.exchange(nullptr, std::memory_order_acquire);
+    while (node != nullptr)
+    {
+        auto* next = node->next;
+        cache.lists[header(node) & k_class_mask].push(node);
+        node = next;
+    }
+}
+
+void ThreadCachedTLSFAllocator::refill(ThreadCache& cache, uint32_t cls)
+{
+    const size_t block_size = k_class_sizes[cls] + k_header_size;
+    const uintptr_t tag = reinterpret_cast<uintptr_t>(&cache) | cls;
+    auto& list = cache.lists[cls];
+
+    std::scoped_lock lock(mutex_);
+    for (size_t ii = 0; ii < batch_size(cls); ++ii)
+    {
+        auto* block = static_cast<uint8_t*>(tlsf_.allocate(block_size, k_cache_alignment, k_header_size));
+        if (block == nullptr)
+        {
+            break;
+        }
+        block += k_header_size;
+        header(block) = tag;
+        list.push(block);
+    }
+}
+
+void ThreadCachedTLSFAllocator::release(ThreadCache& cache, uint32_t cls, size_t count)
+{
+    auto& list = cache.lists[cls];
+
+    std::scoped_lock lock(mutex_);
+    for (size_t ii = 0; ii < count && list.head != nullptr; ++ii)
+    {
+        tlsf_.deallocate(&header(list.pop()));
+    }
+}
+
+void ThreadCachedTLSFAllocator::retire(ThreadCache& cache)
+{
+    auto* node = cache.remote.exchange(&ThreadCache::retired, std::memory_order_acquire);
+
+    std::scoped_lock lock(mutex_);
+    while (node != nullptr)
+    {
+        auto* next = node->next;
+        tlsf_.deallocate(&header(node));
+        node = next;
+    }
+    for (auto& list : cache.lists)
+    {
+        while (list.head != nullptr)
+        {
+            tlsf_.deallocate(&header(list.pop()));
+        }
+    }
+}
+
+void ThreadCachedTLSFAllocator::flush_thread_cache()
+{
+    ThreadCache& cache = local_cache();
+    collect_remote(cache);
+    for (uint32_t cls = 0; cls < k_class_count; ++cls)
+    {
+        release(cache, cls, cache.lists[cls].count);
+    }
+}
+
+size_t ThreadCachedTLSFAllocator::used_size() const
+{
+    std::scoped_lock lock(mutex_);
+    return tlsf_.used_size();
+}
+
+size_t ThreadCachedTLSFAllocator::largest_free_block() const
+{
+    std::scoped_lock lock(mutex_);
+    return tlsf_.largest_free_block();
+}
+
+} // namespace kb::memory
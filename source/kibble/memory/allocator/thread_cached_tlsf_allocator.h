@@ -0,0 +1,173 @@
+#pragma once
+
+#include "kibble/memory/allocator/tlsf_allocator.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace kb::memory
+{
+
+/**
+ * @brief Thread-safe TLSF allocator with per-thread caches for small blocks.
+ *
+ * Small allocations are served from a cache owned by the calling thread, without any synchronization. Each cache
+ * holds one free list per size class, and talks to the shared TLSFAllocator in batches: a miss refills a whole batch
+ * of blocks under a single lock, and a list that grows too long gives a batch back. Larger blocks, or blocks with
+ * stricter alignment requirements, are allocated directly from the TLSF pool under the lock.
+ *
+ * A block freed by another thread than the one that allocated it is pushed to the owner cache's remote free list,
+ * a lock-free stack that the owner collects the next time it misses. This keeps producer / consumer patterns from
+ * migrating blocks between caches.
+ *
+ * Every block is preceded by an 8B header identifying its owner cache and size class, so the deallocation path never
+ * needs to look up a size.
+ *
+ * When a thread exits, its caches are drained back to the TLSF pools of the allocators still alive, and the blocks it
+ * allocated that are freed afterwards go straight back to the pool.
+ *
+ * @note This allocator synchronizes itself, so a MemoryArena using it only takes its thread guard around the memory
+ * tracking policy. Use it with policy::MultiThread when tracking is enabled, policy::SingleThread otherwise.
+ * @note Blocks sitting in a thread cache are accounted as used by the TLSF pool. Call flush_thread_cache() to give
+ * them back without waiting for the thread to exit.
+ *
+ */
+class ThreadCachedTLSFAllocator
+{
+public:
+    /// @brief Tells the arena this allocator does not need the thread guard
+    static constexpr bool k_thread_safe = true;
+    /// @brief Larger allocations bypass the thread caches
+    static constexpr size_t k_max_cached_size = 1024;
+    /// @brief Alignment of cached blocks, stricter requirements bypass the thread caches
+    static constexpr size_t k_cache_alignment = 16;
+
+    /**
+     * @brief Reserve a block on a HeapArea and use it for TLSF allocation.
+     *
+     * @param arena arena base pointer
+     * @param area reference to the memory resource the allocator will reserve a block from
+     * @param decoration_size allocation overhead
+     * @param pool_size size of the allocation pool
+     */
+    ThreadCachedTLSFAllocator(const MemoryArenaBase* arena, HeapArea& area, uint32_t decoration_size,
+                              std::size_t pool_size);
+
+    ~ThreadCachedTLSFAllocator();
+
+    /**
+     * @brief Allocate a block of memory of a given size, with arbitrary >= 8B alignment.
+     *
+     * @note Lock-free when the block fits in a size class and the calling thread cache is not empty.
+     *
+     * @param size Minimum size to allocate
+     * @param alignment Alignment constraint, such that `(returned_pointer + offset) % alignment == 0`
+     * @param offset Offset to the user pointer
+     * @return void* Pointer to the beginning of the block
+     */
+    void* allocate(std::size_t size, std::size_t alignment, std::size_t offset);
+
+    /**
+     * @brief Free a memory block allocated by any thread.
+     *
+     * @param ptr
+     */
+    void deallocate(void* ptr);
+
+    /**
+     * @brief Give all the blocks cached by the calling thread back to the TLSF pool.
+     *
+     */
+    void flush_thread_cache();
+
+    // * Debug
+
+    /// @brief Get total size in bytes
+    inline size_t total_size() const
+    {
+        return tlsf_.total_size();
+    }
+
+    /// @brief Get used size in bytes, including the blocks held by the thread caches
+    size_t used_size() const;
+
+    /// @brief Get the size of the largest free block of the backend, blocks held by the thread caches are not counted
+    size_t largest_free_block() const;
+
+    /**
+     * @brief Access the underlying TLSF allocator, to check the pool integrity.
+     *
+     * @warning Not synchronized, only call this when no other thread uses the allocator.
+     * @return const TLSFAllocator&
+     */
+    inline const TLSFAllocator& get_backend() const
+    {
+        return tlsf_;
+    }
+
+private:
+    struct ThreadCache;
+    struct LocalCaches;
+
+    /**
+     * @internal
+     * @brief Get the caches of the calling thread, drained when the thread exits.
+     *
+     * @return LocalCaches&
+     */
+    static LocalCaches& local_caches();
+
+    /**
+     * @internal
+     * @brief Get the calling thread cache for this allocator, create it if needed.
+     *
+     * @return ThreadCache&
+     */
+    ThreadCache& local_cache();
+
+    /**
+     * @internal
+     * @brief Move the blocks freed by other threads to the local free lists.
+     *
+     * @param cache
+     */
+    void collect_remote(ThreadCache& cache);
+
+    /**
+     * @internal
+     * @brief Allocate a batch of blocks of a given size class from the TLSF pool.
+     *
+     * @param cache
+     * @param cls size class index
+     */
+    void refill(ThreadCache& cache, uint32_t cls);
+
+    /**
+     * @internal
+     * @brief Give some blocks of a given size class back to the TLSF pool.
+     *
+     * @param cache
+     * @param cls size class index
+     * @param count maximum number of blocks to release
+     */
+    void release(ThreadCache& cache, uint32_t cls, size_t count);
+
+    /**
+     * @internal
+     * @brief Give all the blocks of an exiting thread cache back to the TLSF pool.
+     * Blocks freed by other threads after this call go straight back to the pool.
+     *
+     * @param cache
+     */
+    void retire(ThreadCache& cache);
+
+private:
+    TLSFAllocator tlsf_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadCache>> caches_;
+    const uint64_t id_;
+};
+
+} // namespace kb::memory
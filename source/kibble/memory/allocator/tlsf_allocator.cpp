@@ -7,6 +7,7 @@
 #include "kibble/memory/util/alignment.h"
 
 #include "fmt/format.h"
+#include <algorithm>
 #include <cstddef>
 
 using std::size_t;
@@ -106,6 +107,24 @@ void TLSFAllocator::create_pool(void* pool, std::size_t size)
     pool_ = pool;
 }
 
+size_t TLSFAllocator::largest_free_block() const
+{
+    if (control_->fl_bitmap == 0)
+    {
+        return 0;
+    }
+
+    const int32_t fli = fls(control_->fl_bitmap);
+    const int32_t sli = fls(control_->sl_bitmap[fli]);
+    size_t largest = 0;
+    for (const BlockHeader* block = control_->blocks[fli][sli]; block != &control_->null_block;
+         block = block->next_free)
+    {
+        largest = std::max(largest, block->block_size());
+    }
+    return largest;
+}
+
 void TLSFAllocator::walk_pool(PoolWalker walk) const
 {
     BlockHeader* block = BlockHeader::offset_to_block(pool_, -std::ptrdiff_t(BlockHeader::k_block_header_overhead));
@@ -92,6 +92,14 @@ public:
     inline size_t used_size() const{ return used_size_; }
     // clang-format on
 
+    /**
+     * @brief Get the size of the largest free block in the pool.
+     * Only the free list of the highest non-empty size class is visited.
+     *
+     * @return size_t
+     */
+    size_t largest_free_block() const;
+
     /// @brief Use this type of functor to visit each block in the pool
     using PoolWalker = std::function<void(void*, size_t, bool)>;
 
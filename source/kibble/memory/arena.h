@@ -1,8 +1,11 @@
 #pragma once
 
 #include "kibble/memory/arena_base.h"
+#include "kibble/memory/arena_stats.h"
 #include "kibble/memory/policy/policy.h"
 
+#include <algorithm>
+#include <cstring>
 #include <type_traits>
 
 namespace kb
@@ -48,6 +51,17 @@ public:
     /// @brief Total overhead due to bookkeeping decoration
     static constexpr size_t k_allocation_overhead = k_front_overhead + k_back_overhead;
 
+    /// @brief The thread guard protects allocator calls, unless the allocator is thread-safe on its own
+    static constexpr bool k_guard_allocator =
+        policy::is_active_threading_policy<ThreadPolicyT> && !policy::is_thread_safe_allocator<AllocatorT>;
+    /// @brief With a thread-safe allocator, the thread guard only protects the memory tracker
+    static constexpr bool k_guard_tracker = policy::is_active_threading_policy<ThreadPolicyT> &&
+                                            policy::is_thread_safe_allocator<AllocatorT> &&
+                                            policy::is_active_memory_tracking_policy<MemoryTrackerT>;
+    /// @brief Statistics counters are updated by a single thread at a time, they don't need atomic increments
+    static constexpr bool k_exclusive_counters =
+        !policy::is_active_threading_policy<ThreadPolicyT> || k_guard_allocator;
+
     /**
      * @brief Forwards all the arguments to the allocator's constructor.
      *
@@ -62,10 +76,12 @@ public:
         {
             memory_tracker_.init(name, area);
         }
+        ArenaRegistry::add(this);
     }
 
     ~MemoryArena()
     {
+        ArenaRegistry::remove(this);
         if constexpr (policy::is_active_memory_tracking_policy<MemoryTrackerT>)
         {
             memory_tracker_.report();
@@ -96,6 +112,69 @@ public:
         return allocator_;
     }
 
+    /// @brief Get the memory tracking policy, to configure it or query its statistics
+    inline MemoryTrackerT& get_memory_tracker()
+    {
+        return memory_tracker_;
+    }
+
+    /// @brief Get the memory tracking policy as a const reference
+    inline const MemoryTrackerT& get_memory_tracker() const
+    {
+        return memory_tracker_;
+    }
+
+    /**
+     * @brief Get runtime statistics.
+     * The used size of an allocator that does not synchronize itself is only read by a StatsScope::Full query, under
+     * the thread guard, along with its largest free block (if it supports it, see policy::has_largest_free_block).
+     *
+     * @param scope see StatsScope
+     * @return ArenaStats
+     */
+    ArenaStats get_stats(StatsScope scope = StatsScope::Counters) const override
+    {
+        ArenaStats stats;
+        get_counter_stats(stats);
+        stats.total_size = allocator_.total_size();
+        if constexpr (policy::is_thread_safe_allocator<AllocatorT>)
+        {
+            stats.used_size = allocator_.used_size();
+        }
+        else
+        {
+            stats.used_size = stats.live_size;
+        }
+
+        if (scope == StatsScope::Full)
+        {
+            if constexpr (policy::is_active_threading_policy<ThreadPolicyT>)
+            {
+                thread_guard_.enter();
+            }
+            stats.used_size = allocator_.used_size();
+            if constexpr (policy::has_largest_free_block<AllocatorT>)
+            {
+                stats.largest_free_block = allocator_.largest_free_block();
+            }
+            if constexpr (policy::is_active_threading_policy<ThreadPolicyT>)
+            {
+                thread_guard_.leave();
+            }
+
+            if constexpr (policy::has_largest_free_block<AllocatorT>)
+            {
+                const size_t free_size = stats.total_size - std::min(stats.used_size, stats.total_size);
+                stats.detailed = true;
+                stats.fragmentation =
+                    free_size > 0 ? 1.f - float(double(stats.largest_free_block) / double(free_size)) : 0.f;
+                stats.fragmentation = std::max(stats.fragmentation, 0.f);
+            }
+        }
+
+        return stats;
+    }
+
     /**
      * @brief Allocate a memory chunk of a given size.
      *
@@ -103,7 +182,8 @@ public:
      * sanitization or array deallocation purposes, so the user pointer may be offset relative to the base
      * pointer returned by this function. The user pointer is the one to be aligned.
      *
-     * @note This function may be a sync point, depending on the thread guard policy.
+     * @note This function may be a sync point, depending on the thread guard policy. With a thread-safe allocator,
+     * only the memory tracking policy is guarded.
      *
      * @param size size of the chunk to allocate
      * @param alignment alignment constraint, such that `(returned_pointer + offset) % alignment == 0`
@@ -116,7 +196,7 @@ public:
                                  [[maybe_unused]] int line) noexcept
     {
         // Lock resource
-        if constexpr (policy::is_active_threading_policy<ThreadPolicyT>)
+        if constexpr (k_guard_allocator)
         {
             thread_guard_.enter();
         }
@@ -128,7 +208,12 @@ public:
         uint8_t* begin = static_cast<uint8_t*>(allocator_.allocate(decorated_size, alignment, offset));
         if (begin == nullptr)
         {
+            count_failure<k_exclusive_counters>();
             // Following operations may write to null if we don't return now.
+            if constexpr (k_guard_allocator)
+            {
+                thread_guard_.leave();
+            }
             return nullptr;
         }
 
@@ -155,11 +240,20 @@ public:
         }
         if constexpr (policy::is_active_memory_tracking_policy<MemoryTrackerT>)
         {
+            if constexpr (k_guard_tracker)
+            {
+                thread_guard_.enter();
+            }
             memory_tracker_.on_allocation(begin, decorated_size, alignment, file, line);
+            if constexpr (k_guard_tracker)
+            {
+                thread_guard_.leave();
+            }
         }
+        count_allocation<k_exclusive_counters>(decorated_size);
 
         // Unlock resource and return user pointer
-        if constexpr (policy::is_active_threading_policy<ThreadPolicyT>)
+        if constexpr (k_guard_allocator)
         {
             thread_guard_.leave();
         }
@@ -176,7 +270,7 @@ public:
      */
     void deallocate(void* ptr, [[maybe_unused]] const char* file, [[maybe_unused]] int line) noexcept
     {
-        if constexpr (policy::is_active_threading_policy<ThreadPolicyT>)
+        if constexpr (k_guard_allocator)
         {
             thread_guard_.enter();
         }
@@ -206,17 +300,173 @@ public:
         }
         if constexpr (policy::is_active_memory_tracking_policy<MemoryTrackerT>)
         {
+            if constexpr (k_guard_tracker)
+            {
+                thread_guard_.enter();
+            }
             memory_tracker_.on_deallocation(begin, decorated_size, file, line);
+            if constexpr (k_guard_tracker)
+            {
+                thread_guard_.leave();
+            }
         }
 
         allocator_.deallocate(begin);
+        count_deallocation<k_exclusive_counters>(decorated_size);
 
-        if constexpr (policy::is_active_threading_policy<ThreadPolicyT>)
+        if constexpr (k_guard_allocator)
         {
             thread_guard_.leave();
         }
     }
 
+    /**
+     * @brief Resize a chunk of memory allocated by allocate(), keeping its content.
+     *
+     * When the allocator supports it (see policy::has_reallocate), the chunk is grown or shrunk in place if possible,
+     * otherwise a new chunk is allocated and the data is copied. Sentinels, allocation size and tracking information
+     * are updated accordingly. Like realloc(), a null pointer allocates a new chunk, and a zero size deallocates it.
+     * If the reallocation fails, the original chunk is left untouched and nullptr is returned.
+     *
+     * @warning Only use this with chunks of trivially copyable data, not with arrays allocated by K_NEW_ARRAY.
+     * @note This function may be a sync point, depending on the thread guard policy.
+     *
+     * @param ptr user pointer returned by allocate(), or nullptr
+     * @param size new size of the chunk
+     * @param alignment alignment constraint of the user pointer, must be the same as the original allocation's
+     * @param file source file where that reallocation was performed
+     * @param line source line where that reallocation was performed
+     * @return new user pointer
+     */
+    [[nodiscard]] void* reallocate(void* ptr, size_t size, size_t alignment, const char* file, int line) noexcept
+    {
+        if (ptr == nullptr)
+        {
+            return allocate(size, alignment, 0, file, line);
+        }
+        if (size == 0)
+        {
+            deallocate(ptr, file, line);
+            return nullptr;
+        }
+
+        uint8_t* begin = static_cast<uint8_t*>(ptr) - k_front_overhead;
+
+        if constexpr (!policy::has_reallocate<AllocatorT>)
+        {
+            // Allocate, copy and free
+            const size_t old_size =
+                *(reinterpret_cast<SizeType*>(begin + policy::BoundsCheckerSentinelSize<BoundsCheckerT>::FRONT)) -
+                k_allocation_overhead;
+            void* new_ptr = allocate(size, alignment, 0, file, line);
+            if (new_ptr != nullptr)
+            {
+                std::memcpy(new_ptr, ptr, std::min(old_size, size));
+                deallocate(ptr, file, line);
+            }
+            return new_ptr;
+        }
+        else
+        {
+            if constexpr (k_guard_allocator)
+            {
+                thread_guard_.enter();
+            }
+
+            if constexpr (policy::is_active_bounds_checking_policy<BoundsCheckerT>)
+            {
+                bounds_checker_.check_sentinel_front(begin);
+            }
+
+            const SizeType old_decorated_size =
+                *(reinterpret_cast<SizeType*>(begin + policy::BoundsCheckerSentinelSize<BoundsCheckerT>::FRONT));
+
+            if constexpr (policy::is_active_bounds_checking_policy<BoundsCheckerT>)
+            {
+                bounds_checker_.check_sentinel_back(begin + old_decorated_size -
+                                                    policy::BoundsCheckerSentinelSize<BoundsCheckerT>::BACK);
+            }
+
+            // The allocator copies the whole block when it can't resize in place, front decoration included
+            const size_t decorated_size = k_allocation_overhead + size;
+            uint8_t* new_begin =
+                static_cast<uint8_t*>(allocator_.reallocate(begin, decorated_size, alignment, k_front_overhead));
+            if (new_begin == nullptr)
+            {
+                count_failure<k_exclusive_counters>();
+                if constexpr (k_guard_allocator)
+                {
+                    thread_guard_.leave();
+                }
+                return nullptr;
+            }
+
+            // Update bookkeeping
+            if constexpr (policy::is_active_bounds_checking_policy<BoundsCheckerT>)
+            {
+                bounds_checker_.put_sentinel_front(new_begin);
+            }
+
+            *(reinterpret_cast<SizeType*>(new_begin + policy::BoundsCheckerSentinelSize<BoundsCheckerT>::FRONT)) =
+                static_cast<SizeType>(decorated_size);
+
+            uint8_t* user_ptr = new_begin + k_front_overhead;
+
+            if constexpr (policy::is_active_memory_tagging_policy<MemoryTaggerT>)
+            {
+                // The preserved user data must not be overwritten, only the grown part is tagged. Whatever was released
+                // (the old block, or the tail of a shrunk block) already belongs to the allocator, which may keep its
+                // own bookkeeping there, so it is not tagged.
+                const size_t old_size = old_decorated_size - k_allocation_overhead;
+                if (size > old_size)
+                {
+                    memory_tagger_.tag_allocation(user_ptr + old_size, size - old_size);
+                }
+            }
+            if constexpr (policy::is_active_bounds_checking_policy<BoundsCheckerT>)
+            {
+                bounds_checker_.put_sentinel_back(user_ptr + size);
+            }
+            if constexpr (policy::is_active_memory_tracking_policy<MemoryTrackerT>)
+            {
+                if constexpr (k_guard_tracker)
+                {
+                    thread_guard_.enter();
+                }
+                memory_tracker_.on_deallocation(begin, old_decorated_size, file, line);
+                memory_tracker_.on_allocation(new_begin, decorated_size, alignment, file, line);
+                if constexpr (k_guard_tracker)
+                {
+                    thread_guard_.leave();
+                }
+            }
+            count_deallocation<k_exclusive_counters>(old_decorated_size);
+            count_allocation<k_exclusive_counters>(decorated_size);
+
+            if constexpr (k_guard_allocator)
+            {
+                thread_guard_.leave();
+            }
+
+            return user_ptr;
+        }
+    }
+
+    void* allocate_bytes(size_t size, size_t alignment, const char* file, int line) override
+    {
+        return allocate(size, alignment, 0, file, line);
+    }
+
+    void deallocate_bytes(void* ptr, const char* file, int line) override
+    {
+        deallocate(ptr, file, line);
+    }
+
+    void* reallocate_bytes(void* ptr, size_t size, size_t alignment, const char* file, int line) override
+    {
+        return reallocate(ptr, size, alignment, file, line);
+    }
+
     /**
      * @brief Reset the allocator.
      *
@@ -231,6 +481,7 @@ public:
         }
 
         allocator_.reset();
+        count_reset();
 
         if constexpr (policy::is_active_threading_policy<ThreadPolicyT>)
         {
@@ -355,7 +606,7 @@ public:
 
 private:
     AllocatorT allocator_;
-    ThreadPolicyT thread_guard_;
+    mutable ThreadPolicyT thread_guard_;
     BoundsCheckerT bounds_checker_;
     MemoryTaggerT memory_tagger_;
     MemoryTrackerT memory_tracker_;
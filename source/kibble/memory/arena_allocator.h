@@ -0,0 +1,127 @@
+#pragma once
+
+#include "kibble/memory/arena_base.h"
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+namespace kb::memory
+{
+
+/**
+ * @brief Standard allocator adapter for memory arenas.
+ * This allows standard containers (and the likes of ankerl::unordered_dense) to allocate their storage in an arena:
+ * @code
+ * std::vector<int, ArenaAllocator<int>> vec(ArenaAllocator<int>(arena));
+ * @endcode
+ *
+ * The arena is accessed through the type-erased MemoryArenaBase interface, so a single allocator type works with
+ * any arena configuration. Allocations go through the arena policies (thread guard, bounds checking, tracking) like
+ * any K_NEW allocation.
+ *
+ * Standard containers never resize their storage in place, but containers of trivially copyable data can use
+ * reallocate() to benefit from in-place growth when the arena allocator supports it (see MemoryArena::reallocate()).
+ *
+ * @note Two ArenaAllocators compare equal when they use the same arena.
+ *
+ * @tparam T value type
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    /**
+     * @brief Create an allocator that will use a given arena.
+     *
+     * @param arena
+     */
+    ArenaAllocator(MemoryArenaBase& arena) noexcept : arena_(&arena)
+    {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena())
+    {
+    }
+
+    /**
+     * @brief Allocate storage for n objects.
+     *
+     * @param n
+     * @return T*
+     * @throw std::bad_alloc if the arena is out of memory
+     */
+    [[nodiscard]] T* allocate(std::size_t n)
+    {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+
+        void* ptr = arena_->allocate_bytes(n * sizeof(T), alignof(T), __FILE__, __LINE__);
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    /**
+     * @brief Free the storage of n objects.
+     *
+     * @param ptr
+     */
+    void deallocate(T* ptr, std::size_t) noexcept
+    {
+        arena_->deallocate_bytes(ptr, __FILE__, __LINE__);
+    }
+
+    /**
+     * @brief Resize the storage pointed to by ptr so that it can hold n objects, in place if possible.
+     * The existing objects are preserved up to the new size.
+     *
+     * @param ptr storage returned by allocate() or reallocate(), or nullptr
+     * @param n new number of objects, must not be 0
+     * @return T* new storage
+     * @throw std::bad_alloc if the arena is out of memory, ptr is still valid in that case
+     */
+    [[nodiscard]] T* reallocate(T* ptr, std::size_t n)
+        requires std::is_trivially_copyable_v<T>
+    {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+
+        void* new_ptr = arena_->reallocate_bytes(ptr, n * sizeof(T), alignof(T), __FILE__, __LINE__);
+        if (new_ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(new_ptr);
+    }
+
+    /// @brief Get the underlying arena
+    inline MemoryArenaBase* arena() const noexcept
+    {
+        return arena_;
+    }
+
+    template <typename U>
+    friend inline bool operator==(const ArenaAllocator& lhs, const ArenaAllocator<U>& rhs) noexcept
+    {
+        return lhs.arena() == rhs.arena();
+    }
+
+private:
+    MemoryArenaBase* arena_;
+};
+
+} // namespace kb::memory
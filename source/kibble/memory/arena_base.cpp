@@ -7,4 +7,19 @@ MemoryArenaBase::MemoryArenaBase(const char* name) : name_(name)
 {
 }
 
-} // namespace kb::memory
\ No newline at end of file
+void MemoryArenaBase::reset_peak()
+{
+    counters_.peak.store(counters_.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void MemoryArenaBase::get_counter_stats(ArenaStats& stats) const
+{
+    stats.name = name_;
+    stats.alloc_count = counters_.allocs.load(std::memory_order_relaxed);
+    stats.free_count = counters_.frees.load(std::memory_order_relaxed);
+    stats.failed_alloc_count = counters_.failures.load(std::memory_order_relaxed);
+    stats.live_size = counters_.live.load(std::memory_order_relaxed);
+    stats.peak_live_size = counters_.peak.load(std::memory_order_relaxed);
+}
+
+} // namespace kb::memory
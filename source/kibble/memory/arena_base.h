@@ -1,10 +1,58 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 
 namespace kb::memory
 {
 
+/**
+ * @brief Runtime statistics of an arena, see MemoryArenaBase::get_stats()
+ *
+ */
+struct ArenaStats
+{
+    /// Arena debug name
+    const char* name = nullptr;
+    /// Capacity of the arena in bytes
+    size_t total_size = 0;
+    /// Used size in bytes, as reported by the allocator (includes allocator bookkeeping). Allocators that do not
+    /// synchronize themselves are only inspected in StatsScope::Full, the live size is reported otherwise
+    size_t used_size = 0;
+    /// Size of the live allocations in bytes, decoration included
+    size_t live_size = 0;
+    /// High-water mark of the live size
+    size_t peak_live_size = 0;
+    /// Number of successful allocations
+    uint64_t alloc_count = 0;
+    /// Number of deallocations
+    uint64_t free_count = 0;
+    /// Number of allocations that failed because the arena was out of memory
+    uint64_t failed_alloc_count = 0;
+    /// True if the largest free block and fragmentation index are set, see StatsScope. Always false for pool
+    /// allocators, whose nodes are all the same size
+    bool detailed = false;
+    /// Size of the largest free block in bytes, only set if detailed
+    size_t largest_free_block = 0;
+    /// `1 - largest_free_block / free_size`: 0 when all the free memory is contiguous, close to 1 when it is scattered
+    /// in small blocks. Only set if detailed
+    float fragmentation = 0.f;
+};
+
+/**
+ * @brief Depth of the statistics gathered by MemoryArenaBase::get_stats()
+ *
+ */
+enum class StatsScope : uint8_t
+{
+    /// Counters only, can be gathered from any thread at any time
+    Counters,
+    /// Also inspect the allocator for its used size and largest free block. This takes the arena thread guard, so
+    /// with a single-threaded arena, it must be done from the thread that uses the arena
+    Full
+};
+
 /**
  * @brief Thin base for memory arenas
  *
@@ -25,8 +73,102 @@ public:
         return total_size() - used_size();
     }
 
+    /**
+     * @brief Get runtime statistics.
+     * Counters are maintained with relaxed atomics, so they are only approximately consistent with each other while
+     * the arena is in use.
+     *
+     * @param scope see StatsScope
+     * @return ArenaStats
+     */
+    virtual ArenaStats get_stats(StatsScope scope = StatsScope::Counters) const = 0;
+
+    /// @brief Restart high-water mark tracking from the current live size
+    void reset_peak();
+
+    // * Type-erased interface, used by ArenaAllocator
+
+    /// @brief Allocate a chunk of memory and return the user pointer, see MemoryArena::allocate()
+    virtual void* allocate_bytes(size_t size, size_t alignment, const char* file, int line) = 0;
+    /// @brief Deallocate a chunk allocated by allocate_bytes(), see MemoryArena::deallocate()
+    virtual void deallocate_bytes(void* ptr, const char* file, int line) = 0;
+    /// @brief Resize a chunk allocated by allocate_bytes(), see MemoryArena::reallocate()
+    virtual void* reallocate_bytes(void* ptr, size_t size, size_t alignment, const char* file, int line) = 0;
+
     /// @brief Arena debug name
     const char* name_{nullptr};
+
+protected:
+    /**
+     * @internal
+     * @brief Update the counters after an allocation.
+     *
+     * @tparam EXCLUSIVE true if the caller is the only thread that can update the counters at this point, in which
+     * case read-modify-write operations are not needed
+     * @param size decorated size of the allocation
+     */
+    template <bool EXCLUSIVE>
+    inline void count_allocation(size_t size)
+    {
+        add<EXCLUSIVE>(counters_.allocs, uint64_t(1));
+        size_t live = add<EXCLUSIVE>(counters_.live, size);
+        size_t peak = counters_.peak.load(std::memory_order_relaxed);
+        while (live > peak && !counters_.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /// @internal Update the counters after a deallocation
+    template <bool EXCLUSIVE>
+    inline void count_deallocation(size_t size)
+    {
+        add<EXCLUSIVE>(counters_.frees, uint64_t(1));
+        add<EXCLUSIVE>(counters_.live, size_t(0) - size);
+    }
+
+    /// @internal Update the counters after a failed allocation
+    template <bool EXCLUSIVE>
+    inline void count_failure()
+    {
+        add<EXCLUSIVE>(counters_.failures, uint64_t(1));
+    }
+
+    /// @internal All the memory was released at once
+    inline void count_reset()
+    {
+        counters_.live.store(0, std::memory_order_relaxed);
+    }
+
+    /// @internal Fill the counter part of the statistics
+    void get_counter_stats(ArenaStats& stats) const;
+
+private:
+    template <bool EXCLUSIVE, typename T>
+    static inline T add(std::atomic<T>& counter, T value)
+    {
+        if constexpr (EXCLUSIVE)
+        {
+            T result = counter.load(std::memory_order_relaxed) + value;
+            counter.store(result, std::memory_order_relaxed);
+            return result;
+        }
+        else
+        {
+            return counter.fetch_add(value, std::memory_order_relaxed) + value;
+        }
+    }
+
+    /// @internal On their own cache line, so that counter updates don't invalidate the rest of the arena
+    struct alignas(64) Counters
+    {
+        std::atomic<uint64_t> allocs{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> failures{0};
+        std::atomic<size_t> live{0};
+        std::atomic<size_t> peak{0};
+    };
+
+    Counters counters_;
 };
 
-} // namespace kb::memory
\ No newline at end of file
+} // namespace kb::memory
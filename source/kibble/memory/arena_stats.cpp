@@ -0,0 +1,154 @@
+#include "kibble/memory/arena_stats.h"
+#include "kibble/logger/logger.h"
+#include "kibble/string/string.h"
+
+#include "fmt/format.h"
+#include "fmt/ostream.h"
+#include <algorithm>
+
+namespace kb::memory
+{
+
+namespace
+{
+
+struct RegistryState
+{
+    std::mutex mutex;
+    std::vector<const MemoryArenaBase*> arenas;
+};
+
+RegistryState& registry_state()
+{
+    // Leaked on purpose: arenas with static storage duration may unregister after the registry would be destroyed
+    static auto* state = new RegistryState;
+    return *state;
+}
+
+} // namespace
+
+void ArenaRegistry::add(const MemoryArenaBase* arena)
+{
+    auto& state = registry_state();
+    std::scoped_lock lock(state.mutex);
+    state.arenas.push_back(arena);
+}
+
+void ArenaRegistry::remove(const MemoryArenaBase* arena)
+{
+    auto& state = registry_state();
+    std::scoped_lock lock(state.mutex);
+    std::erase(state.arenas, arena);
+}
+
+std::vector<ArenaStats> ArenaRegistry::snapshot(StatsScope scope)
+{
+    auto& state = registry_state();
+    std::scoped_lock lock(state.mutex);
+    std::vector<ArenaStats> result;
+    result.reserve(state.arenas.size());
+    for (const auto* arena : state.arenas)
+    {
+        result.push_back(arena->get_stats(scope));
+    }
+    return result;
+}
+
+void log_arena_stats(const std::vector<ArenaStats>& stats, const kb::log::Channel* channel)
+{
+    for (const auto& arena : stats)
+    {
+        std::string details;
+        if (arena.detailed)
+        {
+            details = fmt::format(", largest free: {}, fragmentation: {:.2f}",
+                                  kb::su::human_size(arena.largest_free_block), arena.fragmentation);
+        }
+        klog(channel)
+            .uid("ArenaStats")
+            .info("{}: used {}/{}, live {} (peak {}), allocs: {}, frees: {}, failed: {}{}", arena.name,
+                  kb::su::human_size(arena.used_size), kb::su::human_size(arena.total_size),
+                  kb::su::human_size(arena.live_size), kb::su::human_size(arena.peak_live_size), arena.alloc_count,
+                  arena.free_count, arena.failed_alloc_count, details);
+    }
+}
+
+void write_arena_stats_csv(std::ostream& os, const std::vector<ArenaStats>& stats, int64_t timestamp_ms, bool header)
+{
+    if (header)
+    {
+        os << "time_ms,arena,total_size,used_size,live_size,peak_live_size,alloc_count,free_count,failed_alloc_count,"
+              "largest_free_block,fragmentation\n";
+    }
+    for (const auto& arena : stats)
+    {
+        fmt::print(os, "{},{},{},{},{},{},{},{},{},", timestamp_ms, arena.name, arena.total_size, arena.used_size,
+                   arena.live_size, arena.peak_live_size, arena.alloc_count, arena.free_count,
+                   arena.failed_alloc_count);
+        if (arena.detailed)
+        {
+            fmt::print(os, "{},{:.4f}\n", arena.largest_free_block, arena.fragmentation);
+        }
+        else
+        {
+            os << ",\n";
+        }
+    }
+}
+
+ArenaStatsReporter::ArenaStatsReporter(std::chrono::milliseconds interval, const kb::log::Channel* channel,
+                                       const std::string& csv_path)
+    : interval_(interval), channel_(channel), start_(std::chrono::steady_clock::now())
+{
+    if (!csv_path.empty())
+    {
+        csv_.open(csv_path);
+        write_arena_stats_csv(csv_, {}, 0, true);
+    }
+    reporter_ = std::thread(&ArenaStatsReporter::report_loop, this);
+}
+
+ArenaStatsReporter::~ArenaStatsReporter()
+{
+    {
+        std::scoped_lock lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    reporter_.join();
+    report();
+}
+
+void ArenaStatsReporter::report()
+{
+    std::scoped_lock lock(report_mutex_);
+    auto stats = ArenaRegistry::snapshot(StatsScope::Counters);
+    if (channel_ != nullptr)
+    {
+        log_arena_stats(stats, channel_);
+    }
+    if (csv_.is_open())
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        write_arena_stats_csv(csv_, stats, std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(),
+                              false);
+        csv_.flush();
+    }
+}
+
+void ArenaStatsReporter::report_loop()
+{
+    std::unique_lock lock(mutex_);
+    while (!stop_)
+    {
+        if (cv_.wait_for(lock, interval_, [this]() { return stop_; }))
+        {
+            break;
+        }
+        lock.unlock();
+        report();
+        lock.lock();
+    }
+}
+
+} // namespace kb::memory
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "kibble/memory/arena_base.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kb::log
+{
+class Channel;
+}
+
+namespace kb::memory
+{
+
+/**
+ * @brief Process-wide list of the live arenas, to gather their statistics from anywhere.
+ * Every MemoryArena registers itself on construction and unregisters on destruction.
+ *
+ */
+class ArenaRegistry
+{
+public:
+    /**
+     * @brief Add an arena to the registry.
+     * @note Called by MemoryArena, once fully constructed.
+     *
+     * @param arena
+     */
+    static void add(const MemoryArenaBase* arena);
+
+    /**
+     * @brief Remove an arena from the registry.
+     * @note Called by MemoryArena, before it is destroyed.
+     *
+     * @param arena
+     */
+    static void remove(const MemoryArenaBase* arena);
+
+    /**
+     * @brief Get the statistics of all registered arenas, in registration order.
+     * Arenas cannot be destroyed while a snapshot is taken.
+     *
+     * @param scope see StatsScope. A Full snapshot of single-threaded arenas must be taken from their thread.
+     * @return std::vector<ArenaStats>
+     */
+    static std::vector<ArenaStats> snapshot(StatsScope scope = StatsScope::Counters);
+};
+
+/**
+ * @brief Print arena statistics on a logger channel, one line per arena.
+ *
+ * @param stats
+ * @param channel
+ */
+void log_arena_stats(const std::vector<ArenaStats>& stats, const kb::log::Channel* channel);
+
+/**
+ * @brief Write arena statistics as CSV rows, one row per arena.
+ *
+ * @param os output stream
+ * @param stats
+ * @param timestamp_ms time of the snapshot, first column of each row
+ * @param header also write the column names before the rows
+ */
+void write_arena_stats_csv(std::ostream& os, const std::vector<ArenaStats>& stats, int64_t timestamp_ms,
+                           bool header);
+
+/**
+ * @brief Periodically export the statistics of all registered arenas to a logger channel and/or a CSV file.
+ * A background thread takes a StatsScope::Counters snapshot at each period. The CSV file accumulates one row per arena
+ * and per period, which makes it easy to plot occupancy over time and to size arenas from real data.
+ *
+ */
+class ArenaStatsReporter
+{
+public:
+    /**
+     * @brief Start reporting.
+     *
+     * @param interval time between two reports
+     * @param channel logger channel to print the statistics on, or nullptr
+     * @param csv_path path of the CSV file to write, or an empty string
+     */
+    ArenaStatsReporter(std::chrono::milliseconds interval, const kb::log::Channel* channel,
+                       const std::string& csv_path = "");
+
+    /// @brief Stop reporting, a last report is issued
+    ~ArenaStatsReporter();
+
+    ArenaStatsReporter(const ArenaStatsReporter&) = delete;
+    ArenaStatsReporter& operator=(const ArenaStatsReporter&) = delete;
+
+    /// @brief Issue a report right now
+    void report();
+
+private:
+    void report_loop();
+
+private:
+    std::chrono::milliseconds interval_;
+    const kb::log::Channel* channel_;
+    std::ofstream csv_;
+    std::chrono::steady_clock::time_point start_;
+
+    std::mutex report_mutex_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread reporter_;
+};
+
+} // namespace kb::memory
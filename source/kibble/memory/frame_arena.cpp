@@ -0,0 +1,39 @@
+#include "kibble/memory/frame_arena.h"
+#include "kibble/memory/heap_area.h"
+#include "kibble/memory/util/alignment.h"
+
+namespace kb
+{
+namespace memory
+{
+
+FrameArena::FrameArena(HeapArea& area, size_t thread_count, size_t region_size, const char* debug_name)
+    : thread_count_(thread_count), region_size_(region_size)
+{
+    // Regions start on a cache line boundary so that threads never share a line
+    region_size_ = (region_size_ + k_cache_line_size - 1) & ~(k_cache_line_size - 1);
+    auto range = area.require_slab(2 * thread_count_ * region_size_ + k_cache_line_size, debug_name);
+    auto* begin = static_cast<uint8_t*>(range.first);
+    begin += alignment_padding(begin, k_cache_line_size);
+
+    slots_.reserve(thread_count_);
+    for (size_t ii = 0; ii < thread_count_; ++ii)
+    {
+        uint8_t* slot_begin = begin + 2 * ii * region_size_;
+        slots_.push_back({{StackAllocator(slot_begin, slot_begin + region_size_),
+                           StackAllocator(slot_begin + region_size_, slot_begin + 2 * region_size_)}});
+    }
+}
+
+void FrameArena::swap_buffers()
+{
+    current_ ^= 1;
+    for (size_t ii = 0; ii < thread_count_; ++ii)
+    {
+        slots_[ii].regions[current_].reset();
+    }
+    ++frame_index_;
+}
+
+} // namespace memory
+} // namespace kb
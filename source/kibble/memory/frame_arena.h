@@ -0,0 +1,163 @@
+#pragma once
+
+#include "kibble/memory/allocator/stack_allocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace kb
+{
+namespace memory
+{
+
+class HeapArea;
+
+/**
+ * @brief Per-thread, double-buffered scratch memory for frame-based applications.
+ *
+ * Each thread owns two stack regions carved from a single HeapArea: the current region receives this frame's
+ * allocations, and the previous region holds last frame's data, which stays valid for exactly one more frame. At the
+ * end of a frame, swap_buffers() resets the previous regions and swaps the roles.
+ *
+ * Threads only ever touch their own regions, so allocation is a pointer bump without any synchronization. Jobs
+ * running on JobSystem workers can get their slot with JobSystem::this_thread_id():
+ * @code
+ * memory::FrameArena frame(area, js.get_threads_count(), 1_MB);
+ * js.create_task(..., [&]() {
+ *     auto tid = js.this_thread_id();
+ *     auto scope = frame.scope(tid);
+ *     float* tmp = frame.allocate_array<float>(tid, 1024);
+ *     // ...
+ * });
+ * @endcode
+ *
+ * @note Only trivially destructible data can live in a frame arena, nothing is destroyed on reset.
+ *
+ */
+class FrameArena
+{
+public:
+    /**
+     * @brief Reserve all the regions on a HeapArea.
+     *
+     * @param area memory resource
+     * @param thread_count number of thread slots, typically JobSystem::get_threads_count()
+     * @param region_size size of each region, each thread uses two of them
+     * @param debug_name name of the slab in the area
+     */
+    FrameArena(HeapArea& area, size_t thread_count, size_t region_size, const char* debug_name = "FrameArena");
+
+    /**
+     * @brief Allocate a chunk of scratch memory valid until the end of the next frame.
+     *
+     * @note Lock-free, each thread must use its own slot.
+     *
+     * @param tid thread slot
+     * @param size size of the chunk
+     * @param alignment alignment constraint
+     * @return void*
+     */
+    inline void* allocate(uint32_t tid, size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        return current(tid).allocate(size, alignment, 0);
+    }
+
+    /**
+     * @brief Construct an object in scratch memory.
+     *
+     * @tparam T trivially destructible type
+     * @param tid thread slot
+     * @param args constructor arguments
+     * @return T*
+     */
+    template <typename T, typename... ArgsT>
+    inline T* create(uint32_t tid, ArgsT&&... args)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "Frame arena objects are never destroyed");
+        return ::new (allocate(tid, sizeof(T), alignof(T))) T(std::forward<ArgsT>(args)...);
+    }
+
+    /**
+     * @brief Allocate an uninitialized array in scratch memory.
+     *
+     * @tparam T trivial type
+     * @param tid thread slot
+     * @param count number of elements
+     * @return T*
+     */
+    template <typename T>
+    inline T* allocate_array(uint32_t tid, size_t count)
+    {
+        static_assert(std::is_trivial_v<T>, "Frame arena arrays are not initialized");
+        return static_cast<T*>(allocate(tid, sizeof(T) * count, alignof(T)));
+    }
+
+    /**
+     * @brief Open a scope in the current region of a thread, everything allocated in it is freed when it closes.
+     *
+     * @param tid thread slot
+     * @return StackScope<StackAllocator>
+     */
+    inline StackScope<StackAllocator> scope(uint32_t tid)
+    {
+        return StackScope<StackAllocator>(current(tid));
+    }
+
+    /**
+     * @brief End the frame.
+     * Last frame's data is freed, and this frame's data becomes last frame's data.
+     *
+     * @warning Must be called when no thread is using the arena, typically after JobSystem::wait().
+     *
+     */
+    void swap_buffers();
+
+    /// @brief Get the region of a thread that receives this frame's allocations
+    inline StackAllocator& current(uint32_t tid)
+    {
+        return slots_[tid].regions[current_];
+    }
+
+    /// @brief Get the region of a thread that holds last frame's data
+    inline StackAllocator& previous(uint32_t tid)
+    {
+        return slots_[tid].regions[current_ ^ 1];
+    }
+
+    /// @brief Get the number of frames since creation
+    inline uint64_t get_frame_index() const
+    {
+        return frame_index_;
+    }
+
+    /// @brief Get the number of thread slots
+    inline size_t get_thread_count() const
+    {
+        return thread_count_;
+    }
+
+    /// @brief Get the size of each region in bytes
+    inline size_t get_region_size() const
+    {
+        return region_size_;
+    }
+
+private:
+    /// @internal Each thread slot is on its own cache lines
+    struct alignas(64) Slot
+    {
+        StackAllocator regions[2];
+    };
+
+    size_t thread_count_;
+    size_t region_size_;
+    size_t current_{0};
+    uint64_t frame_index_{0};
+    std::vector<Slot> slots_;
+};
+
+} // namespace memory
+} // namespace kb
@@ -8,12 +8,36 @@
 #include "kibble/string/string.h"
 
 #include "fmt/color.h"
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace kb
 {
 namespace memory
 {
 
+namespace
+{
+
+#ifdef __linux__
+// Huge page size on x86-64 and most aarch64 configurations
+constexpr size_t k_huge_page_size = 2 * 1024 * 1024;
+// From linux/mempolicy.h, so as not to depend on libnuma
+constexpr int k_mpol_bind = 2;
+#endif
+
+inline size_t round_up(size_t value, size_t multiple)
+{
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+} // namespace
+
 void HeapArea::debug_show_content()
 {
     size_t b_addr = reinterpret_cast<size_t>(begin_);
@@ -55,21 +79,215 @@ void HeapArea::debug_show_content()
     }
 }
 
-HeapArea::HeapArea(size_t size, const kb::log::Channel* channel) : size_(size), log_channel_(channel)
+HeapArea::HeapArea(size_t size, const kb::log::Channel* channel) : HeapArea(size, Config{}, channel)
 {
-    begin_ = new uint8_t[size_];
-    head_ = begin_;
+}
+
+HeapArea::HeapArea(size_t size, const Config& config, const kb::log::Channel* channel)
+    : size_(size), config_(config), log_channel_(channel)
+{
+#ifndef __linux__
+    if (config_.backend == AreaBackend::VirtualMemory)
+    {
+        klog(log_channel_).uid("HeapArea").warn("VirtualMemory backend is not supported, falling back to Heap.");
+        config_.backend = AreaBackend::Heap;
+    }
+#endif
+
+    if (config_.backend == AreaBackend::VirtualMemory)
+    {
+        reserve();
+    }
+    else
+    {
+        begin_ = new uint8_t[size_];
+        committed_ = begin_ + size_;
 #ifdef K_USE_MEM_AREA_MEMSET
-    memset(begin_, k_area_memset_byte, size_);
+        memset(begin_, k_area_memset_byte, size_);
 #endif
-    klog(log_channel_).uid("HeapArea").debug("Size: {} Begin: {:#x}", su::human_size(size_), uint64_t(begin_));
+    }
+
+    head_ = begin_;
+    klog(log_channel_)
+        .uid("HeapArea")
+        .debug("Size: {} Begin: {:#x} Backend: {}", su::human_size(size_), uint64_t(begin_),
+               (config_.backend == AreaBackend::VirtualMemory) ? "virtual memory" : "heap");
 }
 
 HeapArea::~HeapArea()
 {
+    if (config_.backend == AreaBackend::VirtualMemory)
+    {
+#ifdef __linux__
+        munmap(begin_, mapped_size_);
+#endif
+        return;
+    }
     delete[] begin_;
 }
 
+void HeapArea::reserve()
+{
+#ifdef __linux__
+    page_size_ = size_t(sysconf(_SC_PAGESIZE));
+    // end() points one byte past the last byte of the area
+    size_t required = size_ + 1;
+    void* ptr = MAP_FAILED;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+
+    // Pages are inaccessible until they are committed. If the area must be bound to a NUMA node, it is prefaulted
+    // after binding, otherwise the pages would be allocated with the default policy.
+    bool populate_now = config_.populate && config_.numa_node < 0;
+    int prot = config_.populate ? (PROT_READ | PROT_WRITE) : PROT_NONE;
+    if (populate_now)
+    {
+        flags |= MAP_POPULATE;
+    }
+
+    if (config_.huge_pages == HugePages::Explicit)
+    {
+        // Huge pages must be reserved up front, otherwise the mapping succeeds and faults fail later on
+        mapped_size_ = round_up(required, k_huge_page_size);
+        ptr = mmap(nullptr, mapped_size_, prot, (flags & ~MAP_NORESERVE) | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED)
+        {
+            page_size_ = k_huge_page_size;
+        }
+        else
+        {
+            klog(log_channel_)
+                .uid("HeapArea")
+                .warn("Could not map {} of explicit huge pages, falling back to transparent huge pages.",
+                      su::human_size(mapped_size_));
+        }
+    }
+
+    if (ptr == MAP_FAILED)
+    {
+        bool huge = (config_.huge_pages != HugePages::None);
+        mapped_size_ = round_up(required, huge ? k_huge_page_size : page_size_);
+
+        // Over-reserve so that the area can be aligned to the huge page size, then trim the excess
+        size_t reserved = mapped_size_ + (huge ? k_huge_page_size : 0);
+        ptr = mmap(nullptr, reserved, prot, flags, -1, 0);
+        if (ptr == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+        if (huge)
+        {
+            auto* base = static_cast<uint8_t*>(ptr);
+            auto* aligned = base + alignment_padding(base, k_huge_page_size);
+            size_t head = size_t(aligned - base);
+            if (head > 0)
+            {
+                munmap(base, head);
+            }
+            if (reserved - head > mapped_size_)
+            {
+                munmap(aligned + mapped_size_, reserved - head - mapped_size_);
+            }
+            ptr = aligned;
+            madvise(ptr, mapped_size_, MADV_HUGEPAGE);
+        }
+    }
+
+    begin_ = static_cast<uint8_t*>(ptr);
+    committed_ = config_.populate ? begin_ + mapped_size_ : begin_;
+    config_.commit_granularity = round_up(std::max(config_.commit_granularity, page_size_), page_size_);
+
+    if (config_.numa_node >= 0)
+    {
+        // The node mask is limited to 64 nodes, which is more than enough. Other nodes keep the default policy.
+        unsigned long nodemask = 0;
+        if (size_t(config_.numa_node) >= sizeof(nodemask) * 8)
+        {
+            klog(log_channel_).uid("HeapArea").warn("NUMA node {} out of range, area is not bound.", config_.numa_node);
+        }
+        else
+        {
+            nodemask = 1ul << config_.numa_node;
+            // The kernel only reads maxnode - 1 bits of the mask, pass one more than its size like libnuma does
+            if (syscall(SYS_mbind, begin_, mapped_size_, k_mpol_bind, &nodemask, sizeof(nodemask) * 8 + 1, 0) != 0)
+            {
+                klog(log_channel_).uid("HeapArea").warn("Could not bind area to NUMA node {}.", config_.numa_node);
+            }
+        }
+        if (config_.populate)
+        {
+            // Prefault on the bound node by touching one byte per page
+            for (size_t offset = 0; offset < mapped_size_; offset += page_size_)
+            {
+                *static_cast<volatile uint8_t*>(begin_ + offset) = 0;
+            }
+        }
+    }
+
+#ifdef K_USE_MEM_AREA_MEMSET
+    if (config_.populate && k_area_memset_byte != 0)
+    {
+        memset(begin_, k_area_memset_byte, mapped_size_);
+    }
+#endif
+#endif
+}
+
+void HeapArea::commit(uint8_t* ptr)
+{
+    if (ptr <= committed_)
+    {
+        return;
+    }
+
+#ifdef __linux__
+    size_t target = std::min(mapped_size_, round_up(size_t(ptr - begin_), config_.commit_granularity));
+    auto* commit_end = begin_ + target;
+    if (mprotect(committed_, size_t(commit_end - committed_), PROT_READ | PROT_WRITE) != 0)
+    {
+        throw std::bad_alloc();
+    }
+#ifdef K_USE_MEM_AREA_MEMSET
+    if (k_area_memset_byte != 0)
+    {
+        memset(committed_, k_area_memset_byte, size_t(commit_end - committed_));
+    }
+#endif
+    committed_ = commit_end;
+#endif
+}
+
+size_t HeapArea::release(void* begin, void* end)
+{
+    if (config_.backend != AreaBackend::VirtualMemory)
+    {
+        return 0;
+    }
+
+#ifdef __linux__
+    // Only whole pages inside the range can be released
+    auto* first = static_cast<uint8_t*>(begin);
+    first += alignment_padding(first, page_size_);
+    auto* last = std::min(static_cast<uint8_t*>(end), committed_);
+    last -= size_t(last - begin_) % page_size_;
+    if (last <= first)
+    {
+        return 0;
+    }
+
+    size_t size = size_t(last - first);
+    if (madvise(first, size, MADV_DONTNEED) != 0)
+    {
+        return 0;
+    }
+    klog(log_channel_).uid("HeapArea").verbose("Released {} at {:#x}", su::human_size(size), uint64_t(first));
+    return size;
+#else
+    (void)begin;
+    (void)end;
+    return 0;
+#endif
+}
+
 void HeapArea::debug_hex_dump(size_t size)
 {
     if (size == 0)
@@ -86,6 +304,8 @@ std::pair<void*, void*> HeapArea::require_slab(size_t size, const MemoryArenaBas
     K_ASSERT(head_ + size + padding < end(), "[HeapArea] Out of memory!\n  -> Required: {}, available: {}",
              size + padding, size_);
 
+    commit(head_ + padding + size + 1);
+
     // Mark padding area
 #ifdef K_USE_MEM_MARK_PADDING
     std::fill(head_, head_ + padding, k_alignment_padding_mark);
@@ -123,6 +343,8 @@ std::pair<void*, void*> HeapArea::require_slab(size_t size, const char* debug_na
     K_ASSERT(head_ + size + padding < end(), "[HeapArea] Out of memory!\n  -> Required: {}, available: {}",
              size + padding, size_);
 
+    commit(head_ + padding + size + 1);
+
     // Mark padding area
 #ifdef K_USE_MEM_MARK_PADDING
     std::fill(head_, head_ + padding, k_alignment_padding_mark);
@@ -38,16 +38,69 @@ struct SlabDescriptor
 
 } // namespace debug
 
+/**
+ * @brief Where the memory of a HeapArea comes from.
+ *
+ */
+enum class AreaBackend : uint8_t
+{
+    /// The whole area is allocated with new[] at construction
+    Heap,
+    /// Address space is reserved at construction, and pages are committed as slabs are required (Linux only, other
+    /// platforms fall back to Heap)
+    VirtualMemory
+};
+
+/**
+ * @brief Huge pages policy of a HeapArea using the VirtualMemory backend.
+ * Huge pages reduce TLB misses when accessing large arenas randomly.
+ *
+ */
+enum class HugePages : uint8_t
+{
+    /// Regular pages
+    None,
+    /// Transparent huge pages, requested with madvise(MADV_HUGEPAGE). The area is aligned to the huge page size
+    Transparent,
+    /// Pages from the hugetlbfs pool (MAP_HUGETLB). Falls back to transparent huge pages if the pool is too small
+    Explicit
+};
+
 /**
  * @brief Memory resource used by memory arenas.
  * A HeapArea is just a big range of memory allocated on the heap. The memory arenas are given a block of a given size
  * belonging to a heap area, and are responsible for the memory management strategy and allocation operations on this
  * block.
  *
+ * With the VirtualMemory backend, constructing even a huge area is almost free: only address space is reserved, and
+ * physical pages are committed in chunks of Config::commit_granularity as require_slab() advances the head. This also
+ * allows to bind the area to a NUMA node, to use huge pages, and to give the pages of a slab back to the OS with
+ * release().
+ *
  */
 class HeapArea
 {
 public:
+    /**
+     * @brief HeapArea configuration structure.
+     *
+     */
+    struct Config
+    {
+        /// Allocation strategy
+        AreaBackend backend = AreaBackend::Heap;
+        /// Huge pages policy (VirtualMemory only)
+        HugePages huge_pages = HugePages::None;
+        /// NUMA node the pages are allocated on, negative for the default policy (VirtualMemory only). Nodes past 63
+        /// cannot be bound, a warning is logged and the default policy is used
+        int32_t numa_node = -1;
+        /// Prefault the whole area at construction, this trades startup time for no page faults later on
+        /// (VirtualMemory only)
+        bool populate = false;
+        /// Pages are committed by chunks of at least this size (VirtualMemory only)
+        size_t commit_granularity = 256 * 1024;
+    };
+
     HeapArea() = default;
 
     /**
@@ -60,6 +113,18 @@ public:
      */
     explicit HeapArea(size_t size, const kb::log::Channel* channel = nullptr);
 
+    /**
+     * @brief Create a heap area with a specific backend.
+     * If K_USE_MEM_AREA_MEMSET is defined, the VirtualMemory backend only initializes the committed pages, and only
+     * if k_area_memset_byte is not zero, as fresh pages are already zeroed.
+     * If the address space cannot be reserved, the constructor will throw a std::bad_alloc exception.
+     *
+     * @param size size of the area
+     * @param config backend configuration
+     * @param channel logging channel
+     */
+    HeapArea(size_t size, const Config& config, const kb::log::Channel* channel = nullptr);
+
     /**
      * @brief Free the whole area.
      *
@@ -119,6 +184,19 @@ public:
      */
     std::pair<void*, void*> require_slab(size_t size, const char* debug_name = nullptr);
 
+    /**
+     * @brief Give the physical pages of a range back to the OS (madvise(MADV_DONTNEED)).
+     * Only the pages fully contained in the range are released. The range stays valid: it will read back as zeros and
+     * will be faulted in again when written to. Typically used on the slab of an arena that was reset and will not be
+     * used for some time.
+     * Does nothing with the Heap backend.
+     *
+     * @param begin beginning of the range
+     * @param end end of the range
+     * @return number of bytes released
+     */
+    size_t release(void* begin, void* end);
+
     /**
      * @brief Show the content of the area using the logger.
      * The channel "memory" must be setup for this to work.
@@ -153,6 +231,12 @@ public:
     inline size_t free_size() const{ return static_cast<size_t>(static_cast<uint8_t*>(end()) - head_); }
     /// @brief Get used size in bytes
     inline size_t used_size() const{ return static_cast<size_t>(head_ - static_cast<uint8_t*>(begin())); }
+    /// @brief Get the size in bytes of the memory backed by physical pages (or that will be on first access)
+    inline size_t committed_size() const{ return static_cast<size_t>(committed_ - begin_); }
+    /// @brief Get the backend actually used by this area
+    inline AreaBackend backend() const{ return config_.backend; }
+    /// @brief Get the size of the pages backing this area (0 with the Heap backend)
+    inline size_t page_size() const{ return page_size_; }
     // clang-format on
 
     /**
@@ -162,6 +246,7 @@ public:
      */
     inline void fill(uint8_t filler)
     {
+        commit(begin_ + size_);
         std::fill(begin_, begin_ + size_, filler);
     }
 
@@ -170,10 +255,18 @@ public:
         return log_channel_;
     }
 
+private:
+    void reserve();
+    void commit(uint8_t* ptr);
+
 private:
     size_t size_;
     uint8_t* begin_;
     uint8_t* head_;
+    uint8_t* committed_;
+    Config config_;
+    size_t page_size_ = 0;
+    size_t mapped_size_ = 0;
 
     std::vector<debug::SlabDescriptor> items_; // for debug
     const kb::log::Channel* log_channel_ = nullptr;
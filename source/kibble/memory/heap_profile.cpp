@@ -0,0 +1,134 @@
+#include "kibble/memory/heap_profile.h"
+#include "kibble/util/pod_io.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+
+namespace kb::memory
+{
+
+static_assert(sizeof(heap_profile::FileHeader) == 32, "FileHeader must not be padded");
+
+namespace
+{
+
+inline void write_string(std::ostream& os, const std::string& str)
+{
+    write_pod(os, uint32_t(str.size()));
+    os.write(str.data(), std::streamsize(str.size()));
+}
+
+inline bool read_string(std::istream& is, std::string& str)
+{
+    uint32_t size = 0;
+    if (!read_pod(is, size))
+    {
+        return false;
+    }
+    str.resize(size);
+    return bool(is.read(str.data(), std::streamsize(size)));
+}
+
+} // namespace
+
+int64_t HeapProfile::live_bytes() const
+{
+    int64_t total = 0;
+    for (const auto& site : sites)
+    {
+        total += site.live_bytes;
+    }
+    return total;
+}
+
+void HeapProfile::sort_by_live_bytes()
+{
+    std::stable_sort(sites.begin(), sites.end(), [](const SiteStats& lhs, const SiteStats& rhs) {
+        return std::abs(lhs.live_bytes) > std::abs(rhs.live_bytes);
+    });
+}
+
+void write_heap_profile(std::ostream& os, const HeapProfile& profile)
+{
+    heap_profile::FileHeader header;
+    header.site_count = uint32_t(profile.sites.size());
+    header.sample_period = profile.sample_period;
+    header.timestamp_ns = profile.timestamp_ns;
+    write_pod(os, header);
+    write_string(os, profile.arena);
+
+    for (const auto& site : profile.sites)
+    {
+        write_string(os, site.location);
+        write_pod(os, site.alloc_count);
+        write_pod(os, site.alloc_bytes);
+        write_pod(os, site.live_count);
+        write_pod(os, site.live_bytes);
+    }
+}
+
+bool read_heap_profile(std::istream& is, HeapProfile& profile)
+{
+    heap_profile::FileHeader header;
+    if (!read_pod(is, header) || header.magic != heap_profile::k_magic || header.version != heap_profile::k_version)
+    {
+        return false;
+    }
+    profile.sample_period = header.sample_period;
+    profile.timestamp_ns = header.timestamp_ns;
+    if (!read_string(is, profile.arena))
+    {
+        return false;
+    }
+
+    profile.sites.resize(header.site_count);
+    for (auto& site : profile.sites)
+    {
+        if (!read_string(is, site.location) || !read_pod(is, site.alloc_count) || !read_pod(is, site.alloc_bytes) ||
+            !read_pod(is, site.live_count) || !read_pod(is, site.live_bytes))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+HeapProfile diff_heap_profiles(const HeapProfile& before, const HeapProfile& after)
+{
+    HeapProfile result;
+    result.arena = after.arena;
+    result.sample_period = after.sample_period;
+    result.timestamp_ns = after.timestamp_ns;
+
+    std::unordered_map<std::string, size_t> index;
+    for (const auto& site : after.sites)
+    {
+        index.insert({site.location, result.sites.size()});
+        result.sites.push_back(site);
+    }
+
+    for (const auto& site : before.sites)
+    {
+        auto [it, inserted] = index.insert({site.location, result.sites.size()});
+        if (inserted)
+        {
+            result.sites.push_back({site.location, 0, 0, 0, 0});
+        }
+        auto& delta = result.sites[it->second];
+        delta.alloc_count -= site.alloc_count;
+        delta.alloc_bytes -= site.alloc_bytes;
+        delta.live_count -= site.live_count;
+        delta.live_bytes -= site.live_bytes;
+    }
+
+    std::erase_if(result.sites, [](const SiteStats& site) {
+        return site.alloc_count == 0 && site.alloc_bytes == 0 && site.live_count == 0 && site.live_bytes == 0;
+    });
+    result.sort_by_live_bytes();
+
+    return result;
+}
+
+} // namespace kb::memory
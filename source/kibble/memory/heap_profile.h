@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace kb::memory
+{
+
+/**
+ * @brief Allocation statistics of a single allocation site.
+ * When the profile was produced by a sampling tracker, all the values are unbiased estimates.
+ *
+ */
+struct SiteStats
+{
+    /// "file:line", optionally followed by a formatted stack trace on the next lines
+    std::string location;
+    /// Number of allocations performed at this site
+    int64_t alloc_count = 0;
+    /// Number of bytes allocated at this site
+    int64_t alloc_bytes = 0;
+    /// Number of allocations from this site that are still alive
+    int64_t live_count = 0;
+    /// Number of bytes from this site that are still alive
+    int64_t live_bytes = 0;
+};
+
+/**
+ * @brief Snapshot of the allocation sites of an arena.
+ *
+ */
+struct HeapProfile
+{
+    /// Name of the arena
+    std::string arena;
+    /// Mean number of bytes between two samples, 0 if every allocation was recorded
+    uint64_t sample_period = 0;
+    /// Time of the snapshot in ns since epoch, system clock
+    int64_t timestamp_ns = 0;
+    /// Per-site statistics
+    std::vector<SiteStats> sites;
+
+    /// Sum of the live bytes of all sites
+    int64_t live_bytes() const;
+    /// Sort sites by decreasing absolute live size
+    void sort_by_live_bytes();
+};
+
+/**
+ * @brief Compact binary heap profile format.
+ *
+ * A profile file starts with a FileHeader, followed by the arena name (uint32 length, then bytes), and site_count
+ * site records. Each site record is the location string (uint32 length, then bytes) followed by the four int64
+ * statistics in SiteStats order. All values are in native byte order.
+ *
+ */
+namespace heap_profile
+{
+
+/// "KHPF" in little endian
+constexpr uint32_t k_magic = 0x4650484b;
+constexpr uint16_t k_version = 1;
+
+struct FileHeader
+{
+    uint32_t magic = k_magic;
+    uint16_t version = k_version;
+    uint16_t reserved = 0;
+    uint32_t site_count = 0;
+    uint32_t reserved2 = 0;
+    uint64_t sample_period = 0;
+    int64_t timestamp_ns = 0;
+};
+
+} // namespace heap_profile
+
+/**
+ * @brief Serialize a heap profile.
+ *
+ * @param os output stream, opened in binary mode
+ * @param profile
+ */
+void write_heap_profile(std::ostream& os, const HeapProfile& profile);
+
+/**
+ * @brief Parse a heap profile.
+ *
+ * @param is input stream, opened in binary mode
+ * @param profile parsed profile
+ * @return false if the stream is not a valid or complete profile
+ */
+bool read_heap_profile(std::istream& is, HeapProfile& profile);
+
+/**
+ * @brief Compute the evolution between two snapshots.
+ * Sites are matched by location, and each statistic of the result is `after - before`. Sites that did not change are
+ * omitted. The result is sorted by decreasing absolute live size delta, so the first sites are the most likely to
+ * leak or bloat.
+ *
+ * @param before older snapshot
+ * @param after newer snapshot
+ * @return HeapProfile
+ */
+HeapProfile diff_heap_profiles(const HeapProfile& before, const HeapProfile& after);
+
+} // namespace kb::memory
@@ -0,0 +1,301 @@
+#include "kibble/memory/policy/memory_tracking_sampling.h"
+#include "kibble/logger/logger.h"
+#include "kibble/memory/heap_area.h"
+#include "kibble/string/string.h"
+
+#include "fmt/format.h"
+#include <cmath>
+#include <fstream>
+
+namespace kb::memory::policy
+{
+
+namespace
+{
+
+constexpr std::size_t k_site_index_size = 2 * SamplingMemoryTracking::k_max_sites;
+constexpr std::size_t k_site_index_mask = k_site_index_size - 1;
+constexpr std::size_t k_live_sample_mask = SamplingMemoryTracking::k_max_live_samples - 1;
+// Keep probe sequences short
+constexpr std::size_t k_max_live_load = 3 * SamplingMemoryTracking::k_max_live_samples / 4;
+// Frames of the tracker and the arena that are not part of the call stack of interest
+constexpr std::size_t k_stack_skip = 4;
+
+static_assert((k_site_index_size & k_site_index_mask) == 0, "site index size must be a power of 2");
+static_assert((SamplingMemoryTracking::k_max_live_samples & k_live_sample_mask) == 0,
+              "live sample table size must be a power of 2");
+
+inline uint64_t mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+inline std::size_t live_slot(const uint8_t* begin)
+{
+    return mix(reinterpret_cast<uint64_t>(begin)) & k_live_sample_mask;
+}
+
+} // namespace
+
+void SamplingMemoryTracking::init(const std::string& debug_name, const HeapArea& area)
+{
+    debug_name_ = debug_name;
+    log_channel_ = area.get_logger_channel();
+
+    // Site 0 aggregates everything that does not fit in the site table, index value 0 marks an empty slot
+    sites_.reserve(k_max_sites);
+    sites_.emplace_back();
+    site_index_.assign(k_site_index_size, 0);
+    live_samples_.assign(k_max_live_samples, LiveSample{});
+
+    rng_state_ = reinterpret_cast<uint64_t>(this) ^
+                 static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    bytes_until_sample_ = next_sample_interval();
+}
+
+void SamplingMemoryTracking::set_sample_period(std::size_t period)
+{
+    sample_period_ = period;
+    bytes_until_sample_ = next_sample_interval();
+}
+
+void SamplingMemoryTracking::set_snapshot_output(const std::string& prefix, std::chrono::milliseconds interval)
+{
+    snapshot_prefix_ = prefix;
+    snapshot_interval_ = interval;
+    next_snapshot_ = std::chrono::steady_clock::now() + interval;
+}
+
+int64_t SamplingMemoryTracking::next_sample_interval()
+{
+    if (sample_period_ == 0)
+    {
+        return 0;
+    }
+
+    // Exponentially distributed interval, so that samples form a Poisson process over allocated bytes
+    rng_state_ += 0x9e3779b97f4a7c15ULL;
+    double uniform = static_cast<double>((mix(rng_state_) >> 11) + 1) * 0x1.0p-53;
+    double interval = -std::log(uniform) * static_cast<double>(sample_period_);
+    return std::max(int64_t(1), static_cast<int64_t>(interval));
+}
+
+uint32_t SamplingMemoryTracking::find_site(const char* file, int line)
+{
+    std::optional<StackTrace> trace;
+    uint64_t key = 0;
+    if (capture_stack_traces_)
+    {
+        trace.emplace(k_stack_skip);
+        key = trace->hash();
+    }
+    else
+    {
+        key = reinterpret_cast<uint64_t>(file) ^ (static_cast<uint64_t>(line) << 48);
+    }
+
+    std::size_t slot = mix(key) & k_site_index_mask;
+    while (site_index_[slot] != 0)
+    {
+        if (sites_[site_index_[slot]].key == key)
+        {
+            return site_index_[slot];
+        }
+        slot = (slot + 1) & k_site_index_mask;
+    }
+
+    if (sites_.size() == k_max_sites)
+    {
+        return 0;
+    }
+
+    auto index = static_cast<uint16_t>(sites_.size());
+    site_index_[slot] = index;
+    auto& site = sites_.emplace_back();
+    site.key = key;
+    site.file = file;
+    site.line = line;
+    site.trace = std::move(trace);
+    return index;
+}
+
+void SamplingMemoryTracking::record_sample(uint8_t* begin, std::size_t size, const char* file, int line)
+{
+    ++sample_count_;
+    bytes_until_sample_ = next_sample_interval();
+
+    // Inverse of the probability to sample an allocation of this size
+    double weight = 1.0;
+    if (sample_period_ > 0)
+    {
+        weight = -1.0 / std::expm1(-static_cast<double>(size) / static_cast<double>(sample_period_));
+    }
+    double bytes = weight * static_cast<double>(size);
+
+    uint32_t site_index = find_site(file, line);
+    auto& site = sites_[site_index];
+    site.alloc_count += weight;
+    site.alloc_bytes += bytes;
+
+    if (live_sample_count_ >= k_max_live_load)
+    {
+        ++dropped_samples_;
+    }
+    else
+    {
+        // A chunk freed without notification (arena reset) may have left a stale sample at this address
+        retire_sample(begin);
+
+        std::size_t slot = live_slot(begin);
+        while (live_samples_[slot].begin != nullptr)
+        {
+            slot = (slot + 1) & k_live_sample_mask;
+        }
+        live_samples_[slot] = {begin, site_index, weight, bytes};
+        ++live_sample_count_;
+        ++live_filter_[filter_slot(begin)];
+        site.live_count += weight;
+        site.live_bytes += bytes;
+    }
+
+    if (!snapshot_prefix_.empty())
+    {
+        dump_periodic_snapshot();
+    }
+}
+
+void SamplingMemoryTracking::retire_sample(uint8_t* begin)
+{
+    std::size_t slot = live_slot(begin);
+    while (live_samples_[slot].begin != begin)
+    {
+        if (live_samples_[slot].begin == nullptr)
+        {
+            return;
+        }
+        slot = (slot + 1) & k_live_sample_mask;
+    }
+
+    const auto& sample = live_samples_[slot];
+    auto& site = sites_[sample.site];
+    site.live_count -= sample.weight;
+    site.live_bytes -= sample.bytes;
+    --live_sample_count_;
+    --live_filter_[filter_slot(begin)];
+
+    // Backward shift deletion, so that probe sequences stay contiguous
+    std::size_t hole = slot;
+    std::size_t next = slot;
+    while (true)
+    {
+        next = (next + 1) & k_live_sample_mask;
+        if (live_samples_[next].begin == nullptr)
+        {
+            break;
+        }
+        std::size_t home = live_slot(live_samples_[next].begin);
+        if (((next - home) & k_live_sample_mask) >= ((next - hole) & k_live_sample_mask))
+        {
+            live_samples_[hole] = live_samples_[next];
+            hole = next;
+        }
+    }
+    live_samples_[hole] = LiveSample{};
+}
+
+void SamplingMemoryTracking::dump_periodic_snapshot()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now < next_snapshot_)
+    {
+        return;
+    }
+    next_snapshot_ = now + snapshot_interval_;
+    dump_snapshot(fmt::format("{}.{:04}.khp", snapshot_prefix_, snapshot_index_++));
+}
+
+HeapProfile SamplingMemoryTracking::snapshot() const
+{
+    HeapProfile profile;
+    profile.arena = debug_name_;
+    profile.sample_period = sample_period_;
+    profile.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+
+    for (const auto& site : sites_)
+    {
+        if (site.alloc_count == 0.0)
+        {
+            continue;
+        }
+
+        auto& stats = profile.sites.emplace_back();
+        if (site.file == nullptr)
+        {
+            stats.location = "<other sites>";
+        }
+        else
+        {
+            stats.location = fmt::format("{}:{}", site.file, site.line);
+        }
+        if (site.trace.has_value())
+        {
+            stats.location += '\n';
+            stats.location += site.trace->format();
+        }
+        stats.alloc_count = std::llround(site.alloc_count);
+        stats.alloc_bytes = std::llround(site.alloc_bytes);
+        stats.live_count = std::llround(site.live_count);
+        stats.live_bytes = std::llround(site.live_bytes);
+    }
+
+    profile.sort_by_live_bytes();
+    return profile;
+}
+
+bool SamplingMemoryTracking::dump_snapshot(const std::string& path) const
+{
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs)
+    {
+        return false;
+    }
+    write_heap_profile(ofs, snapshot());
+    return bool(ofs);
+}
+
+void SamplingMemoryTracking::report() const
+{
+    if (!snapshot_prefix_.empty())
+    {
+        dump_snapshot(fmt::format("{}.final.khp", snapshot_prefix_));
+    }
+
+    if (num_allocs_)
+    {
+        klog(log_channel_)
+            .uid("MemoryTracker")
+            .error("Arena: {}, Alloc-dealloc mismatch: {}", debug_name_, num_allocs_);
+
+        // Sites with live samples are the most likely culprits
+        auto profile = snapshot();
+        constexpr std::size_t k_max_reported = 8;
+        for (std::size_t ii = 0; ii < std::min(k_max_reported, profile.sites.size()); ++ii)
+        {
+            const auto& site = profile.sites[ii];
+            if (site.live_count == 0)
+            {
+                break;
+            }
+            klog(log_channel_)
+                .uid("MemoryTracker")
+                .info("Live (est.): {} in {} allocations from {}", kb::su::human_size(size_t(site.live_bytes)),
+                      site.live_count, site.location);
+        }
+    }
+}
+
+} // namespace kb::memory::policy
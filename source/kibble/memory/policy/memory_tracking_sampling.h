@@ -0,0 +1,220 @@
+#pragma once
+
+#include "kibble/memory/heap_profile.h"
+#include "kibble/util/stack_trace.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace kb::memory
+{
+class HeapArea;
+}
+
+namespace kb::log
+{
+class Channel;
+}
+
+namespace kb::memory::policy
+{
+
+/**
+ * @brief Low-overhead memory tracking policy that samples allocations and aggregates them by allocation site.
+ *
+ * Allocations are sampled with a Poisson process over allocated bytes (same scheme as the tcmalloc heap profiler): on
+ * average, one sample is taken every sample_period bytes, so an allocation of size s is sampled with probability
+ * `1 - exp(-s/T)`. Each sample is weighted by the inverse of this probability, which makes the per-site statistics
+ * unbiased estimates of the real allocation counts and sizes.
+ *
+ * Unsampled allocations only cost a counter decrement. Unsampled deallocations are filtered out by a small counting
+ * filter over live sample addresses that stays in cache, and only the rare positives look up the fixed-size table of
+ * live samples. Sites are identified by their
+ * (file,line) pair, or optionally by their call stack. All tables are allocated once in init(), so the tracker itself
+ * never allocates on the hot path.
+ *
+ * Snapshots of the site statistics can be taken at any time with snapshot(), and can be dumped periodically to
+ * compact binary files (see write_heap_profile()) that the kheap utility can display and compare.
+ *
+ * The exact number of live allocations is still maintained, so the leak check of SimpleMemoryTracking is preserved.
+ *
+ * @note Like the other tracking policies, this class is not thread-safe by itself, it is protected by the arena
+ * thread guard.
+ *
+ */
+class SamplingMemoryTracking
+{
+public:
+    /// Default mean number of bytes between two samples
+    static constexpr std::size_t k_default_sample_period = 512 * 1024;
+    /// Maximum number of distinct allocation sites, sites in excess are aggregated in a single overflow site
+    static constexpr std::size_t k_max_sites = 1024;
+    /// Maximum number of sampled allocations alive at the same time, samples in excess are dropped
+    static constexpr std::size_t k_max_live_samples = 4096;
+    /// Number of counters in the live sample filter
+    static constexpr std::size_t k_live_filter_size = 256;
+
+    void init(const std::string& debug_name, const HeapArea& area);
+
+    /**
+     * @brief On allocating a chunk, count it and decide whether to sample it
+     *
+     */
+    inline void on_allocation(uint8_t* begin, std::size_t decorated_size, std::size_t, const char* file, int line)
+    {
+        ++num_allocs_;
+        bytes_until_sample_ -= static_cast<int64_t>(decorated_size);
+        if (bytes_until_sample_ <= 0)
+        {
+            record_sample(begin, decorated_size, file, line);
+        }
+    }
+
+    /**
+     * @brief On deallocating a chunk, uncount it and retire its sample if it has one
+     *
+     */
+    inline void on_deallocation(uint8_t* begin, std::size_t, const char*, int)
+    {
+        --num_allocs_;
+        if (live_filter_[filter_slot(begin)] != 0)
+        {
+            retire_sample(begin);
+        }
+    }
+
+    /**
+     * @brief Print a tracking report on the logger.
+     * Reports alloc-dealloc mismatches along with the sites that most likely leaked, and writes a last snapshot if
+     * periodic snapshots are enabled.
+     *
+     */
+    void report() const;
+
+    /**
+     * @brief Get the exact number of live allocations
+     *
+     * @return int32_t
+     */
+    inline int32_t get_allocation_count() const
+    {
+        return num_allocs_;
+    }
+
+    /**
+     * @brief Set the mean number of bytes between two samples.
+     * A period of 0 records every single allocation, the statistics are exact in this case.
+     *
+     * @param period
+     */
+    void set_sample_period(std::size_t period);
+
+    /**
+     * @brief Identify sites by call stack instead of (file,line).
+     * Stack traces are only captured for sampled allocations, but are much more expensive than the rest of the
+     * tracking, so this is best used with a large sample period.
+     *
+     * @param value
+     */
+    inline void set_capture_stack_traces(bool value)
+    {
+        capture_stack_traces_ = value;
+    }
+
+    /**
+     * @brief Dump snapshots periodically.
+     * Time is only checked when a sample is taken. Files are named `<prefix>.<index>.khp`.
+     *
+     * @param prefix path prefix of the snapshot files
+     * @param interval minimal duration between two snapshots
+     */
+    void set_snapshot_output(const std::string& prefix, std::chrono::milliseconds interval);
+
+    /**
+     * @brief Take a snapshot of the site statistics
+     *
+     * @return HeapProfile
+     */
+    HeapProfile snapshot() const;
+
+    /**
+     * @brief Write a snapshot to a file
+     *
+     * @param path
+     * @return false if the file could not be written
+     */
+    bool dump_snapshot(const std::string& path) const;
+
+    // clang-format off
+    /// @brief Get the mean number of bytes between two samples
+    inline std::size_t get_sample_period() const { return sample_period_; }
+    /// @brief Get the total number of samples taken
+    inline uint64_t get_sample_count() const { return sample_count_; }
+    /// @brief Get the number of samples that could not be tracked because the live sample table was full
+    inline uint64_t get_dropped_sample_count() const { return dropped_samples_; }
+    // clang-format on
+
+private:
+    /// @internal Aggregated statistics of an allocation site, in estimated counts and bytes
+    struct Site
+    {
+        uint64_t key = 0;
+        const char* file = nullptr;
+        int line = 0;
+        std::optional<StackTrace> trace;
+        double alloc_count = 0.0;
+        double alloc_bytes = 0.0;
+        double live_count = 0.0;
+        double live_bytes = 0.0;
+    };
+
+    /// @internal A sampled allocation that is still alive
+    struct LiveSample
+    {
+        uint8_t* begin = nullptr;
+        uint32_t site = 0;
+        double weight = 0.0;
+        double bytes = 0.0;
+    };
+
+    static inline std::size_t filter_slot(const uint8_t* begin)
+    {
+        auto addr = reinterpret_cast<std::size_t>(begin);
+        return ((addr >> 4) ^ (addr >> 12)) & (k_live_filter_size - 1);
+    }
+
+    void record_sample(uint8_t* begin, std::size_t size, const char* file, int line);
+    void retire_sample(uint8_t* begin);
+    uint32_t find_site(const char* file, int line);
+    int64_t next_sample_interval();
+    void dump_periodic_snapshot();
+
+private:
+    int32_t num_allocs_ = 0;
+    int64_t bytes_until_sample_ = 0;
+    std::size_t sample_period_ = k_default_sample_period;
+    bool capture_stack_traces_ = false;
+    uint64_t rng_state_ = 0;
+    uint64_t sample_count_ = 0;
+    uint64_t dropped_samples_ = 0;
+    std::size_t live_sample_count_ = 0;
+    std::array<uint16_t, k_live_filter_size> live_filter_{};
+
+    std::vector<Site> sites_;
+    std::vector<uint16_t> site_index_;
+    std::vector<LiveSample> live_samples_;
+
+    std::string snapshot_prefix_;
+    std::chrono::milliseconds snapshot_interval_{0};
+    std::chrono::steady_clock::time_point next_snapshot_;
+    uint32_t snapshot_index_ = 0;
+
+    std::string debug_name_;
+    const kb::log::Channel* log_channel_ = nullptr;
+};
+
+} // namespace kb::memory::policy
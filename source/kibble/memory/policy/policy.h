@@ -70,10 +70,24 @@ concept is_active_memory_tracking_policy = requires(T& policy, const std::string
     // clang-format on
 };
 
+/// @brief Allocators that synchronize themselves. The arena thread guard then only protects stateful policies.
 template <typename AllocatorT>
-concept has_reallocate = requires(AllocatorT& allocator, void* ptr, std::size_t old_size, std::size_t new_size) {
+concept is_thread_safe_allocator = AllocatorT::k_thread_safe;
+
+/// @brief Allocators that can resize a block, in place when possible
+template <typename AllocatorT>
+concept has_reallocate =
+    requires(AllocatorT& allocator, void* ptr, std::size_t size, std::size_t alignment, std::size_t offset) {
+        // clang-format off
+        { allocator.reallocate(ptr, size, alignment, offset) } -> std::same_as<void*>;
+        // clang-format on
+    };
+
+/// @brief Allocators that can report their largest free block, for fragmentation statistics
+template <typename AllocatorT>
+concept has_largest_free_block = requires(const AllocatorT& allocator) {
     // clang-format off
-    { allocator.reallocate(ptr, old_size, new_size) } -> std::same_as<void*>;
+    { allocator.largest_free_block() } -> std::convertible_to<std::size_t>;
     // clang-format on
 };
 
@@ -0,0 +1,67 @@
+#include "kibble/memory/util/atomic_free_list.h"
+#include "kibble/assert/assert.h"
+
+namespace kb
+{
+namespace memory
+{
+
+AtomicFreelist::AtomicFreelist(void* begin, std::size_t element_size, std::size_t max_elements, std::size_t alignment,
+                               std::size_t offset)
+{
+    init(begin, element_size, max_elements, alignment, offset);
+}
+
+void AtomicFreelist::init(void* begin, std::size_t element_size, std::size_t max_elements, std::size_t, std::size_t)
+{
+    K_ASSERT(element_size >= sizeof(uint32_t), "Free list elements must be at least {} bytes", sizeof(uint32_t));
+    K_ASSERT(max_elements < k_null, "Too many free list elements: {}", max_elements);
+    K_ASSERT(reinterpret_cast<uintptr_t>(begin) % alignof(uint32_t) == 0 && element_size % alignof(uint32_t) == 0,
+             "Free list elements must be {}B aligned", alignof(uint32_t));
+
+    begin_ = static_cast<uint8_t*>(begin);
+    element_size_ = element_size;
+
+    // Make every element point to the next one in the list
+    for (size_t ii = 0; ii < max_elements; ++ii)
+    {
+        next(uint32_t(ii)).store((ii + 1 < max_elements) ? uint32_t(ii + 1) : k_null, std::memory_order_relaxed);
+    }
+    head_.store(pack(0, (max_elements > 0) ? 0 : k_null), std::memory_order_release);
+}
+
+void* AtomicFreelist::acquire()
+{
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (true)
+    {
+        uint32_t index = index_of(head);
+        if (index == k_null)
+        {
+            return nullptr;
+        }
+
+        // If another thread popped this node in the meantime, the link may be garbage, but the compare-exchange will
+        // fail because the counter has changed. Nodes live in the pool memory, so reading it is always safe.
+        uint32_t next_index = next(index).load(std::memory_order_relaxed);
+        if (head_.compare_exchange_weak(head, pack(tag_of(head) + 1, next_index), std::memory_order_acquire,
+                                        std::memory_order_acquire))
+        {
+            return node(index);
+        }
+    }
+}
+
+void AtomicFreelist::release(void* ptr)
+{
+    auto index = uint32_t(size_t(static_cast<uint8_t*>(ptr) - begin_) / element_size_);
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    do
+    {
+        next(index).store(index_of(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, pack(tag_of(head) + 1, index), std::memory_order_release,
+                                          std::memory_order_relaxed));
+}
+
+} // namespace memory
+} // namespace kb
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace kb
+{
+namespace memory
+{
+
+/**
+ * @brief Lock-free implementation of a free list data structure.
+ * Used in the LockFreePoolAllocator class.
+ *
+ * This is a Treiber stack threaded through the free nodes themselves, so it needs no side storage and its capacity is
+ * set at runtime. Nodes are handed out in LIFO order, so the most recently released (cache-hot) node is reused first.
+ *
+ * Nodes are referred to by their index in the block, which allows to pack the head of the stack with a modification
+ * counter in a single 64-bit word. The counter is incremented on each push and pop, so a stale compare-exchange fails
+ * even if the head index was popped and pushed back in between (ABA problem).
+ *
+ */
+class AtomicFreelist
+{
+public:
+    /// @brief Tells the pool allocator this free list can be shared by multiple threads
+    static constexpr bool k_thread_safe = true;
+
+    AtomicFreelist() = default;
+
+    /**
+     * @brief Construct a free list.
+     *
+     * @param begin pointer to the start of the allocated memory block
+     * @param element_size size of each node in the free list, at least 4 bytes
+     * @param max_elements maximum number of elements
+     * @param alignment alignment requirement (unused)
+     * @param offset offset requirement (unused)
+     */
+    AtomicFreelist(void* begin, std::size_t element_size, std::size_t max_elements, std::size_t alignment,
+                   std::size_t offset);
+
+    /**
+     * @brief Initialize a free list.
+     *
+     * @note Not thread-safe.
+     *
+     * @param begin pointer to the start of the allocated memory block
+     * @param element_size size of each node in the free list, at least 4 bytes
+     * @param max_elements maximum number of elements
+     * @param alignment alignment requirement (unused)
+     * @param offset offset requirement (unused)
+     */
+    void init(void* begin, std::size_t element_size, std::size_t max_elements, std::size_t alignment,
+              std::size_t offset);
+
+    /**
+     * @brief Get a pointer to the next unallocated block.
+     *
+     * @note Lock-free.
+     *
+     * @return pointer to the next available block or nullptr if there is no more room
+     */
+    void* acquire();
+
+    /**
+     * @brief Return a block to the free list.
+     *
+     * @note Lock-free.
+     *
+     * @param ptr
+     */
+    void release(void* ptr);
+
+private:
+    static constexpr uint32_t k_null = 0xffffffff;
+
+    // Head layout: modification counter in the high 32 bits, node index in the low 32 bits
+    static inline uint64_t pack(uint32_t tag, uint32_t index)
+    {
+        return (uint64_t(tag) << 32) | index;
+    }
+
+    static inline uint32_t tag_of(uint64_t head)
+    {
+        return uint32_t(head >> 32);
+    }
+
+    static inline uint32_t index_of(uint64_t head)
+    {
+        return uint32_t(head & 0xffffffff);
+    }
+
+    inline uint8_t* node(uint32_t index) const
+    {
+        return begin_ + size_t(index) * element_size_;
+    }
+
+    /// Access the link stored in the first bytes of a node
+    inline std::atomic_ref<uint32_t> next(uint32_t index) const
+    {
+        return std::atomic_ref<uint32_t>(*reinterpret_cast<uint32_t*>(node(index)));
+    }
+
+private:
+    alignas(64) std::atomic<uint64_t> head_{pack(0, k_null)};
+    uint8_t* begin_{nullptr};
+    std::size_t element_size_{0};
+};
+
+} // namespace memory
+} // namespace kb
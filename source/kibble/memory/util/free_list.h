@@ -17,6 +17,9 @@ namespace memory
 class Freelist
 {
 public:
+    /// @brief This free list must not be shared by multiple threads
+    static constexpr bool k_thread_safe = false;
+
     Freelist() = default;
 
     /**
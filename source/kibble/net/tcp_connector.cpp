@@ -2,9 +2,12 @@
 #include "kibble/net/tcp_stream.h"
 
 #include <arpa/inet.h>
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -52,5 +55,49 @@ TCPStream* TCPConnector::connect(const std::string& server, uint16_t port)
     return new TCPStream(fd, &address);
 }
 
+TCPStream* TCPConnector::connect(const std::string& server, uint16_t port, int timeout_ms)
+{
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (resolve_host(server, &address.sin_addr))
+    {
+        inet_pton(PF_INET, server.c_str(), &address.sin_addr);
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    bool connected = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    if (!connected && errno == EINPROGRESS)
+    {
+        // The socket becomes writable when the connection is established or has failed
+        pollfd pfd{fd, POLLOUT, 0};
+        if (poll(&pfd, 1, timeout_ms) > 0)
+        {
+            int error = 0;
+            socklen_t len = sizeof(error);
+            connected = getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+        }
+    }
+
+    if (!connected)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    fcntl(fd, F_SETFL, flags);
+    return new TCPStream(fd, &address);
+}
+
 } // namespace net
 } // namespace kb
\ No newline at end of file
@@ -27,6 +27,18 @@ public:
      * @return new stream pointer. Caller is responsible for its destruction.
      */
     static TCPStream* connect(const std::string& server, uint16_t port);
+
+    /**
+     * @brief Connect to a server, giving up after a timeout.
+     * The connection is established in non-blocking mode, the returned stream is in blocking mode.
+     *
+     * @param server server's IP address
+     * @param port the same port the server is listening to
+     * @param timeout_ms maximum time to wait for the connection in milliseconds
+     * @return new stream pointer, or nullptr if the connection failed or timed out. Caller is responsible for its
+     * destruction.
+     */
+    static TCPStream* connect(const std::string& server, uint16_t port, int timeout_ms);
 };
 
 } // namespace net
@@ -3,6 +3,9 @@
 #include <arpa/inet.h>
 #include <iostream>
 #include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <vector>
 
@@ -32,6 +35,20 @@ ssize_t TCPStream::send(const char* buffer, size_t len)
     return write(fd_, buffer, len);
 }
 
+ssize_t TCPStream::send_nonblocking(const iovec* buffers, size_t count)
+{
+    msghdr message{};
+    message.msg_iov = const_cast<iovec*>(buffers);
+    message.msg_iovlen = count;
+    return sendmsg(fd_, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+bool TCPStream::wait_writable(int timeout_ms)
+{
+    pollfd pfd{fd_, POLLOUT, 0};
+    return poll(&pfd, 1, timeout_ms) > 0;
+}
+
 ssize_t TCPStream::receive(char* buffer, size_t len)
 {
     return read(fd_, buffer, len);
@@ -2,6 +2,8 @@
 
 #include <string>
 
+struct iovec;
+
 namespace kb
 {
 namespace net
@@ -55,6 +57,25 @@ public:
      */
     ssize_t send(const char* buffer, size_t len);
 
+    /**
+     * @brief Send multiple buffers with a single call, without blocking.
+     * SIGPIPE is not raised if the peer closed the connection, the call fails instead.
+     *
+     * @param buffers array of buffers
+     * @param count number of buffers
+     * @return size of data that was written, or -1 on error. If the socket send buffer is full, errno is set to
+     * EAGAIN or EWOULDBLOCK.
+     */
+    ssize_t send_nonblocking(const iovec* buffers, size_t count);
+
+    /**
+     * @brief Wait until data can be sent without blocking.
+     *
+     * @param timeout_ms maximum time to wait in milliseconds
+     * @return true if the socket is writable or in error (the next send will report it), false on timeout
+     */
+    bool wait_writable(int timeout_ms);
+
     /**
      * @brief Receive data from the peer and copy it to a buffer.
      *
@@ -1,14 +1,32 @@
 #pragma once
 
+#include <coroutine>
 #include <cstddef>
 #include <limits>
 
 namespace kb::th
 {
 
+struct JobMetadata;
+
 /// @brief Barrier ID type
 using barrier_t = std::size_t;
 /// @brief Barrier ID value representing no barrier
 [[maybe_unused]] static constexpr barrier_t k_no_barrier = std::numeric_limits<barrier_t>::max();
 
+/**
+ * @brief Intrusive list node used to resume a suspended coroutine once a barrier is finished.
+ * @see JobSystem::suspend_on_barrier()
+ *
+ */
+struct BarrierWaiter
+{
+    /// Next waiter of the same barrier
+    BarrierWaiter* next = nullptr;
+    /// Coroutine to resume
+    std::coroutine_handle<> handle;
+    /// Metadata of the job that will resume the coroutine
+    const JobMetadata* meta = nullptr;
+};
+
 } // namespace kb::th
\ No newline at end of file
@@ -0,0 +1,405 @@
+#pragma once
+
+#include "kibble/assert/assert.h"
+#include "kibble/thread/job/daemon.h"
+#include "kibble/thread/job/job_system.h"
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace kb::th
+{
+
+template <typename T>
+class co_task;
+
+namespace detail
+{
+
+// Continuation value of a finished coroutine
+inline char k_co_task_done = 0;
+
+/**
+ * @internal
+ * @brief State shared by all co_task promises.
+ *
+ */
+struct CoPromiseBase
+{
+    /// Job system the coroutine is resumed on
+    JobSystem* js = nullptr;
+    /// Metadata of the jobs resuming this coroutine
+    JobMetadata meta;
+    /// Coroutine awaiting this one, or &k_co_task_done once this coroutine is finished
+    std::atomic<void*> continuation{nullptr};
+    /// Set when the coroutine was scheduled or awaited for the first time, publishes js and meta
+    std::atomic<bool> started{false};
+    /// Exception thrown by the coroutine body
+    std::exception_ptr exception;
+
+    struct FinalAwaiter
+    {
+        inline bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template <typename PromiseT>
+        inline std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> handle) noexcept
+        {
+            // The frame may be destroyed by another thread as soon as the continuation is exchanged
+            void* awaiting = handle.promise().continuation.exchange(&k_co_task_done, std::memory_order_acq_rel);
+            if (awaiting != nullptr)
+            {
+                // Symmetric transfer to the awaiting coroutine, on this worker
+                return std::coroutine_handle<>::from_address(awaiting);
+            }
+            return std::noop_coroutine();
+        }
+
+        inline void await_resume() const noexcept
+        {
+        }
+    };
+
+    /// Coroutines are lazy: they start when they are scheduled or awaited
+    inline std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    inline FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    inline void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+
+    inline bool is_done() const noexcept
+    {
+        return continuation.load(std::memory_order_acquire) == &k_co_task_done;
+    }
+
+    /**
+     * @brief Resume the coroutine once all jobs under a barrier are processed.
+     * The coroutine must have been scheduled on a job system, or be awaited by such a coroutine.
+     *
+     */
+    struct BarrierAwaiter
+    {
+        CoPromiseBase& promise;
+        barrier_t barrier_id;
+        BarrierWaiter waiter{};
+
+        inline bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        inline bool await_suspend(std::coroutine_handle<> handle)
+        {
+            K_ASSERT(promise.js != nullptr, "Coroutine awaits a barrier but is not bound to a job system.");
+            waiter.handle = handle;
+            waiter.meta = &promise.meta;
+            return promise.js->suspend_on_barrier(barrier_id, waiter);
+        }
+
+        inline void await_resume() const noexcept
+        {
+        }
+    };
+
+    /// co_await on a barrier ID suspends the coroutine till the barrier is finished
+    inline BarrierAwaiter await_transform(barrier_t barrier_id)
+    {
+        return BarrierAwaiter{*this, barrier_id};
+    }
+
+    /// Other awaitables are left untouched
+    template <typename AwaitableT>
+    inline AwaitableT&& await_transform(AwaitableT&& awaitable) noexcept
+    {
+        return std::forward<AwaitableT>(awaitable);
+    }
+};
+
+template <typename T>
+struct CoPromise : public CoPromiseBase
+{
+    std::optional<T> value;
+
+    inline co_task<T> get_return_object() noexcept;
+
+    template <typename U>
+    inline void return_value(U&& result) noexcept(std::is_nothrow_constructible_v<T, U&&>)
+    {
+        value.emplace(std::forward<U>(result));
+    }
+
+    inline T get()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct CoPromise<void> : public CoPromiseBase
+{
+    inline co_task<void> get_return_object() noexcept;
+
+    inline void return_void() const noexcept
+    {
+    }
+
+    inline void get()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Coroutine executed by the job system.
+ *
+ * A co_task is lazy: nothing happens until it is either scheduled on a job system with schedule(), or awaited by
+ * another co_task. Inside a co_task, it is possible to co_await:
+ * - another co_task: if it was not started yet, it runs on the current worker right away, then the awaiting coroutine
+ * continues on the worker the awaited one finished on. If it was scheduled beforehand, the awaiting coroutine is
+ * suspended until it finishes.
+ * - a barrier_t: the coroutine is suspended until all jobs under this barrier are processed.
+ * - a delay (see th::delay()): the coroutine is suspended for some time.
+ *
+ * A suspended coroutine does not block any thread: it is resumed by a job pushed to the regular queues, with the
+ * metadata passed to schedule() (or those of the awaiting coroutine). This allows to overlap a large number of waits
+ * on a fixed number of workers.
+ *
+ * The coroutine frame is owned by the co_task object, which must outlive the coroutine execution.
+ *
+ * @tparam T type of the value returned with co_return
+ */
+template <typename T = void>
+class [[nodiscard]] co_task
+{
+public:
+    using promise_type = detail::CoPromise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    co_task(const co_task&) = delete;
+    co_task& operator=(const co_task&) = delete;
+
+    co_task(co_task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr))
+    {
+    }
+
+    co_task& operator=(co_task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    ~co_task()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Start the coroutine on a worker.
+     *
+     * @param js job system instance
+     * @param meta metadata of the jobs executing this coroutine
+     */
+    void schedule(JobSystem& js, JobMetadata&& meta = JobMetadata{})
+    {
+        auto& promise = handle_.promise();
+        K_ASSERT(!promise.started.load(std::memory_order_relaxed), "Coroutine already started.");
+        promise.js = &js;
+        promise.meta = std::move(meta);
+        promise.started.store(true, std::memory_order_release);
+        js.resume(handle_, promise.meta);
+    }
+
+    /// Check if the coroutine has finished
+    inline bool is_done() const
+    {
+        return handle_.promise().is_done();
+    }
+
+    /**
+     * @brief Get the value returned by the coroutine.
+     * If the coroutine threw an exception, it is rethrown here.
+     * @warning The coroutine must be finished.
+     *
+     * @return T
+     */
+    T get()
+    {
+        K_ASSERT(is_done(), "Coroutine is not finished.");
+        return handle_.promise().get();
+    }
+
+    /**
+     * @brief Wait for a scheduled coroutine to finish, from a thread of the job system that is not a coroutine.
+     * Synchronous work is executed in the meantime.
+     *
+     * @return the value returned by the coroutine
+     */
+    T wait()
+    {
+        K_ASSERT(handle_.promise().js != nullptr, "Coroutine was never scheduled.");
+        handle_.promise().js->wait_until([this]() { return !is_done(); });
+        return get();
+    }
+
+    struct Awaiter
+    {
+        handle_type handle;
+
+        inline bool await_ready() const noexcept
+        {
+            return handle.promise().is_done();
+        }
+
+        template <typename PromiseT>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> awaiting) noexcept
+        {
+            auto& promise = handle.promise();
+            if (!promise.started.load(std::memory_order_acquire))
+            {
+                // Run the awaited coroutine right away, it inherits the context of the awaiting one
+                const auto& parent = awaiting.promise();
+                promise.js = parent.js;
+                promise.meta = parent.meta;
+                promise.started.store(true, std::memory_order_release);
+                promise.continuation.store(awaiting.address(), std::memory_order_relaxed);
+                return handle;
+            }
+
+            // Already running somewhere: register as its continuation, unless it finished in the meantime
+            void* expected = nullptr;
+            if (promise.continuation.compare_exchange_strong(expected, awaiting.address(), std::memory_order_acq_rel))
+            {
+                return std::noop_coroutine();
+            }
+            return awaiting;
+        }
+
+        inline T await_resume()
+        {
+            return handle.promise().get();
+        }
+    };
+
+    /// Await the result of this coroutine from another co_task
+    inline Awaiter operator co_await() noexcept
+    {
+        return Awaiter{handle_};
+    }
+
+private:
+    friend struct detail::CoPromise<T>;
+
+    explicit co_task(handle_type handle) : handle_(handle)
+    {
+    }
+
+    void destroy()
+    {
+        if (handle_)
+        {
+            K_ASSERT(!handle_.promise().started.load(std::memory_order_acquire) || handle_.promise().is_done(),
+                     "Coroutine destroyed while it is running.");
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    handle_type handle_;
+};
+
+namespace detail
+{
+
+template <typename T>
+inline co_task<T> CoPromise<T>::get_return_object() noexcept
+{
+    return co_task<T>(co_task<T>::handle_type::from_promise(*this));
+}
+
+inline co_task<void> CoPromise<void>::get_return_object() noexcept
+{
+    return co_task<void>(co_task<void>::handle_type::from_promise(*this));
+}
+
+} // namespace detail
+
+/**
+ * @brief Awaitable that suspends a co_task for some time.
+ * The coroutine is resumed by a one-shot daemon, so the delay is rounded to the tick of the DaemonScheduler, and is
+ * only honored if the scheduler is updated regularly (or has a timer thread).
+ *
+ */
+struct DelayAwaiter
+{
+    DaemonScheduler& ds;
+    std::chrono::microseconds duration;
+
+    inline bool await_ready() const noexcept
+    {
+        return duration.count() <= 0;
+    }
+
+    template <typename PromiseT>
+    void await_suspend(std::coroutine_handle<PromiseT> handle)
+    {
+        auto& promise = handle.promise();
+        K_ASSERT(promise.js != nullptr, "Coroutine awaits a delay but is not bound to a job system.");
+        SchedulingData scheduling_data;
+        scheduling_data.cooldown_ms = float(duration.count()) / 1000.f;
+        scheduling_data.ttl = 1;
+        JobMetadata meta = promise.meta;
+        ds.create(
+            [handle, &promise]() {
+                promise.js->resume(handle, promise.meta);
+                return false;
+            },
+            std::move(scheduling_data), std::move(meta));
+    }
+
+    inline void await_resume() const noexcept
+    {
+    }
+};
+
+/**
+ * @brief Suspend the calling co_task for some time, without blocking a worker.
+ *
+ * @param ds daemon scheduler in charge of the timer
+ * @param duration delay
+ * @return DelayAwaiter
+ */
+inline DelayAwaiter delay(DaemonScheduler& ds, std::chrono::microseconds duration)
+{
+    return DelayAwaiter{ds, duration};
+}
+
+} // namespace kb::th
@@ -6,6 +6,8 @@
 #include "kibble/thread/job/impl/job.h"
 #include "kibble/thread/job/impl/worker.h"
 
+#include <cmath>
+
 namespace kb
 {
 namespace th
@@ -25,49 +27,54 @@ std::string what(const std::exception_ptr &eptr = std::current_exception())
 // clang-format on
 
 DaemonScheduler::DaemonScheduler(JobSystem& js, const kb::log::Channel* log_channel)
-    : js_(js), log_channel_(log_channel)
+    : DaemonScheduler(js, Config{}, log_channel)
+{
+}
+
+DaemonScheduler::DaemonScheduler(JobSystem& js, const Config& config, const kb::log::Channel* log_channel)
+    : js_(js), config_(config), start_(std::chrono::steady_clock::now()), log_channel_(log_channel)
 {
+    K_ASSERT(config_.tick.count() > 0, "Tick duration must be positive");
+    buckets_.fill(k_nil);
+
+    if (config_.timer_thread)
+    {
+        timer_thread_ = std::thread(&DaemonScheduler::timer_loop, this);
+    }
 }
 
 DaemonScheduler::~DaemonScheduler()
 {
-    for (auto&& [hnd, daemon] : daemons_)
+    if (timer_thread_.joinable())
     {
-        daemon->job->force_state(JobState::Processed);
-        js_.release_job(daemon->job);
+        {
+            std::scoped_lock lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        timer_thread_.join();
     }
+
+    // Spawned jobs refer to the daemons, wait for them to finish
+    js_.wait_until([this]() { return in_flight_.load(std::memory_order_acquire) > 0; });
 }
 
 DaemonHandle DaemonScheduler::create(std::function<bool()> kernel, SchedulingData&& scheduling_data, JobMetadata&& meta)
 {
-    JS_PROFILE_FUNCTION(js_.get_instrumentation_session(), 0);
+    JS_PROFILE_FUNCTION(js_.get_instrumentation_session(), js_.try_this_thread_id());
 
-    auto&& [it, inserted] = daemons_.insert({current_handle_++, std::make_unique<Daemon>()});
-    K_ASSERT(inserted, "Could not insert new daemon");
+    std::scoped_lock lock(mutex_);
 
-    auto& daemon = *it->second;
+    uint32_t idx = allocate();
+    auto& daemon = at(idx);
+    daemon.kernel = std::move(kernel);
+    daemon.meta = std::move(meta);
     daemon.scheduling_data = std::move(scheduling_data);
-    daemon.job = js_.create_job(
-        [this, &daemon, kernel = std::move(kernel)]() {
-            bool self_terminate = false;
-            try
-            {
-                self_terminate = !kernel();
-            }
-            catch (...)
-            {
-                klog(log_channel_)
-                    .error("Exception occurred during daemon execution.\n    -> {}\n    -> Daemon will be stopped.",
-                           what());
-                self_terminate = true;
-            }
-            if (self_terminate)
-            {
-                daemon.marked_for_deletion.store(true, std::memory_order_release);
-            }
-        },
-        std::move(meta));
-    daemon.job->keep_alive = true;
+    daemon.interval = std::max(uint64_t(1), to_ticks(daemon.scheduling_data.interval_ms));
+    daemon.expiry = current_tick_ + std::max(uint64_t(1), to_ticks(daemon.scheduling_data.cooldown_ms));
+    link(idx);
+
+    DaemonHandle hnd = (DaemonHandle(daemon.generation) << 32) | idx;
 
     klog(log_channel_)
         .uid("DaemonScheduler")
@@ -79,71 +86,321 @@ ttl:       {}
 tid hint:  {}
 balanced:  {}
 stealable: {})",
-                 it->first, daemon.scheduling_data.interval_ms, daemon.scheduling_data.cooldown_ms,
-                 daemon.scheduling_data.ttl, (meta.worker_affinity & kb::th::k_tid_hint_mask),
-                 bool(meta.worker_affinity >> kb::th::k_balance_bit),
-                 bool(meta.worker_affinity >> kb::th::k_stealable_bit));
+                 hnd, daemon.scheduling_data.interval_ms, daemon.scheduling_data.cooldown_ms,
+                 daemon.scheduling_data.ttl, (daemon.meta.worker_affinity & kb::th::k_tid_hint_mask),
+                 bool(daemon.meta.worker_affinity >> kb::th::k_balance_bit),
+                 bool(daemon.meta.worker_affinity >> kb::th::k_stealable_bit));
 
-    return it->first;
+    return hnd;
 }
 
 void DaemonScheduler::kill(DaemonHandle hnd)
 {
-    JS_PROFILE_FUNCTION(js_.get_instrumentation_session(), 0);
+    JS_PROFILE_FUNCTION(js_.get_instrumentation_session(), js_.try_this_thread_id());
+
+    std::scoped_lock lock(mutex_);
 
-    auto findit = daemons_.find(hnd);
-    K_ASSERT(findit != daemons_.end(), "Could not find daemon {}", hnd);
-    findit->second->marked_for_deletion.store(true, std::memory_order_release);
+    uint32_t idx = find(hnd);
+    K_ASSERT(idx != k_nil, "Could not find daemon {}", hnd);
+
+    auto& daemon = at(idx);
+    daemon.marked_for_deletion.store(true, std::memory_order_release);
+    unlink(idx);
+
+    if (!daemon.running.load(std::memory_order_acquire))
+    {
+        destroy(idx);
+        return;
+    }
+
+    // The daemon will be destroyed once its job has finished
+    daemon.expiry = current_tick_ + 1;
+    link(idx);
 }
 
 void DaemonScheduler::update()
 {
-    JS_PROFILE_FUNCTION(js_.get_instrumentation_session(), 0);
+    JS_PROFILE_FUNCTION(js_.get_instrumentation_session(), js_.try_this_thread_id());
+
+    if (config_.timer_thread)
+    {
+        return;
+    }
 
-    // Count time in ms since last call
-    delta_t_ms_ = float(clock_.restart().count()) / 1000.f;
+    std::scoped_lock lock(mutex_);
+    advance_to(elapsed_ticks());
+}
 
-    // Iterate daemons, reschedule those whose cooldown reached zero
-    for (auto&& [hnd, daemon] : daemons_)
+void DaemonScheduler::advance(size_t ticks)
+{
+    std::scoped_lock lock(mutex_);
+    for (size_t ii = 0; ii < ticks; ++ii)
     {
-        SchedulingData& sd = daemon->scheduling_data;
+        step();
+    }
+}
 
-        if (daemon->marked_for_deletion.load(std::memory_order_acquire))
+size_t DaemonScheduler::size() const
+{
+    std::scoped_lock lock(mutex_);
+    return alive_;
+}
+
+uint32_t DaemonScheduler::allocate()
+{
+    if (free_list_.empty())
+    {
+        pages_.push_back(std::make_unique<Daemon[]>(k_page_size));
+        for (uint32_t ii = k_page_size; ii > 0; --ii)
         {
-            // Job is not scheduled at this point, we need to manually release it
-            daemon->job->force_state(JobState::Processed);
-            js_.release_job(daemon->job);
-            kill_list_.push_back(hnd);
-            continue;
+            free_list_.push_back(capacity_ + ii - 1);
         }
+        capacity_ += k_page_size;
+    }
+
+    uint32_t idx = free_list_.back();
+    free_list_.pop_back();
 
-        // Update cooldown timer
-        sd.cooldown_ms -= delta_t_ms_;
+    auto& daemon = at(idx);
+    daemon.alive = true;
+    daemon.bucket = k_nil;
+    daemon.marked_for_deletion.store(false, std::memory_order_relaxed);
+    ++alive_;
+    return idx;
+}
+
+void DaemonScheduler::destroy(uint32_t idx)
+{
+    auto& daemon = at(idx);
+    daemon.alive = false;
+    ++daemon.generation;
+    // Release the resources held by the kernel captures
+    daemon.kernel = nullptr;
+    free_list_.push_back(idx);
+    --alive_;
+
+    klog(log_channel_).uid("DaemonScheduler").verbose("Killed daemon {}", idx);
+}
+
+uint32_t DaemonScheduler::find(DaemonHandle hnd)
+{
+    uint32_t idx = uint32_t(hnd & 0xffffffff);
+    uint32_t generation = uint32_t(hnd >> 32);
+    if (idx >= capacity_)
+    {
+        return k_nil;
+    }
+    const auto& daemon = at(idx);
+    return (daemon.alive && daemon.generation == generation) ? idx : k_nil;
+}
+
+uint64_t DaemonScheduler::to_ticks(float ms) const
+{
+    if (ms <= 0.f)
+    {
+        return 0;
+    }
+    return uint64_t(std::llround(double(ms) * 1000.0 / double(config_.tick.count())));
+}
 
-        if (sd.cooldown_ms <= 0.f)
+uint64_t DaemonScheduler::elapsed_ticks() const
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_);
+    return uint64_t(elapsed.count() / config_.tick.count());
+}
+
+void DaemonScheduler::link(uint32_t idx)
+{
+    auto& daemon = at(idx);
+
+    // Daemons too far in the future are parked in the last level, and reinserted when it cascades
+    uint64_t when = std::min(daemon.expiry, current_tick_ + k_wheel_range - 1);
+    uint64_t delta = when - current_tick_;
+
+    uint32_t level = 0;
+    while (level + 1 < k_wheel_levels && delta >= (uint64_t(1) << (k_wheel_bits * (level + 1))))
+    {
+        ++level;
+    }
+    uint32_t slot = uint32_t(when >> (k_wheel_bits * level)) & (k_wheel_size - 1);
+    uint32_t bucket = level * k_wheel_size + slot;
+
+    // Push front
+    daemon.bucket = bucket;
+    daemon.prev = k_nil;
+    daemon.next = buckets_[bucket];
+    if (daemon.next != k_nil)
+    {
+        at(daemon.next).prev = idx;
+    }
+    buckets_[bucket] = idx;
+}
+
+void DaemonScheduler::unlink(uint32_t idx)
+{
+    auto& daemon = at(idx);
+    if (daemon.bucket == k_nil)
+    {
+        return;
+    }
+
+    if (daemon.prev != k_nil)
+    {
+        at(daemon.prev).next = daemon.next;
+    }
+    else
+    {
+        buckets_[daemon.bucket] = daemon.next;
+    }
+    if (daemon.next != k_nil)
+    {
+        at(daemon.next).prev = daemon.prev;
+    }
+    daemon.bucket = k_nil;
+}
+
+uint32_t DaemonScheduler::detach(uint32_t bucket)
+{
+    uint32_t head = buckets_[bucket];
+    buckets_[bucket] = k_nil;
+    return head;
+}
+
+void DaemonScheduler::step()
+{
+    ++current_tick_;
+
+    // When a level wraps around, the next bucket of the level above is redistributed into the lower levels
+    for (uint32_t level = 1; level < k_wheel_levels; ++level)
+    {
+        uint32_t shift = k_wheel_bits * level;
+        if ((current_tick_ & ((uint64_t(1) << shift) - 1)) != 0)
         {
-            sd.cooldown_ms = sd.interval_ms;
-            if (sd.ttl > 0 && --sd.ttl == 0)
-            {
-                daemon->job->keep_alive = false;
-                kill_list_.push_back(hnd);
-            }
-
-            daemon->job->reset();
-            [[maybe_unused]] bool success = js_.try_schedule(daemon->job, 1);
-            K_ASSERT(success, "Could not schedule job. Dameon handle: {}", hnd);
+            break;
         }
+
+        uint32_t slot = uint32_t(current_tick_ >> shift) & (k_wheel_size - 1);
+        for (uint32_t idx = detach(level * k_wheel_size + slot); idx != k_nil;)
+        {
+            uint32_t next = at(idx).next;
+            link(idx);
+            idx = next;
+        }
+    }
+
+    // Fire all the daemons of the current level 0 bucket
+    for (uint32_t idx = detach(uint32_t(current_tick_) & (k_wheel_size - 1)); idx != k_nil;)
+    {
+        uint32_t next = at(idx).next;
+        at(idx).bucket = k_nil;
+        fire(idx);
+        idx = next;
     }
+}
 
-    // Cleanup
-    for (auto hnd : kill_list_)
+void DaemonScheduler::advance_to(uint64_t tick)
+{
+    // Nothing to fire, skip the empty ticks
+    if (alive_ == 0)
     {
-        daemons_.erase(hnd);
-        klog(log_channel_).uid("DaemonScheduler").verbose("Killed daemon {}", hnd);
+        current_tick_ = std::max(current_tick_, tick);
+        return;
     }
 
-    kill_list_.clear();
+    while (current_tick_ < tick)
+    {
+        step();
+    }
+}
+
+void DaemonScheduler::fire(uint32_t idx)
+{
+    auto& daemon = at(idx);
+
+    // Parked in the last level, not due yet
+    if (daemon.expiry > current_tick_)
+    {
+        link(idx);
+        return;
+    }
+
+    bool running = daemon.running.load(std::memory_order_acquire);
+    if (daemon.marked_for_deletion.load(std::memory_order_acquire))
+    {
+        if (!running)
+        {
+            destroy(idx);
+            return;
+        }
+        // Retry on next tick
+        daemon.expiry = current_tick_ + 1;
+        link(idx);
+        return;
+    }
+
+    // Previous execution is not over, skip this period
+    if (running)
+    {
+        daemon.expiry = current_tick_ + daemon.interval;
+        link(idx);
+        return;
+    }
+
+    // Last execution: the daemon is destroyed as soon as it is over
+    SchedulingData& sd = daemon.scheduling_data;
+    bool last = (sd.ttl > 0 && --sd.ttl == 0);
+    if (last)
+    {
+        daemon.marked_for_deletion.store(true, std::memory_order_relaxed);
+    }
+    daemon.expiry = current_tick_ + (last ? 1 : daemon.interval);
+    link(idx);
+
+    daemon.running.store(true, std::memory_order_relaxed);
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+
+    JobMetadata meta = daemon.meta;
+    Job* job = js_.create_job([this, &daemon](ResultSlot&) { run(daemon); }, std::move(meta));
+    [[maybe_unused]] bool success = js_.try_schedule(job, 1);
+    K_ASSERT(success, "Could not schedule job. Daemon index: {}", idx);
+}
+
+void DaemonScheduler::run(Daemon& daemon)
+{
+    bool self_terminate = false;
+    try
+    {
+        self_terminate = !daemon.kernel();
+    }
+    catch (...)
+    {
+        klog(log_channel_)
+            .error("Exception occurred during daemon execution.\n    -> {}\n    -> Daemon will be stopped.", what());
+        self_terminate = true;
+    }
+    if (self_terminate)
+    {
+        daemon.marked_for_deletion.store(true, std::memory_order_release);
+    }
+
+    // The daemon may be destroyed as soon as it is not running anymore
+    daemon.running.store(false, std::memory_order_release);
+    in_flight_.fetch_sub(1, std::memory_order_release);
+}
+
+void DaemonScheduler::timer_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_)
+    {
+        auto next_tick = start_ + config_.tick * int64_t(current_tick_ + 1);
+        if (cv_.wait_until(lock, next_tick, [this]() { return stop_; }))
+        {
+            break;
+        }
+        advance_to(elapsed_ticks());
+    }
 }
 
 } // namespace th
-} // namespace kb
\ No newline at end of file
+} // namespace kb
@@ -1,11 +1,16 @@
 #pragma once
 
-#include "kibble/memory/util/alignment.h"
 #include "kibble/thread/job/job_system.h"
-#include "kibble/time/clock.h"
-#include "kibble/util/unordered_dense.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace kb
@@ -34,12 +39,30 @@ struct SchedulingData
  */
 struct Daemon
 {
+    /// Function executed by the daemon
+    std::function<bool()> kernel;
+    /// Metadata of the jobs spawned by this daemon
+    JobMetadata meta;
     /// Data necessary for repeated scheduling of this daemon
     SchedulingData scheduling_data;
-    /// The job is kept alive by the JobSystem, the DaemonScheduler needs to store this pointer
-    Job* job = nullptr;
-    /// When set to true, this daemon will be returned to the pool by DaemonScheduler::update()
-    L1_ALIGN std::atomic<bool> marked_for_deletion = false;
+    /// Tick at which the daemon will be rescheduled
+    uint64_t expiry = 0;
+    /// Rescheduling interval in ticks
+    uint64_t interval = 0;
+    /// Incremented each time this slot is recycled, so that stale handles can be detected
+    uint32_t generation = 0;
+    /// Timer wheel bucket this daemon is linked into
+    uint32_t bucket = 0;
+    /// Previous daemon in the bucket
+    uint32_t prev = 0;
+    /// Next daemon in the bucket
+    uint32_t next = 0;
+    /// Set while a job spawned by this daemon is pending or executing
+    std::atomic<bool> running = false;
+    /// When set to true, this daemon will be destroyed once it is not running anymore
+    std::atomic<bool> marked_for_deletion = false;
+    /// False when this slot is free
+    bool alive = false;
 };
 
 /// Refers to a particular daemon
@@ -48,23 +71,50 @@ using DaemonHandle = size_t;
 /**
  * @brief This system can create, automatically schedule and kill recurring jobs.
  *
- * Recurring jobs are referred to as daemons. Once created, a daemon will be rescheduled
- * each time its internal cooldown counter reaches zero. For this to happen, the update()
- * function needs to be called regularly (typically each frame).
+ * Recurring jobs are referred to as daemons. Once created, a daemon will be rescheduled each time its internal
+ * cooldown counter reaches zero. Daemons are stored contiguously and sorted into a hierarchical timer wheel, so that
+ * creating, killing and rescheduling a daemon are constant time operations, and time only advances in ticks of fixed
+ * duration (1ms by default), whatever the number of daemons.
+ *
+ * The wheel is either advanced by calling update() regularly (typically each frame), or by a dedicated timer thread
+ * if Config::timer_thread is set.
  *
  */
 class DaemonScheduler
 {
 public:
     /**
-     * @brief Construct a new DaemonScheduler.
+     * @brief DaemonScheduler configuration structure.
+     *
+     */
+    struct Config
+    {
+        /// Resolution of the timer wheel, intervals and cooldowns are rounded to a multiple of this
+        std::chrono::microseconds tick{1000};
+        /// If set, a dedicated thread advances the wheel and update() does nothing
+        bool timer_thread = false;
+    };
+
+    /**
+     * @brief Construct a new DaemonScheduler with the default configuration.
      *
      * @param js Reference to an existing JobSystem instance.
+     * @param log_channel Logging channel
      */
     DaemonScheduler(JobSystem& js, const kb::log::Channel* log_channel = nullptr);
 
+    /**
+     * @brief Construct a new DaemonScheduler.
+     *
+     * @param js Reference to an existing JobSystem instance.
+     * @param config Configuration
+     * @param log_channel Logging channel
+     */
+    DaemonScheduler(JobSystem& js, const Config& config, const kb::log::Channel* log_channel = nullptr);
+
     /**
      * @brief Kill all daemons and destroy the DaemonScheduler.
+     * Waits for the daemons that are still running.
      *
      */
     ~DaemonScheduler();
@@ -73,9 +123,9 @@ public:
      * @brief Create a daemon.
      *
      * A daemon is a recurring task, rescheduled regularly and automatically.
-     * The underlying job will be kept alive by the JobSystem, meaning it will
-     * not be released to the pool once the job finishes, so there is no data
-     * copy happening each time a daemon is rescheduled.
+     * The kernel is stored once inside the daemon, each time the daemon is rescheduled, a job that only refers to
+     * this daemon is spawned, so there is no data copy happening, and idle daemons do not hold any job.
+     * If the previous execution of a daemon is not over when it should be rescheduled, this period is skipped.
      *
      * The daemon will self-terminate if:
      * - the kernel returns false
@@ -99,24 +149,75 @@ public:
     /**
      * @brief Call regularly to force daemon rescheduling.
      *
-     * An internal clock is used to measure the time interval between each call, and this
-     * interval is subtracted from each daemon cooldown counter. Daemons whose counters
-     * reach zero are rescheduled. If the ttl property of a daemon was initialized with
-     * a non-zero value, it is also decremented each time the daemon task is rescheduled,
-     * and the daemon is automatically killed once its ttl reaches zero.
+     * The wheel is advanced by the number of ticks elapsed since the last call. Daemons whose cooldown reached zero
+     * during these ticks are rescheduled. If the ttl property of a daemon was initialized with a non-zero value, it is
+     * also decremented each time the daemon task is rescheduled, and the daemon is automatically killed once its ttl
+     * reaches zero.
+     * Does nothing if a timer thread was requested.
      *
      */
     void update();
 
+    /**
+     * @brief Advance the wheel by a number of ticks, regardless of the time elapsed.
+     * Mostly useful for deterministic testing. The next calls to update() will only advance the wheel once the real
+     * time catches up.
+     *
+     * @param ticks number of ticks
+     */
+    void advance(size_t ticks = 1);
+
+    /// Get the number of daemons alive
+    size_t size() const;
+
+private:
+    // Daemons are allocated in pages, so that their address is stable
+    static constexpr uint32_t k_page_bits = 10;
+    static constexpr uint32_t k_page_size = 1u << k_page_bits;
+    // Each wheel level has 256 buckets, 4 levels cover 2^32 ticks (about 50 days at 1ms per tick)
+    static constexpr uint32_t k_wheel_bits = 8;
+    static constexpr uint32_t k_wheel_levels = 4;
+    static constexpr uint32_t k_wheel_size = 1u << k_wheel_bits;
+    static constexpr uint64_t k_wheel_range = uint64_t(1) << (k_wheel_bits * k_wheel_levels);
+    static constexpr uint32_t k_nil = 0xffffffff;
+
+    inline Daemon& at(uint32_t idx)
+    {
+        return pages_[idx >> k_page_bits][idx & (k_page_size - 1)];
+    }
+
+    uint32_t allocate();
+    void destroy(uint32_t idx);
+    uint32_t find(DaemonHandle hnd);
+    uint64_t to_ticks(float ms) const;
+    uint64_t elapsed_ticks() const;
+
+    void link(uint32_t idx);
+    void unlink(uint32_t idx);
+    uint32_t detach(uint32_t bucket);
+    void step();
+    void advance_to(uint64_t tick);
+    void fire(uint32_t idx);
+    void run(Daemon& daemon);
+    void timer_loop();
+
 private:
     JobSystem& js_;
-    ankerl::unordered_dense::map<DaemonHandle, std::unique_ptr<Daemon>> daemons_;
-    std::vector<DaemonHandle> kill_list_;
-    microClock clock_;
-    DaemonHandle current_handle_ = 0;
-    float delta_t_ms_ = 0.f;
+    Config config_;
+    std::vector<std::unique_ptr<Daemon[]>> pages_;
+    std::vector<uint32_t> free_list_;
+    uint32_t capacity_ = 0;
+    size_t alive_ = 0;
+    std::array<uint32_t, k_wheel_levels * k_wheel_size> buckets_;
+    uint64_t current_tick_ = 0;
+    std::chrono::steady_clock::time_point start_;
+    std::atomic<size_t> in_flight_ = 0;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread timer_thread_;
     const kb::log::Channel* log_channel_ = nullptr;
 };
 
 } // namespace th
-} // namespace kb
\ No newline at end of file
+} // namespace kb
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace kb::th
+{
+
+class JobSystem;
+struct Job;
+
+/**
+ * @brief Type-erased storage for the result of a task.
+ * Each job node embeds a result slot, so that producing a value does not require any additional allocation, as long
+ * as the value is small enough to fit the inline storage. Larger values, or values that cannot be moved without
+ * throwing, are heap allocated.
+ *
+ * A slot holds either nothing, a value, a void completion marker, or an exception.
+ *
+ */
+class ResultSlot
+{
+public:
+    /// Size of the inline storage
+    static constexpr size_t k_inline_size = 32;
+    /// Alignment of the inline storage
+    static constexpr size_t k_inline_alignment = alignof(std::max_align_t);
+
+    /**
+     * @brief Check if a value of type T can be stored without a heap allocation.
+     *
+     * @tparam T value type
+     */
+    template <typename T>
+    static constexpr bool k_is_inline = sizeof(T) <= k_inline_size && alignof(T) <= k_inline_alignment &&
+                                        std::is_nothrow_move_constructible_v<T>;
+
+    ResultSlot() = default;
+    ResultSlot(const ResultSlot&) = delete;
+    ResultSlot& operator=(const ResultSlot&) = delete;
+
+    ~ResultSlot()
+    {
+        reset();
+    }
+
+    /**
+     * @brief Construct a value of type T in place.
+     * Any previous value or exception is destroyed first.
+     *
+     * @tparam T value type
+     * @tparam ArgsT constructor arguments types
+     * @param args constructor arguments
+     */
+    template <typename T, typename... ArgsT>
+    void emplace(ArgsT&&... args)
+    {
+        reset();
+        if constexpr (k_is_inline<T>)
+        {
+            new (storage_) T(std::forward<ArgsT>(args)...);
+            destroy_ = [](std::byte* storage) { std::launder(reinterpret_cast<T*>(storage))->~T(); };
+        }
+        else
+        {
+            *reinterpret_cast<T**>(storage_) = new T(std::forward<ArgsT>(args)...);
+            destroy_ = [](std::byte* storage) { delete *reinterpret_cast<T**>(storage); };
+        }
+    }
+
+    /**
+     * @brief Store an exception, it will be rethrown by get().
+     *
+     * @param exception
+     */
+    inline void set_exception(std::exception_ptr exception)
+    {
+        reset();
+        exception_ = std::move(exception);
+    }
+
+    /// Check if an exception was stored
+    inline bool has_exception() const
+    {
+        return bool(exception_);
+    }
+
+    /// Get the stored exception, if any
+    inline const std::exception_ptr& get_exception() const
+    {
+        return exception_;
+    }
+
+    /// Rethrow the stored exception, if any
+    inline void rethrow_if_exception() const
+    {
+        if (exception_)
+        {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+    /**
+     * @brief Access the stored value, or rethrow the stored exception.
+     * @warning T must be the exact type used with emplace().
+     *
+     * @tparam T value type
+     * @return const T&
+     */
+    template <typename T>
+    const T& get() const
+    {
+        rethrow_if_exception();
+        if constexpr (k_is_inline<T>)
+        {
+            return *std::launder(reinterpret_cast<const T*>(storage_));
+        }
+        else
+        {
+            return **reinterpret_cast<T* const*>(storage_);
+        }
+    }
+
+    /// Destroy the stored value and exception
+    inline void reset()
+    {
+        if (destroy_)
+        {
+            destroy_(storage_);
+            destroy_ = nullptr;
+        }
+        exception_ = nullptr;
+    }
+
+private:
+    alignas(k_inline_alignment) std::byte storage_[k_inline_size];
+    void (*destroy_)(std::byte*) = nullptr;
+    std::exception_ptr exception_;
+};
+
+namespace detail
+{
+/*
+    The job node is not visible from public headers, these functions give futures
+    the minimal access they need.
+*/
+
+/// Add a reference to a job, preventing its return to the pool
+void retain_job(Job* job);
+/// Remove a reference to a job, the last reference returns the job to the pool
+void release_job(JobSystem* js, Job* job);
+/// Check if a job was processed
+bool is_job_processed(const Job* job);
+/// Wait for a job to be processed, the calling thread may execute other jobs in the meantime
+void wait_for_job(JobSystem* js, const Job* job);
+/// Get the result slot of a job
+const ResultSlot& get_result_slot(const Job* job);
+} // namespace detail
+
+/**
+ * @brief Future result of a task.
+ * The result lives in the result slot of the job node, and the future simply references the job. Futures are
+ * reference counted handles: they can be copied, and passed to other tasks. The job is returned to the pool once it
+ * was processed and the last future referencing it was destroyed. This mimics the std::shared_future API without
+ * requiring a shared state allocation per task.
+ *
+ * @warning Futures must not outlive the job system, and should only be used on a thread owned by the job system
+ * (the main thread or a worker thread).
+ *
+ * @tparam T result type
+ */
+template <typename T>
+class Future
+{
+public:
+    friend class JobSystem;
+
+    Future() = default;
+
+    Future(const Future& other) : js_(other.js_), job_(other.job_)
+    {
+        if (job_)
+        {
+            detail::retain_job(job_);
+        }
+    }
+
+    Future(Future&& other) noexcept : js_(std::exchange(other.js_, nullptr)), job_(std::exchange(other.job_, nullptr))
+    {
+    }
+
+    Future& operator=(const Future& other)
+    {
+        Future(other).swap(*this);
+        return *this;
+    }
+
+    Future& operator=(Future&& other) noexcept
+    {
+        Future(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    ~Future()
+    {
+        if (job_)
+        {
+            detail::release_job(js_, job_);
+        }
+    }
+
+    /// Check if this future references a task
+    inline bool valid() const
+    {
+        return job_ != nullptr;
+    }
+
+    /**
+     * @brief Non-blockingly check if the result is available.
+     *
+     * @return true if the task was processed
+     */
+    inline bool is_ready() const
+    {
+        return detail::is_job_processed(job_);
+    }
+
+    /**
+     * @brief Hold execution on this thread until the result is available.
+     * Other jobs may be executed by this thread in the meantime.
+     *
+     */
+    inline void wait() const
+    {
+        if (!is_ready())
+        {
+            detail::wait_for_job(js_, job_);
+        }
+    }
+
+    /**
+     * @brief Wait for the result and access it.
+     * If the task threw an exception, it is rethrown here.
+     *
+     * @return const T& for non-void tasks, nothing otherwise
+     */
+    decltype(auto) get() const
+    {
+        wait();
+        const ResultSlot& slot = detail::get_result_slot(job_);
+        if constexpr (std::is_void_v<T>)
+        {
+            slot.rethrow_if_exception();
+        }
+        else
+        {
+            return slot.get<T>();
+        }
+    }
+
+    inline void swap(Future& other) noexcept
+    {
+        std::swap(js_, other.js_);
+        std::swap(job_, other.job_);
+    }
+
+private:
+    /**
+     * @internal
+     * @brief Reference a job.
+     *
+     * @param js job system instance
+     * @param job the job producing the result
+     */
+    Future(JobSystem* js, Job* job) : js_(js), job_(job)
+    {
+        detail::retain_job(job_);
+    }
+
+private:
+    JobSystem* js_{nullptr};
+    Job* job_{nullptr};
+};
+
+} // namespace kb::th
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "kibble/memory/util/alignment.h"
+#include "kibble/thread/job/barrier_id.h"
 #include <atomic>
+#include <mutex>
 
 namespace kb::th
 {
@@ -27,11 +29,14 @@ public:
         pending_.fetch_add(count);
     }
 
-    /// @brief Called by a worker thread when a job using this barrier is finished
-    inline void remove_dependency() noexcept
-    {
-        pending_.fetch_sub(1);
-    }
+    /**
+     * @brief Called by a worker thread when a job using this barrier is finished
+     *
+     * @param waiters set to the list of registered waiters if this was the last pending job. They are taken along
+     * with the transition to zero, so that a barrier reused right away never keeps the waiters of the previous round.
+     * @return true if this was the last pending job
+     */
+    inline bool remove_dependency(BarrierWaiter*& waiters) noexcept;
 
     /// @brief Non-blockingly check if all jobs using this barrier have finished
     inline bool finished() const noexcept
@@ -58,9 +63,57 @@ public:
         return in_use_.compare_exchange_strong(expected, desired);
     }
 
+    /**
+     * @brief Register a waiter to be resumed when this barrier is finished
+     *
+     * @param waiter intrusive waiter node, must stay alive until it is taken back by remove_dependency()
+     * @return false if the barrier is already finished, in which case the waiter is not registered
+     */
+    inline bool push_waiter(BarrierWaiter* waiter);
+
 private:
     L1_ALIGN std::atomic<std::size_t> pending_{0};
     L1_ALIGN std::atomic<bool> in_use_{false};
+    // Rarely contended: only locked by waiters and when the last pending job finishes
+    std::mutex waiters_mutex_;
+    BarrierWaiter* waiters_{nullptr};
 };
 
+inline bool Barrier::remove_dependency(BarrierWaiter*& waiters) noexcept
+{
+    waiters = nullptr;
+    // Lock-free unless this may be the last pending job
+    std::size_t pending = pending_.load();
+    while (pending > 1)
+    {
+        if (pending_.compare_exchange_weak(pending, pending - 1))
+        {
+            return false;
+        }
+    }
+
+    // Waiters are pushed under the lock only while the barrier is not finished, so none can be registered between
+    // the transition and the moment the list is taken
+    std::scoped_lock lock(waiters_mutex_);
+    if (pending_.fetch_sub(1) != 1)
+    {
+        return false;
+    }
+    waiters = waiters_;
+    waiters_ = nullptr;
+    return true;
+}
+
+inline bool Barrier::push_waiter(BarrierWaiter* waiter)
+{
+    std::scoped_lock lock(waiters_mutex_);
+    if (finished())
+    {
+        return false;
+    }
+    waiter->next = waiters_;
+    waiters_ = waiter;
+    return true;
+}
+
 } // namespace kb::th
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
 #include "atomic_queue/atomic_queue.h"
 #include "config.h"
+#include "kibble/thread/job/impl/work_stealing_deque.h"
+#include "kibble/thread/job/job_meta.h"
+#include "kibble/thread/job/job_stats.h"
+
+#include <array>
 
 namespace kb
 {
@@ -13,6 +18,9 @@ using worker_affinity_t = uint32_t;
 template <typename T>
 using JobQueue = atomic_queue::AtomicQueue<T, KIBBLE_JOBSYS_JOB_QUEUE_SIZE, T{}, true, true, false, false>;
 
+template <typename T>
+using JobDeque = WorkStealingDeque<T, KIBBLE_JOBSYS_JOB_QUEUE_SIZE>;
+
 template <typename T>
 using ActivityQueue = atomic_queue::AtomicQueue2<T, KIBBLE_JOBSYS_STATS_QUEUE_SIZE, true, true, false, false>;
 
@@ -33,8 +41,16 @@ struct WorkerActivity
     size_t executed = 0;
     /// Number of tasks stolen by the worker
     size_t stolen = 0;
+    /// Number of tasks stolen from a worker outside of this worker's L3 domain
+    size_t stolen_remote = 0;
     /// Number of children tasks scheduled by the worker
     size_t scheduled = 0;
+    /// Number of times the worker thread was unparked
+    size_t wakeups = 0;
+    /// Number of times the worker thread was unparked but found nothing to do
+    size_t spurious_wakeups = 0;
+    /// Queue latency of the jobs executed by the worker, per priority class
+    std::array<LatencyHistogram, k_priority_count> latency;
     /// Worker id
     tid_t tid = 0;
 
@@ -48,17 +64,28 @@ struct WorkerActivity
         idle_time_us = 0;
         executed = 0;
         stolen = 0;
+        stolen_remote = 0;
         scheduled = 0;
+        wakeups = 0;
+        spurious_wakeups = 0;
+        for (auto& histogram : latency)
+        {
+            histogram.reset();
+        }
     }
 };
 
 // The following macros simplify the declaration of an instrumentation timer.
 // The token pasting stuff allows to declare multiple timers with different names in the same function.
+// Names are interned once per call site.
 #ifdef KB_JOB_SYSTEM_PROFILING
 #define CONCAT_IMPL(first, second) first##second
 #define CONCAT(first, second) CONCAT_IMPL(first, second)
 #define JS_PROFILE_SCOPE(session, name, thread_id)                                                                     \
-    volatile InstrumentationTimer CONCAT(timer_000_, __LINE__)(session, name, "js_internal", thread_id)
+    static const uint32_t CONCAT(name_000_, __LINE__) = InstrumentationSession::intern(name);                       \
+    static const uint32_t CONCAT(category_000_, __LINE__) = InstrumentationSession::intern("js_internal");          \
+    volatile InstrumentationTimer CONCAT(timer_000_, __LINE__)(session, CONCAT(name_000_, __LINE__),                \
+                                                               CONCAT(category_000_, __LINE__), thread_id)
 #define JS_PROFILE_FUNCTION(session, thread_id) JS_PROFILE_SCOPE(session, __PRETTY_FUNCTION__, thread_id)
 #else
 #define JS_PROFILE_SCOPE(session, name, thread_id)
@@ -2,28 +2,41 @@
 
 #include "config.h"
 #include "kibble/thread/job/barrier_id.h"
+#include "kibble/thread/job/future.h"
 #include "kibble/thread/job/impl/job_graph.h"
+#include "kibble/thread/job/job_kernel.h"
 #include "kibble/thread/job/job_meta.h"
 
-#include <functional>
+#include <atomic>
 
 namespace kb::th
 {
 
 /**
  * @brief Represents some amount of work to execute.
+ * The scheduling state, dependency edges and bookkeeping data are packed in the first cache lines, the kernel
+ * starts on its own cache line and spans whole cache lines.
  *
  */
-struct L1_ALIGN Job : public ProcessNode<Job*, KIBBLE_JOBSYS_MAX_PARENT_JOBS, KIBBLE_JOBSYS_MAX_CHILD_JOBS>
+struct L1_ALIGN Job : public ProcessNode<Job*, KIBBLE_JOBSYS_INLINE_CHILD_JOBS>
 {
     /// Job metadata
     JobMetadata meta;
-    /// The function to execute
-    std::function<void(void)> kernel = []() {};
+    /// One reference is held until the job is processed, and one by each future
+    std::atomic<uint32_t> refs{1};
     /// If true, job will not be returned to the pool once finished
     bool keep_alive = false;
     /// Barrier ID for this job and its dependents
     barrier_t barrier_id{k_no_barrier};
+    /// When the job was last handed to a worker, used to measure queue latency when profiling
+    int64_t dispatch_time_ns = 0;
+    /// Result (or exception) produced by the kernel, read by futures
+    ResultSlot result;
+    /// The function to execute
+    L1_ALIGN JobKernel kernel;
 };
 
-} // namespace kb::th
\ No newline at end of file
+/// Overflow storage for the dependents of a job
+using JobEdgeBlock = Job::OverflowBlock;
+
+} // namespace kb::th
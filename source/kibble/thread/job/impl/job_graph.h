@@ -5,7 +5,9 @@
 #include <array>
 #include <atomic>
 #include <cstddef>
-#include <stdexcept>
+#include <cstdint>
+#include <iterator>
+#include <utility>
 
 namespace kb
 {
@@ -21,36 +23,204 @@ enum class JobState : size_t
     Processed  // Finished
 };
 
+/**
+ * @brief Growable list of edges with inline storage.
+ *
+ * The first INLINE_SIZE edges are stored inside the list object. Additional edges spill to a singly linked list of
+ * fixed-size overflow blocks, that are obtained from (and returned to) an external pool, so that wide fan-outs
+ * do not require every node to reserve space for the worst case.
+ *
+ * @tparam T edge type (typically a node pointer)
+ * @tparam INLINE_SIZE number of edges stored inline
+ */
+template <typename T, size_t INLINE_SIZE>
+class EdgeList
+{
+public:
+    /**
+     * @brief Overflow storage, spans two cache lines.
+     *
+     */
+    struct L1_ALIGN OverflowBlock
+    {
+        static constexpr size_t k_capacity = (2 * memory::k_cache_line_size - sizeof(void*)) / sizeof(T);
+
+        std::array<T, k_capacity> items;
+        OverflowBlock* next = nullptr;
+    };
+
+    /**
+     * @brief Forward iterator over all edges, inline ones first.
+     *
+     */
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        const_iterator(const EdgeList* list, size_t index) : list_(list), block_(list->head_), index_(index)
+        {
+        }
+
+        inline reference operator*() const
+        {
+            return (index_ < INLINE_SIZE) ? list_->inline_[index_]
+                                          : block_->items[(index_ - INLINE_SIZE) % OverflowBlock::k_capacity];
+        }
+
+        inline const_iterator& operator++()
+        {
+            ++index_;
+            if (index_ > INLINE_SIZE && (index_ - INLINE_SIZE) % OverflowBlock::k_capacity == 0)
+            {
+                block_ = block_->next;
+            }
+            return *this;
+        }
+
+        inline const_iterator operator++(int)
+        {
+            const_iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        inline bool operator==(const const_iterator& other) const
+        {
+            return index_ == other.index_;
+        }
+
+    private:
+        const EdgeList* list_{nullptr};
+        const OverflowBlock* block_{nullptr};
+        size_t index_{0};
+    };
+
+    /**
+     * @brief Add an edge.
+     *
+     * @tparam AllocT callable returning a new (default constructed) OverflowBlock*
+     * @param item the edge to add
+     * @param allocate_block called when the inline storage and the last overflow block are full
+     */
+    template <typename AllocT>
+    void push_back(T item, AllocT&& allocate_block)
+    {
+        if (size_ < INLINE_SIZE)
+        {
+            inline_[size_++] = item;
+            return;
+        }
+
+        size_t overflow_index = (size_ - INLINE_SIZE) % OverflowBlock::k_capacity;
+        if (overflow_index == 0)
+        {
+            OverflowBlock* block = allocate_block();
+            if (tail_)
+            {
+                tail_->next = block;
+            }
+            else
+            {
+                head_ = block;
+            }
+            tail_ = block;
+        }
+        tail_->items[overflow_index] = item;
+        ++size_;
+    }
+
+    /**
+     * @brief Remove all edges and return the overflow blocks.
+     *
+     * @tparam DeallocT callable taking an OverflowBlock*
+     * @param free_block called on each overflow block
+     */
+    template <typename DeallocT>
+    void clear(DeallocT&& free_block)
+    {
+        OverflowBlock* block = head_;
+        while (block)
+        {
+            OverflowBlock* next = block->next;
+            free_block(block);
+            block = next;
+        }
+        head_ = tail_ = nullptr;
+        size_ = 0;
+    }
+
+    /// Check if some edges are stored in overflow blocks
+    inline bool has_overflow() const
+    {
+        return head_ != nullptr;
+    }
+
+    // clang-format off
+    inline const_iterator begin() const { return const_iterator(this, 0); }
+    inline const_iterator end() const   { return const_iterator(this, size_); }
+    inline size_t size() const          { return size_; }
+    // clang-format on
+
+private:
+    std::array<T, INLINE_SIZE> inline_;
+    uint32_t size_{0};
+    OverflowBlock* head_{nullptr};
+    OverflowBlock* tail_{nullptr};
+};
+
 /**
  * @brief Holds job dependency information, and the associated shared state.
  *
  * It allows to create an intrusive acyclic directed graph of jobs, so as to
  * schedule children jobs just in time, when their dependencies have been processed.
- * The dependencies are organized in two arrays (harnesses), one references the
- * input nodes (dependencies) and the outher the output nodes (dependents).
+ * Only the output edges (dependents) are stored, in an EdgeList. Input nodes (dependencies) are only counted,
+ * as nothing needs to walk the graph upwards.
  *
  * @tparam T Underlying output object type
- * @tparam MAX_IN Maximum number of input nodes
- * @tparam MAX_OUT Maximum number of output nodes
+ * @tparam INLINE_OUT Number of output edges stored inline, more edges spill to overflow blocks
  */
-template <typename T, size_t MAX_IN, size_t MAX_OUT>
+template <typename T, size_t INLINE_OUT>
 class ProcessNode
 {
 public:
+    using Edges = EdgeList<T, INLINE_OUT>;
+    using OverflowBlock = typename Edges::OverflowBlock;
+
     /**
      * @brief Connect this node to another
      *
+     * @tparam AllocT callable returning a new OverflowBlock*
      * @param to Reference to the target node
      * @param object Value associated to the output node (typically a job pointer)
+     * @param allocate_block called when the output edges need more storage
      */
-    inline void connect(ProcessNode& to, T object)
+    template <typename AllocT>
+    inline void connect(ProcessNode& to, T object, AllocT&& allocate_block)
     {
-        out_objects_[out_nodes_.count()] = object;
-        out_nodes_.add(to);
-        to.in_nodes_.add(*this);
+        out_edges_.push_back(object, std::forward<AllocT>(allocate_block));
+        ++to.in_count_;
         to.pending_in_.fetch_add(1, std::memory_order_release);
     }
 
+    /**
+     * @brief Remove all output edges, and return the overflow blocks.
+     * @note Input counts of the dependent nodes are not updated, only call this when the node is destroyed.
+     *
+     * @tparam DeallocT callable taking an OverflowBlock*
+     * @param free_block called on each overflow block
+     */
+    template <typename DeallocT>
+    inline void clear_edges(DeallocT&& free_block)
+    {
+        out_edges_.clear(std::forward<DeallocT>(free_block));
+    }
+
     /// Check if there are no pending dependencies
     inline bool is_ready() const
     {
@@ -68,7 +238,7 @@ public:
         pending_in_.fetch_sub(1, std::memory_order_release);
     }
 
-    inline bool check_state(JobState expected)
+    inline bool check_state(JobState expected) const
     {
         return state_.load(std::memory_order_acquire) == expected;
     }
@@ -83,109 +253,40 @@ public:
         return state_.compare_exchange_strong(expected, desired);
     }
 
-    /// (Recursively) reset the shared state only, useful for jobs that are kept alive
-    void reset()
+    /**
+     * @brief Make this node schedulable again, useful for jobs that are kept alive.
+     * The state is reset and all dependencies are pending again. This is not recursive: when a graph is rearmed,
+     * each node must be rearmed exactly once.
+     * @warning Only call this when the node and its parents are processed (or were never scheduled).
+     *
+     */
+    inline void rearm()
     {
-        // scheduled_.clear(std::memory_order_seq_cst);
-        // processed_.store(false, std::memory_order_release);
+        pending_in_.store(in_count_, std::memory_order_relaxed);
         state_.store(JobState::Idle, std::memory_order_release);
-
-        for (auto* child : out_nodes_)
-        {
-            child->pending_in_.fetch_add(1, std::memory_order_release);
-            child->reset();
-        }
     }
 
     // clang-format off
-    /// Get iterator to the beginning of the output harness
-    inline auto begin()        { return std::begin(out_objects_); }
-    /// Get iterator to the end of the output harness
-    inline auto end()          { return std::begin(out_objects_) + out_nodes_.count(); }
-    /// Get const iterator to the beginning of the output harness
-    inline auto cbegin() const { return std::cbegin(out_objects_); }
-    /// Get const iterator to the end of the output harness
-    inline auto cend() const   { return std::cbegin(out_objects_) + out_nodes_.count(); }
-    /// Get the number of elements in the output harness
-    inline size_t out_count() const { return out_nodes_.count(); }
-    /// Get the number of elements in the input harness
-    inline size_t in_count() const  { return in_nodes_.count(); }
+    /// Get iterator to the beginning of the output edges
+    inline auto begin() const       { return out_edges_.begin(); }
+    /// Get iterator to the end of the output edges
+    inline auto end() const         { return out_edges_.end(); }
+    /// Get the number of output edges
+    inline size_t out_count() const { return out_edges_.size(); }
+    /// Get the number of input edges
+    inline size_t in_count() const  { return in_count_; }
     // clang-format on
 
 private:
-    /**
-     * @internal
-     * @brief Represent a group of connections.
-     *
-     * @tparam SIZE Maximum amount of connections
-     */
-    template <size_t SIZE>
-    class Harness
-    {
-    public:
-        /// Add a node to this harness
-        inline void add(ProcessNode& node)
-        {
-            if (count_ + 1 == SIZE)
-            {
-                throw std::overflow_error("Maximum node amount reached.");
-            }
-
-            slots_[count_++] = &node;
-        }
-
-        /// Access an element by index (const version)
-        inline const auto& operator[](int idx) const
-        {
-            if (idx >= count_)
-            {
-                throw std::out_of_range("Index out of bounds in harness.");
-            }
-
-            return slots_[idx];
-        }
-
-        /// Access an element by index
-        inline auto& operator[](int idx)
-        {
-            if (idx >= count_)
-            {
-                throw std::out_of_range("Index out of bounds in harness.");
-            }
-
-            return slots_[idx];
-        }
-
-        // clang-format off
-        /// Get iterator to the beginning
-        inline auto begin()         { return std::begin(slots_); }
-        /// Get iterator to the end
-        inline auto end()           { return std::begin(slots_) + count_; }
-        /// Get const iterator to the beginning
-        inline auto cbegin() const  { return std::cbegin(slots_); }
-        /// Get const iterator to the end
-        inline auto cend() const    { return std::cbegin(slots_) + count_; }
-        /// Get the number of elements in this harness
-        inline size_t count() const { return count_; }
-        // clang-format on
-
-    private:
-        std::array<ProcessNode*, SIZE> slots_;
-        size_t count_ = 0;
-    };
-
-private:
-    /// Dependencies
-    L1_ALIGN Harness<MAX_IN> in_nodes_;
-    /// Dependent nodes
-    L1_ALIGN Harness<MAX_OUT> out_nodes_;
-    /// Dependent objects
-    L1_ALIGN std::array<T, MAX_OUT> out_objects_;
-    /// Number of pending dependencies
-    L1_ALIGN std::atomic<size_t> pending_in_ = 0;
     /// State of the node
-    L1_ALIGN std::atomic<JobState> state_{JobState::Idle};
+    std::atomic<JobState> state_{JobState::Idle};
+    /// Number of pending dependencies
+    std::atomic<uint32_t> pending_in_{0};
+    /// Total number of dependencies
+    uint32_t in_count_{0};
+    /// Dependent nodes
+    Edges out_edges_;
 };
 
 } // namespace th
-} // namespace kb
\ No newline at end of file
+} // namespace kb
@@ -24,7 +24,14 @@ void Monitor::update_statistics()
         stats_[tid].idle_time_ms += double(activity.idle_time_us) / 1000.0;
         stats_[tid].total_executed += activity.executed;
         stats_[tid].total_stolen += activity.stolen;
+        stats_[tid].total_stolen_remote += activity.stolen_remote;
         stats_[tid].total_scheduled += activity.scheduled;
+        stats_[tid].total_wakeups += activity.wakeups;
+        stats_[tid].total_spurious_wakeups += activity.spurious_wakeups;
+        for (size_t ii = 0; ii < k_priority_count; ++ii)
+        {
+            latency_[ii].merge(activity.latency[ii]);
+        }
         ++stats_[tid].cycles;
     }
 }
@@ -47,10 +54,27 @@ Mean idle time:       {}ms
 Mean activity ratio:  {}%
 Total executed:       {} jobs
 Total stolen:         {} jobs
+Stolen outside L3:    {} jobs
 Total scheduled:      {} jobs
-Average jobs / cycle: {})",
+Average jobs / cycle: {}
+Wakeups:              {}
+Spurious wakeups:     {})",
                                        tid, stats.cycles, mean_active_ms, mean_idle_ms, mean_activity,
-                                       stats.total_executed, stats.total_stolen, stats.total_scheduled, jobs_per_cycle);
+                                       stats.total_executed, stats.total_stolen, stats.total_stolen_remote,
+                                       stats.total_scheduled, jobs_per_cycle, stats.total_wakeups,
+                                       stats.total_spurious_wakeups);
+}
+
+void Monitor::log_latency(const kb::log::Channel* channel) const
+{
+    static constexpr std::array<const char*, k_priority_count> k_names = {"High", "Normal", "Low"};
+    for (size_t ii = 0; ii < k_priority_count; ++ii)
+    {
+        const auto& histogram = latency_[ii];
+        klog(channel).uid("Monitor").debug("{} priority: {} jobs, queue latency p50 < {}us, p90 < {}us, p99 < {}us",
+                                           k_names[ii], histogram.total(), histogram.percentile_us(0.5),
+                                           histogram.percentile_us(0.9), histogram.percentile_us(0.99));
+    }
 }
 
 } // namespace th
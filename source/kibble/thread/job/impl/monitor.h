@@ -26,8 +26,14 @@ struct WorkerStats
     unsigned long long total_executed = 0;
     /// Total number of tasks stolen by the worker
     unsigned long long total_stolen = 0;
+    /// Total number of tasks stolen from a worker outside of this worker's L3 domain
+    unsigned long long total_stolen_remote = 0;
     /// Total number of children tasks scheduled by the worker
     unsigned long long total_scheduled = 0;
+    /// Total number of times the worker thread was unparked
+    unsigned long long total_wakeups = 0;
+    /// Total number of times the worker thread was unparked but found nothing to do
+    unsigned long long total_spurious_wakeups = 0;
     /// Number of sleep cycles
     size_t cycles = 0;
 };
@@ -80,6 +86,24 @@ public:
         return stats_[tid];
     }
 
+    /**
+     * @brief Get the queue latency histogram of a priority class, cumulated over all workers.
+     *
+     * @param priority priority class
+     * @return const LatencyHistogram&
+     */
+    inline const LatencyHistogram& get_latency_histogram(JobPriority priority) const
+    {
+        return latency_[size_t(priority)];
+    }
+
+    /**
+     * @brief Show the queue latency percentiles of each priority class.
+     *
+     * @param channel logger channel
+     */
+    void log_latency(const kb::log::Channel* channel) const;
+
     /**
      * @brief Called by workers when they wake up to submit their activity reports.
      *
@@ -108,6 +132,7 @@ private:
 
 private:
     std::array<WorkerStats, KIBBLE_JOBSYS_MAX_THREADS> stats_;
+    std::array<LatencyHistogram, k_priority_count> latency_;
     JobSystem& js_;
     ActivityQueue<WorkerActivity> activity_queue_;
 };
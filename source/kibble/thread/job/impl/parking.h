@@ -0,0 +1,214 @@
+#pragma once
+
+#include "kibble/memory/util/alignment.h"
+#include "kibble/thread/impl/intrin.h"
+#include "kibble/thread/job/scheduling_policy.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace kb::th
+{
+
+/**
+ * @brief Sleep slot of a single thread.
+ * A thread that runs out of work parks itself on its own slot, and other threads wake it up by targeting this slot
+ * specifically, instead of notifying a condition variable shared by all workers. Under the hood, this relies on C++20
+ * std::atomic::wait() / notify_one(), which map to a futex on Linux.
+ *
+ * Lost wakeups are avoided with an epoch counter and a Dekker-style handshake:
+ * - The sleeper calls prepare_park(), which publishes its intent to sleep and returns the current epoch. It then checks
+ *   one last time for work (or for its wait condition), and either calls cancel_park() or park().
+ * - The waker publishes its work (job push, job completion...), then calls unpark(). If the sleeper is parked,
+ *   the waker claims the wakeup (so that concurrent wakers do not target the same thread), increments the epoch and
+ *   notifies the sleeper. park() returns as soon as the epoch differs from the snapshot,
+ *   so a wakeup happening between prepare_park() and park() is never missed.
+ * Both sides issue a sequentially consistent fence between their write and their read, so either the sleeper sees the
+ * work, or the waker sees the parked sleeper.
+ *
+ */
+class L1_ALIGN ParkingSlot
+{
+public:
+    /**
+     * @brief Why the thread is parked.
+     *
+     */
+    enum class Reason : uint8_t
+    {
+        /// Not parked
+        None,
+        /// Idle worker waiting for a job
+        Idle,
+        /// Thread waiting for some jobs to complete (JobSystem::wait_until())
+        Wait
+    };
+
+    /**
+     * @brief Announce that the owner thread is about to park.
+     * @note Owner only.
+     *
+     * @param reason why the thread parks
+     * @return uint32_t epoch snapshot to pass to park()
+     */
+    inline uint32_t prepare_park(Reason reason)
+    {
+        state_.store(reason, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Go back to work without parking, because work was found after prepare_park().
+     * @note Owner only.
+     *
+     */
+    inline void cancel_park()
+    {
+        state_.store(Reason::None, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Block until another thread calls unpark() after the epoch snapshot was taken.
+     * Returns immediately if a wakeup already happened in the meantime.
+     * @note Owner only.
+     *
+     * @param epoch value returned by prepare_park()
+     */
+    inline void park(uint32_t epoch)
+    {
+        // The waker resets the state when it claims the wakeup, before incrementing the epoch
+        epoch_.wait(epoch, std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Wake the owner thread up if it is parked.
+     * The caller must have published the work it wants the owner to see before calling this function.
+     *
+     * @return true if the owner thread was parked and has been notified
+     * @return false if it was not parked
+     */
+    inline bool unpark()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Reason reason = state_.load(std::memory_order_relaxed);
+        while (reason != Reason::None)
+        {
+            if (claim(reason))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Wake the owner thread up only if it is parked for the given reason.
+     *
+     * @param reason only wake up threads parked for this reason
+     * @return true if the owner thread was parked for this reason and has been notified
+     * @return false otherwise
+     */
+    inline bool unpark(Reason reason)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Reason expected = reason;
+        return claim(expected);
+    }
+
+    /**
+     * @brief Non-blockingly check if the owner thread is parked (or about to).
+     *
+     * @return true if the owner thread is parked
+     */
+    inline bool is_parked() const
+    {
+        return state_.load(std::memory_order_relaxed) != Reason::None;
+    }
+
+    /**
+     * @brief Non-blockingly check if the owner thread is parked (or about to) for the given reason.
+     *
+     * @param reason
+     * @return true if the owner thread is parked for this reason
+     */
+    inline bool is_parked(Reason reason) const
+    {
+        return state_.load(std::memory_order_relaxed) == reason;
+    }
+
+private:
+    /**
+     * @internal
+     * @brief Atomically take the wakeup for ourselves and notify the owner thread.
+     * Only one waker can succeed for a given park, so concurrent wakers targeting the same idle workers will wake
+     * distinct threads.
+     *
+     * @param expected state the slot is expected to be in, updated on failure
+     * @return true if the wakeup was claimed
+     */
+    inline bool claim(Reason& expected)
+    {
+        if (!state_.compare_exchange_strong(expected, Reason::None, std::memory_order_relaxed))
+        {
+            return false;
+        }
+        epoch_.fetch_add(1, std::memory_order_release);
+        epoch_.notify_one();
+        return true;
+    }
+
+private:
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<Reason> state_{Reason::None};
+};
+
+/**
+ * @brief Spin-then-park idle strategy.
+ * Each call to next() consumes one idle round: first a few rounds spinning with a CPU pause, then a few rounds
+ * yielding the time slice. When all rounds are consumed, next() returns false and the thread should park.
+ *
+ */
+class IdleBackoff
+{
+public:
+    explicit IdleBackoff(const ParkingPolicy& policy) : policy_(policy)
+    {
+    }
+
+    /**
+     * @brief Wait a little before the next attempt at finding work.
+     *
+     * @return true if the thread should try again
+     * @return false if the thread should park
+     */
+    inline bool next()
+    {
+        if (rounds_ < policy_.spin_count)
+        {
+            ++rounds_;
+            intrin::spin__();
+            return true;
+        }
+        if (rounds_ < policy_.spin_count + policy_.yield_count)
+        {
+            ++rounds_;
+            std::this_thread::yield();
+            return true;
+        }
+        return false;
+    }
+
+    /// Call when work was found
+    inline void reset()
+    {
+        rounds_ = 0;
+    }
+
+private:
+    ParkingPolicy policy_;
+    uint32_t rounds_{0};
+};
+
+} // namespace kb::th
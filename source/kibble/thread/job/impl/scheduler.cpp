@@ -17,9 +17,11 @@ Scheduler::Scheduler(JobSystem& js) : js_(js)
     std::fill(round_robin_.begin(), round_robin_.end(), 0);
 }
 
-void Scheduler::dispatch(Job* job)
+tid_t Scheduler::dispatch(Job* job)
 {
-    std::size_t& rr = round_robin_[js_.this_thread_id()];
+    tid_t this_tid = js_.try_this_thread_id();
+    bool external = (this_tid == k_external_tid);
+    std::size_t rr = external ? external_round_robin_.load(std::memory_order_relaxed) : round_robin_[this_tid];
 
     // The following code should be branchless (once optimized by the compiler)
     bool stealable = (job->meta.worker_affinity & (1 << k_stealable_bit)) >> k_stealable_bit;
@@ -31,13 +33,47 @@ void Scheduler::dispatch(Job* job)
              "Affinity TID hint bigger than workers count.\n  -> TID hint: {}, threads count: {}", tid_hint,
              js_.get_threads_count());
 
+    bool local = (job->meta.worker_affinity & (1 << k_local_bit)) >> k_local_bit;
+
     // Use TID hint strictly when balance is false, otherwise make sure that the TID produced is never lower than the
     // hint
     uint32_t tid = tid_hint + (balance * rr) % (uint32_t(js_.get_threads_count()) - tid_hint);
+
+    // Local jobs are balanced among the workers sharing the L3 of the current thread, the TID hint is ignored
+    if (local && !external)
+    {
+        const auto& local_workers = js_.get_worker(this_tid).get_local_workers();
+        tid = local_workers[rr % local_workers.size()];
+    }
+
+    // In work-stealing mode, a balanced job that the current worker is allowed to execute stays local: it goes to this
+    // worker's deque, and idle workers will steal it if needed
+    bool keep_local = !external && stealable && balance && this_tid >= tid_hint &&
+                      js_.get_worker(this_tid).get_queue_mode() == QueueMode::WorkStealing;
+    tid = keep_local ? this_tid : tid;
+
     // Advance round robin if balance is true
-    rr = balance ? (rr + 1) % js_.get_threads_count() : rr;
+    rr = (balance && !keep_local) ? (rr + 1) % js_.get_threads_count() : rr;
+    if (external)
+    {
+        external_round_robin_.store(rr, std::memory_order_relaxed);
+    }
+    else
+    {
+        round_robin_[this_tid] = rr;
+    }
+
+    // Jobs close to their deadline jump to the high priority lane
+    size_t lane = size_t(job->meta.priority);
+    if (job->meta.has_deadline() &&
+        job->meta.deadline - JobMetadata::clock::now() < js_.get_config().deadline_promotion)
+    {
+        lane = size_t(JobPriority::High);
+    }
+
     // Submit job to the appropriate queue
-    js_.get_worker(tid).submit(job, stealable);
+    js_.get_worker(tid).submit(job, stealable, tid == this_tid, lane);
+    return tid;
 }
 
 } // namespace th
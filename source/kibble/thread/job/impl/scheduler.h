@@ -2,8 +2,10 @@
 
 #include "config.h"
 #include "kibble/memory/util/alignment.h"
+#include "kibble/thread/job/impl/common.h"
 
 #include <array>
+#include <atomic>
 
 namespace kb
 {
@@ -35,15 +37,25 @@ public:
      * @brief Hand this job to the next worker.
      * If the job declares a non-default worker affinity in its metadata, the round robin will cycle until the
      * appropriate worker can handle it.
+     * In QueueMode::WorkStealing mode, balanced stealable jobs scheduled from a worker that can execute them are kept
+     * local to this worker instead.
+     * Jobs with the local bit set (WORKER_AFFINITY_LOCAL) are balanced among the workers sharing the L3 cache of the
+     * current thread.
+     * The job is pushed to the lane of its priority class, or to the high priority lane if its deadline is closer than
+     * JobSystem::Config::deadline_promotion.
+     * Jobs scheduled from an external thread are never kept local, and share a single round robin state.
      *
      * @param job job instance
+     * @return tid_t id of the worker the job was handed to
      */
-    void dispatch(Job* job);
+    tid_t dispatch(Job* job);
 
 private:
     L1_ALIGN JobSystem& js_;
     // Each thread has its own round robin state (64b to avoid false sharing)
     L1_ALIGN std::array<std::size_t, KIBBLE_JOBSYS_MAX_THREADS> round_robin_;
+    // Round robin state of the external threads, lost updates only affect load balancing
+    L1_ALIGN std::atomic<std::size_t> external_round_robin_{0};
 };
 
 } // namespace th
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "kibble/memory/util/alignment.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace kb::th
+{
+
+/**
+ * @brief Bounded Chase-Lev work-stealing deque.
+ * The owner thread pushes and pops at the bottom end (LIFO) without contention in the common case, while other threads
+ * steal from the top end (FIFO) with a single CAS. The owner and the thieves only compete when a single element is left.
+ *
+ * This is the fixed-capacity flavor of the algorithm, using the memory orderings described in:
+ * - Lê, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013)
+ * The buffer never grows, push() simply fails when the deque is full, and the caller is expected to fall back to
+ * another queue.
+ *
+ * @warning Only the owner thread may call push() and pop(). Any thread may call steal().
+ *
+ * @tparam T element type, must be trivially copyable (typically a pointer)
+ * @tparam SIZE capacity, must be a power of two
+ */
+template <typename T, size_t SIZE>
+class WorkStealingDeque
+{
+    static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "WorkStealingDeque capacity must be a power of two.");
+    static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque elements must be trivially copyable.");
+
+public:
+    /**
+     * @brief Push an element at the bottom of the deque.
+     * @note Owner only.
+     *
+     * @param item element to push
+     * @return true if the element was pushed
+     * @return false if the deque was full
+     */
+    bool push(T item)
+    {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        if (bottom - top >= int64_t(SIZE))
+        {
+            return false;
+        }
+
+        buffer_[index(bottom)].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Pop the most recently pushed element.
+     * @note Owner only.
+     *
+     * @param item output variable that will contain the element on success
+     * @return true if an element was popped
+     * @return false if the deque was empty, or the last element was stolen concurrently
+     */
+    bool pop(T& item)
+    {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            // Deque was empty, restore bottom
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = buffer_[index(bottom)].load(std::memory_order_relaxed);
+        if (top != bottom)
+        {
+            // More than one element left, no thief can reach this one
+            return true;
+        }
+
+        // Last element: race against thieves for it
+        bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    /**
+     * @brief Steal the oldest element.
+     * @note Can be called from any thread.
+     *
+     * @param item output variable that will contain the element on success
+     * @return true if an element was stolen
+     * @return false if the deque was empty, or another thread won the race
+     */
+    bool steal(T& item)
+    {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+        if (top >= bottom)
+        {
+            return false;
+        }
+
+        // The owner cannot overwrite this slot before top is incremented, as push() would see the deque as full
+        T stolen = buffer_[index(top)].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        item = stolen;
+        return true;
+    }
+
+    /**
+     * @brief Non-blockingly check if the deque was empty.
+     * The result may be outdated as soon as it is returned.
+     *
+     * @return true if the deque was empty
+     */
+    inline bool was_empty() const
+    {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the capacity of this deque.
+     *
+     * @return constexpr size_t
+     */
+    static constexpr size_t capacity()
+    {
+        return SIZE;
+    }
+
+private:
+    static constexpr size_t index(int64_t pos)
+    {
+        return size_t(pos) & (SIZE - 1);
+    }
+
+private:
+    // Top is written by thieves, bottom by the owner only, keep them on separate cache lines
+    L1_ALIGN std::atomic<int64_t> top_{0};
+    L1_ALIGN std::atomic<int64_t> bottom_{0};
+    L1_ALIGN std::array<std::atomic<T>, SIZE> buffer_{};
+};
+
+} // namespace kb::th
@@ -1,10 +1,12 @@
 #include "kibble/thread/job/impl/worker.h"
 #include "kibble/assert/assert.h"
+#include "kibble/logger/logger.h"
 #include "kibble/thread/job/impl/barrier.h"
 #include "kibble/thread/job/impl/job.h"
 #include "kibble/thread/job/impl/job_graph.h"
 #include "kibble/thread/job/impl/monitor.h"
 #include "kibble/thread/job/job_system.h"
+#include "kibble/thread/topology.h"
 #include "kibble/time/clock.h"
 #include "kibble/time/instrumentation.h"
 #include "kibble/util/sanitizer.h"
@@ -27,14 +29,38 @@ void WorkerThread::spawn(JobSystem* js, SharedState* ss, const WorkerProperties&
     activity_.tid = props_.tid;
 #endif
 
-    // Generate list of stealable workers
+    // Each worker gets its own victim sequence
+    rng_.seed(uint64_t(props_.tid) + 1);
+
+    // Generate list of stealable workers, closest first
     // Make sure that this worker cannot steal from itself
+    const auto& this_cpu = js_->get_worker_cpu(props_.tid);
+    auto distance_to = [this, &this_cpu](tid_t tid) {
+        return CpuTopology::distance(this_cpu, js_->get_worker_cpu(tid));
+    };
     for (tid_t tid = 0; tid < js_->get_threads_count(); ++tid)
     {
         if (props_.tid != tid)
         {
             stealable_workers_.push_back(tid);
         }
+        // Workers sharing the L3 of this one, including itself
+        if (distance_to(tid) <= CpuDistance::SameL3)
+        {
+            local_workers_.push_back(tid);
+        }
+    }
+    std::stable_sort(stealable_workers_.begin(), stealable_workers_.end(),
+                     [&distance_to](tid_t a, tid_t b) { return distance_to(a) < distance_to(b); });
+
+    // Boundaries of the groups of victims at the same distance
+    for (size_t ii = 0; ii < stealable_workers_.size(); ++ii)
+    {
+        if (ii + 1 == stealable_workers_.size() ||
+            distance_to(stealable_workers_[ii]) != distance_to(stealable_workers_[ii + 1]))
+        {
+            victim_tiers_.push_back(ii + 1);
+        }
     }
 
     // Spawn thread if it is not the main thread
@@ -44,6 +70,11 @@ void WorkerThread::spawn(JobSystem* js, SharedState* ss, const WorkerProperties&
     }
 }
 
+bool WorkerThread::pin(uint32_t cpu)
+{
+    return is_background() ? pin_thread(thread_.native_handle(), cpu) : pin_this_thread(cpu);
+}
+
 WorkerTerminationStatus WorkerThread::terminate_and_join(std::chrono::seconds timeout)
 {
     if (!is_background())
@@ -53,17 +84,7 @@ WorkerTerminationStatus WorkerThread::terminate_and_join(std::chrono::seconds ti
     }
 
     should_terminate_.store(true, std::memory_order_release);
-
-    // Try to acquire the wake_mutex
-    {
-        std::unique_lock<std::mutex> lock(ss_->wake_mutex, std::try_to_lock);
-        if (lock.owns_lock())
-        {
-            // If we got the lock, we can notify directly
-            ss_->cv_wake.notify_all();
-        }
-        // If we didn't get the lock, the worker might be stuck inside the critical section
-    }
+    slot_.unpark();
 
     // Wait for the thread to join or timeout
     auto start = std::chrono::steady_clock::now();
@@ -98,24 +119,40 @@ WorkerTerminationStatus WorkerThread::terminate_and_join(std::chrono::seconds ti
     return WorkerTerminationStatus::Failed;
 }
 
-void WorkerThread::submit(Job* job, bool stealable)
+void WorkerThread::submit(Job* job, bool stealable, bool local, size_t lane)
 {
+    // Only the owner thread is allowed to push to the deque. If it is full, fall back to the public queue.
+    if (stealable && local && props_.queue_mode == QueueMode::WorkStealing && deques_[lane].push(job))
+    {
+        return;
+    }
+
     size_t idx = size_t(!stealable);
-    ANNOTATE_HAPPENS_BEFORE(&queues_[idx]); // Avoid false positives with TSan
-    queues_[idx].push(job);
+    ANNOTATE_HAPPENS_BEFORE(&queues_[lane][idx]); // Avoid false positives with TSan
+    queues_[lane][idx].push(job);
 }
 
 void WorkerThread::run()
 {
     K_ASSERT(is_background(), "run() should not be called in the main thread.");
 
+    IdleBackoff backoff(props_.parking);
+    [[maybe_unused]] bool just_woke_up = false;
+
     while (!should_terminate_.load(std::memory_order_acquire))
     {
         state_.store(State::Running, std::memory_order_release);
 
         Job* job = nullptr;
-        if (get_job(job))
+        bool got_job = get_job(job);
+#ifdef KB_JOB_SYSTEM_PROFILING
+        // We were woken up for nothing
+        activity_.spurious_wakeups += size_t(just_woke_up && !got_job);
+        just_woke_up = false;
+#endif
+        if (got_job)
         {
+            backoff.reset();
             JobState expected = JobState::Pending;
             if (job->exchange_state(expected, JobState::Executing))
             {
@@ -124,22 +161,33 @@ void WorkerThread::run()
             continue;
         }
 
+        // Spin for a while, more work may come shortly
+        if (backoff.next())
+        {
+            continue;
+        }
+
         state_.store(State::Idle, std::memory_order_release);
 #ifdef KB_JOB_SYSTEM_PROFILING
         microClock clk;
 #endif
-        std::unique_lock<std::mutex> lock(ss_->wake_mutex);
         /*
-            The first condition in passed lambda avoids a possible deadlock, where a worker can
-            go to sleep with a non-empty queue and never wakes up, while the main thread waits for
-            the pending jobs it holds.
-            The second condition forces workers to wake up when the job system shuts down.
-            This avoids another deadlock on exit.
+            Announce that we are about to park, then check one last time for work. A job pushed to our queues
+            before this check will be seen by it, a job pushed after it will find us parked and wake us up.
+            The same goes for the termination request, this avoids a deadlock on exit.
         */
-        ss_->cv_wake.wait(lock,
-                          [this]() { return had_pending_jobs() || should_terminate_.load(std::memory_order_acquire); });
+        uint32_t epoch = slot_.prepare_park(ParkingSlot::Reason::Idle);
+        if (had_pending_jobs() || should_terminate_.load(std::memory_order_acquire))
+        {
+            slot_.cancel_park();
+            continue;
+        }
+        slot_.park(epoch);
+        backoff.reset();
 
 #ifdef KB_JOB_SYSTEM_PROFILING
+        just_woke_up = true;
+        ++activity_.wakeups;
         activity_.idle_time_us += clk.get_elapsed_time().count();
         js_->get_monitor().report_thread_activity(activity_);
         activity_.reset();
@@ -151,23 +199,92 @@ void WorkerThread::run()
 
 bool WorkerThread::get_job(Job*& job)
 {
-    // First, try to pop a job from the private queue, then the public queue, only then try to steal
-    // Logical or is short-circuiting, only one job will be popped
-    ANNOTATE_HAPPENS_AFTER(&queues_[Q_PRIVATE]); // Avoid false positives with TSan
-    ANNOTATE_HAPPENS_AFTER(&queues_[Q_PUBLIC]);  // Avoid false positives with TSan
-    return (queues_[Q_PRIVATE].try_pop(job) || queues_[Q_PUBLIC].try_pop(job) || steal_job(job));
+    // Lanes are drained from high to low priority. In each lane, first try to pop a job from the private queue, then
+    // the public queue. Only when all the lanes are empty, try to steal
+    for (size_t lane = 0; lane < k_priority_count; ++lane)
+    {
+        ANNOTATE_HAPPENS_AFTER(&queues_[lane][Q_PRIVATE]); // Avoid false positives with TSan
+        ANNOTATE_HAPPENS_AFTER(&queues_[lane][Q_PUBLIC]);  // Avoid false positives with TSan
+        if (queues_[lane][Q_PRIVATE].try_pop(job))
+        {
+            return true;
+        }
+        // Owner pops its own deque in LIFO order, the most recently spawned jobs are the hottest in cache
+        if (props_.queue_mode == QueueMode::WorkStealing && deques_[lane].pop(job))
+        {
+            return true;
+        }
+        if (queues_[lane][Q_PUBLIC].try_pop(job))
+        {
+            return true;
+        }
+    }
+    return steal_job(job);
 }
 
 bool WorkerThread::steal_job(Job*& job)
 {
+    // Single worker: nobody to steal from
+    if (stealable_workers_.empty())
+    {
+        return false;
+    }
+
+    if (props_.victim_selection == VictimSelection::Hierarchical)
+    {
+        return steal_job_hierarchical(job);
+    }
+
     for (size_t jj = 0; jj < props_.max_stealing_attempts; ++jj)
     {
-        auto& worker = js_->get_worker(rr_next());
-        ANNOTATE_HAPPENS_AFTER(&worker.queues_[Q_PUBLIC]); // Avoid false positives with TSan
-        if (worker.queues_[Q_PUBLIC].try_pop(job))
+        if (steal_from(next_victim(), job))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkerThread::steal_job_hierarchical(Job*& job)
+{
+    // Sweep the victims tier by tier, closest first, starting at a random position in each tier so that thieves
+    // spread over their neighbours. Each sweep visits every victim once, keep sweeping until the attempts run out.
+    size_t attempts = 0;
+    while (attempts < props_.max_stealing_attempts)
+    {
+        size_t tier_begin = 0;
+        for (size_t tier_end : victim_tiers_)
+        {
+            size_t tier_size = tier_end - tier_begin;
+            size_t offset = rng_.rand64() % tier_size;
+            for (size_t ii = 0; ii < tier_size; ++ii)
+            {
+                size_t idx = tier_begin + (offset + ii) % tier_size;
+                if (steal_from(stealable_workers_[idx], job))
+                {
+                    return true;
+                }
+            }
+            attempts += tier_size;
+            tier_begin = tier_end;
+        }
+    }
+    return false;
+}
+
+bool WorkerThread::steal_from(tid_t victim, Job*& job)
+{
+    auto& worker = js_->get_worker(victim);
+    bool use_deque = (props_.queue_mode == QueueMode::WorkStealing);
+    // Highest priority work first
+    for (size_t lane = 0; lane < k_priority_count; ++lane)
+    {
+        ANNOTATE_HAPPENS_AFTER(&worker.queues_[lane][Q_PUBLIC]); // Avoid false positives with TSan
+        if ((use_deque && worker.deques_[lane].steal(job)) || worker.queues_[lane][Q_PUBLIC].try_pop(job))
         {
 #ifdef KB_JOB_SYSTEM_PROFILING
             ++activity_.stolen;
+            activity_.stolen_remote += !is_local_worker(victim);
 #endif
             return true;
         }
@@ -178,29 +295,24 @@ bool WorkerThread::steal_job(Job*& job)
 void WorkerThread::process(Job* job)
 {
 #ifdef KB_JOB_SYSTEM_PROFILING
-    auto start = std::chrono::high_resolution_clock::now();
+    int64_t start_ns = InstrumentationSession::now_ns();
 #endif
 
-    job->kernel();
+    job->kernel(job->result);
 
 #ifdef KB_JOB_SYSTEM_PROFILING
-    auto stop = std::chrono::high_resolution_clock::now();
-    auto start_us = std::chrono::time_point_cast<std::chrono::microseconds>(start).time_since_epoch().count();
-    auto stop_us = std::chrono::time_point_cast<std::chrono::microseconds>(stop).time_since_epoch().count();
+    int64_t stop_ns = InstrumentationSession::now_ns();
 
-    activity_.active_time_us += stop_us - start_us;
+    activity_.active_time_us += (stop_ns - start_ns) / 1000;
     ++activity_.executed;
+    activity_.latency[size_t(job->meta.priority)].add(start_ns - job->dispatch_time_ns);
 
     // If an instrumentation session exists, push profile for this job
     if (auto* instr = js_->get_instrumentation_session())
     {
-        instr->push(ProfileResult{
-            .name = job->meta.name,
-            .category = "task",
-            .thread_id = js_->this_thread_id(),
-            .start = start_us,
-            .end = stop_us,
-        });
+        static const uint32_t k_task_category = InstrumentationSession::intern("task");
+        instr->push(js_->this_thread_id(),
+                    {start_ns, stop_ns, InstrumentationSession::intern(job->meta.name), k_task_category});
     }
 #endif
 
@@ -210,17 +322,31 @@ void WorkerThread::process(Job* job)
 
     schedule_children(job);
 
-    if (job->barrier_id != k_no_barrier)
+    // A job that is kept alive belongs to its owner (daemon scheduler, task graph...), which may rearm or destroy it
+    // as soon as the barrier is signaled, so everything we need must be read beforehand
+    bool keep_alive = job->keep_alive;
+    barrier_t barrier_id = job->barrier_id;
+
+    // Only the executing worker holds a reference: nobody can observe this exception
+    if (!keep_alive && job->result.has_exception() && job->refs.load(std::memory_order_acquire) == 1)
     {
-        js_->get_barrier(job->barrier_id).remove_dependency();
+        report_unobserved_exception(job);
     }
 
-    if (!job->keep_alive)
+    if (barrier_id != k_no_barrier)
     {
-        js_->release_job(job);
+        js_->signal_barrier(barrier_id);
+    }
+
+    if (!keep_alive)
+    {
+        js_->release_job_ref(job);
     }
 
     ss_->pending.fetch_sub(1, std::memory_order_release);
+
+    // Threads waiting for job completion may need to reevaluate their condition
+    js_->notify_waiters();
 }
 
 void WorkerThread::schedule_children(Job* job)
@@ -243,6 +369,24 @@ void WorkerThread::schedule_children(Job* job)
     }
 }
 
+void WorkerThread::report_unobserved_exception(Job* job)
+{
+    try
+    {
+        std::rethrow_exception(job->result.get_exception());
+    }
+    catch (const std::exception& e)
+    {
+        klog(js_->log_channel_)
+            .uid("JobSystem")
+            .error("Unobserved exception in job \"{}\":\n{}", job->meta.name, e.what());
+    }
+    catch (...)
+    {
+        klog(js_->log_channel_).uid("JobSystem").error("Unobserved exception in job \"{}\".", job->meta.name);
+    }
+}
+
 bool WorkerThread::foreground_work()
 {
     Job* job = nullptr;
@@ -259,11 +403,14 @@ bool WorkerThread::foreground_work()
 void WorkerThread::panic()
 {
     Job* job = nullptr;
-    while (queues_[Q_PRIVATE].try_pop(job))
+    for (auto& lane : queues_)
     {
-        if (job->meta.is_essential())
+        while (lane[Q_PRIVATE].try_pop(job))
         {
-            job->kernel();
+            if (job->meta.is_essential())
+            {
+                job->kernel(job->result);
+            }
         }
     }
 }
@@ -1,11 +1,14 @@
 #pragma once
 #include "kibble/memory/util/alignment.h"
+#include "kibble/random/xor_shift.h"
 #include "kibble/thread/job/impl/common.h"
+#include "kibble/thread/job/impl/parking.h"
+#include "kibble/thread/job/scheduling_policy.h"
 
+#include <algorithm>
 #include <atomic>
-#include <condition_variable>
-#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace kb::th
 {
@@ -18,6 +21,12 @@ struct WorkerProperties
 {
     /// maximum allowable attempts at stealing a job
     size_t max_stealing_attempts = 16;
+    /// per-worker queue layout
+    QueueMode queue_mode = QueueMode::Shared;
+    /// how the next worker to steal from is chosen
+    VictimSelection victim_selection = VictimSelection::RoundRobin;
+    /// spin-then-park policy observed when idle
+    ParkingPolicy parking;
     /// worker id
     tid_t tid;
 };
@@ -34,10 +43,8 @@ struct L1_ALIGN SharedState
 {
     /// Number of tasks left
     L1_ALIGN std::atomic<uint64_t> pending{0};
-    /// To wake worker threads
-    L1_ALIGN std::condition_variable cv_wake;
-    /// Workers wait on this one when they're idle
-    L1_ALIGN std::mutex wake_mutex;
+    /// Number of threads parked in JobSystem::wait_until(), they need to be woken up when a job completes
+    L1_ALIGN std::atomic<uint32_t> waiters{0};
 };
 
 enum class WorkerTerminationStatus : uint32_t
@@ -56,10 +63,19 @@ class JobSystem;
  * balanced among workers: some workers would basically do nothing while others would have piles of work to process.
  * This implementation of a worker thread allows for work stealing, in an attempt to enhance load balancing naturally.
  * When a worker has processed all jobs in its queues, it will try to pop jobs from other worker's public queues.
+ * If it still cannot find any work after spinning for a while, the worker parks its thread on its own ParkingSlot, and
+ * will only be woken up when a job is pushed to its queues, or when another worker needs help.
  *
  * The job queues used behind the scene are lock-free atomic queues, so there is low contention due to dispatching or
  * work stealing. This makes this implementation thread-safe and quite fast.
  *
+ * In QueueMode::WorkStealing mode, each worker also owns a Chase-Lev deque. Stealable jobs scheduled by the worker
+ * itself (typically children of a job it just executed) are pushed to and popped from the bottom of this deque, without
+ * touching any shared cache line, while thieves take the oldest jobs from the top.
+ *
+ * All queues are replicated per priority class (lanes). A worker drains its lanes from high to low priority before
+ * stealing, and thieves also take the highest priority work available in their victim's queues.
+ *
  */
 class L1_ALIGN WorkerThread
 {
@@ -94,6 +110,15 @@ public:
      */
     void spawn(JobSystem* js, SharedState* ss, const WorkerProperties& props);
 
+    /**
+     * @brief Pin this worker's thread to a logical CPU.
+     * For the foreground worker, this pins the calling thread.
+     *
+     * @param cpu logical CPU index
+     * @return true on success
+     */
+    bool pin(uint32_t cpu);
+
     /**
      * @brief Join this worker's thread.
      *
@@ -109,8 +134,11 @@ public:
      *
      * @param job the job to push
      * @param stealable if the job is stealable it will be put in the public queue, otherwise, in the private queue.
+     * @param local true if the caller is this worker's own thread. In work-stealing mode, local stealable jobs are
+     * pushed to the deque.
+     * @param lane priority lane (index of a JobPriority value)
      */
-    void submit(Job* job, bool stealable);
+    void submit(Job* job, bool stealable, bool local, size_t lane);
 
     /**
      * @brief Only the main thread calls this function to pop and execute a single job.
@@ -163,12 +191,72 @@ public:
     /**
      * @brief Check if there are pending jobs in the queues.
      *
-     * @return true if either the private or public queue had pending jobs.
+     * @return true if either the private or public queue (or the deque) had pending jobs.
      * @return false otherwise.
      */
     inline bool had_pending_jobs() const
     {
-        return !queues_[Q_PUBLIC].was_empty() || !queues_[Q_PRIVATE].was_empty();
+        for (size_t lane = 0; lane < k_priority_count; ++lane)
+        {
+            if (!queues_[lane][Q_PUBLIC].was_empty() || !queues_[lane][Q_PRIVATE].was_empty() ||
+                !deques_[lane].was_empty())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Get the workers sharing the L3 cache of this worker, including itself.
+     *
+     * @return const std::vector<tid_t>&
+     */
+    inline const std::vector<tid_t>& get_local_workers() const
+    {
+        return local_workers_;
+    }
+
+    /**
+     * @brief Check if a worker shares the L3 cache of this worker.
+     *
+     * @param tid worker id
+     */
+    inline bool is_local_worker(tid_t tid) const
+    {
+        return std::find(local_workers_.begin(), local_workers_.end(), tid) != local_workers_.end();
+    }
+
+    /**
+     * @brief Get the queue layout used by this worker.
+     *
+     * @return QueueMode
+     */
+    inline QueueMode get_queue_mode() const
+    {
+        return props_.queue_mode;
+    }
+
+    /**
+     * @brief Wake this worker up if it is parked.
+     *
+     * @return true if the worker was parked and has been notified
+     * @return false otherwise
+     */
+    inline bool wake_up()
+    {
+        return slot_.unpark();
+    }
+
+    /**
+     * @brief Get the sleep slot of this worker's thread.
+     * The slot is also used by the main thread (worker #0) and by any worker waiting in JobSystem::wait_until().
+     *
+     * @return ParkingSlot&
+     */
+    inline ParkingSlot& get_parking_slot()
+    {
+        return slot_;
     }
 
     /**
@@ -212,8 +300,8 @@ private:
      * @internal
      * @brief Get next locally available job or steal work from another worker.
      * First, the worker tries to pop a job from its private queue. If the queue is empty, it will try to pop a job
-     * from the public queue. If the queue is empty, it will try to steal work from the next worker in the
-     * round robin.
+     * from its deque (work-stealing mode only), then from the public queue. If the queue is empty, it will try to
+     * steal work from another worker.
      *
      * @param job Output variable that will contain the next job, or will be left uninitialized if no job could be
      * obtained.
@@ -224,7 +312,9 @@ private:
 
     /**
      * @internal
-     * @brief Try to steal a job from the next worker in the round robin.
+     * @brief Try to steal a job from another worker.
+     * Victims are chosen according to the victim selection policy. In work-stealing mode, the victim's deque is
+     * tried before its public queue.
      *
      * @param job Output variable that will contain the next job, or will be left uninitialized if no job could be
      * obtained.
@@ -233,6 +323,27 @@ private:
      */
     bool steal_job(Job*& job);
 
+    /**
+     * @internal
+     * @brief Try to steal a job, closest victims first (VictimSelection::Hierarchical).
+     *
+     * @param job Output variable that will contain the next job.
+     * @return true if a job was obtained
+     * @return false otherwise
+     */
+    bool steal_job_hierarchical(Job*& job);
+
+    /**
+     * @internal
+     * @brief Try to steal a job from a particular worker.
+     *
+     * @param victim the worker to steal from
+     * @param job Output variable that will contain the next job.
+     * @return true if a job was obtained
+     * @return false otherwise
+     */
+    bool steal_from(tid_t victim, Job*& job);
+
     /**
      * @internal
      * @brief Execute a job.
@@ -241,6 +352,14 @@ private:
      */
     void process(Job* job);
 
+    /**
+     * @internal
+     * @brief Log an exception thrown by a job that nobody holds a future for.
+     *
+     * @param job the faulty job
+     */
+    void report_unobserved_exception(Job* job);
+
     /**
      * @internal
      * @brief If a job has children with satisfied dependencies, schedule them.
@@ -262,6 +381,21 @@ private:
         return stealable_workers_[(stealing_round_robin_++) % (stealable_workers_.size())];
     }
 
+    /**
+     * @internal
+     * @brief Return the tid of the next worker to steal from.
+     *
+     * @return tid_t
+     */
+    inline tid_t next_victim()
+    {
+        if (props_.victim_selection == VictimSelection::Random)
+        {
+            return stealable_workers_[rng_.rand64() % stealable_workers_.size()];
+        }
+        return rr_next();
+    }
+
 private:
     WorkerProperties props_;
     JobSystem* js_{nullptr};
@@ -272,9 +406,15 @@ private:
 
     WorkerActivity activity_;
     std::vector<tid_t> stealable_workers_;
+    std::vector<size_t> victim_tiers_;
+    std::vector<tid_t> local_workers_;
     size_t stealing_round_robin_ = 0;
+    rng::XorShiftEngine rng_{uint64_t(0)};
 
-    L1_ALIGN std::array<JobQueue<Job*>, 2> queues_;
+    // One lane per priority class, each lane has a public and a private queue
+    L1_ALIGN std::array<std::array<JobQueue<Job*>, 2>, k_priority_count> queues_;
+    L1_ALIGN std::array<JobDeque<Job*>, k_priority_count> deques_;
+    ParkingSlot slot_;
 };
 
 } // namespace kb::th
\ No newline at end of file
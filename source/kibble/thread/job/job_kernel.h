@@ -0,0 +1,174 @@
+#pragma once
+
+#include "kibble/memory/util/alignment.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace kb::th
+{
+
+class ResultSlot;
+
+/**
+ * @brief Move-only type-erased function executed by a job.
+ * This replaces std::function, which requires copyable callables and allocates as soon as the captures exceed a
+ * couple of pointers. The callable is stored inline in a buffer that spans a whole number of cache lines, so the job
+ * kernel packs neatly inside the cache-line-aligned job node. Callables that do not fit, or that cannot be moved
+ * without throwing, are heap allocated.
+ *
+ * The kernel receives the result slot of its job, where it can store a value or an exception.
+ *
+ */
+class JobKernel
+{
+public:
+    /// Total size of a kernel object
+    static constexpr size_t k_size = 3 * memory::k_cache_line_size;
+    /// Size of the inline storage
+    static constexpr size_t k_storage_size = k_size - sizeof(void*);
+    /// Alignment of the inline storage
+    static constexpr size_t k_storage_alignment = alignof(std::max_align_t);
+
+    /**
+     * @brief Check if a callable of type FuncT can be stored without a heap allocation.
+     *
+     * @tparam FuncT callable type
+     */
+    template <typename FuncT>
+    static constexpr bool k_is_inline = sizeof(FuncT) <= k_storage_size && alignof(FuncT) <= k_storage_alignment &&
+                                        std::is_nothrow_move_constructible_v<FuncT>;
+
+    JobKernel() = default;
+
+    /**
+     * @brief Wrap a callable.
+     *
+     * @tparam FuncT callable type, must be invocable with a ResultSlot reference
+     * @param func callable
+     */
+    template <typename FuncT>
+        requires(!std::is_same_v<std::decay_t<FuncT>, JobKernel> && std::is_invocable_v<FuncT&, ResultSlot&>)
+    JobKernel(FuncT&& func)
+    {
+        using F = std::decay_t<FuncT>;
+        if constexpr (k_is_inline<F>)
+        {
+            new (storage_) F(std::forward<FuncT>(func));
+            ops_ = &k_inline_ops<F>;
+        }
+        else
+        {
+            *reinterpret_cast<F**>(storage_) = new F(std::forward<FuncT>(func));
+            ops_ = &k_heap_ops<F>;
+        }
+    }
+
+    JobKernel(const JobKernel&) = delete;
+    JobKernel& operator=(const JobKernel&) = delete;
+
+    JobKernel(JobKernel&& other) noexcept
+    {
+        take(other);
+    }
+
+    JobKernel& operator=(JobKernel&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~JobKernel()
+    {
+        reset();
+    }
+
+    /**
+     * @brief Execute the callable. Does nothing if the kernel is empty.
+     *
+     * @param slot result slot of the job
+     */
+    inline void operator()(ResultSlot& slot)
+    {
+        if (ops_)
+        {
+            ops_->invoke(storage_, slot);
+        }
+    }
+
+    /// Check if a callable is stored
+    inline explicit operator bool() const
+    {
+        return ops_ != nullptr;
+    }
+
+    /// Destroy the callable
+    inline void reset()
+    {
+        if (ops_)
+        {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops
+    {
+        void (*invoke)(std::byte*, ResultSlot&);
+        void (*relocate)(std::byte* dst, std::byte* src) noexcept;
+        void (*destroy)(std::byte*) noexcept;
+    };
+
+    template <typename F>
+    static F* inline_ptr(std::byte* storage)
+    {
+        return std::launder(reinterpret_cast<F*>(storage));
+    }
+
+    template <typename F>
+    static F*& heap_ptr(std::byte* storage)
+    {
+        return *reinterpret_cast<F**>(storage);
+    }
+
+    template <typename F>
+    static constexpr Ops k_inline_ops{
+        [](std::byte* storage, ResultSlot& slot) { (*inline_ptr<F>(storage))(slot); },
+        [](std::byte* dst, std::byte* src) noexcept {
+            new (dst) F(std::move(*inline_ptr<F>(src)));
+            inline_ptr<F>(src)->~F();
+        },
+        [](std::byte* storage) noexcept { inline_ptr<F>(storage)->~F(); },
+    };
+
+    template <typename F>
+    static constexpr Ops k_heap_ops{
+        [](std::byte* storage, ResultSlot& slot) { (*heap_ptr<F>(storage))(slot); },
+        [](std::byte* dst, std::byte* src) noexcept { heap_ptr<F>(dst) = heap_ptr<F>(src); },
+        [](std::byte* storage) noexcept { delete heap_ptr<F>(storage); },
+    };
+
+    inline void take(JobKernel& other) noexcept
+    {
+        if (other.ops_)
+        {
+            other.ops_->relocate(storage_, other.storage_);
+            ops_ = std::exchange(other.ops_, nullptr);
+        }
+    }
+
+private:
+    alignas(k_storage_alignment) std::byte storage_[k_storage_size];
+    const Ops* ops_{nullptr};
+};
+
+static_assert(sizeof(JobKernel) == JobKernel::k_size, "JobKernel must span a whole number of cache lines.");
+
+} // namespace kb::th
@@ -2,6 +2,7 @@
 
 #include "kibble/logger/channel.h"
 
+#include <chrono>
 #include <cstdint>
 #include <string>
 
@@ -13,7 +14,10 @@ using worker_affinity_t = uint32_t;
 
 [[maybe_unused]] static constexpr uint32_t k_stealable_bit = 8;
 [[maybe_unused]] static constexpr uint32_t k_balance_bit = 9;
+[[maybe_unused]] static constexpr uint32_t k_local_bit = 10;
 [[maybe_unused]] static constexpr uint32_t k_tid_hint_mask = 0xff;
+/// Thread ID of the threads that were not spawned by the job system (see JobSystem::try_this_thread_id())
+[[maybe_unused]] static constexpr tid_t k_external_tid = 0xffffffff;
 
 /**
  * @brief Encode worker affinity
@@ -48,6 +52,26 @@ inline constexpr worker_affinity_t force_worker(tid_t worker_id)
 [[maybe_unused]] static constexpr worker_affinity_t WORKER_AFFINITY_ASYNC_STRICT = worker_affinity(1, false, true);
 /// A job with this affinity can be executed on any worker
 [[maybe_unused]] static constexpr worker_affinity_t WORKER_AFFINITY_ANY = worker_affinity(0, true, true);
+/// A job with this affinity is dispatched to a worker sharing the L3 cache of the submitting thread, it can be stolen
+[[maybe_unused]] static constexpr worker_affinity_t WORKER_AFFINITY_LOCAL = WORKER_AFFINITY_ANY | 1u << k_local_bit;
+
+/**
+ * @brief Priority class of a job.
+ * Each worker has one set of queues (lane) per priority class, and drains them from high to low priority.
+ *
+ */
+enum class JobPriority : uint8_t
+{
+    /// Latency-critical work, such as jobs the current frame depends on
+    High = 0,
+    /// Default priority
+    Normal,
+    /// Background work that can be delayed, such as asset streaming
+    Low
+};
+
+/// Number of priority classes
+[[maybe_unused]] static constexpr size_t k_priority_count = 3;
 
 /**
  * @brief Metadata associated to a job.
@@ -55,24 +79,39 @@ inline constexpr worker_affinity_t force_worker(tid_t worker_id)
  */
 struct JobMetadata
 {
+    using clock = std::chrono::steady_clock;
+
     JobMetadata() = default;
-    JobMetadata(worker_affinity_t affinity, const std::string& profile_name);
+    JobMetadata(worker_affinity_t affinity, const std::string& profile_name,
+                JobPriority job_priority = JobPriority::Normal);
 
     /// Workers this job can be pushed to
     worker_affinity_t worker_affinity = WORKER_AFFINITY_ANY;
 
-    /// Descriptive name for the job (only used when profiling)
-    std::string name;
+    /// Priority class of this job
+    JobPriority priority = JobPriority::Normal;
 
 private:
+    // Packed with the fields above
     friend class kb::log::Channel;
     bool essential__ = false;
 
 public:
+    /// Optional deadline, a job dispatched too close to its deadline is promoted to the high priority lane
+    clock::time_point deadline{};
+
+    /// Descriptive name for the job (only used when profiling)
+    std::string name;
+
     inline bool is_essential() const
     {
         return essential__;
     }
+
+    inline bool has_deadline() const
+    {
+        return deadline != clock::time_point{};
+    }
 };
 
 } // namespace kb::th
\ No newline at end of file
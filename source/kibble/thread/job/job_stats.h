@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace kb::th
+{
+
+/**
+ * @brief Histogram of job queue latencies (time between dispatch and start of execution).
+ * Bucket 0 counts latencies under 1µs, bucket n > 0 counts latencies in [2^(n-1), 2^n[ µs, the last bucket also
+ * counts everything above.
+ *
+ */
+struct LatencyHistogram
+{
+    static constexpr size_t k_buckets = 24;
+
+    std::array<uint64_t, k_buckets> counts{};
+
+    /// Record a latency
+    inline void add(int64_t latency_ns)
+    {
+        uint64_t latency_us = latency_ns > 0 ? uint64_t(latency_ns) / 1000 : 0;
+        auto width = std::bit_width(latency_us);
+        ++counts[width < k_buckets ? width : k_buckets - 1];
+    }
+
+    /// Add the counts of another histogram to this one
+    inline void merge(const LatencyHistogram& other)
+    {
+        for (size_t ii = 0; ii < k_buckets; ++ii)
+        {
+            counts[ii] += other.counts[ii];
+        }
+    }
+
+    /// Total number of samples
+    inline uint64_t total() const
+    {
+        uint64_t sum = 0;
+        for (auto count : counts)
+        {
+            sum += count;
+        }
+        return sum;
+    }
+
+    /**
+     * @brief Get an upper bound of a latency percentile.
+     *
+     * @param percentile in [0,1]
+     * @return the upper bound in µs of the bucket the percentile falls in, 0 if there are no samples
+     */
+    inline uint64_t percentile_us(double percentile) const
+    {
+        uint64_t target = uint64_t(percentile * double(total()));
+        uint64_t sum = 0;
+        for (size_t ii = 0; ii < k_buckets; ++ii)
+        {
+            sum += counts[ii];
+            if (counts[ii] > 0 && sum >= target)
+            {
+                return uint64_t(1) << ii;
+            }
+        }
+        return 0;
+    }
+
+    inline void reset()
+    {
+        counts.fill(0);
+    }
+};
+
+} // namespace kb::th
@@ -65,19 +65,27 @@ struct JobSystem::Internal
         memory::MemoryArena<memory::AtomicPoolAllocator<KIBBLE_JOBSYS_JOB_QUEUE_SIZE * KIBBLE_JOBSYS_MAX_THREADS>,
                             memory::policy::SingleThread, memory::policy::NoBoundsChecking,
                             memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+    using EdgePoolArena =
+        memory::MemoryArena<memory::AtomicPoolAllocator<KIBBLE_JOBSYS_EDGE_BLOCKS>, memory::policy::SingleThread,
+                            memory::policy::NoBoundsChecking, memory::policy::NoMemoryTagging,
+                            memory::policy::NoMemoryTracking>;
 #else
     using JobPoolArena = memory::MemoryArena<memory::PoolAllocator, memory::policy::MultiThread<std::mutex>,
                                              memory::policy::NoBoundsChecking, memory::policy::NoMemoryTagging,
                                              memory::policy::NoMemoryTracking>;
+    using EdgePoolArena = JobPoolArena;
 #endif
 
     Internal(JobSystem* js, memory::HeapArea& area)
         : arena("JobSystemLocalArena", area, local_arena_requirements(js->get_config())),
 #ifdef KIBBLE_JOBSYS_ATOMIC_POOL
           job_pool("JobPool", area, sizeof(Job), kb::memory::k_cache_line_size),
+          edge_pool("JobEdgePool", area, sizeof(JobEdgeBlock), kb::memory::k_cache_line_size),
 #else
           job_pool("JobPool", area, KIBBLE_JOBSYS_JOB_QUEUE_SIZE * KIBBLE_JOBSYS_MAX_THREADS, sizeof(Job),
                    kb::memory::k_cache_line_size),
+          edge_pool("JobEdgePool", area, KIBBLE_JOBSYS_EDGE_BLOCKS, sizeof(JobEdgeBlock),
+                    kb::memory::k_cache_line_size),
 #endif
           scheduler(*js), monitor(*js)
     {
@@ -85,6 +93,7 @@ struct JobSystem::Internal
 
     L1_ALIGN JobSystemArena arena;
     L1_ALIGN JobPoolArena job_pool;
+    L1_ALIGN EdgePoolArena edge_pool;
 
     Scheduler scheduler;
     Monitor monitor;
@@ -103,7 +112,8 @@ void Deleter<th::JobSystem::Internal>::operator()(th::JobSystem::Internal* p)
 namespace th
 {
 
-JobMetadata::JobMetadata(worker_affinity_t affinity, const std::string& profile_name) : worker_affinity(affinity)
+JobMetadata::JobMetadata(worker_affinity_t affinity, const std::string& profile_name, JobPriority job_priority)
+    : worker_affinity(affinity), priority(job_priority)
 {
     name = profile_name;
 }
@@ -121,7 +131,12 @@ size_t JobSystem::get_memory_requirements(const Config& scheme)
     size_t job_alloc_size =
         KIBBLE_JOBSYS_JOB_QUEUE_SIZE * KIBBLE_JOBSYS_MAX_THREADS * k_job_node_size + kb::memory::k_cache_line_size;
 
-    return local_arena_requirements(scheme) + job_alloc_size;
+    // Same thing for the dependency edges overflow blocks
+    constexpr size_t k_edge_node_size = math::round_up_pow2(
+        sizeof(JobEdgeBlock) + Internal::EdgePoolArena::k_allocation_overhead, kb::memory::k_cache_line_size);
+    size_t edge_alloc_size = KIBBLE_JOBSYS_EDGE_BLOCKS * k_edge_node_size + kb::memory::k_cache_line_size;
+
+    return local_arena_requirements(scheme) + job_alloc_size + edge_alloc_size;
 }
 
 JobSystem::JobSystem(memory::HeapArea& area, const Config& scheme, const kb::log::Channel* log_channel)
@@ -144,6 +159,19 @@ JobSystem::JobSystem(memory::HeapArea& area, const Config& scheme, const kb::log
     klog(log_channel_).uid("JobSystem").debug("Detected {} CPU cores.", CPU_cores_count_);
     klog(log_channel_).uid("JobSystem").debug("Spawning {} (async) worker threads.", threads_count_ - 1);
 
+    // * Place workers on the CPU topology
+    topology_ = CpuTopology::detect();
+    klog(log_channel_)
+        .uid("JobSystem")
+        .verbose("CPU topology: {} logical CPUs, {} cores, {} L3 domains, {} sockets{}.", topology_.size(),
+                 topology_.core_count(), topology_.l3_count(), topology_.package_count(),
+                 topology_.is_detected() ? "" : " (not detected)");
+    auto placement = topology_.placement_order();
+    for (size_t ii = 0; ii < threads_count_; ++ii)
+    {
+        worker_cpus_.push_back(topology_.cpus()[placement[ii % placement.size()]]);
+    }
+
     if (threads_count_ == 1)
     {
         klog(log_channel_)
@@ -158,6 +186,9 @@ JobSystem::JobSystem(memory::HeapArea& area, const Config& scheme, const kb::log
     {
         WorkerProperties props;
         props.max_stealing_attempts = scheme.max_stealing_attempts;
+        props.queue_mode = scheme.queue_mode;
+        props.victim_selection = scheme.victim_selection;
+        props.parking = scheme.parking;
         props.tid = ii;
 
         auto& worker = workers_[ii];
@@ -167,6 +198,19 @@ JobSystem::JobSystem(memory::HeapArea& area, const Config& scheme, const kb::log
         klog(log_channel_)
             .uid("JobSystem")
             .verbose("Spawned worker #{}, native thread id: {}", worker.get_tid(), native_id);
+
+        if (scheme.pin_workers && (worker.is_background() || scheme.pin_main_thread))
+        {
+            uint32_t cpu = worker_cpus_[ii].cpu;
+            if (worker.pin(cpu))
+            {
+                klog(log_channel_).uid("JobSystem").verbose("Pinned worker #{} to CPU {}", ii, cpu);
+            }
+            else
+            {
+                klog(log_channel_).uid("JobSystem").warn("Could not pin worker #{} to CPU {}", ii, cpu);
+            }
+        }
     }
 
     klog(log_channel_).uid("JobSystem").debug("Ready.");
@@ -234,6 +278,7 @@ void JobSystem::shutdown()
     {
         internal_->monitor.log_statistics(workers_[idx].get_tid(), log_channel_);
     }
+    internal_->monitor.log_latency(log_channel_);
 #endif
 
     klog(log_channel_).uid("JobSystem").info("Shutdown complete.");
@@ -273,9 +318,9 @@ Barrier& JobSystem::get_barrier(barrier_t id)
     return barriers_[id];
 }
 
-Job* JobSystem::create_job(std::function<void()>&& kernel, JobMetadata&& meta)
+Job* JobSystem::create_job(JobKernel&& kernel, JobMetadata&& meta)
 {
-    JS_PROFILE_FUNCTION(instrumentor_, this_thread_id());
+    JS_PROFILE_FUNCTION(instrumentor_, try_this_thread_id());
 
     Job* job = K_NEW(Job, internal_->job_pool);
     job->kernel = std::move(kernel);
@@ -290,13 +335,27 @@ void JobSystem::release_job(Job* job)
     // Make sure that the job was processed
     K_ASSERT(job->check_state(JobState::Processed), "Tried to release unprocessed job.");
 
-    // Return job to the pool
+    // Return dependency edges overflow and job to the pools
+    job->clear_edges([this](JobEdgeBlock* block) { K_DELETE(block, internal_->edge_pool); });
     K_DELETE(job, internal_->job_pool);
 }
 
+void JobSystem::connect(Job* parent, Job* child)
+{
+    parent->connect(*child, child, [this]() { return K_NEW(JobEdgeBlock, internal_->edge_pool); });
+}
+
+void JobSystem::release_job_ref(Job* job)
+{
+    if (job->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        release_job(job);
+    }
+}
+
 bool JobSystem::try_schedule(Job* job, size_t num_jobs)
 {
-    JS_PROFILE_FUNCTION(instrumentor_, this_thread_id());
+    JS_PROFILE_FUNCTION(instrumentor_, try_this_thread_id());
     // Sanity check
     K_ASSERT(job->is_ready(), "Tried to schedule job with unfinished dependencies.");
 
@@ -308,14 +367,52 @@ bool JobSystem::try_schedule(Job* job, size_t num_jobs)
         {
             shared_state_->pending.fetch_add(num_jobs, std::memory_order_release);
         }
-        internal_->scheduler.dispatch(job);
-        shared_state_->cv_wake.notify_all();
+#ifdef KB_JOB_SYSTEM_PROFILING
+        job->dispatch_time_ns = InstrumentationSession::now_ns();
+#endif
+        tid_t target = internal_->scheduler.dispatch(job);
+        wake_up(target, job->meta.worker_affinity & (1 << k_stealable_bit));
         return true;
     }
 
     return false;
 }
 
+void JobSystem::wake_up(tid_t target, bool stealable)
+{
+    // If the target worker was parked, it will handle the job itself
+    if (workers_[target].wake_up() || !stealable)
+    {
+        return;
+    }
+
+    // Otherwise, the target is busy, wake a single idle worker up so it can steal the job
+    for (size_t idx = 0; idx < threads_count_; ++idx)
+    {
+        auto& slot = workers_[idx].get_parking_slot();
+        if (idx != target && slot.is_parked(ParkingSlot::Reason::Idle) && slot.unpark(ParkingSlot::Reason::Idle))
+        {
+            return;
+        }
+    }
+}
+
+void JobSystem::notify_waiters()
+{
+    // Pairs with the fence in ParkingSlot::prepare_park(): either the waiter sees the job completion when it
+    // evaluates its condition, or we see the waiter here
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (shared_state_->waiters.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    for (size_t idx = 0; idx < threads_count_; ++idx)
+    {
+        workers_[idx].get_parking_slot().unpark(ParkingSlot::Reason::Wait);
+    }
+}
+
 // Main thread and workers (on rescheduling) atomically increment pending each
 // time a job is pushed to the queue.
 // Main thread and workers atomically decrement pending each time they finished a job.
@@ -326,37 +423,66 @@ bool JobSystem::is_busy() const
     return shared_state_->pending.load(std::memory_order_acquire) > 0;
 }
 
-// NOTE(ndx): Instead of busy-waiting I tried
-//      std::unique_lock<std::mutex> lock(shared_state_->wait_mutex);
-//      shared_state_->cv_wait.wait(lock, [this]() { return !is_busy(); });
-// and in WorkerThread::execute() I do this after the fetch_sub:
-//      ss_.cv_wait.notify_one();
-// But it deadlocks (lost wakeups?)
+bool JobSystem::this_thread_has_pending_jobs() const
+{
+    return workers_[this_thread_id()].had_pending_jobs();
+}
+
+// NOTE(ndx): This used to busy-yield, because a condition variable based implementation
+// deadlocked (lost wakeups). The parking slot protocol closes the race: the waiter registers
+// itself and publishes its intent to park *before* reevaluating the condition, and workers
+// check for waiters *after* a job completion is published. See parking.h.
 void JobSystem::wait_until(std::function<bool()> condition)
 {
-    // Do some work to assist other threads
+    auto& worker = workers_[this_thread_id()];
+    auto& slot = worker.get_parking_slot();
+    IdleBackoff backoff(config_.parking);
 #ifdef KB_JOB_SYSTEM_PROFILING
     int64_t idle_time_us = 0;
+    auto& activity = worker.get_activity();
 #endif
 
     while (condition())
     {
-        if (!workers_[this_thread_id()].foreground_work())
+        // Do some work to assist other threads
+        if (worker.foreground_work())
         {
-            // There's nothing we can do, just wait. Some work may come to us.
+            backoff.reset();
+            continue;
+        }
+
+        // There's nothing we can do, spin for a while, some work may come to us
+        if (backoff.next())
+        {
+            continue;
+        }
+
+        // Then park until a job is pushed to us or a job completes
 #ifdef KB_JOB_SYSTEM_PROFILING
-            microClock clk;
+        microClock clk;
 #endif
-            shared_state_->cv_wake.notify_all(); // wake worker threads
-            std::this_thread::yield();           // allow this thread to be rescheduled
+        shared_state_->waiters.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t epoch = slot.prepare_park(ParkingSlot::Reason::Wait);
+        if (condition() && !worker.had_pending_jobs())
+        {
+            slot.park(epoch);
 #ifdef KB_JOB_SYSTEM_PROFILING
-            idle_time_us += clk.get_elapsed_time().count();
+            ++activity.wakeups;
+            activity.spurious_wakeups += size_t(condition() && !worker.had_pending_jobs());
 #endif
         }
+        else
+        {
+            slot.cancel_park();
+        }
+        shared_state_->waiters.fetch_sub(1, std::memory_order_relaxed);
+        backoff.reset();
+#ifdef KB_JOB_SYSTEM_PROFILING
+        idle_time_us += clk.get_elapsed_time().count();
+#endif
     }
 
 #ifdef KB_JOB_SYSTEM_PROFILING
-    auto& activity = workers_[this_thread_id()].get_activity();
     activity.idle_time_us += idle_time_us;
     internal_->monitor.report_thread_activity(activity);
     activity.reset();
@@ -377,6 +503,36 @@ void JobSystem::wait_on_barrier(uint64_t barrier_id)
     wait_until([&barrier]() { return !barrier.finished(); });
 }
 
+void JobSystem::resume(std::coroutine_handle<> handle, const JobMetadata& meta)
+{
+    JobMetadata resume_meta = meta;
+    Job* job = create_job([handle](ResultSlot&) { handle.resume(); }, std::move(resume_meta));
+    [[maybe_unused]] bool success = try_schedule(job, 1);
+    K_ASSERT(success, "Could not schedule coroutine resumption.");
+}
+
+bool JobSystem::suspend_on_barrier(barrier_t barrier_id, BarrierWaiter& waiter)
+{
+    return get_barrier(barrier_id).push_waiter(&waiter);
+}
+
+void JobSystem::signal_barrier(barrier_t id)
+{
+    BarrierWaiter* waiter = nullptr;
+    if (!get_barrier(id).remove_dependency(waiter))
+    {
+        return;
+    }
+
+    while (waiter != nullptr)
+    {
+        // The waiter lives in the coroutine frame, read it before the coroutine is resumed
+        BarrierWaiter* next = waiter->next;
+        resume(waiter->handle, *waiter->meta);
+        waiter = next;
+    }
+}
+
 WorkerThread& JobSystem::get_worker(size_t idx)
 {
     return workers_[idx];
@@ -388,6 +544,12 @@ const WorkerThread& JobSystem::get_worker(size_t idx) const
     return workers_[idx];
 }
 
+const LatencyHistogram& JobSystem::get_queue_latency(JobPriority priority)
+{
+    internal_->monitor.update_statistics();
+    return internal_->monitor.get_latency_histogram(priority);
+}
+
 Monitor& JobSystem::get_monitor()
 {
     return internal_->monitor;
@@ -503,16 +665,17 @@ bool Task::try_preempt_and_execute()
 
     if (job_->exchange_state(expected1, JobState::Preempted) || job_->exchange_state(expected2, JobState::Preempted))
     {
-        job_->kernel();
+        job_->kernel(job_->result);
 
         if (job_->barrier_id != k_no_barrier)
         {
-            js_->get_barrier(job_->barrier_id).remove_dependency();
+            js_->signal_barrier(job_->barrier_id);
         }
 
         job_->force_state(JobState::Processed);
-        js_->release_job(job_);
+        js_->release_job_ref(job_);
         js_->shared_state_->pending.fetch_sub(1, std::memory_order_release);
+        js_->notify_waiters();
 
         return true;
     }
@@ -539,13 +702,41 @@ bool Task::is_processed() const
 
 void Task::add_child(const Task& task)
 {
-    job_->connect(*task.job_, task.job_);
+    js_->connect(job_, task.job_);
 }
 
 void Task::add_parent(const Task& task)
 {
-    task.job_->connect(*job_, job_);
+    js_->connect(task.job_, job_);
+}
+
+namespace detail
+{
+void retain_job(Job* job)
+{
+    job->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void release_job(JobSystem* js, Job* job)
+{
+    js->release_job_ref(job);
+}
+
+bool is_job_processed(const Job* job)
+{
+    return job->check_state(JobState::Processed);
+}
+
+void wait_for_job(JobSystem* js, const Job* job)
+{
+    js->wait_until([job]() { return !job->check_state(JobState::Processed); });
+}
+
+const ResultSlot& get_result_slot(const Job* job)
+{
+    return job->result;
 }
+} // namespace detail
 
 } // namespace th
 } // namespace kb
\ No newline at end of file
@@ -1,12 +1,17 @@
 #pragma once
 
 #include "kibble/thread/job/barrier_id.h"
+#include "kibble/thread/job/future.h"
+#include "kibble/thread/job/job_kernel.h"
 #include "kibble/thread/job/job_meta.h"
-#include "kibble/thread/job/promise_pool.h"
+#include "kibble/thread/job/job_stats.h"
+#include "kibble/thread/job/scheduling_policy.h"
+#include "kibble/thread/topology.h"
 #include "kibble/util/internal.h"
 #include "kibble/util/unordered_dense.h"
 
-#include <future>
+#include <functional>
+#include <thread>
 
 namespace kb::log
 {
@@ -32,6 +37,18 @@ class Task;
 class Barrier;
 struct Job;
 
+/**
+ * @brief Tag type used to create a fire-and-forget task.
+ *
+ */
+struct DetachedTag
+{
+    explicit DetachedTag() = default;
+};
+
+/// Pass this tag to JobSystem::create_task() to create a task without a future
+inline constexpr DetachedTag detached{};
+
 /**
  * @brief Assign work to multiple worker threads.
  * The job system implementation is split into multiple single-responsibility components. All these components are
@@ -47,6 +64,8 @@ public:
     friend class WorkerThread;
     friend class Scheduler;
     friend class DaemonScheduler;
+    friend class TaskGraph;
+    friend void detail::release_job(JobSystem*, Job*);
 
     /**
      * @brief Job system configuration structure.
@@ -60,6 +79,18 @@ public:
         size_t max_stealing_attempts = 16;
         /// Maximum number of barriers
         size_t max_barriers = 16;
+        /// Per-worker queue layout
+        QueueMode queue_mode = QueueMode::Shared;
+        /// How idle workers choose the next worker to steal from
+        VictimSelection victim_selection = VictimSelection::RoundRobin;
+        /// How long idle workers and waiting threads spin before they park
+        ParkingPolicy parking;
+        /// Pin each background worker to a logical CPU, following CpuTopology::placement_order()
+        bool pin_workers = false;
+        /// Also pin the main thread (worker #0) to the first CPU of the placement order, requires pin_workers
+        bool pin_main_thread = false;
+        /// Jobs dispatched less than this before their deadline (or past it) go to the high priority lane
+        std::chrono::microseconds deadline_promotion{2000};
     };
 
     /**
@@ -131,31 +162,25 @@ public:
      * @param meta job metadata. Can be used to give a unique label to this task and setup worker affinity.
      * @param function function containing code to execute.
      * @param args arguments to be passed to the function
-     * @return a pair containing the created task and its future result (std::shared_future)
+     * @return a pair containing the created task and its future result
      */
     template <typename FuncT, typename... ArgsT>
-    inline auto create_task(JobMetadata&& meta, FuncT&& function, ArgsT&&... args)
-    {
-        /*
-            NOTE(ndx): I have to use a shared pointer for the promise, because the promise
-            itself being non-copyable, cannot be captured by the job kernel lambda. But
-            to avoid frequent heap allocations, I'm pooling the promises.
-            See promise_pool.h for implementation detail.
-            This could in theory be solved differently with std::move_only_function in C++23.
-        */
-
-        using ResultType = std::invoke_result_t<FuncT, ArgsT...>;
-        using PromiseType = std::promise<ResultType>;
-        using AllocPromiseType =
-            std::allocator_traits<PromiseAllocator<PromiseType>>::template rebind_alloc<PromiseType>;
+    auto create_task(JobMetadata&& meta, FuncT&& function, ArgsT&&... args);
 
-        auto promise = std::allocate_shared<PromiseType>(AllocPromiseType{});
-        std::shared_future<ResultType> future = promise->get_future();
-
-        return std::make_pair(Task(this, std::forward<JobMetadata>(meta), std::forward<FuncT>(function),
-                                   std::move(promise), std::forward<ArgsT>(args)...),
-                              std::move(future));
-    }
+    /**
+     * @brief Create a fire-and-forget task
+     * No future is created, and the return value of the function (if any) is discarded. An exception thrown by the
+     * function is logged by the job system.
+     *
+     * @tparam FuncT type of the function to execute
+     * @tparam ArgsT type of the arguments to be passed to the function
+     * @param meta job metadata. Can be used to give a unique label to this task and setup worker affinity.
+     * @param function function containing code to execute.
+     * @param args arguments to be passed to the function
+     * @return the created task
+     */
+    template <typename FuncT, typename... ArgsT>
+    Task create_task(DetachedTag, JobMetadata&& meta, FuncT&& function, ArgsT&&... args);
 
     /**
      * @brief Non-blockingly check if any worker threads are busy.
@@ -165,8 +190,20 @@ public:
      */
     bool is_busy() const;
 
+    /**
+     * @brief Non-blockingly check if the calling thread has jobs waiting in its own queues.
+     * Adaptive algorithms use this to decide whether to split their work: if the local queues are empty, idle threads
+     * have nothing to steal from us.
+     *
+     * @return true if at least one job is waiting in the queues of the calling thread
+     */
+    bool this_thread_has_pending_jobs() const;
+
     /**
      * @brief Wait for an input condition to become false, synchronous work may be executed in the meantime.
+     * When there is no work left for this thread, it spins for a while, then parks until a job is pushed to its
+     * queues or a job completes, at which point the condition is reevaluated. The condition should thus only depend
+     * on job completion (or be cheap enough to be polled).
      * @note Will automatically release all finished jobs.
      *
      * @param condition predicate that will keep the function busy till it evaluates to false
@@ -191,6 +228,24 @@ public:
      */
     void wait_on_barrier(uint64_t barrier_id);
 
+    /**
+     * @brief Schedule the resumption of a suspended coroutine on a worker.
+     * The coroutine is resumed by a detached job going through the regular queues.
+     *
+     * @param handle coroutine to resume
+     * @param meta metadata of the resuming job (affinity, priority...)
+     */
+    void resume(std::coroutine_handle<> handle, const JobMetadata& meta);
+
+    /**
+     * @brief Resume a suspended coroutine once all jobs under a barrier are processed.
+     *
+     * @param barrier_id barrier ID
+     * @param waiter intrusive waiter node holding the coroutine handle, must outlive the suspension
+     * @return false if the barrier is already finished: the coroutine should not suspend
+     */
+    bool suspend_on_barrier(barrier_t barrier_id, BarrierWaiter& waiter);
+
     /// Get the number of threads
     inline size_t get_threads_count() const
     {
@@ -208,12 +263,54 @@ public:
         return config_;
     }
 
+    /**
+     * @brief Get the queue latency histogram of a priority class.
+     * Latencies are measured between dispatch and start of execution, only when profiling is enabled. Workers report
+     * their activity when they go idle, so the histogram lags behind a little.
+     *
+     * @param priority priority class
+     * @return const LatencyHistogram&
+     */
+    const LatencyHistogram& get_queue_latency(JobPriority priority);
+
+    /// Get the CPU topology detected on construction
+    inline const CpuTopology& get_topology() const
+    {
+        return topology_;
+    }
+
+    /**
+     * @brief Get the logical CPU a worker is placed on.
+     * Workers are assigned CPUs in the order given by CpuTopology::placement_order(), wrapping around if there are
+     * more workers than CPUs. The worker is only guaranteed to run there if Config::pin_workers is set.
+     *
+     * @param tid worker id
+     * @return const CpuInfo&
+     */
+    inline const CpuInfo& get_worker_cpu(tid_t tid) const
+    {
+        return worker_cpus_[tid];
+    }
+
     /// Get the tid of the current thread.
     inline tid_t this_thread_id() const
     {
         return thread_ids_.at(std::this_thread::get_id());
     }
 
+    /**
+     * @brief Get the tid of the current thread, if it is the main thread or a worker.
+     * Jobs can also be scheduled from external threads (a timer thread for example), they are then dispatched to the
+     * workers public and private queues only.
+     *
+     * @return the tid of the current thread, or k_external_tid if the thread was not spawned by the job system
+     */
+    inline tid_t try_this_thread_id() const
+    {
+        auto findit = thread_ids_.find(std::this_thread::get_id());
+        return (findit != thread_ids_.end()) ? findit->second : k_external_tid;
+    }
+
     /// Get pointer to instrumentation session
     inline InstrumentationSession* get_instrumentation_session()
     {
@@ -245,6 +342,14 @@ private:
      */
     Barrier& get_barrier(barrier_t id);
 
+    /**
+     * @internal
+     * @brief Remove a job from a barrier, and resume the coroutines waiting on it if this was the last one.
+     *
+     * @param id Barrier ID
+     */
+    void signal_barrier(barrier_t id);
+
     /**
      * @internal
      * @brief Create a new job.
@@ -255,7 +360,7 @@ private:
      * @param meta job metadata. Can be used to give a unique label to this job and setup worker affinity.
      * @return a new job from the pool
      */
-    Job* create_job(std::function<void(void)>&& kernel, JobMetadata&& meta = JobMetadata{});
+    Job* create_job(JobKernel&& kernel, JobMetadata&& meta = JobMetadata{});
 
     /**
      * @internal
@@ -269,6 +374,29 @@ private:
      */
     void release_job(Job* job);
 
+    /**
+     * @internal
+     * @brief Remove a reference to a job.
+     * A job is referenced by the worker that executes it until it is processed, and by its futures. The last
+     * reference returns the job to the pool.
+     *
+     * @note Can be called concurrently.
+     *
+     * @param job the job to release
+     */
+    void release_job_ref(Job* job);
+
+    /**
+     * @internal
+     * @brief Make a job dependent on another.
+     * The first dependents are stored inside the parent job, additional ones are stored in overflow blocks
+     * allocated from a dedicated pool, and returned to the pool when the parent job is released.
+     *
+     * @param parent the job to be processed first
+     * @param child the dependent job
+     */
+    void connect(Job* parent, Job* child);
+
     /**
      * @internal
      * @brief Try to schedule job execution.
@@ -287,6 +415,24 @@ private:
      */
     bool try_schedule(Job* job, size_t num_jobs);
 
+    /**
+     * @internal
+     * @brief Wake up the worker a job was just dispatched to.
+     * If the target worker is busy and the job is stealable, a parked idle worker is woken up instead, so that it can
+     * steal the job.
+     *
+     * @param target worker the job was dispatched to
+     * @param stealable whether the job can be stolen
+     */
+    void wake_up(tid_t target, bool stealable);
+
+    /**
+     * @internal
+     * @brief Wake up the threads parked in wait_until(), after a job completed.
+     *
+     */
+    void notify_waiters();
+
 private:
     Config config_;
 
@@ -296,6 +442,8 @@ private:
 
     size_t CPU_cores_count_{0};
     size_t threads_count_{0};
+    CpuTopology topology_;
+    std::vector<CpuInfo> worker_cpus_;
     ankerl::unordered_dense::map<std::thread::id, tid_t> thread_ids_;
     Barrier* barriers_{nullptr};
     SharedState* shared_state_{nullptr};
@@ -391,45 +539,43 @@ private:
      * @brief Construct a new Task
      *
      * @tparam FuncT type of function to execute
-     * @tparam PromiseT promise type
      * @tparam ArgsT kernel arguments pack
      * @param js job system instance
      * @param meta job metadata
      * @param func function to execute
-     * @param promise promise to store the result
      * @param args kernel arguments
      */
-    template <typename FuncT, typename PromiseT, typename... ArgsT>
-    Task(JobSystem* js, JobMetadata&& meta, FuncT&& func, PromiseT&& promise, ArgsT&&... args) : js_(js)
+    template <typename FuncT, typename... ArgsT>
+    Task(JobSystem* js, JobMetadata&& meta, FuncT&& func, ArgsT&&... args) : js_(js)
     {
         /*
             Job kernel is a void wrapper around the templated kernel passed in this call. This allows
             some form of type erasure: user code can access kernel arguments, but the
             workers only see a void function call.
-            The promise is stored as a shared_ptr, as a plain std::promise cannot
-            be captured by the lambda (non-copyable). The kernel and its arguments can be moved.
+            The result is stored in the result slot of the job, where futures can find it.
+            The kernel and its arguments are moved, they can be move-only.
         */
-        auto kernel = [func = std::forward<FuncT>(func), promise = std::forward<PromiseT>(promise),
-                       ... args = std::forward<ArgsT>(args)]() mutable {
+        auto kernel = [func = std::forward<FuncT>(func),
+                       ... args = std::forward<ArgsT>(args)](ResultSlot& slot) mutable {
+            using ResultType = std::invoke_result_t<FuncT, ArgsT...>;
             try
             {
                 // void functions need special care
-                if constexpr (std::is_void_v<std::invoke_result_t<FuncT, ArgsT...>>)
+                if constexpr (std::is_void_v<ResultType>)
                 {
                     func(std::forward<ArgsT>(args)...);
-                    promise->set_value();
                 }
                 else
                 {
-                    // set the promise value as the kernel return value
-                    promise->set_value(func(std::forward<ArgsT>(args)...));
+                    // set the result as the kernel return value
+                    slot.emplace<ResultType>(func(std::forward<ArgsT>(args)...));
                 }
             }
             catch (...)
             {
                 // Store any exception thrown by the kernel function,
                 // it will be rethrown when the future's get() function is called.
-                promise->set_exception(std::current_exception());
+                slot.set_exception(std::current_exception());
             }
         };
 
@@ -437,10 +583,62 @@ private:
         job_ = js_->create_job(std::move(kernel), std::move(meta));
     }
 
+    /**
+     * @internal
+     * @brief Construct a new fire-and-forget Task
+     *
+     * @tparam FuncT type of function to execute
+     * @tparam ArgsT kernel arguments pack
+     * @param js job system instance
+     * @param meta job metadata
+     * @param func function to execute
+     * @param args kernel arguments
+     */
+    template <typename FuncT, typename... ArgsT>
+    Task(JobSystem* js, DetachedTag, JobMetadata&& meta, FuncT&& func, ArgsT&&... args) : js_(js)
+    {
+        auto kernel = [func = std::forward<FuncT>(func),
+                       ... args = std::forward<ArgsT>(args)](ResultSlot& slot) mutable {
+            try
+            {
+                func(std::forward<ArgsT>(args)...);
+            }
+            catch (...)
+            {
+                // Nobody will ever read it, but the worker will log it
+                slot.set_exception(std::current_exception());
+            }
+        };
+
+        job_ = js_->create_job(std::move(kernel), std::move(meta));
+    }
+
 private:
     JobSystem* js_{nullptr};
     Job* job_{nullptr};
 };
 
+template <typename FuncT, typename... ArgsT>
+inline auto JobSystem::create_task(JobMetadata&& meta, FuncT&& function, ArgsT&&... args)
+{
+    using ResultType = std::invoke_result_t<FuncT, ArgsT...>;
+
+    /*
+        NOTE(ndx): The result is written to the job node directly, and the future is a
+        reference counted handle to the job. This used to require a pooled std::promise
+        behind a shared_ptr, because std::function cannot hold a move-only callable.
+    */
+    Task task(this, std::forward<JobMetadata>(meta), std::forward<FuncT>(function), std::forward<ArgsT>(args)...);
+    Future<ResultType> future(this, task.job_);
+    return std::make_pair(std::move(task), std::move(future));
+}
+
+template <typename FuncT, typename... ArgsT>
+inline Task JobSystem::create_task(DetachedTag, JobMetadata&& meta, FuncT&& function, ArgsT&&... args)
+{
+    return Task(this, detached, std::forward<JobMetadata>(meta), std::forward<FuncT>(function),
+                std::forward<ArgsT>(args)...);
+}
+
 } // namespace th
 } // namespace kb
\ No newline at end of file
@@ -0,0 +1,547 @@
+#pragma once
+
+#include "kibble/memory/util/alignment.h"
+#include "kibble/thread/job/job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @file parallel.h
+ * @brief Data-parallel algorithms built on top of the job system.
+ *
+ * All algorithms use lazy binary splitting: the calling thread starts processing the whole range grain by grain,
+ * and before each grain, it checks whether its own job queues are empty. If they are, no work is available for
+ * thieves, so the remaining range is split in two halves, and the upper half is scheduled as a new task. This task
+ * can in turn be split by whoever steals it. Splitting thus only happens when there are idle workers to feed, which
+ * adapts the task granularity to the actual load, without any tuning.
+ * This works best with QueueMode::WorkStealing, where spawned tasks are pushed to the local deque of the spawning
+ * worker. With QueueMode::Shared, spawned tasks are dispatched to other workers, the local queues are mostly empty,
+ * and the splitting degenerates into eager splitting down to the grain size.
+ *
+ * Spawned tasks are grouped under a barrier, and the calling thread helps executing them until they are all done.
+ * If no barrier is available, or if the job system has a single thread, the algorithm runs serially on the calling
+ * thread.
+ *
+ * If the user function throws, remaining grains are skipped, and the first exception is rethrown on the calling
+ * thread once all spawned tasks have finished.
+ *
+ * @warning The algorithms must be called from a thread owned by the job system (main thread or worker thread). They
+ * can be nested.
+ */
+
+namespace kb::th
+{
+
+/**
+ * @brief Options common to all parallel algorithms.
+ *
+ */
+struct ParallelOptions
+{
+    /// Number of iterations processed between two split checks, and smallest range a task can be split into. If 0,
+    /// the grain size is deduced from the range size and the number of threads.
+    size_t grain_size = 0;
+    /// Worker affinity of the spawned tasks
+    worker_affinity_t affinity = WORKER_AFFINITY_ANY;
+    /// Name of the spawned tasks, for profiling
+    const char* name = "parallel";
+};
+
+namespace detail
+{
+
+/**
+ * @internal
+ * @brief State shared by all the tasks spawned by a single parallel algorithm call.
+ *
+ */
+class ParallelContext
+{
+public:
+    /// Maximum number of tasks spawned per thread, this bounds the load on the job pool
+    static constexpr size_t k_max_tasks_per_thread = 64;
+    /// Number of grains per thread when the grain size is deduced automatically
+    static constexpr size_t k_auto_grains_per_thread = 16;
+
+    ParallelContext(JobSystem& js, size_t count, const ParallelOptions& options)
+        : js_(js), options_(options), grain_(options.grain_size),
+          budget_(int64_t(js.get_threads_count() * k_max_tasks_per_thread))
+    {
+        size_t threads = js_.get_threads_count();
+        if (grain_ == 0)
+        {
+            grain_ = std::max(size_t(1), count / (threads * k_auto_grains_per_thread));
+        }
+        if (threads > 1 && count > grain_)
+        {
+            barrier_ = js_.create_barrier();
+        }
+    }
+
+    ~ParallelContext()
+    {
+        if (barrier_ != k_no_barrier)
+        {
+            js_.destroy_barrier(barrier_);
+        }
+    }
+
+    inline size_t grain() const
+    {
+        return grain_;
+    }
+
+    /// Check if a range of this size should be split now
+    inline bool should_split(size_t remaining) const
+    {
+        return barrier_ != k_no_barrier && remaining > grain_ &&
+               budget_.load(std::memory_order_relaxed) > 0 && !js_.this_thread_has_pending_jobs();
+    }
+
+    /// Schedule a task under the barrier of this context
+    template <typename FuncT>
+    inline void spawn(FuncT&& func)
+    {
+        budget_.fetch_sub(1, std::memory_order_relaxed);
+        auto task =
+            js_.create_task(detached, JobMetadata(options_.affinity, options_.name), std::forward<FuncT>(func));
+        task.schedule(barrier_);
+    }
+
+    /// Help executing spawned tasks until they are all processed, then rethrow the first exception, if any
+    inline void wait()
+    {
+        if (barrier_ != k_no_barrier)
+        {
+            js_.wait_on_barrier(barrier_);
+        }
+        if (exception_)
+        {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+    /// Save the current exception, only the first one is kept
+    inline void capture_exception()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!exception_)
+        {
+            exception_ = std::current_exception();
+        }
+        failed_.store(true, std::memory_order_relaxed);
+    }
+
+    /// Check if any task failed
+    inline bool failed() const
+    {
+        return failed_.load(std::memory_order_relaxed);
+    }
+
+private:
+    JobSystem& js_;
+    ParallelOptions options_;
+    size_t grain_;
+    barrier_t barrier_{k_no_barrier};
+    std::atomic<int64_t> budget_;
+    std::atomic<bool> failed_{false};
+    std::mutex mutex_;
+    std::exception_ptr exception_{nullptr};
+};
+
+/**
+ * @internal
+ * @brief Process the range [begin, end) grain by grain, splitting it lazily.
+ *
+ * @tparam BodyT callable with signature void(size_t begin, size_t end)
+ * @param ctx shared context
+ * @param begin start of the range
+ * @param end end of the range
+ * @param body function called on each grain
+ */
+template <typename BodyT>
+void lazy_split(ParallelContext& ctx, size_t begin, size_t end, BodyT& body)
+{
+    try
+    {
+        while (begin < end && !ctx.failed())
+        {
+            if (ctx.should_split(end - begin))
+            {
+                size_t mid = begin + (end - begin) / 2;
+                ctx.spawn([&ctx, &body, mid, end]() { lazy_split(ctx, mid, end, body); });
+                end = mid;
+                continue;
+            }
+
+            size_t grain_end = begin + std::min(end - begin, ctx.grain());
+            body(begin, grain_end);
+            begin = grain_end;
+        }
+    }
+    catch (...)
+    {
+        ctx.capture_exception();
+    }
+}
+
+/**
+ * @internal
+ * @brief Run a body over [0, count) in parallel and wait for completion.
+ *
+ * @tparam BodyT callable with signature void(size_t begin, size_t end)
+ * @param js job system instance
+ * @param count number of iterations
+ * @param body function called on each grain
+ * @param options algorithm options
+ */
+template <typename BodyT>
+void run_parallel(JobSystem& js, size_t count, BodyT&& body, const ParallelOptions& options)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    ParallelContext ctx(js, count, options);
+    lazy_split(ctx, 0, count, body);
+    ctx.wait();
+}
+
+/// Cache line sized wrapper, so that per-thread accumulators do not false share
+template <typename T>
+struct L1_ALIGN PaddedValue
+{
+    T value;
+};
+
+/**
+ * @internal
+ * @brief Find how many elements of a come first in the stable merge of a and b truncated to k elements.
+ *
+ */
+template <typename ItA, typename ItB, typename CompareT>
+size_t merge_corank(size_t k, ItA a, size_t size_a, ItB b, size_t size_b, CompareT& comp)
+{
+    size_t lo = (k > size_b) ? k - size_b : 0;
+    size_t hi = std::min(k, size_a);
+    while (lo < hi)
+    {
+        size_t ii = lo + (hi - lo) / 2;
+        size_t jj = k - ii;
+        // Ties are resolved in favor of a, as in std::merge
+        if (jj == 0 || comp(b[std::ptrdiff_t(jj - 1)], a[std::ptrdiff_t(ii)]))
+        {
+            hi = ii;
+        }
+        else
+        {
+            lo = ii + 1;
+        }
+    }
+    return lo;
+}
+
+} // namespace detail
+
+/**
+ * @brief Call a function for each index in [first, last), in parallel.
+ *
+ * @tparam IndexT integral index type
+ * @tparam FuncT callable with signature void(IndexT)
+ * @param js job system instance
+ * @param first first index
+ * @param last index past the end
+ * @param func function to call for each index
+ * @param options algorithm options
+ */
+template <std::integral IndexT, typename FuncT>
+void parallel_for(JobSystem& js, IndexT first, IndexT last, FuncT&& func, const ParallelOptions& options = {})
+{
+    if (last <= first)
+    {
+        return;
+    }
+
+    auto body = [first, &func](size_t begin, size_t end) {
+        for (size_t ii = begin; ii < end; ++ii)
+        {
+            func(IndexT(first + IndexT(ii)));
+        }
+    };
+    detail::run_parallel(js, size_t(last - first), body, options);
+}
+
+/**
+ * @brief Map each index in [first, last) to a value and reduce these values, in parallel.
+ *
+ * Each grain is reduced locally, then partial results are accumulated per thread, and the per-thread results are
+ * finally reduced on the calling thread. The order in which values are combined is unspecified, so the reduction
+ * must be associative and commutative.
+ *
+ * @tparam IndexT integral index type
+ * @tparam T value type
+ * @tparam MapT callable with signature T(IndexT)
+ * @tparam ReduceT callable with signature T(T, T)
+ * @param js job system instance
+ * @param first first index
+ * @param last index past the end
+ * @param identity identity element of the reduction
+ * @param map function producing the value for an index
+ * @param reduce function combining two values
+ * @param options algorithm options
+ * @return T the reduced value
+ */
+template <std::integral IndexT, typename T, typename MapT, typename ReduceT>
+T parallel_reduce(JobSystem& js, IndexT first, IndexT last, T identity, MapT&& map, ReduceT&& reduce,
+                  const ParallelOptions& options = {})
+{
+    if (last <= first)
+    {
+        return identity;
+    }
+
+    std::vector<detail::PaddedValue<T>> partials(js.get_threads_count(), detail::PaddedValue<T>{identity});
+    auto body = [&](size_t begin, size_t end) {
+        T acc = identity;
+        for (size_t ii = begin; ii < end; ++ii)
+        {
+            acc = reduce(std::move(acc), map(IndexT(first + IndexT(ii))));
+        }
+        T& partial = partials[js.this_thread_id()].value;
+        partial = reduce(std::move(partial), std::move(acc));
+    };
+    detail::run_parallel(js, size_t(last - first), body, options);
+
+    T result = identity;
+    for (auto& partial : partials)
+    {
+        result = reduce(std::move(result), std::move(partial.value));
+    }
+    return result;
+}
+
+/**
+ * @brief Compute an inclusive prefix scan of [first, last) into d_first, in parallel.
+ *
+ * The range is divided into blocks. A first pass reduces each block, the block sums are scanned serially, and a second
+ * pass scans each block starting from the prefix of the preceding blocks. The operation must be associative.
+ * The output range may be the same as the input range.
+ *
+ * @tparam InputIt random access input iterator
+ * @tparam OutputIt random access output iterator
+ * @tparam T value type
+ * @tparam BinaryOp callable with signature T(T, T)
+ * @param js job system instance
+ * @param first start of the input range
+ * @param last end of the input range
+ * @param d_first start of the output range
+ * @param identity identity element of the operation
+ * @param op associative operation
+ * @param options algorithm options. The grain size is the block size.
+ */
+template <std::random_access_iterator InputIt, std::random_access_iterator OutputIt, typename T,
+          typename BinaryOp = std::plus<>>
+void parallel_scan(JobSystem& js, InputIt first, InputIt last, OutputIt d_first, T identity, BinaryOp op = {},
+                   const ParallelOptions& options = {})
+{
+    auto count = size_t(std::distance(first, last));
+    if (count == 0)
+    {
+        return;
+    }
+
+    size_t threads = js.get_threads_count();
+    size_t block_size = options.grain_size;
+    if (block_size == 0)
+    {
+        block_size = std::max(size_t(1), count / (threads * detail::ParallelContext::k_auto_grains_per_thread));
+    }
+    size_t blocks = (count + block_size - 1) / block_size;
+    auto block_range = [=](size_t block) {
+        return std::make_pair(std::ptrdiff_t(block * block_size),
+                              std::ptrdiff_t(std::min(count, (block + 1) * block_size)));
+    };
+
+    ParallelOptions block_options = options;
+    block_options.grain_size = 1;
+
+    // Pass 1: reduce each block
+    std::vector<T> sums(blocks, identity);
+    detail::run_parallel(
+        js, blocks,
+        [&](size_t begin, size_t end) {
+            for (size_t block = begin; block < end; ++block)
+            {
+                auto [block_begin, block_end] = block_range(block);
+                T acc = identity;
+                for (auto ii = block_begin; ii < block_end; ++ii)
+                {
+                    acc = op(std::move(acc), first[ii]);
+                }
+                sums[block] = std::move(acc);
+            }
+        },
+        block_options);
+
+    // Exclusive scan of the block sums
+    T prefix = identity;
+    for (auto& sum : sums)
+    {
+        T next = op(prefix, std::move(sum));
+        sum = std::move(prefix);
+        prefix = std::move(next);
+    }
+
+    // Pass 2: scan each block, starting from its prefix
+    detail::run_parallel(
+        js, blocks,
+        [&](size_t begin, size_t end) {
+            for (size_t block = begin; block < end; ++block)
+            {
+                auto [block_begin, block_end] = block_range(block);
+                T acc = sums[block];
+                for (auto ii = block_begin; ii < block_end; ++ii)
+                {
+                    acc = op(std::move(acc), first[ii]);
+                    d_first[ii] = acc;
+                }
+            }
+        },
+        block_options);
+}
+
+/**
+ * @brief Sort a range in parallel.
+ *
+ * The range is divided into a power of two number of chunks that are sorted concurrently with std::sort(). Then,
+ * chunks are merged pairwise until a single one remains. Each merge is itself split into independent segments by
+ * binary searching the position of the segment bounds in both inputs, so that all threads stay busy during the last
+ * merge rounds. Merges ping-pong between the range and a temporary buffer.
+ * This sort is not stable, because of std::sort().
+ *
+ * @tparam RandomIt random access iterator, the value type must be default constructible and movable
+ * @tparam CompareT comparison function object type
+ * @param js job system instance
+ * @param first start of the range
+ * @param last end of the range
+ * @param comp comparison function object
+ * @param options algorithm options. If the grain size is not 0, ranges smaller than it are sorted serially.
+ */
+template <std::random_access_iterator RandomIt, typename CompareT = std::less<>>
+void parallel_sort(JobSystem& js, RandomIt first, RandomIt last, CompareT comp = {},
+                   const ParallelOptions& options = {})
+{
+    using ValueType = typename std::iterator_traits<RandomIt>::value_type;
+    static constexpr size_t k_serial_threshold = 4096;
+    static constexpr size_t k_segments_per_thread = 4;
+
+    auto count = size_t(std::distance(first, last));
+    size_t threads = js.get_threads_count();
+    size_t serial_threshold = (options.grain_size != 0) ? options.grain_size : k_serial_threshold;
+    if (threads == 1 || count <= serial_threshold)
+    {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    size_t chunks = std::min(std::bit_ceil(2 * threads), std::bit_floor(count / serial_threshold));
+    chunks = std::max(chunks, size_t(2));
+    size_t chunk_size = (count + chunks - 1) / chunks;
+    auto bound = [count](size_t idx, size_t width) { return std::ptrdiff_t(std::min(count, idx * width)); };
+
+    ParallelOptions chunk_options = options;
+    chunk_options.grain_size = 1;
+
+    // Sort each chunk
+    detail::run_parallel(
+        js, chunks,
+        [&](size_t begin, size_t end) {
+            for (size_t chunk = begin; chunk < end; ++chunk)
+            {
+                std::sort(first + bound(chunk, chunk_size), first + bound(chunk + 1, chunk_size), comp);
+            }
+        },
+        chunk_options);
+
+    // Merge pairs of chunks, doubling the chunk width at each round
+    std::vector<ValueType> buffer(count);
+    std::vector<std::pair<size_t, size_t>> splits;
+    bool in_buffer = false;
+    for (size_t width = chunk_size; width < count; width *= 2)
+    {
+        size_t pairs = (count + 2 * width - 1) / (2 * width);
+        size_t segments = std::max(size_t(1), (threads * k_segments_per_thread) / pairs);
+        // For each segment: (rank in the merged output, rank in the left chunk)
+        splits.resize(pairs * (segments + 1));
+
+        auto merge_round = [&](auto src, auto dst) {
+            // Elements are moved during the merge, so all segment bounds are computed beforehand
+            for (size_t pair = 0; pair < pairs; ++pair)
+            {
+                auto left = bound(2 * pair, width);
+                auto mid = bound(2 * pair + 1, width);
+                auto right = bound(2 * pair + 2, width);
+                auto size_a = size_t(mid - left);
+                auto size_b = size_t(right - mid);
+                for (size_t segment = 0; segment <= segments; ++segment)
+                {
+                    size_t k = ((size_a + size_b) * segment) / segments;
+                    splits[pair * (segments + 1) + segment] = {
+                        k, detail::merge_corank(k, src + left, size_a, src + mid, size_b, comp)};
+                }
+            }
+
+            detail::run_parallel(
+                js, pairs * segments,
+                [&](size_t begin, size_t end) {
+                    for (size_t item = begin; item < end; ++item)
+                    {
+                        size_t pair = item / segments;
+                        auto [k0, i0] = splits[item + pair];
+                        auto [k1, i1] = splits[item + pair + 1];
+                        auto a = src + bound(2 * pair, width);
+                        auto b = src + bound(2 * pair + 1, width);
+                        std::merge(std::make_move_iterator(a + std::ptrdiff_t(i0)),
+                                   std::make_move_iterator(a + std::ptrdiff_t(i1)),
+                                   std::make_move_iterator(b + std::ptrdiff_t(k0 - i0)),
+                                   std::make_move_iterator(b + std::ptrdiff_t(k1 - i1)),
+                                   dst + bound(2 * pair, width) + std::ptrdiff_t(k0), comp);
+                    }
+                },
+                chunk_options);
+        };
+
+        if (in_buffer)
+        {
+            merge_round(buffer.begin(), first);
+        }
+        else
+        {
+            merge_round(first, buffer.begin());
+        }
+        in_buffer = !in_buffer;
+    }
+
+    if (in_buffer)
+    {
+        detail::run_parallel(
+            js, count,
+            [&](size_t begin, size_t end) {
+                std::move(buffer.begin() + std::ptrdiff_t(begin), buffer.begin() + std::ptrdiff_t(end),
+                          first + std::ptrdiff_t(begin));
+            },
+            options);
+    }
+}
+
+} // namespace kb::th
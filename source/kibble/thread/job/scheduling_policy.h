@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+namespace kb::th
+{
+
+/**
+ * @brief Layout of the per-worker job queues.
+ *
+ */
+enum class QueueMode : uint8_t
+{
+    /// Stealable jobs are pushed to the public MPMC queue of the target worker, owner and thieves pop from the same
+    /// ring buffer
+    Shared,
+    /// Stealable jobs scheduled from a worker thread are pushed to a Chase-Lev deque owned by this worker. The owner
+    /// pops in LIFO order without contention, thieves steal in FIFO order. Jobs scheduled from another thread still go
+    /// through the public queue of the target worker.
+    WorkStealing
+};
+
+/**
+ * @brief How an idle worker chooses the next worker to steal from.
+ *
+ */
+enum class VictimSelection : uint8_t
+{
+    /// Cycle through the other workers in order
+    RoundRobin,
+    /// Pick the next victim at random, this spreads the pressure more evenly when many workers are stealing
+    Random,
+    /// Steal from the closest workers first: SMT siblings, then the same L3, then the same socket, then the other
+    /// sockets. Workers at the same distance are visited in random order. Distances are derived from the CPU each
+    /// worker is placed on, so this is best combined with worker pinning.
+    Hierarchical
+};
+
+/**
+ * @brief Spin-then-park policy for threads that run out of work.
+ * An idle thread first retries spin_count times with a CPU pause in between, then yield_count times while yielding its
+ * time slice, and then parks until it is woken up explicitly. Spinning longer lowers the wakeup latency of bursty
+ * workloads at the expense of burnt CPU cycles.
+ *
+ */
+struct ParkingPolicy
+{
+    /// Number of attempts at finding work, separated by a CPU pause
+    uint32_t spin_count = 64;
+    /// Number of attempts at finding work, separated by a yield, after the spinning phase
+    uint32_t yield_count = 4;
+};
+
+} // namespace kb::th
@@ -0,0 +1,117 @@
+#include "kibble/thread/job/task_graph.h"
+#include "kibble/assert/assert.h"
+#include "kibble/thread/job/impl/barrier.h"
+#include "kibble/thread/job/impl/common.h"
+#include "kibble/thread/job/impl/job.h"
+#include "kibble/time/instrumentation.h"
+
+#include <stdexcept>
+
+namespace kb
+{
+namespace th
+{
+
+TaskGraph::TaskGraph(JobSystem& js) : js_(js)
+{
+    barrier_id_ = js_.create_barrier();
+    if (barrier_id_ == k_no_barrier)
+    {
+        throw std::runtime_error("TaskGraph: no barrier available.");
+    }
+}
+
+TaskGraph::~TaskGraph()
+{
+    js_.wait_on_barrier(barrier_id_);
+
+    for (Job* job : nodes_)
+    {
+        job->force_state(JobState::Processed);
+        js_.release_job(job);
+    }
+
+    js_.destroy_barrier(barrier_id_);
+}
+
+TaskGraphNode TaskGraph::add_job(Job* job)
+{
+    K_ASSERT(is_done(), "Tried to modify a TaskGraph while it is executing.");
+
+    // The job is never returned to the pool by the workers
+    job->keep_alive = true;
+    job->barrier_id = barrier_id_;
+    nodes_.push_back(job);
+    dirty_ = true;
+    return nodes_.size() - 1;
+}
+
+void TaskGraph::precede(TaskGraphNode before, TaskGraphNode after)
+{
+    K_ASSERT(is_done(), "Tried to modify a TaskGraph while it is executing.");
+    K_ASSERT(before < nodes_.size() && after < nodes_.size(), "TaskGraph node out of bounds.");
+    K_ASSERT(before != after, "A TaskGraph node cannot depend on itself.");
+
+    js_.connect(nodes_[before], nodes_[after]);
+    dirty_ = true;
+}
+
+void TaskGraph::submit()
+{
+    JS_PROFILE_FUNCTION(js_.get_instrumentation_session(), js_.this_thread_id());
+    K_ASSERT(is_done(), "Tried to submit a TaskGraph that is still executing.");
+
+    if (nodes_.empty())
+    {
+        return;
+    }
+
+    // Cache the root nodes, they only change when the graph is modified
+    if (dirty_)
+    {
+        roots_.clear();
+        for (Job* job : nodes_)
+        {
+            if (job->in_count() == 0)
+            {
+                roots_.push_back(job);
+            }
+        }
+        K_ASSERT(!roots_.empty(), "TaskGraph has no root node, it must contain a cycle.");
+        dirty_ = false;
+    }
+
+    for (Job* job : nodes_)
+    {
+        job->rearm();
+        job->result.reset();
+    }
+
+    // The whole graph is accounted for when the first root is scheduled
+    js_.get_barrier(barrier_id_).add_dependencies(nodes_.size());
+    size_t num_jobs = nodes_.size();
+    for (Job* job : roots_)
+    {
+        [[maybe_unused]] bool success = js_.try_schedule(job, num_jobs);
+        K_ASSERT(success, "Could not schedule TaskGraph root node.");
+        num_jobs = 0;
+    }
+}
+
+void TaskGraph::wait()
+{
+    js_.wait_on_barrier(barrier_id_);
+
+    for (Job* job : nodes_)
+    {
+        job->result.rethrow_if_exception();
+    }
+}
+
+bool TaskGraph::is_done() const
+{
+    return js_.get_barrier(barrier_id_).finished();
+}
+
+} // namespace th
+} // namespace kb
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "kibble/thread/job/job_system.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace kb
+{
+namespace th
+{
+
+/// Refers to a particular node of a TaskGraph
+using TaskGraphNode = size_t;
+
+/**
+ * @brief Reusable graph of jobs.
+ *
+ * Building a job graph with tasks has a cost: each frame, every job must be allocated, its kernel moved in, the
+ * dependencies connected, and the graph walked before scheduling. A TaskGraph is built once and re-submitted as many
+ * times as needed. Its jobs are kept alive by the JobSystem (like daemon jobs), so a submission only rearms each node
+ * and schedules the root nodes.
+ *
+ * Kernels cannot return values, results should be written to some state captured by reference. If a kernel throws,
+ * the first exception found is rethrown by wait().
+ *
+ * @note The graph holds a barrier of the JobSystem for its entire lifetime.
+ * @warning The graph must not be modified or destroyed while a submission is in flight. The destructor waits
+ * for the last submission to finish.
+ *
+ */
+class TaskGraph
+{
+public:
+    /**
+     * @brief Construct an empty graph.
+     *
+     * @param js Reference to an existing JobSystem instance.
+     */
+    TaskGraph(JobSystem& js);
+
+    /**
+     * @brief Wait for the last submission, return all jobs to the pool and release the barrier.
+     *
+     */
+    ~TaskGraph();
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    /**
+     * @brief Add a node to the graph.
+     *
+     * @tparam FuncT type of function to execute, must return void
+     * @tparam ArgsT kernel arguments pack
+     * @param meta job metadata
+     * @param func function to execute each time the graph is submitted
+     * @param args kernel arguments, they are passed as lvalues as the kernel may run more than once
+     * @return a handle to the new node
+     */
+    template <typename FuncT, typename... ArgsT>
+    TaskGraphNode add(JobMetadata&& meta, FuncT&& func, ArgsT&&... args)
+    {
+        static_assert(std::is_void_v<std::invoke_result_t<FuncT&, ArgsT&...>>, "TaskGraph kernels must return void.");
+
+        auto kernel = [func = std::forward<FuncT>(func),
+                       ... args = std::forward<ArgsT>(args)](ResultSlot& slot) mutable {
+            try
+            {
+                func(args...);
+            }
+            catch (...)
+            {
+                // Rethrown by wait()
+                slot.set_exception(std::current_exception());
+            }
+        };
+
+        return add_job(js_.create_job(std::move(kernel), std::move(meta)));
+    }
+
+    /**
+     * @brief Make a node dependent on another.
+     * There is no limit to the number of dependents and dependencies of a node.
+     *
+     * @param before the node to process first
+     * @param after the node to process once before is processed
+     */
+    void precede(TaskGraphNode before, TaskGraphNode after);
+
+    /**
+     * @brief Schedule all the nodes of the graph.
+     * Only the root nodes are dispatched, the others are scheduled by the workers as their dependencies are processed.
+     *
+     * @warning The previous submission must be finished.
+     *
+     */
+    void submit();
+
+    /**
+     * @brief Hold execution on this thread until all the nodes of the last submission are processed.
+     * If some kernels threw, the first exception found is rethrown.
+     *
+     */
+    void wait();
+
+    /**
+     * @brief Non-blockingly check if the last submission is finished.
+     *
+     * @return true if all the nodes are processed, or the graph was never submitted
+     */
+    bool is_done() const;
+
+    /// Get the number of nodes
+    inline size_t size() const
+    {
+        return nodes_.size();
+    }
+
+private:
+    /**
+     * @internal
+     * @brief Take ownership of a new job.
+     *
+     * @param job the job
+     * @return a handle to the node
+     */
+    TaskGraphNode add_job(Job* job);
+
+private:
+    JobSystem& js_;
+    barrier_t barrier_id_{k_no_barrier};
+    std::vector<Job*> nodes_;
+    std::vector<Job*> roots_;
+    bool dirty_{false};
+};
+
+} // namespace th
+} // namespace kb
@@ -0,0 +1,350 @@
+#include "kibble/thread/topology.h"
+#include "kibble/string/string.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <set>
+#include <tuple>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#elif _WIN32
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace kb::th
+{
+
+namespace
+{
+
+// CPU indices past this are malformed, and could make a range loop wrap around
+#ifdef __linux__
+constexpr unsigned long k_max_cpus = CPU_SETSIZE;
+#else
+constexpr unsigned long k_max_cpus = 1024;
+#endif
+
+std::optional<std::string> read_line(const fs::path& path)
+{
+    std::ifstream ifs(path);
+    std::string line;
+    if (!ifs.is_open() || !std::getline(ifs, line))
+    {
+        return std::nullopt;
+    }
+    su::trim(line);
+    return line;
+}
+
+std::optional<uint32_t> read_uint(const fs::path& path)
+{
+    auto line = read_line(path);
+    if (!line || line->empty())
+    {
+        return std::nullopt;
+    }
+    try
+    {
+        long value = std::stol(*line);
+        return value < 0 ? 0u : uint32_t(value);
+    }
+    catch (const std::exception&)
+    {
+        return std::nullopt;
+    }
+}
+
+// Lowest CPU index of a CPU list file
+std::optional<uint32_t> read_list_min(const fs::path& path)
+{
+    auto line = read_line(path);
+    if (!line)
+    {
+        return std::nullopt;
+    }
+    auto cpus = parse_cpu_list(*line);
+    if (cpus.empty())
+    {
+        return std::nullopt;
+    }
+    return *std::min_element(cpus.begin(), cpus.end());
+}
+
+// Highest level cache shared by this CPU, identified by the lowest CPU index sharing it
+std::optional<uint32_t> read_llc(const fs::path& cpu_dir)
+{
+    std::error_code ec;
+    if (!fs::is_directory(cpu_dir / "cache", ec))
+    {
+        return std::nullopt;
+    }
+
+    uint32_t best_level = 0;
+    std::optional<uint32_t> llc;
+    for (const auto& entry : fs::directory_iterator(cpu_dir / "cache", ec))
+    {
+        if (entry.path().filename().string().rfind("index", 0) != 0)
+        {
+            continue;
+        }
+        auto level = read_uint(entry.path() / "level");
+        auto shared = read_list_min(entry.path() / "shared_cpu_list");
+        if (level && shared && *level > best_level)
+        {
+            best_level = *level;
+            llc = shared;
+        }
+    }
+    return llc;
+}
+
+std::optional<uint32_t> read_node(const fs::path& cpu_dir)
+{
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(cpu_dir, ec))
+    {
+        auto name = entry.path().filename().string();
+        auto is_digit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+        if (name.size() > 4 && name.rfind("node", 0) == 0 && std::all_of(name.begin() + 4, name.end(), is_digit))
+        {
+            return uint32_t(std::stoul(name.substr(4)));
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<uint32_t> allowed_cpus()
+{
+    std::vector<uint32_t> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+template <typename MemberT>
+size_t count_distinct(const std::vector<CpuInfo>& cpus, MemberT member)
+{
+    std::set<uint32_t> ids;
+    for (const auto& info : cpus)
+    {
+        ids.insert(info.*member);
+    }
+    return ids.size();
+}
+
+} // namespace
+
+std::vector<uint32_t> parse_cpu_list(const std::string& list)
+{
+    std::vector<uint32_t> cpus;
+    su::tokenize(list, ',', [&cpus](const std::string& token) {
+        auto range = su::trim_copy(token);
+        if (range.empty())
+        {
+            return;
+        }
+        try
+        {
+            auto dash = range.find('-');
+            unsigned long first = std::stoul(range.substr(0, dash));
+            unsigned long last = (dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1));
+            if (last >= k_max_cpus)
+            {
+                return;
+            }
+            for (unsigned long cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(uint32_t(cpu));
+            }
+        }
+        catch (const std::exception&)
+        {
+            // Malformed token, skip it
+        }
+    });
+    return cpus;
+}
+
+CpuTopology CpuTopology::detect()
+{
+    auto topology = from_sysfs("/sys/devices/system/cpu", allowed_cpus());
+    if (topology.size() == 0)
+    {
+        return flat(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    return topology;
+}
+
+CpuTopology CpuTopology::from_sysfs(const std::string& sysfs_root, const std::vector<uint32_t>& allowed)
+{
+    CpuTopology topology;
+    fs::path root(sysfs_root);
+
+    std::vector<uint32_t> online;
+    if (auto line = read_line(root / "online"))
+    {
+        online = parse_cpu_list(*line);
+    }
+
+    for (uint32_t cpu : online)
+    {
+        if (!allowed.empty() && std::find(allowed.begin(), allowed.end(), cpu) == allowed.end())
+        {
+            continue;
+        }
+
+        fs::path cpu_dir = root / ("cpu" + std::to_string(cpu));
+        fs::path topo_dir = cpu_dir / "topology";
+
+        CpuInfo info;
+        info.cpu = cpu;
+        info.core = read_list_min(topo_dir / "thread_siblings_list").value_or(cpu);
+        info.package = read_uint(topo_dir / "physical_package_id").value_or(0);
+        // Without cache information, assume that the last level cache spans the socket
+        info.l3 = read_llc(cpu_dir).value_or(read_list_min(topo_dir / "core_siblings_list").value_or(0));
+        info.node = read_node(cpu_dir).value_or(info.package);
+        topology.cpus_.push_back(info);
+    }
+
+    topology.detected_ = !topology.cpus_.empty();
+    return topology;
+}
+
+CpuTopology CpuTopology::flat(uint32_t count)
+{
+    CpuTopology topology;
+    for (uint32_t cpu = 0; cpu < count; ++cpu)
+    {
+        topology.cpus_.push_back(CpuInfo{.cpu = cpu, .core = cpu, .l3 = 0, .package = 0, .node = 0});
+    }
+    return topology;
+}
+
+CpuDistance CpuTopology::distance(const CpuInfo& a, const CpuInfo& b)
+{
+    if (a.cpu == b.cpu)
+    {
+        return CpuDistance::Self;
+    }
+    if (a.package != b.package)
+    {
+        return CpuDistance::Remote;
+    }
+    if (a.core == b.core)
+    {
+        return CpuDistance::SameCore;
+    }
+    if (a.l3 == b.l3)
+    {
+        return CpuDistance::SameL3;
+    }
+    return CpuDistance::SamePackage;
+}
+
+std::vector<size_t> CpuTopology::placement_order() const
+{
+    // Rank of each CPU among its SMT siblings
+    std::vector<uint32_t> smt_rank(cpus_.size(), 0);
+    for (size_t ii = 0; ii < cpus_.size(); ++ii)
+    {
+        for (size_t jj = 0; jj < ii; ++jj)
+        {
+            if (cpus_[jj].core == cpus_[ii].core && cpus_[jj].package == cpus_[ii].package)
+            {
+                ++smt_rank[ii];
+            }
+        }
+    }
+
+    std::vector<size_t> order(cpus_.size());
+    for (size_t ii = 0; ii < order.size(); ++ii)
+    {
+        order[ii] = ii;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const auto& ca = cpus_[a];
+        const auto& cb = cpus_[b];
+        return std::tie(smt_rank[a], ca.package, ca.l3, ca.core, ca.cpu) <
+               std::tie(smt_rank[b], cb.package, cb.l3, cb.core, cb.cpu);
+    });
+    return order;
+}
+
+size_t CpuTopology::core_count() const
+{
+    std::set<std::pair<uint32_t, uint32_t>> cores;
+    for (const auto& info : cpus_)
+    {
+        cores.insert({info.package, info.core});
+    }
+    return cores.size();
+}
+
+size_t CpuTopology::l3_count() const
+{
+    return count_distinct(cpus_, &CpuInfo::l3);
+}
+
+size_t CpuTopology::package_count() const
+{
+    return count_distinct(cpus_, &CpuInfo::package);
+}
+
+bool pin_thread([[maybe_unused]] std::thread::native_handle_type native_handle, [[maybe_unused]] uint32_t cpu)
+{
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE)
+    {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(native_handle, sizeof(set), &set) == 0;
+#elif _WIN32
+    if (cpu >= 64)
+    {
+        return false;
+    }
+    return SetThreadAffinityMask(native_handle, DWORD_PTR(1) << cpu) != 0;
+#else
+    // No strict affinity API on this platform
+    return false;
+#endif
+}
+
+bool pin_this_thread([[maybe_unused]] uint32_t cpu)
+{
+#if defined(__linux__)
+    return pin_thread(pthread_self(), cpu);
+#elif _WIN32
+    if (cpu >= 64)
+    {
+        return false;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#else
+    return false;
+#endif
+}
+
+} // namespace kb::th
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kb::th
+{
+
+/**
+ * @brief Location of a logical CPU in the machine topology.
+ * Identifiers are only meaningful for comparison: two CPUs with the same core ID are SMT siblings, two CPUs with the
+ * same L3 ID share the last level cache, and so on.
+ *
+ */
+struct CpuInfo
+{
+    /// Logical CPU index, as used by the OS for affinity masks
+    uint32_t cpu = 0;
+    /// Physical core (lowest CPU index among the SMT siblings)
+    uint32_t core = 0;
+    /// Last level cache domain (lowest CPU index sharing the L3)
+    uint32_t l3 = 0;
+    /// Socket
+    uint32_t package = 0;
+    /// NUMA node
+    uint32_t node = 0;
+};
+
+/**
+ * @brief How far apart two logical CPUs are, from the point of view of data sharing.
+ *
+ */
+enum class CpuDistance : uint8_t
+{
+    /// Same logical CPU
+    Self = 0,
+    /// SMT siblings, they share the whole cache hierarchy
+    SameCore,
+    /// Different cores sharing the last level cache
+    SameL3,
+    /// Same socket, but not the same L3
+    SamePackage,
+    /// Cache lines go through the interconnect
+    Remote
+};
+
+/**
+ * @brief Logical CPUs available to this process, and how they relate to each other.
+ *
+ * On Linux, the topology is read from sysfs, and restricted to the CPUs of the process affinity mask. Elsewhere, or if
+ * sysfs cannot be read, a flat topology is assumed: one core per logical CPU, a single L3, a single socket.
+ *
+ */
+class CpuTopology
+{
+public:
+    /**
+     * @brief Detect the topology of this machine, restricted to the CPUs this process is allowed to run on.
+     *
+     * @return the topology, or a flat topology of std::thread::hardware_concurrency() CPUs if detection failed
+     */
+    static CpuTopology detect();
+
+    /**
+     * @brief Read the topology from a sysfs CPU directory.
+     *
+     * @param sysfs_root path to the sysfs CPU directory (normally /sys/devices/system/cpu)
+     * @param allowed if not empty, only these logical CPUs are kept
+     * @return the topology, empty if the directory could not be read
+     */
+    static CpuTopology from_sysfs(const std::string& sysfs_root, const std::vector<uint32_t>& allowed = {});
+
+    /**
+     * @brief Build a flat topology.
+     *
+     * @param count number of logical CPUs
+     * @return the topology
+     */
+    static CpuTopology flat(uint32_t count);
+
+    /**
+     * @brief Get the distance between two logical CPUs.
+     *
+     * @param a first CPU info
+     * @param b second CPU info
+     * @return CpuDistance
+     */
+    static CpuDistance distance(const CpuInfo& a, const CpuInfo& b);
+
+    /**
+     * @brief Order the logical CPUs for thread placement.
+     * Physical cores are filled first, socket by socket and L3 by L3, then the remaining SMT siblings in the same order.
+     * Placing N threads on the first N CPUs of this list keeps them as close as possible without sharing a core.
+     *
+     * @return indices into cpus()
+     */
+    std::vector<size_t> placement_order() const;
+
+    /// Get the list of logical CPUs
+    inline const std::vector<CpuInfo>& cpus() const
+    {
+        return cpus_;
+    }
+
+    /// Get the number of logical CPUs
+    inline size_t size() const
+    {
+        return cpus_.size();
+    }
+
+    /// Get the number of physical cores
+    size_t core_count() const;
+
+    /// Get the number of L3 domains
+    size_t l3_count() const;
+
+    /// Get the number of sockets
+    size_t package_count() const;
+
+    /// True if the topology was read from the system, false if it is a flat fallback
+    inline bool is_detected() const
+    {
+        return detected_;
+    }
+
+private:
+    std::vector<CpuInfo> cpus_;
+    bool detected_ = false;
+};
+
+/**
+ * @brief Parse a Linux CPU list, such as "0-3,8,10-11".
+ * Malformed ranges and CPU indices that do not fit in a cpu_set_t are skipped.
+ *
+ * @param list the CPU list
+ * @return the CPU indices, in order of appearance
+ */
+std::vector<uint32_t> parse_cpu_list(const std::string& list);
+
+/**
+ * @brief Pin a thread to a single logical CPU.
+ *
+ * @param native_handle native handle of the thread (std::thread::native_handle())
+ * @param cpu logical CPU index
+ * @return true on success, false if the platform does not support it or the call failed
+ */
+bool pin_thread(std::thread::native_handle_type native_handle, uint32_t cpu);
+
+/**
+ * @brief Pin the calling thread to a single logical CPU.
+ *
+ * @param cpu logical CPU index
+ * @return true on success
+ */
+bool pin_this_thread(uint32_t cpu);
+
+} // namespace kb::th
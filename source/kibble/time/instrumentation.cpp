@@ -1,92 +1,222 @@
 #include "kibble/time/instrumentation.h"
 #include "config.h"
+#include "kibble/assert/assert.h"
+#include "kibble/util/unordered_dense.h"
 
-#include "fmt/core.h"
-#include "fmt/std.h"
 #include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 namespace kb
 {
 
-InstrumentationSession::InstrumentationSession()
-    : base_timestamp_us_(
-          std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now())
-              .time_since_epoch()
-              .count())
+namespace
 {
-    profile_data_.resize(KIBBLE_JOBSYS_MAX_THREADS);
+
+struct StringHash
+{
+    using is_transparent = void;
+    using is_avalanching = void;
+
+    inline uint64_t operator()(std::string_view str) const noexcept
+    {
+        return ankerl::unordered_dense::hash<std::string_view>{}(str);
+    }
+};
+
+using StringMap = ankerl::unordered_dense::map<std::string, uint32_t, StringHash, std::equal_to<>>;
+
+/*
+    Process-wide string table, so that interned IDs can be cached in static variables at call sites.
+    Strings are only ever appended.
+*/
+struct StringRegistry
+{
+    std::mutex mutex;
+    std::vector<std::string> strings;
+    StringMap ids;
+};
+
+StringRegistry& registry()
+{
+    static StringRegistry instance;
+    return instance;
+}
+
+} // namespace
+
+InstrumentationSession::InstrumentationSession(size_t ring_capacity)
+    : base_timestamp_ns_(now_ns()), ring_capacity_(ring_capacity)
+{
+    trace_ = std::make_unique<std::stringstream>(std::ios::in | std::ios::out | std::ios::binary);
+    start();
+}
+
+InstrumentationSession::InstrumentationSession(const fs::path& trace_path, size_t ring_capacity)
+    : base_timestamp_ns_(now_ns()), ring_capacity_(ring_capacity)
+{
+    trace_ = std::make_unique<std::fstream>(trace_path, std::ios::in | std::ios::out | std::ios::binary |
+                                                            std::ios::trunc);
+    K_ASSERT(trace_->good(), "Could not open trace file: {}", trace_path.string());
+    start();
 }
 
-void InstrumentationSession::push(const ProfileResult& result)
+InstrumentationSession::~InstrumentationSession()
 {
-    if (enabled_)
     {
-        // Each thread has its own queue, no need to lock.
-        profile_data_[result.thread_id].push_back(result);
+        std::scoped_lock lock(mutex_);
+        stop_ = true;
     }
+    cv_.notify_one();
+    flusher_.join();
+    flush();
 }
 
-void InstrumentationSession::push(ProfileResult&& result)
+void InstrumentationSession::start()
 {
-    if (enabled_)
+    K_ASSERT((ring_capacity_ & (ring_capacity_ - 1)) == 0 && ring_capacity_ > 0,
+             "Ring capacity must be a power of 2, got {}", ring_capacity_);
+
+    ring_count_ = KIBBLE_JOBSYS_MAX_THREADS;
+    rings_ = std::make_unique<EventRing[]>(ring_count_);
+    for (size_t ii = 0; ii < ring_count_; ++ii)
     {
-        profile_data_[result.thread_id].push_back(std::move(result));
+        rings_[ii].events = std::make_unique<TraceEvent[]>(ring_capacity_);
     }
+
+    trace::write_header(*trace_, base_timestamp_ns_);
+    flusher_ = std::thread(&InstrumentationSession::flush_loop, this);
 }
 
-void InstrumentationSession::write(const fs::path& filepath)
+uint32_t InstrumentationSession::intern(std::string_view str)
 {
-    std::ofstream ofs(filepath);
+    // Each thread caches the strings it has already seen, so the registry is only locked once per string and thread
+    thread_local StringMap cache;
+    if (auto it = cache.find(str); it != cache.end())
+    {
+        return it->second;
+    }
+
+    auto& reg = registry();
+    uint32_t id = 0;
+    {
+        std::scoped_lock lock(reg.mutex);
+        auto [it, inserted] = reg.ids.try_emplace(std::string(str), uint32_t(reg.strings.size()));
+        if (inserted)
+        {
+            reg.strings.emplace_back(str);
+        }
+        id = it->second;
+    }
+
+    cache.emplace(std::string(str), id);
+    return id;
+}
 
-    // FIX: Global locale may have changed, we want to make sure we use the C locale,
-    // this avoids outputting float values with comma decimal separators for instance...
-    std::locale system_locale("C");
-    ofs.imbue(system_locale);
+void InstrumentationSession::push(uint32_t thread_id, const TraceEvent& event)
+{
+    if (!enabled_.load(std::memory_order_relaxed) || thread_id >= ring_count_)
+    {
+        return;
+    }
 
-    // Trace Event Format:
-    // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/edit
+    auto& ring = rings_[thread_id];
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= ring_capacity_)
+    {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
 
-    fmt::print(ofs, "{{\"otherData\": {{}},\"traceEvents\":[");
+    ring.events[head & (ring_capacity_ - 1)] = event;
+    ring.head.store(head + 1, std::memory_order_release);
+}
 
-    size_t profile_count = 0;
-    for (const auto& profiles : profile_data_)
+void InstrumentationSession::flush()
+{
+    std::scoped_lock lock(mutex_);
+    drain();
+    trace_->flush();
+}
+
+void InstrumentationSession::drain()
+{
+    // Strings must be defined before the events that refer to them, and they are interned before the events are
+    // pushed, so writing them first is enough
     {
-        for (const auto& profile : profiles)
+        auto& reg = registry();
+        std::scoped_lock lock(reg.mutex);
+        for (; strings_written_ < reg.strings.size(); ++strings_written_)
         {
-            std::string name = profile.name;
-            std::replace(name.begin(), name.end(), '"', '\'');
-            if (profile_count++ > 0)
-            {
-                fmt::print(ofs, ",");
-            }
-            fmt::print(ofs, "{{\"cat\":\"{}\",\"dur\":{},\"name\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{}}}",
-                       profile.category, profile.end - profile.start, name, profile.thread_id + 1,
-                       profile.start - base_timestamp_us_);
+            trace::write_string(*trace_, strings_written_, reg.strings[strings_written_]);
         }
     }
 
-    fmt::print(ofs, "]}}");
+    for (uint32_t tid = 0; tid < ring_count_; ++tid)
+    {
+        auto& ring = rings_[tid];
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+        while (tail != head)
+        {
+            // Write up to the end of the buffer, the wrapped part is handled at the next iteration
+            uint64_t begin = tail & (ring_capacity_ - 1);
+            uint64_t count = std::min(head - tail, ring_capacity_ - begin);
+            trace::write_events(*trace_, tid, &ring.events[begin], uint32_t(count));
+            tail += count;
+        }
+        ring.tail.store(tail, std::memory_order_release);
+
+        if (uint64_t dropped = ring.dropped.exchange(0, std::memory_order_relaxed); dropped > 0)
+        {
+            trace::write_dropped(*trace_, tid, dropped);
+            total_dropped_ += dropped;
+        }
+    }
 }
 
-InstrumentationTimer::InstrumentationTimer(InstrumentationSession* session, const std::string& name,
-                                           const std::string& category, size_t thread_id)
-    : session_(session), name_(name), category_(category), thread_id_(thread_id),
-      start_(std::chrono::high_resolution_clock::now())
+void InstrumentationSession::flush_loop()
 {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_)
+    {
+        if (cv_.wait_for(lock, k_flush_interval, [this]() { return stop_; }))
+        {
+            break;
+        }
+        drain();
+    }
 }
 
-InstrumentationTimer::~InstrumentationTimer()
+void InstrumentationSession::write(const fs::path& filepath)
 {
-    if (session_ == nullptr)
+    trace::TraceData data;
     {
-        return;
+        std::scoped_lock lock(mutex_);
+        drain();
+
+        // Read the binary trace back, then restore the write position
+        trace_->flush();
+        trace_->seekg(0, std::ios::beg);
+        trace::read_trace(*trace_, data);
+        trace_->clear();
+        trace_->seekp(0, std::ios::end);
     }
 
-    auto stop = std::chrono::high_resolution_clock::now();
-    long long start_us = std::chrono::time_point_cast<std::chrono::microseconds>(start_).time_since_epoch().count();
-    long long stop_us = std::chrono::time_point_cast<std::chrono::microseconds>(stop).time_since_epoch().count();
+    std::ofstream ofs(filepath);
+    trace::write_chrome_json(data, ofs);
+}
 
-    session_->push({name_, category_, thread_id_, start_us, stop_us});
+uint64_t InstrumentationSession::get_dropped_count() const
+{
+    std::scoped_lock lock(mutex_);
+    uint64_t dropped = total_dropped_;
+    for (size_t ii = 0; ii < ring_count_; ++ii)
+    {
+        dropped += rings_[ii].dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
 }
 
-} // namespace kb
\ No newline at end of file
+} // namespace kb
@@ -1,65 +1,107 @@
 #pragma once
 
-// Adapted from https://gist.github.com/TheCherno/31f135eea6ee729ab5f26a6908eb3a5e
+// Originally adapted from https://gist.github.com/TheCherno/31f135eea6ee729ab5f26a6908eb3a5e
 // Basic instrumentation profiler by Cherno
 
+#include "kibble/time/trace_format.h"
+
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
-#include <string>
-#include <vector>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <thread>
 
 namespace fs = std::filesystem;
 
 namespace kb
 {
 
-/**
- * @brief All the information necessary to write an execution profile.
- *
- */
-struct ProfileResult
-{
-    /// Descriptive name of the function / scope / task
-    std::string name;
-    /// Event type, to allow for filtering in chrome:tracing
-    std::string category;
-    /// ID of the thread that executed the function
-    size_t thread_id;
-    /// Start timestamp in µs
-    long long start;
-    /// Stop timestamp in µs
-    long long end;
-};
-
 /**
  * @brief Encapsulates profile logging facilities for some part of your codebase.
  * In a game engine, the startup, runtime and shutdown will typically correspond
  * to three distinct profiling sessions. This makes it easier to find the relevant
  * information later on.
  *
+ * Each thread pushes its events to its own fixed-size ring buffer, without locking or allocating. A background thread
+ * regularly drains the ring buffers into a compact binary trace (see trace_format.h), either in memory or streamed to
+ * a file. If a ring buffer is full when an event is pushed, the event is dropped and counted, so the memory footprint
+ * of the profiled threads stays constant whatever the session duration.
+ *
+ * The binary trace can be converted to Chrome JSON with write() or offline with the ktrace utility, which can also
+ * produce a Perfetto protobuf trace.
+ *
  */
 class InstrumentationSession
 {
 public:
+    /// Default number of events per thread ring buffer, must be a power of 2
+    static constexpr size_t k_default_ring_capacity = 16384;
+    /// Time between two flushes of the ring buffers
+    static constexpr std::chrono::milliseconds k_flush_interval{5};
+
+    /**
+     * @brief Construct a session that keeps the binary trace in memory until write() is called.
+     *
+     * @param ring_capacity number of events per thread ring buffer, must be a power of 2
+     */
+    explicit InstrumentationSession(size_t ring_capacity = k_default_ring_capacity);
+
     /**
-     * @brief Construct session.
+     * @brief Construct a session that streams the binary trace to a file.
      *
-     * @param filepath Output json file path.
+     * @param trace_path binary trace file path
+     * @param ring_capacity number of events per thread ring buffer, must be a power of 2
      */
-    InstrumentationSession();
+    explicit InstrumentationSession(const fs::path& trace_path, size_t ring_capacity = k_default_ring_capacity);
+
+    /**
+     * @brief Flush the remaining events and stop the background thread.
+     *
+     */
+    ~InstrumentationSession();
+
+    /**
+     * @brief Get the ID of an interned string.
+     * Interned strings are shared by all sessions, and their IDs never change, so call sites can intern their
+     * names once and store the IDs in static variables. The lookup is lock-free once a thread has seen a string.
+     *
+     * @param str string to intern
+     * @return uint32_t
+     */
+    static uint32_t intern(std::string_view str);
+
+    /// Get the current timestamp in ns, as stored in trace events
+    static inline int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
 
     /**
      * @brief Save profiling information.
      *
-     * @note Lock-free and thread-safe.
+     * @note Lock-free and wait-free. Each thread ID must be used by a single thread at a time. Events from threads
+     * foreign to the job system (ID out of range) are ignored.
+     *
+     * @param thread_id ID of the thread that executed the function
+     * @param event Profiling data.
+     */
+    void push(uint32_t thread_id, const TraceEvent& event);
+
+    /**
+     * @brief Drain the ring buffers to the binary trace now.
      *
-     * @param result Profiling data.
      */
-    void push(const ProfileResult& result);
-    void push(ProfileResult&& result);
+    void flush();
 
     /**
-     * @brief Write profiling information to file.
+     * @brief Write profiling information to a Chrome JSON trace file.
      *
      * @param filepath
      */
@@ -72,13 +114,46 @@ public:
      */
     inline void enable(bool value)
     {
-        enabled_ = value;
+        enabled_.store(value, std::memory_order_relaxed);
     }
 
+    /// Get the number of events dropped so far because a ring buffer was full
+    uint64_t get_dropped_count() const;
+
 private:
-    const long long base_timestamp_us_;
-    bool enabled_ = true;
-    std::vector<std::vector<ProfileResult>> profile_data_;
+    /**
+     * @internal
+     * @brief Single-producer single-consumer event queue.
+     * The producer is the profiled thread, the consumer is the flusher.
+     *
+     */
+    struct alignas(64) EventRing
+    {
+        std::unique_ptr<TraceEvent[]> events;
+        alignas(64) std::atomic<uint64_t> head{0};
+        alignas(64) std::atomic<uint64_t> tail{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    void start();
+    void drain();
+    void flush_loop();
+
+private:
+    const int64_t base_timestamp_ns_;
+    const size_t ring_capacity_;
+    std::atomic<bool> enabled_{true};
+    size_t ring_count_;
+    std::unique_ptr<EventRing[]> rings_;
+    uint64_t total_dropped_ = 0;
+
+    std::unique_ptr<std::iostream> trace_;
+    uint32_t strings_written_ = 0;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread flusher_;
 };
 
 /**
@@ -97,26 +172,51 @@ public:
      * @brief Start timer on construction.
      *
      * @param session The instrumentation session this timer will send information to on destruction.
-     * @param name Name of the current work unit (displayed in chrome:tracing)
-     * @param category Event type, to allow for filtering in chrome:tracing
+     * @param name_id Interned name of the current work unit (displayed in the trace viewer)
+     * @param category_id Interned event type, to allow for filtering in the trace viewer
+     * @param thread_id ID of the current thread
      */
-    InstrumentationTimer(InstrumentationSession* session, const std::string& name, const std::string& category,
-                         size_t thread_id = 0);
+    InstrumentationTimer(InstrumentationSession* session, uint32_t name_id, uint32_t category_id,
+                         uint32_t thread_id = 0)
+        : session_(session), name_id_(name_id), category_id_(category_id), thread_id_(thread_id),
+          start_ns_(InstrumentationSession::now_ns())
+    {
+    }
+
+    /**
+     * @brief Start timer on construction.
+     * This overload interns the strings each time, prefer interning them once (see example).
+     *
+     * @param session The instrumentation session this timer will send information to on destruction.
+     * @param name Name of the current work unit (displayed in the trace viewer)
+     * @param category Event type, to allow for filtering in the trace viewer
+     * @param thread_id ID of the current thread
+     */
+    InstrumentationTimer(InstrumentationSession* session, std::string_view name, std::string_view category,
+                         uint32_t thread_id = 0)
+        : InstrumentationTimer(session, InstrumentationSession::intern(name), InstrumentationSession::intern(category),
+                               thread_id)
+    {
+    }
 
     /**
      * @brief Stop timer, and send execution information to the session.
      *
      */
-    ~InstrumentationTimer();
+    ~InstrumentationTimer()
+    {
+        if (session_ != nullptr)
+        {
+            session_->push(thread_id_, {start_ns_, InstrumentationSession::now_ns(), name_id_, category_id_});
+        }
+    }
 
 private:
-    using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
-
     InstrumentationSession* session_;
-    std::string name_;
-    std::string category_;
-    size_t thread_id_;
-    TimePoint start_;
+    uint32_t name_id_;
+    uint32_t category_id_;
+    uint32_t thread_id_;
+    int64_t start_ns_;
 };
 
 } // namespace kb
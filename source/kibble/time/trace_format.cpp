@@ -0,0 +1,361 @@
+#include "kibble/time/trace_format.h"
+#include "kibble/util/pod_io.h"
+
+#include "fmt/format.h"
+#include "fmt/ostream.h"
+#include <algorithm>
+#include <map>
+
+namespace kb::trace
+{
+
+static_assert(sizeof(FileHeader) == 16, "FileHeader must not be padded");
+static_assert(sizeof(TraceEvent) == 24, "TraceEvent must not be padded");
+
+namespace
+{
+
+std::string json_escape(std::string_view str)
+{
+    std::string out;
+    out.reserve(str.size());
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out += fmt::format("\\u{:04x}", int(c));
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+/*
+    Minimal protobuf encoder, only what is needed to produce a Perfetto trace.
+    Field numbers come from perfetto/protos/perfetto/trace/trace_packet.proto and the track_event protos.
+*/
+namespace pb
+{
+
+enum WireType : uint32_t
+{
+    Varint = 0,
+    LengthDelimited = 2
+};
+
+inline void put_varint(std::string& buf, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buf.push_back(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buf.push_back(char(value));
+}
+
+inline void put_tag(std::string& buf, uint32_t field, WireType type)
+{
+    put_varint(buf, (uint64_t(field) << 3) | type);
+}
+
+inline void put_uint(std::string& buf, uint32_t field, uint64_t value)
+{
+    put_tag(buf, field, Varint);
+    put_varint(buf, value);
+}
+
+inline void put_bytes(std::string& buf, uint32_t field, std::string_view bytes)
+{
+    put_tag(buf, field, LengthDelimited);
+    put_varint(buf, bytes.size());
+    buf.append(bytes);
+}
+
+// Trace
+constexpr uint32_t k_trace_packet = 1;
+// TracePacket
+constexpr uint32_t k_packet_timestamp = 8;
+constexpr uint32_t k_packet_sequence_id = 10;
+constexpr uint32_t k_packet_track_event = 11;
+constexpr uint32_t k_packet_track_descriptor = 60;
+// TrackDescriptor
+constexpr uint32_t k_track_uuid = 1;
+constexpr uint32_t k_track_process = 3;
+constexpr uint32_t k_track_thread = 4;
+// ProcessDescriptor
+constexpr uint32_t k_process_pid = 1;
+constexpr uint32_t k_process_name = 6;
+// ThreadDescriptor
+constexpr uint32_t k_thread_pid = 1;
+constexpr uint32_t k_thread_tid = 2;
+constexpr uint32_t k_thread_name = 5;
+// TrackEvent
+constexpr uint32_t k_event_type = 9;
+constexpr uint32_t k_event_track_uuid = 11;
+constexpr uint32_t k_event_categories = 22;
+constexpr uint32_t k_event_name = 23;
+constexpr uint64_t k_slice_begin = 1;
+constexpr uint64_t k_slice_end = 2;
+
+} // namespace pb
+
+// Arbitrary IDs, all the events of a trace belong to the same sequence and process
+constexpr uint64_t k_sequence_id = 1;
+constexpr uint64_t k_pid = 1;
+constexpr uint64_t k_process_uuid = 1;
+
+inline uint64_t thread_uuid(uint32_t thread_id)
+{
+    return k_process_uuid + 1 + thread_id;
+}
+
+void write_packet(std::ostream& os, const std::string& packet)
+{
+    std::string header;
+    pb::put_tag(header, pb::k_trace_packet, pb::LengthDelimited);
+    pb::put_varint(header, packet.size());
+    os.write(header.data(), std::streamsize(header.size()));
+    os.write(packet.data(), std::streamsize(packet.size()));
+}
+
+void write_slice(std::ostream& os, const TraceData& data, uint32_t thread_id, int64_t timestamp_ns,
+                 const TraceEvent* event)
+{
+    std::string track_event;
+    pb::put_uint(track_event, pb::k_event_type, event ? pb::k_slice_begin : pb::k_slice_end);
+    pb::put_uint(track_event, pb::k_event_track_uuid, thread_uuid(thread_id));
+    if (event)
+    {
+        pb::put_bytes(track_event, pb::k_event_categories, data.string(event->category_id));
+        pb::put_bytes(track_event, pb::k_event_name, data.string(event->name_id));
+    }
+
+    std::string packet;
+    pb::put_uint(packet, pb::k_packet_timestamp, uint64_t(std::max(int64_t(0), timestamp_ns - data.base_ns)));
+    pb::put_uint(packet, pb::k_packet_sequence_id, k_sequence_id);
+    pb::put_bytes(packet, pb::k_packet_track_event, track_event);
+    write_packet(os, packet);
+}
+
+} // namespace
+
+std::string_view TraceData::string(uint32_t id) const
+{
+    if (id < strings.size())
+    {
+        return strings[id];
+    }
+    return "<unknown>";
+}
+
+void write_header(std::ostream& os, int64_t base_ns)
+{
+    FileHeader header;
+    header.base_ns = base_ns;
+    write_pod(os, header);
+}
+
+void write_string(std::ostream& os, uint32_t id, std::string_view str)
+{
+    write_pod(os, RecordType::String);
+    write_pod(os, id);
+    write_pod(os, uint32_t(str.size()));
+    os.write(str.data(), std::streamsize(str.size()));
+}
+
+void write_events(std::ostream& os, uint32_t thread_id, const TraceEvent* events, uint32_t count)
+{
+    write_pod(os, RecordType::Events);
+    write_pod(os, thread_id);
+    write_pod(os, count);
+    os.write(reinterpret_cast<const char*>(events), std::streamsize(count * sizeof(TraceEvent)));
+}
+
+void write_dropped(std::ostream& os, uint32_t thread_id, uint64_t count)
+{
+    write_pod(os, RecordType::Dropped);
+    write_pod(os, thread_id);
+    write_pod(os, count);
+}
+
+bool read_trace(std::istream& is, TraceData& data)
+{
+    FileHeader header;
+    if (!read_pod(is, header) || header.magic != k_magic || header.version != k_version ||
+        header.event_size != sizeof(TraceEvent))
+    {
+        return false;
+    }
+    data.base_ns = header.base_ns;
+
+    RecordType type;
+    while (read_pod(is, type))
+    {
+        uint32_t id = 0;
+        uint32_t size = 0;
+        switch (type)
+        {
+        case RecordType::String: {
+            if (!read_pod(is, id) || !read_pod(is, size))
+            {
+                return true;
+            }
+            std::string str(size, '\0');
+            if (!is.read(str.data(), std::streamsize(size)))
+            {
+                return true;
+            }
+            if (id >= data.strings.size())
+            {
+                data.strings.resize(id + 1);
+            }
+            data.strings[id] = std::move(str);
+            break;
+        }
+        case RecordType::Events: {
+            if (!read_pod(is, id) || !read_pod(is, size))
+            {
+                return true;
+            }
+            std::vector<TraceEvent> events(size);
+            if (!is.read(reinterpret_cast<char*>(events.data()), std::streamsize(size * sizeof(TraceEvent))))
+            {
+                return true;
+            }
+            for (const auto& event : events)
+            {
+                data.events.push_back({id, event});
+            }
+            break;
+        }
+        case RecordType::Dropped: {
+            uint64_t count = 0;
+            if (!read_pod(is, id) || !read_pod(is, count))
+            {
+                return true;
+            }
+            data.dropped += count;
+            break;
+        }
+        default:
+            // Unknown record, the rest of the file cannot be interpreted
+            return true;
+        }
+    }
+
+    return true;
+}
+
+void write_chrome_json(const TraceData& data, std::ostream& os)
+{
+    // Trace Event Format:
+    // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/edit
+
+    // Formatting is done by fmt, which is locale-independent by default, so decimal separators are always dots
+    fmt::print(os, "{{\"otherData\":{{\"dropped\":{}}},\"traceEvents\":[", data.dropped);
+
+    // Strings are escaped once
+    std::vector<std::string> escaped;
+    escaped.reserve(data.strings.size());
+    for (const auto& str : data.strings)
+    {
+        escaped.push_back(json_escape(str));
+    }
+    auto get = [&escaped](uint32_t id) -> std::string_view {
+        return (id < escaped.size()) ? std::string_view(escaped[id]) : std::string_view("<unknown>");
+    };
+
+    size_t count = 0;
+    for (const auto& [thread_id, event] : data.events)
+    {
+        fmt::print(os, "{}{{\"cat\":\"{}\",\"dur\":{:.3f},\"name\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f}}}",
+                   (count++ > 0) ? "," : "", get(event.category_id), double(event.end_ns - event.start_ns) / 1000.0,
+                   get(event.name_id), thread_id + 1, double(event.start_ns - data.base_ns) / 1000.0);
+    }
+
+    fmt::print(os, "]}}");
+}
+
+void write_perfetto(const TraceData& data, std::ostream& os)
+{
+    // Events are split by thread and sorted so that enclosing scopes come first
+    std::map<uint32_t, std::vector<TraceEvent>> threads;
+    for (const auto& [thread_id, event] : data.events)
+    {
+        threads[thread_id].push_back(event);
+    }
+
+    // Track descriptors
+    {
+        std::string process;
+        pb::put_uint(process, pb::k_process_pid, k_pid);
+        pb::put_bytes(process, pb::k_process_name, "kibble");
+        std::string track;
+        pb::put_uint(track, pb::k_track_uuid, k_process_uuid);
+        pb::put_bytes(track, pb::k_track_process, process);
+        std::string packet;
+        pb::put_uint(packet, pb::k_packet_sequence_id, k_sequence_id);
+        pb::put_bytes(packet, pb::k_packet_track_descriptor, track);
+        write_packet(os, packet);
+    }
+    for (const auto& [thread_id, events] : threads)
+    {
+        std::string thread;
+        pb::put_uint(thread, pb::k_thread_pid, k_pid);
+        pb::put_uint(thread, pb::k_thread_tid, thread_id + 1);
+        pb::put_bytes(thread, pb::k_thread_name, fmt::format("Thread #{}", thread_id));
+        std::string track;
+        pb::put_uint(track, pb::k_track_uuid, thread_uuid(thread_id));
+        pb::put_bytes(track, pb::k_track_thread, thread);
+        std::string packet;
+        pb::put_uint(packet, pb::k_packet_sequence_id, k_sequence_id);
+        pb::put_bytes(packet, pb::k_packet_track_descriptor, track);
+        write_packet(os, packet);
+    }
+
+    // Slices must nest properly on a track: a scope that overlaps the end of its parent (clock granularity) is clamped
+    for (auto& [thread_id, events] : threads)
+    {
+        std::sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+            return (a.start_ns != b.start_ns) ? a.start_ns < b.start_ns : a.end_ns > b.end_ns;
+        });
+
+        std::vector<int64_t> open;
+        for (const auto& event : events)
+        {
+            while (!open.empty() && open.back() <= event.start_ns)
+            {
+                write_slice(os, data, thread_id, open.back(), nullptr);
+                open.pop_back();
+            }
+            write_slice(os, data, thread_id, event.start_ns, &event);
+            open.push_back(open.empty() ? event.end_ns : std::min(event.end_ns, open.back()));
+        }
+        while (!open.empty())
+        {
+            write_slice(os, data, thread_id, open.back(), nullptr);
+            open.pop_back();
+        }
+    }
+}
+
+} // namespace kb::trace
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kb
+{
+
+/**
+ * @brief Profiling event, as stored in the per-thread ring buffers and in trace files.
+ * Names and categories are interned strings (see InstrumentationSession::intern()), so this is a POD type that can be
+ * copied around and written to a file as is.
+ *
+ */
+struct TraceEvent
+{
+    /// Start timestamp in ns, steady clock
+    int64_t start_ns;
+    /// Stop timestamp in ns, steady clock
+    int64_t end_ns;
+    /// Interned name of the function / scope / task
+    uint32_t name_id;
+    /// Interned event type, to allow for filtering in the trace viewer
+    uint32_t category_id;
+};
+
+/**
+ * @brief Compact binary trace format.
+ *
+ * A trace file starts with a FileHeader, followed by a sequence of records. Each record starts with a RecordType tag:
+ * - String: uint32 id, uint32 length, then the string bytes. Defines an interned string.
+ * - Events: uint32 thread id, uint32 count, then count TraceEvent structs.
+ * - Dropped: uint32 thread id, uint64 count. Number of events lost because a ring buffer was full.
+ *
+ * A string is always defined before the first event that refers to it. All values are in native byte order, the
+ * magic number and event size in the header allow to detect an incompatible file.
+ *
+ */
+namespace trace
+{
+
+/// "KTRC" in little endian
+constexpr uint32_t k_magic = 0x4352544b;
+constexpr uint16_t k_version = 1;
+
+struct FileHeader
+{
+    uint32_t magic = k_magic;
+    uint16_t version = k_version;
+    uint16_t event_size = sizeof(TraceEvent);
+    /// Timestamp of the session start in ns, steady clock
+    int64_t base_ns = 0;
+};
+
+enum class RecordType : uint8_t
+{
+    String = 1,
+    Events = 2,
+    Dropped = 3
+};
+
+/**
+ * @brief Profiling event along with the thread that produced it.
+ *
+ */
+struct ThreadEvent
+{
+    uint32_t thread_id;
+    TraceEvent event;
+};
+
+/**
+ * @brief Whole content of a trace file.
+ *
+ */
+struct TraceData
+{
+    /// Timestamp of the session start in ns
+    int64_t base_ns = 0;
+    /// Interned strings, indexed by ID
+    std::vector<std::string> strings;
+    /// All events, in file order
+    std::vector<ThreadEvent> events;
+    /// Number of events lost by the session
+    uint64_t dropped = 0;
+
+    /// Get an interned string, or a placeholder if it was not defined
+    std::string_view string(uint32_t id) const;
+};
+
+/// Write the file header
+void write_header(std::ostream& os, int64_t base_ns);
+/// Write a String record
+void write_string(std::ostream& os, uint32_t id, std::string_view str);
+/// Write an Events record
+void write_events(std::ostream& os, uint32_t thread_id, const TraceEvent* events, uint32_t count);
+/// Write a Dropped record
+void write_dropped(std::ostream& os, uint32_t thread_id, uint64_t count);
+
+/**
+ * @brief Parse a binary trace.
+ *
+ * @param is input stream, opened in binary mode
+ * @param data parsed trace
+ * @return false if the stream is not a valid trace. A trace truncated in the middle of a record (for instance, if
+ * the session was not shut down properly) is parsed up to the last complete record.
+ */
+bool read_trace(std::istream& is, TraceData& data);
+
+/**
+ * @brief Export a trace to the Chrome Trace Event format (JSON), readable by chrome://tracing and Perfetto UI.
+ *
+ * @param data trace
+ * @param os output stream
+ */
+void write_chrome_json(const TraceData& data, std::ostream& os);
+
+/**
+ * @brief Export a trace to the Perfetto protobuf format, readable by Perfetto UI and trace_processor.
+ * Each thread gets its own track, and events are emitted as nested slices.
+ *
+ * @param data trace
+ * @param os output stream, opened in binary mode
+ */
+void write_perfetto(const TraceData& data, std::ostream& os);
+
+} // namespace trace
+} // namespace kb
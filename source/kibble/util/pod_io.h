@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+namespace kb
+{
+
+/*
+ * Raw binary I/O of trivially copyable structs, for the internal file formats (traces, heap profiles, binary logs).
+ * Values are written in native byte order, with their padding, so file format structs must not be padded.
+ */
+
+/// @internal Write the bytes of a value to a stream
+template <typename T>
+inline void write_pod(std::ostream& os, const T& value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/// @internal Read a value from a stream, return false if the stream ended before
+template <typename T>
+inline bool read_pod(std::istream& is, T& value)
+{
+    return bool(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+/// @internal Read a value from a possibly unaligned memory location
+template <typename T>
+inline T read_pod(const uint8_t* src)
+{
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+    return value;
+}
+
+} // namespace kb
@@ -33,6 +33,9 @@ StackTrace& StackTrace::operator=(const StackTrace& other)
     return *this;
 }
 
+StackTrace::StackTrace(StackTrace&&) noexcept = default;
+StackTrace& StackTrace::operator=(StackTrace&&) noexcept = default;
+
 std::string StackTrace::format() const
 {
     std::ostringstream oss;
@@ -46,4 +49,16 @@ std::string StackTrace::format() const
     return oss.str();
 }
 
+size_t StackTrace::hash() const
+{
+    // FNV-1a over the frame addresses
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t ii = 0; ii < ptrace_->size(); ++ii)
+    {
+        hash ^= reinterpret_cast<uint64_t>((*ptrace_)[ii].addr);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 } // namespace kb
\ No newline at end of file
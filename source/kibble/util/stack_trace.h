@@ -16,9 +16,14 @@ public:
     StackTrace(size_t skip);
     StackTrace(const StackTrace&);
     StackTrace& operator=(const StackTrace&);
+    StackTrace(StackTrace&&) noexcept;
+    StackTrace& operator=(StackTrace&&) noexcept;
 
     std::string format() const;
 
+    /// @brief Hash the return addresses of the trace, two traces with the same call stack have the same hash
+    size_t hash() const;
+
 private:
     friend struct internal_deleter::Deleter<backward::StackTrace>;
     internal_ptr<backward::StackTrace> ptrace_ = nullptr;
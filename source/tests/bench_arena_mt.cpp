@@ -0,0 +1,106 @@
+#include "kibble/memory/allocator/thread_cached_tlsf_allocator.h"
+#include "kibble/memory/allocator/tlsf_allocator.h"
+#include "kibble/memory/arena.h"
+#include "kibble/memory/heap_area.h"
+#include "kibble/memory/policy/thread_guard_multi_thread.h"
+#include "kibble/memory/util/literals.h"
+#include "kibble/random/xor_shift.h"
+
+#include <benchmark/benchmark.h>
+#include <array>
+#include <cstdlib>
+#include <mutex>
+
+using namespace kb;
+using namespace kb::memory::literals;
+
+using MutexTLSFArena =
+    memory::MemoryArena<memory::TLSFAllocator, memory::policy::MultiThread<std::mutex>, memory::policy::NoBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+using ThreadCachedTLSFArena =
+    memory::MemoryArena<memory::ThreadCachedTLSFAllocator, memory::policy::SingleThread,
+                        memory::policy::NoBoundsChecking, memory::policy::NoMemoryTagging,
+                        memory::policy::NoMemoryTracking>;
+
+constexpr size_t k_live_blocks = 256;
+
+template <typename ArenaT>
+ArenaT& get_arena()
+{
+    static memory::HeapArea area(130_MB);
+    static ArenaT arena("BenchArena", area, 128_MB);
+    return arena;
+}
+
+struct ArenaAlloc
+{
+    template <typename ArenaT>
+    static void* allocate(ArenaT& arena, size_t size)
+    {
+        return arena.allocate(size, 8, 0, __FILE__, __LINE__);
+    }
+
+    template <typename ArenaT>
+    static void deallocate(ArenaT& arena, void* ptr)
+    {
+        arena.deallocate(ptr, __FILE__, __LINE__);
+    }
+};
+
+/*
+    Each thread keeps a window of live blocks of random small sizes, and replaces a random one at each step.
+    This is the typical allocation pattern of a job system where every worker allocates short-lived objects.
+*/
+template <typename AllocFn>
+static void run_churn(benchmark::State& state, AllocFn&& alloc_free)
+{
+    rng::XorShiftEngine rng;
+    rng.seed(uint64_t(state.thread_index()) + 1);
+    std::array<void*, k_live_blocks> blocks{};
+
+    for (auto _ : state)
+    {
+        size_t idx = rng.rand64() % k_live_blocks;
+        size_t size = 16 + rng.rand64() % 497;
+        blocks[idx] = alloc_free(blocks[idx], size);
+        benchmark::DoNotOptimize(blocks[idx]);
+    }
+
+    for (void*& ptr : blocks)
+    {
+        ptr = alloc_free(ptr, 0);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+
+template <typename ArenaT>
+static void BM_arena_churn(benchmark::State& state)
+{
+    auto& arena = get_arena<ArenaT>();
+    run_churn(state, [&arena](void* ptr, size_t size) -> void* {
+        if (ptr != nullptr)
+        {
+            ArenaAlloc::deallocate(arena, ptr);
+        }
+        return (size > 0) ? ArenaAlloc::allocate(arena, size) : nullptr;
+    });
+
+    if constexpr (std::is_same_v<ArenaT, ThreadCachedTLSFArena>)
+    {
+        arena.get_allocator().flush_thread_cache();
+    }
+}
+
+static void BM_malloc_churn(benchmark::State& state)
+{
+    run_churn(state, [](void* ptr, size_t size) -> void* {
+        std::free(ptr);
+        return (size > 0) ? std::malloc(size) : nullptr;
+    });
+}
+
+BENCHMARK(BM_arena_churn<MutexTLSFArena>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_arena_churn<ThreadCachedTLSFArena>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_malloc_churn)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
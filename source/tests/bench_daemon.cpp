@@ -0,0 +1,127 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/random/xor_shift.h"
+#include "kibble/thread/job/daemon.h"
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using namespace kb;
+
+/*
+    Rescheduling cost of a large number of periodic daemons, such as per-connection heartbeats. Daemons are sorted
+    into a timer wheel, so a tick only touches the daemons that are due. Intervals are spread between 1s and 10s,
+    with one tick per ms, so about 20 daemons are due each tick.
+*/
+static constexpr size_t k_daemons = 100'000;
+// Jobs spawned by the daemons are waited on regularly, so as to never exceed the job pool capacity
+static constexpr size_t k_ticks_per_wait = 64;
+
+static th::JobSystem& job_system()
+{
+    static memory::HeapArea area(th::JobSystem::get_memory_requirements({}));
+    static th::JobSystem js(area, {});
+    return js;
+}
+
+static float random_interval_ms(rng::XorShiftEngine& rng)
+{
+    return 1000.f + float(rng.rand64() % 9000);
+}
+
+static void BM_daemon_create_kill(benchmark::State& state)
+{
+    auto& js = job_system();
+    th::DaemonScheduler ds(js);
+    rng::XorShiftEngine rng;
+    rng.seed(42);
+    std::vector<th::DaemonHandle> handles(k_daemons);
+
+    for (auto _ : state)
+    {
+        for (size_t ii = 0; ii < k_daemons; ++ii)
+        {
+            th::SchedulingData sd;
+            sd.interval_ms = random_interval_ms(rng);
+            handles[ii] = ds.create([]() { return true; }, std::move(sd));
+        }
+        for (auto hnd : handles)
+        {
+            ds.kill(hnd);
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(k_daemons));
+}
+
+static void BM_daemon_tick(benchmark::State& state)
+{
+    auto& js = job_system();
+    th::DaemonScheduler ds(js);
+    rng::XorShiftEngine rng;
+    rng.seed(42);
+
+    for (size_t ii = 0; ii < k_daemons; ++ii)
+    {
+        th::SchedulingData sd;
+        sd.interval_ms = random_interval_ms(rng);
+        sd.cooldown_ms = random_interval_ms(rng);
+        ds.create([]() { return true; }, std::move(sd));
+    }
+
+    size_t ticks = 0;
+    for (auto _ : state)
+    {
+        ds.advance();
+        if (++ticks % k_ticks_per_wait == 0)
+        {
+            js.wait();
+        }
+    }
+    js.wait();
+
+    state.SetItemsProcessed(int64_t(ticks));
+}
+
+// The previous implementation walked all the daemons on each update, this reproduces its loop without the job spawning
+static void BM_daemon_polling_baseline(benchmark::State& state)
+{
+    struct Entry
+    {
+        float interval_ms;
+        float cooldown_ms;
+    };
+
+    rng::XorShiftEngine rng;
+    rng.seed(42);
+    std::vector<Entry> entries(k_daemons);
+    for (auto& entry : entries)
+    {
+        entry.interval_ms = random_interval_ms(rng);
+        entry.cooldown_ms = random_interval_ms(rng);
+    }
+
+    size_t ticks = 0;
+    size_t fired = 0;
+    for (auto _ : state)
+    {
+        for (auto& entry : entries)
+        {
+            entry.cooldown_ms -= 1.f;
+            if (entry.cooldown_ms <= 0.f)
+            {
+                entry.cooldown_ms = entry.interval_ms;
+                ++fired;
+            }
+        }
+        ++ticks;
+    }
+
+    benchmark::DoNotOptimize(fired);
+    state.SetItemsProcessed(int64_t(ticks));
+}
+
+BENCHMARK(BM_daemon_create_kill)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_daemon_tick)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_daemon_polling_baseline)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,195 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/memory/util/literals.h"
+#include "kibble/random/xor_shift.h"
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace kb;
+using namespace kb::memory::literals;
+
+static memory::HeapArea::Config make_config(memory::AreaBackend backend, memory::HugePages huge_pages)
+{
+    memory::HeapArea::Config config;
+    config.backend = backend;
+    config.huge_pages = huge_pages;
+    return config;
+}
+
+/*
+    Startup cost: create an area, carve a 1MB slab out of it and use it, then destroy the area.
+    The heap backend allocates (and memsets when K_USE_MEM_AREA_MEMSET is defined) the whole area up front, the
+    virtual memory backend only commits what the slab needs.
+*/
+static void BM_area_startup(benchmark::State& state, memory::AreaBackend backend)
+{
+    size_t size = size_t(state.range(0)) * 1_MB;
+    auto config = make_config(backend, memory::HugePages::None);
+
+    for (auto _ : state)
+    {
+        memory::HeapArea area(size, config);
+        auto [begin, end] = area.require_slab(1_MB, "slab");
+        std::memset(begin, 0x42, 1_MB);
+        benchmark::DoNotOptimize(begin);
+    }
+}
+
+/*
+    Counts data TLB misses of the calling thread with perf_event_open, when the kernel lets us.
+*/
+class DTLBMissCounter
+{
+public:
+    DTLBMissCounter()
+    {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~DTLBMissCounter()
+    {
+#ifdef __linux__
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+#endif
+    }
+
+    inline bool is_available() const
+    {
+        return fd_ >= 0;
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        if (fd_ >= 0)
+        {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    uint64_t stop()
+    {
+        uint64_t count = 0;
+#ifdef __linux__
+        if (fd_ >= 0)
+        {
+            ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd_, &count, sizeof(count)) != sizeof(count))
+            {
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+/*
+    TLB pressure: chase pointers along a random cycle that visits every 4kB page of a 256MB area once. With regular
+    pages, almost every access misses the TLB, with huge pages the whole area is covered by a few hundred entries.
+*/
+static void BM_area_random_access(benchmark::State& state, memory::AreaBackend backend, memory::HugePages huge_pages)
+{
+    constexpr size_t k_size = 256_MB;
+    constexpr size_t k_stride = 4_kB;
+    constexpr size_t k_nodes = k_size / k_stride - 1;
+
+    memory::HeapArea area(k_size, make_config(backend, huge_pages));
+    auto [begin, end] = area.require_slab(k_size - 4_kB, "nodes");
+    auto* base = static_cast<uint8_t*>(begin);
+
+    // Random cyclic permutation, each node sits at a random cache line of its page (the last page is left out)
+    rng::XorShiftEngine rng;
+    rng.seed(42);
+    std::vector<size_t> order(k_nodes);
+    std::iota(order.begin(), order.end(), 0);
+    for (size_t ii = k_nodes - 1; ii > 0; --ii)
+    {
+        std::swap(order[ii], order[rng.rand64() % (ii + 1)]);
+    }
+    auto node = [base, &order](size_t ii) {
+        size_t line = (order[ii] * 7) % (k_stride / 64);
+        return reinterpret_cast<void**>(base + order[ii] * k_stride + line * 64);
+    };
+    for (size_t ii = 0; ii < k_nodes; ++ii)
+    {
+        *node(ii) = node((ii + 1) % k_nodes);
+    }
+
+    DTLBMissCounter counter;
+    uint64_t misses = 0;
+    void** current = node(0);
+    for (auto _ : state)
+    {
+        counter.start();
+        for (size_t ii = 0; ii < k_nodes; ++ii)
+        {
+            current = static_cast<void**>(*current);
+        }
+        misses += counter.stop();
+        benchmark::DoNotOptimize(current);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(k_nodes));
+    if (counter.is_available())
+    {
+        state.counters["dtlb_miss_per_access"] =
+            double(misses) / (double(state.iterations()) * double(k_nodes));
+    }
+}
+
+BENCHMARK_CAPTURE(BM_area_startup, heap, memory::AreaBackend::Heap)
+    ->Arg(64)
+    ->Arg(512)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_area_startup, virtual_memory, memory::AreaBackend::VirtualMemory)
+    ->Arg(64)
+    ->Arg(512)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_area_random_access, heap, memory::AreaBackend::Heap, memory::HugePages::None)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_area_random_access, vm_regular_pages, memory::AreaBackend::VirtualMemory, memory::HugePages::None)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_area_random_access, vm_transparent_huge_pages, memory::AreaBackend::VirtualMemory,
+                  memory::HugePages::Transparent)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_area_random_access, vm_explicit_huge_pages, memory::AreaBackend::VirtualMemory,
+                  memory::HugePages::Explicit)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,321 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/thread/job/job_system.h"
+#include "kibble/thread/job/task_graph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <numeric>
+#include <vector>
+
+using namespace kb;
+
+// Total number of jobs executed per iteration
+static constexpr size_t k_tiny_jobs = 1'000'000;
+// Jobs are scheduled in batches, so as to never exceed the job pool and queue capacities
+static constexpr size_t k_roots_per_batch = 4;
+static constexpr size_t k_children_per_root = 128;
+static constexpr size_t k_jobs_per_batch = k_roots_per_batch * (k_children_per_root + 1);
+// Shape of the DAG submitted each frame: one root, a wide layer, one sink
+static constexpr size_t k_dag_width = 256;
+
+static th::JobSystem::Config make_config(th::QueueMode queue_mode, th::VictimSelection victim_selection)
+{
+    th::JobSystem::Config config;
+    config.queue_mode = queue_mode;
+    config.victim_selection = victim_selection;
+    return config;
+}
+
+// All tiny jobs are scheduled from the main thread
+static void BM_tiny_jobs_flat(benchmark::State& state, th::QueueMode queue_mode, th::VictimSelection victim_selection)
+{
+    auto config = make_config(queue_mode, victim_selection);
+    memory::HeapArea area(th::JobSystem::get_memory_requirements(config));
+    th::JobSystem js(area, config);
+    std::atomic<size_t> counter{0};
+
+    for (auto _ : state)
+    {
+        for (size_t ii = 0; ii < k_tiny_jobs; ii += k_jobs_per_batch)
+        {
+            for (size_t jj = 0; jj < k_jobs_per_batch; ++jj)
+            {
+                auto&& [task, future] = js.create_task({th::WORKER_AFFINITY_ANY, "tiny"}, [&counter]() {
+                    counter.fetch_add(1, std::memory_order_relaxed);
+                });
+                task.schedule();
+            }
+            js.wait();
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(counter.load()));
+}
+
+// Same as above, but tasks are created without a future
+static void BM_tiny_jobs_flat_detached(benchmark::State& state, th::QueueMode queue_mode,
+                                       th::VictimSelection victim_selection)
+{
+    auto config = make_config(queue_mode, victim_selection);
+    memory::HeapArea area(th::JobSystem::get_memory_requirements(config));
+    th::JobSystem js(area, config);
+    std::atomic<size_t> counter{0};
+
+    for (auto _ : state)
+    {
+        for (size_t ii = 0; ii < k_tiny_jobs; ii += k_jobs_per_batch)
+        {
+            for (size_t jj = 0; jj < k_jobs_per_batch; ++jj)
+            {
+                auto task = js.create_task(th::detached, {th::WORKER_AFFINITY_ANY, "tiny"},
+                                           [&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+                task.schedule();
+            }
+            js.wait();
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(counter.load()));
+}
+
+// A few root jobs fan out tiny jobs from worker threads
+static void BM_tiny_jobs_fan_out(benchmark::State& state, th::QueueMode queue_mode,
+                                 th::VictimSelection victim_selection)
+{
+    auto config = make_config(queue_mode, victim_selection);
+    memory::HeapArea area(th::JobSystem::get_memory_requirements(config));
+    th::JobSystem js(area, config);
+    std::atomic<size_t> counter{0};
+
+    for (auto _ : state)
+    {
+        for (size_t ii = 0; ii < k_tiny_jobs; ii += k_jobs_per_batch)
+        {
+            for (size_t jj = 0; jj < k_roots_per_batch; ++jj)
+            {
+                auto&& [task, future] = js.create_task({th::WORKER_AFFINITY_ANY, "root"}, [&js, &counter]() {
+                    for (size_t kk = 0; kk < k_children_per_root; ++kk)
+                    {
+                        auto&& [child, child_future] =
+                            js.create_task({th::WORKER_AFFINITY_ANY, "tiny"},
+                                           [&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+                        child.schedule();
+                    }
+                });
+                task.schedule();
+            }
+            js.wait();
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(counter.load()));
+}
+
+/*
+    Steal locality: each root job fills a buffer that fits in L2, then fans out children that read slices of it.
+    Children stolen by a worker that does not share the L3 of the producer pull the data through the interconnect.
+    With profiling enabled, the Monitor reports the number of jobs stolen outside of the L3 domain of each worker.
+*/
+static constexpr size_t k_locality_roots = 64;
+static constexpr size_t k_locality_children = 16;
+static constexpr size_t k_locality_floats = 64 * 1024;
+
+static void BM_steal_locality(benchmark::State& state, bool topology_aware)
+{
+    auto config = make_config(th::QueueMode::WorkStealing,
+                              topology_aware ? th::VictimSelection::Hierarchical : th::VictimSelection::Random);
+    config.pin_workers = topology_aware;
+    memory::HeapArea area(th::JobSystem::get_memory_requirements(config));
+    th::JobSystem js(area, config);
+
+    auto child_affinity = topology_aware ? th::WORKER_AFFINITY_LOCAL : th::WORKER_AFFINITY_ANY;
+    std::vector<std::vector<float>> buffers(k_locality_roots, std::vector<float>(k_locality_floats));
+    std::vector<float> sums(k_locality_roots * k_locality_children);
+
+    for (auto _ : state)
+    {
+        for (size_t ii = 0; ii < k_locality_roots; ++ii)
+        {
+            auto root = js.create_task(th::detached, {th::WORKER_AFFINITY_ANY, "produce"}, [&, ii]() {
+                auto& buffer = buffers[ii];
+                std::iota(buffer.begin(), buffer.end(), float(ii));
+                for (size_t jj = 0; jj < k_locality_children; ++jj)
+                {
+                    auto child = js.create_task(th::detached, {child_affinity, "consume"}, [&, ii, jj]() {
+                        constexpr size_t k_slice = k_locality_floats / k_locality_children;
+                        auto begin = buffers[ii].begin() + long(jj * k_slice);
+                        sums[ii * k_locality_children + jj] = std::accumulate(begin, begin + long(k_slice), 0.f);
+                    });
+                    child.schedule();
+                }
+            });
+            root.schedule();
+        }
+        js.wait();
+        benchmark::DoNotOptimize(sums.data());
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations() * k_locality_roots * k_locality_children));
+}
+
+/*
+    Queue latency of frame-critical jobs scheduled behind a flood of long background jobs. Without priorities, all the
+    jobs share the same lane. The p99 latency (dispatch to start) of the critical jobs is reported in microseconds.
+*/
+static constexpr size_t k_background_jobs = 512;
+static constexpr size_t k_critical_jobs = 64;
+
+static void spin_for(std::chrono::microseconds duration)
+{
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < duration)
+    {
+    }
+}
+
+static void BM_priority_latency(benchmark::State& state, bool use_priorities)
+{
+    using clock = std::chrono::steady_clock;
+    auto config = make_config(th::QueueMode::Shared, th::VictimSelection::Random);
+    memory::HeapArea area(th::JobSystem::get_memory_requirements(config));
+    th::JobSystem js(area, config);
+
+    auto background_priority = use_priorities ? th::JobPriority::Low : th::JobPriority::Normal;
+    auto critical_priority = use_priorities ? th::JobPriority::High : th::JobPriority::Normal;
+    std::vector<int64_t> latencies_us;
+
+    for (auto _ : state)
+    {
+        std::vector<int64_t> frame_latencies(k_critical_jobs);
+        for (size_t ii = 0; ii < k_background_jobs; ++ii)
+        {
+            auto task = js.create_task(th::detached, {th::WORKER_AFFINITY_ANY, "asset", background_priority},
+                                       []() { spin_for(std::chrono::microseconds(50)); });
+            task.schedule();
+
+            // Critical jobs are submitted while the background jobs pile up
+            if (ii % (k_background_jobs / k_critical_jobs) == 0)
+            {
+                size_t idx = ii / (k_background_jobs / k_critical_jobs);
+                auto submitted = clock::now();
+                auto critical = js.create_task(
+                    th::detached, {th::WORKER_AFFINITY_ANY, "critical", critical_priority},
+                    [&frame_latencies, idx, submitted]() {
+                        frame_latencies[idx] =
+                            std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - submitted).count();
+                    });
+                critical.schedule();
+            }
+        }
+        js.wait();
+        latencies_us.insert(latencies_us.end(), frame_latencies.begin(), frame_latencies.end());
+    }
+
+    std::sort(latencies_us.begin(), latencies_us.end());
+    state.counters["p50_us"] = double(latencies_us[latencies_us.size() / 2]);
+    state.counters["p99_us"] = double(latencies_us[latencies_us.size() * 99 / 100]);
+}
+
+// The same DAG is built and scheduled each frame
+static void BM_dag_rebuild(benchmark::State& state)
+{
+    auto config = make_config(th::QueueMode::WorkStealing, th::VictimSelection::Random);
+    memory::HeapArea area(th::JobSystem::get_memory_requirements(config));
+    th::JobSystem js(area, config);
+    th::barrier_t barrier = js.create_barrier();
+    std::atomic<size_t> counter{0};
+
+    for (auto _ : state)
+    {
+        auto root = js.create_task(th::detached, {th::WORKER_AFFINITY_ANY, "root"}, []() {});
+        auto sink = js.create_task(th::detached, {th::WORKER_AFFINITY_ANY, "sink"}, []() {});
+        for (size_t ii = 0; ii < k_dag_width; ++ii)
+        {
+            auto chunk = js.create_task(th::detached, {th::WORKER_AFFINITY_ANY, "chunk"},
+                                        [&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+            root.add_child(chunk);
+            chunk.add_child(sink);
+        }
+        root.schedule(barrier);
+        js.wait_on_barrier(barrier);
+    }
+
+    js.destroy_barrier(barrier);
+    state.SetItemsProcessed(int64_t(counter.load()));
+}
+
+// The DAG is built once as a TaskGraph, and re-submitted each frame
+static void BM_dag_task_graph(benchmark::State& state)
+{
+    auto config = make_config(th::QueueMode::WorkStealing, th::VictimSelection::Random);
+    memory::HeapArea area(th::JobSystem::get_memory_requirements(config));
+    th::JobSystem js(area, config);
+    std::atomic<size_t> counter{0};
+
+    th::TaskGraph graph(js);
+    auto root = graph.add({th::WORKER_AFFINITY_ANY, "root"}, []() {});
+    auto sink = graph.add({th::WORKER_AFFINITY_ANY, "sink"}, []() {});
+    for (size_t ii = 0; ii < k_dag_width; ++ii)
+    {
+        auto chunk = graph.add({th::WORKER_AFFINITY_ANY, "chunk"},
+                               [&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+        graph.precede(root, chunk);
+        graph.precede(chunk, sink);
+    }
+
+    for (auto _ : state)
+    {
+        graph.submit();
+        graph.wait();
+    }
+
+    state.SetItemsProcessed(int64_t(counter.load()));
+}
+
+BENCHMARK_CAPTURE(BM_tiny_jobs_flat, shared_round_robin, th::QueueMode::Shared, th::VictimSelection::RoundRobin)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_tiny_jobs_flat, shared_random, th::QueueMode::Shared, th::VictimSelection::Random)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_tiny_jobs_flat, deque_round_robin, th::QueueMode::WorkStealing, th::VictimSelection::RoundRobin)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_tiny_jobs_flat, deque_random, th::QueueMode::WorkStealing, th::VictimSelection::Random)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_tiny_jobs_flat_detached, shared_round_robin, th::QueueMode::Shared,
+                  th::VictimSelection::RoundRobin)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_tiny_jobs_flat_detached, deque_random, th::QueueMode::WorkStealing, th::VictimSelection::Random)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_tiny_jobs_fan_out, shared_round_robin, th::QueueMode::Shared, th::VictimSelection::RoundRobin)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_tiny_jobs_fan_out, shared_random, th::QueueMode::Shared, th::VictimSelection::Random)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_tiny_jobs_fan_out, deque_round_robin, th::QueueMode::WorkStealing,
+                  th::VictimSelection::RoundRobin)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_tiny_jobs_fan_out, deque_random, th::QueueMode::WorkStealing, th::VictimSelection::Random)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_steal_locality, flat, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_steal_locality, topology_aware, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_priority_latency, single_lane, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_priority_latency, priority_lanes, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK(BM_dag_rebuild)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_dag_task_graph)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
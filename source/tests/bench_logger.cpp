@@ -0,0 +1,239 @@
+#include "kibble/logger/async_backend.h"
+#include "kibble/logger/logger.h"
+#include "kibble/logger/policies/rate_limit_policy.h"
+#include "kibble/logger/sink.h"
+#include "kibble/logger/sinks/file_sink.h"
+#include "kibble/logger/sinks/rotating_file_sink.h"
+#include "kibble/math/color_table.h"
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+
+using namespace kb;
+
+/*
+    Measures the cost of a logging call on the producer side, from 1 to 32 producer threads.
+    The sink does a minimal amount of work under a lock, as a real sink would when writing to a shared output.
+*/
+class NullSink : public log::Sink
+{
+public:
+    void submit(const log::LogEntry& e, const log::ChannelPresentation&) override
+    {
+        std::scoped_lock lock(mutex_);
+        bytes_ += e.message.size();
+        benchmark::DoNotOptimize(bytes_);
+    }
+
+private:
+    std::mutex mutex_;
+    size_t bytes_ = 0;
+};
+
+static log::Channel& get_channel()
+{
+    static auto channel = []() {
+        auto chan = std::make_unique<log::Channel>(log::Severity::Verbose, "bench", "bch", kb::col::aliceblue);
+        chan->attach_sink(std::make_shared<NullSink>());
+        return chan;
+    }();
+    return *channel;
+}
+
+static void run_log_calls(benchmark::State& state)
+{
+    auto& chan = get_channel();
+    size_t ii = 0;
+    for (auto _ : state)
+    {
+        klog(chan).uid("Bench").info("Producer #{} logging message #{}", state.thread_index(), ii++);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+
+static void BM_log_sync(benchmark::State& state)
+{
+    run_log_calls(state);
+}
+
+static void run_backend(benchmark::State& state, log::OverflowPolicy policy, bool deferred = false)
+{
+    static std::unique_ptr<log::AsyncBackend> backend;
+    if (state.thread_index() == 0)
+    {
+        backend = std::make_unique<log::AsyncBackend>(4096, policy);
+        log::Channel::set_backend(backend.get());
+        log::Channel::set_deferred_formatting(deferred);
+    }
+
+    run_log_calls(state);
+
+    if (state.thread_index() == 0)
+    {
+        backend->flush();
+        state.counters["dropped"] = double(backend->get_dropped_count());
+        backend.reset();
+        log::Channel::set_deferred_formatting(false);
+    }
+}
+
+static void BM_log_backend_block(benchmark::State& state)
+{
+    run_backend(state, log::OverflowPolicy::Block);
+}
+
+static void BM_log_backend_block_deferred(benchmark::State& state)
+{
+    run_backend(state, log::OverflowPolicy::Block, true);
+}
+
+static void BM_log_backend_drop_newest(benchmark::State& state)
+{
+    run_backend(state, log::OverflowPolicy::DropNewest);
+}
+
+static void BM_log_backend_drop_oldest(benchmark::State& state)
+{
+    run_backend(state, log::OverflowPolicy::DropOldest);
+}
+
+/*
+    Cost of a logging call rejected by the channel severity threshold.
+*/
+static log::Channel& get_quiet_channel()
+{
+    static auto channel = []() {
+        auto chan = std::make_unique<log::Channel>(log::Severity::Warn, "quiet", "qut", kb::col::aliceblue);
+        chan->attach_sink(std::make_shared<NullSink>());
+        return chan;
+    }();
+    return *channel;
+}
+
+static void BM_log_rejected_builder(benchmark::State& state)
+{
+    auto& chan = get_quiet_channel();
+    size_t ii = 0;
+    for (auto _ : state)
+    {
+        klog(chan).uid("Bench").info("Rejected message #{}", ii++);
+    }
+}
+
+static void BM_log_rejected_macro(benchmark::State& state)
+{
+    auto& chan = get_quiet_channel();
+    size_t ii = 0;
+    for (auto _ : state)
+    {
+        klog_info(chan).uid("Bench").msg("Rejected message #{}", ii++);
+    }
+    benchmark::DoNotOptimize(ii);
+}
+
+/*
+    Cost of a logging call suppressed by the rate limiting policy, from 1 to 32 threads logging from the same call site.
+*/
+static log::Channel& get_rate_limited_channel()
+{
+    static auto channel = []() {
+        auto chan = std::make_unique<log::Channel>(log::Severity::Verbose, "limited", "lim", kb::col::aliceblue);
+        chan->attach_sink(std::make_shared<NullSink>());
+        log::RateLimitPolicy::Config config;
+        config.rate = 1;
+        config.burst = 1;
+        chan->attach_policy(std::make_shared<log::RateLimitPolicy>(*chan, config));
+        return chan;
+    }();
+    return *channel;
+}
+
+static void BM_log_rate_limited(benchmark::State& state)
+{
+    auto& chan = get_rate_limited_channel();
+    size_t ii = 0;
+    for (auto _ : state)
+    {
+        klog(chan).uid("Bench").info("Flooding message #{}", ii++);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+
+/*
+    Throughput of the file sinks in MB/s and lines/s. Entries are submitted to the sink directly, so both sinks do the
+    same formatting work, and the byte count is the size of the files on disk.
+*/
+static const std::filesystem::path k_bench_dir = "/tmp/kibble_bench_file_sink";
+
+template <typename SinkT>
+static void run_file_sink(benchmark::State& state, SinkT& sink)
+{
+    log::ChannelPresentation presentation{"bench", "bch", kb::col::aliceblue};
+    log::LogEntry entry;
+    entry.thread_id = 0;
+    entry.message = "Producer logging a message of a typical size, with a few formatted values: 42, 3.14, true";
+
+    for (auto _ : state)
+    {
+        sink.submit(entry, presentation);
+    }
+    sink.flush();
+}
+
+static void report_file_throughput(benchmark::State& state)
+{
+    size_t bytes = 0;
+    for (const auto& file : std::filesystem::directory_iterator(k_bench_dir))
+    {
+        bytes += std::filesystem::file_size(file.path());
+    }
+    state.SetBytesProcessed(int64_t(bytes));
+    state.SetItemsProcessed(int64_t(state.iterations()));
+    std::filesystem::remove_all(k_bench_dir);
+}
+
+static void BM_file_sink(benchmark::State& state)
+{
+    std::filesystem::create_directories(k_bench_dir);
+    {
+        log::FileSink sink(k_bench_dir / "bench.log");
+        run_file_sink(state, sink);
+    }
+    report_file_throughput(state);
+}
+
+static void BM_rotating_file_sink(benchmark::State& state)
+{
+    {
+        log::RotatingFileSink sink(k_bench_dir, "bench");
+        run_file_sink(state, sink);
+    }
+    report_file_throughput(state);
+}
+
+static void BM_rotating_file_sink_periodic_sync(benchmark::State& state)
+{
+    {
+        log::RotatingFileSink::Config config;
+        config.durability = log::Durability::Periodic;
+        log::RotatingFileSink sink(k_bench_dir, "bench", config);
+        run_file_sink(state, sink);
+    }
+    report_file_throughput(state);
+}
+
+BENCHMARK(BM_file_sink);
+BENCHMARK(BM_rotating_file_sink);
+BENCHMARK(BM_rotating_file_sink_periodic_sync);
+BENCHMARK(BM_log_rejected_builder);
+BENCHMARK(BM_log_rejected_macro);
+BENCHMARK(BM_log_rate_limited)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_log_sync)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_log_backend_block)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_log_backend_block_deferred)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_log_backend_drop_newest)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_log_backend_drop_oldest)->ThreadRange(1, 32)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+#include "kibble/memory/allocator/tlsf_allocator.h"
+#include "kibble/memory/arena.h"
+#include "kibble/memory/heap_area.h"
+#include "kibble/memory/policy/memory_tracking_sampling.h"
+#include "kibble/memory/policy/memory_tracking_simple.h"
+#include "kibble/memory/policy/memory_tracking_verbose.h"
+#include "kibble/memory/util/literals.h"
+#include "kibble/random/xor_shift.h"
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using namespace kb;
+using namespace kb::memory::literals;
+
+template <typename MemoryTrackerT>
+using TrackedArena = memory::MemoryArena<memory::TLSFAllocator, memory::policy::SingleThread,
+                                         memory::policy::NoBoundsChecking, memory::policy::NoMemoryTagging,
+                                         MemoryTrackerT>;
+
+/*
+    Each operation frees the block held by a random slot and allocates a new one of random size. The allocation site
+    depends on the size, so that the sampling tracker has a few sites to aggregate.
+*/
+struct TraceOp
+{
+    uint32_t slot;
+    uint32_t size;
+};
+
+constexpr size_t k_slots = 4096;
+constexpr size_t k_trace_length = 1 << 16;
+
+static const std::vector<TraceOp>& get_trace()
+{
+    static std::vector<TraceOp> trace = []() {
+        rng::XorShiftEngine rng;
+        rng.seed(42);
+        std::vector<TraceOp> ops(k_trace_length);
+        for (auto& op : ops)
+        {
+            op.slot = uint32_t(rng.rand64() % k_slots);
+            op.size = uint32_t(8 + rng.rand64() % 1017);
+        }
+        return ops;
+    }();
+    return trace;
+}
+
+template <typename ArenaT>
+static void* allocate(ArenaT& arena, size_t size)
+{
+    if (size < 64)
+    {
+        return arena.allocate(size, 8, 0, __FILE__, __LINE__);
+    }
+    if (size < 256)
+    {
+        return arena.allocate(size, 8, 0, __FILE__, __LINE__);
+    }
+    return arena.allocate(size, 8, 0, __FILE__, __LINE__);
+}
+
+template <typename MemoryTrackerT>
+static void replay(benchmark::State& state)
+{
+    memory::HeapArea area(16_MB);
+    TrackedArena<MemoryTrackerT> arena("BenchArena", area, 12_MB);
+    const auto& trace = get_trace();
+    std::vector<void*> slots(k_slots, nullptr);
+
+    for (auto _ : state)
+    {
+        for (const auto& op : trace)
+        {
+            if (slots[op.slot] != nullptr)
+            {
+                arena.deallocate(slots[op.slot], __FILE__, __LINE__);
+            }
+            slots[op.slot] = allocate(arena, op.size);
+            benchmark::DoNotOptimize(slots[op.slot]);
+        }
+    }
+
+    for (void* ptr : slots)
+    {
+        if (ptr != nullptr)
+        {
+            arena.deallocate(ptr, __FILE__, __LINE__);
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(trace.size()));
+}
+
+static void BM_no_tracking(benchmark::State& state)
+{
+    replay<memory::policy::NoMemoryTracking>(state);
+}
+
+static void BM_simple_tracking(benchmark::State& state)
+{
+    replay<memory::policy::SimpleMemoryTracking>(state);
+}
+
+static void BM_sampling_tracking(benchmark::State& state)
+{
+    replay<memory::policy::SamplingMemoryTracking>(state);
+}
+
+static void BM_verbose_tracking(benchmark::State& state)
+{
+    replay<memory::policy::VerboseMemoryTracking>(state);
+}
+
+BENCHMARK(BM_no_tracking)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_simple_tracking)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_sampling_tracking)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_verbose_tracking)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
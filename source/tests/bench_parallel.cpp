@@ -0,0 +1,223 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/random/xor_shift.h"
+#include "kibble/thread/job/parallel.h"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <execution>
+#include <numeric>
+#include <vector>
+
+using namespace kb;
+
+/*
+    Compare the parallel algorithms of the job system with a serial baseline
+    and the standard parallel algorithms. With libstdc++, std::execution::par
+    only runs in parallel if TBB is available.
+    The largest sizes need several GB of memory, use --benchmark_filter to skip them.
+*/
+
+static th::JobSystem& job_system()
+{
+    static th::JobSystem::Config config{.queue_mode = th::QueueMode::WorkStealing,
+                                        .victim_selection = th::VictimSelection::Random};
+    static memory::HeapArea area(th::JobSystem::get_memory_requirements(config));
+    static th::JobSystem js(area, config);
+    return js;
+}
+
+static void sizes(benchmark::internal::Benchmark* bench)
+{
+    for (int64_t size = 1'000'000; size <= 1'000'000'000; size *= 10)
+    {
+        bench->Arg(size);
+    }
+    bench->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+static std::vector<float> random_data(size_t size)
+{
+    std::vector<float> data(size);
+    rng::XorShiftEngine rng(uint64_t(42));
+    for (auto& value : data)
+    {
+        value = float(rng.rand64() % 1'000'000) / 1000.f;
+    }
+    return data;
+}
+
+// A few flops per element
+static inline float kernel(float value)
+{
+    return std::sqrt(value) * 1.5f + std::sin(value);
+}
+
+// ---- for ----
+
+static void BM_for_serial(benchmark::State& state)
+{
+    auto data = random_data(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        std::for_each(data.begin(), data.end(), [](float& value) { value = kernel(value); });
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+static void BM_for_std_par(benchmark::State& state)
+{
+    auto data = random_data(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        std::for_each(std::execution::par, data.begin(), data.end(), [](float& value) { value = kernel(value); });
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+static void BM_for_kibble(benchmark::State& state)
+{
+    auto& js = job_system();
+    auto data = random_data(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        th::parallel_for(js, size_t(0), data.size(), [&data](size_t idx) { data[idx] = kernel(data[idx]); });
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_for_serial)->Apply(sizes);
+BENCHMARK(BM_for_std_par)->Apply(sizes);
+BENCHMARK(BM_for_kibble)->Apply(sizes);
+
+// ---- reduce ----
+
+static void BM_reduce_serial(benchmark::State& state)
+{
+    auto data = random_data(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(std::reduce(data.begin(), data.end(), 0.0, std::plus<>{}));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+static void BM_reduce_std_par(benchmark::State& state)
+{
+    auto data = random_data(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(std::reduce(std::execution::par, data.begin(), data.end(), 0.0, std::plus<>{}));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+static void BM_reduce_kibble(benchmark::State& state)
+{
+    auto& js = job_system();
+    auto data = random_data(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(th::parallel_reduce(
+            js, size_t(0), data.size(), 0.0, [&data](size_t idx) { return double(data[idx]); }, std::plus<>{}));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_reduce_serial)->Apply(sizes);
+BENCHMARK(BM_reduce_std_par)->Apply(sizes);
+BENCHMARK(BM_reduce_kibble)->Apply(sizes);
+
+// ---- scan ----
+
+static void BM_scan_serial(benchmark::State& state)
+{
+    auto data = random_data(size_t(state.range(0)));
+    std::vector<float> out(data.size());
+    for (auto _ : state)
+    {
+        std::inclusive_scan(data.begin(), data.end(), out.begin());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+static void BM_scan_std_par(benchmark::State& state)
+{
+    auto data = random_data(size_t(state.range(0)));
+    std::vector<float> out(data.size());
+    for (auto _ : state)
+    {
+        std::inclusive_scan(std::execution::par, data.begin(), data.end(), out.begin());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+static void BM_scan_kibble(benchmark::State& state)
+{
+    auto& js = job_system();
+    auto data = random_data(size_t(state.range(0)));
+    std::vector<float> out(data.size());
+    for (auto _ : state)
+    {
+        th::parallel_scan(js, data.begin(), data.end(), out.begin(), 0.f);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_scan_serial)->Apply(sizes);
+BENCHMARK(BM_scan_std_par)->Apply(sizes);
+BENCHMARK(BM_scan_kibble)->Apply(sizes);
+
+// ---- sort ----
+
+static void BM_sort_serial(benchmark::State& state)
+{
+    auto data = random_data(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto copy = data;
+        state.ResumeTiming();
+        std::sort(copy.begin(), copy.end());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+static void BM_sort_std_par(benchmark::State& state)
+{
+    auto data = random_data(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto copy = data;
+        state.ResumeTiming();
+        std::sort(std::execution::par, copy.begin(), copy.end());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+static void BM_sort_kibble(benchmark::State& state)
+{
+    auto& js = job_system();
+    auto data = random_data(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto copy = data;
+        state.ResumeTiming();
+        th::parallel_sort(js, copy.begin(), copy.end());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_sort_serial)->Apply(sizes);
+BENCHMARK(BM_sort_std_par)->Apply(sizes);
+BENCHMARK(BM_sort_kibble)->Apply(sizes);
+
+BENCHMARK_MAIN();
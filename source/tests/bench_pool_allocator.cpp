@@ -0,0 +1,88 @@
+#include "kibble/memory/allocator/atomic_pool_allocator.h"
+#include "kibble/memory/allocator/pool_allocator.h"
+#include "kibble/memory/arena.h"
+#include "kibble/memory/heap_area.h"
+#include "kibble/memory/policy/thread_guard_multi_thread.h"
+#include "kibble/memory/util/literals.h"
+
+#include <benchmark/benchmark.h>
+#include <array>
+#include <mutex>
+
+using namespace kb;
+using namespace kb::memory::literals;
+
+constexpr size_t k_max_nodes = 8192;
+constexpr size_t k_node_size = 64;
+constexpr size_t k_batch = 8;
+
+using MutexPoolArena =
+    memory::MemoryArena<memory::PoolAllocator, memory::policy::MultiThread<std::mutex>, memory::policy::NoBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+using AtomicQueuePoolArena =
+    memory::MemoryArena<memory::AtomicPoolAllocator<k_max_nodes>, memory::policy::SingleThread,
+                        memory::policy::NoBoundsChecking, memory::policy::NoMemoryTagging,
+                        memory::policy::NoMemoryTracking>;
+using LockFreePoolArena =
+    memory::MemoryArena<memory::LockFreePoolAllocator, memory::policy::SingleThread, memory::policy::NoBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+
+template <typename ArenaT>
+ArenaT& get_arena();
+
+template <>
+MutexPoolArena& get_arena()
+{
+    static memory::HeapArea area(2 * k_max_nodes * k_node_size);
+    static MutexPoolArena arena("MutexPool", area, k_max_nodes, k_node_size - 16, 16u);
+    return arena;
+}
+
+template <>
+AtomicQueuePoolArena& get_arena()
+{
+    static memory::HeapArea area(2 * k_max_nodes * k_node_size);
+    static AtomicQueuePoolArena arena("AtomicQueuePool", area, k_node_size - 16, 16u);
+    return arena;
+}
+
+template <>
+LockFreePoolArena& get_arena()
+{
+    static memory::HeapArea area(2 * k_max_nodes * k_node_size);
+    static LockFreePoolArena arena("LockFreePool", area, k_max_nodes, k_node_size - 16, 16u);
+    return arena;
+}
+
+/*
+    Each thread allocates a small batch of nodes, touches them, and frees them in reverse order. All threads hammer the
+    same pool, so the free list head is the contention point.
+*/
+template <typename ArenaT>
+static void BM_pool_contention(benchmark::State& state)
+{
+    auto& arena = get_arena<ArenaT>();
+    std::array<void*, k_batch> nodes;
+
+    for (auto _ : state)
+    {
+        for (auto& node : nodes)
+        {
+            node = arena.allocate(k_node_size - 16, 8, 0, __FILE__, __LINE__);
+            *static_cast<size_t*>(node) = size_t(state.thread_index());
+        }
+        benchmark::ClobberMemory();
+        for (size_t ii = k_batch; ii > 0; --ii)
+        {
+            arena.deallocate(nodes[ii - 1], __FILE__, __LINE__);
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations() * k_batch));
+}
+
+BENCHMARK(BM_pool_contention<MutexPoolArena>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_pool_contention<AtomicQueuePoolArena>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_pool_contention<LockFreePoolArena>)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
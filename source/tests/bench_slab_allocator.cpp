@@ -0,0 +1,135 @@
+#include "kibble/memory/allocator/slab_allocator.h"
+#include "kibble/memory/allocator/tlsf_allocator.h"
+#include "kibble/memory/arena.h"
+#include "kibble/memory/heap_area.h"
+#include "kibble/memory/util/literals.h"
+#include "kibble/random/xor_shift.h"
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <vector>
+
+using namespace kb;
+using namespace kb::memory::literals;
+
+using SlabArena =
+    memory::MemoryArena<memory::SlabAllocator, memory::policy::SingleThread, memory::policy::NoBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+using TLSFArena =
+    memory::MemoryArena<memory::TLSFAllocator, memory::policy::SingleThread, memory::policy::NoBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+
+/*
+    A trace is a sequence of operations on a set of slots: each operation frees the block held by a slot (if any) and
+    allocates a new one. Sizes follow a distribution typical of a game engine heap: mostly small objects (nodes,
+    handles, small strings), some medium buffers, and a few large ones.
+*/
+struct TraceOp
+{
+    uint32_t slot;
+    uint32_t size;
+};
+
+constexpr size_t k_slots = 4096;
+constexpr size_t k_trace_length = 1 << 16;
+
+static size_t sample_size(rng::XorShiftEngine& rng)
+{
+    uint64_t pick = rng.rand64() % 100;
+    if (pick < 60)
+    {
+        return 8 + rng.rand64() % 57;
+    }
+    if (pick < 90)
+    {
+        return 64 + rng.rand64() % 449;
+    }
+    if (pick < 99)
+    {
+        return 512 + rng.rand64() % 3585;
+    }
+    return 4096 + rng.rand64() % 61441;
+}
+
+static const std::vector<TraceOp>& get_trace()
+{
+    static std::vector<TraceOp> trace = []() {
+        rng::XorShiftEngine rng;
+        rng.seed(42);
+        std::vector<TraceOp> ops(k_trace_length);
+        for (auto& op : ops)
+        {
+            // Recently touched slots are more likely to be touched again (short-lived objects)
+            uint64_t span = (rng.rand64() % 4 == 0) ? k_slots : k_slots / 16;
+            op.slot = uint32_t(rng.rand64() % span);
+            op.size = uint32_t(sample_size(rng));
+        }
+        return ops;
+    }();
+    return trace;
+}
+
+template <typename AllocateFn, typename DeallocateFn>
+static void replay(benchmark::State& state, AllocateFn&& allocate, DeallocateFn&& deallocate)
+{
+    const auto& trace = get_trace();
+    std::vector<void*> slots(k_slots, nullptr);
+
+    for (auto _ : state)
+    {
+        for (const auto& op : trace)
+        {
+            if (slots[op.slot] != nullptr)
+            {
+                deallocate(slots[op.slot]);
+            }
+            slots[op.slot] = allocate(op.size);
+            benchmark::DoNotOptimize(slots[op.slot]);
+        }
+
+        state.PauseTiming();
+        for (void*& ptr : slots)
+        {
+            if (ptr != nullptr)
+            {
+                deallocate(ptr);
+                ptr = nullptr;
+            }
+        }
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(trace.size()));
+}
+
+template <typename ArenaT, typename... ArgsT>
+static void replay_arena(benchmark::State& state, ArgsT... args)
+{
+    memory::HeapArea area(160_MB);
+    ArenaT arena("BenchArena", area, args...);
+    replay(
+        state, [&arena](size_t size) { return arena.allocate(size, 8, 0, __FILE__, __LINE__); },
+        [&arena](void* ptr) { arena.deallocate(ptr, __FILE__, __LINE__); });
+}
+
+static void BM_slab_trace(benchmark::State& state)
+{
+    // Small objects in the slab, the rest in the TLSF fallback
+    replay_arena<SlabArena>(state, 64_MB, 64_MB);
+}
+
+static void BM_tlsf_trace(benchmark::State& state)
+{
+    replay_arena<TLSFArena>(state, 128_MB);
+}
+
+static void BM_malloc_trace(benchmark::State& state)
+{
+    replay(state, [](size_t size) { return std::malloc(size); }, [](void* ptr) { std::free(ptr); });
+}
+
+BENCHMARK(BM_slab_trace)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_tlsf_trace)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_malloc_trace)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
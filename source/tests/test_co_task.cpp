@@ -0,0 +1,179 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/thread/job/co_task.h"
+#include "kibble/thread/job/impl/barrier.h"
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace kb;
+
+class CoTaskFixture
+{
+public:
+    CoTaskFixture() : area(th::JobSystem::get_memory_requirements({})), js(area, {})
+    {
+    }
+
+protected:
+    memory::HeapArea area;
+    th::JobSystem js;
+};
+
+static th::co_task<int> square(int value)
+{
+    co_return value * value;
+}
+
+static th::co_task<int> sum_of_squares(int count)
+{
+    int sum = 0;
+    for (int ii = 1; ii <= count; ++ii)
+    {
+        sum += co_await square(ii);
+    }
+    co_return sum;
+}
+
+TEST_CASE_METHOD(CoTaskFixture, "Coroutines can await other coroutines", "[co_task]")
+{
+    auto task = sum_of_squares(10);
+    task.schedule(js);
+    REQUIRE(task.wait() == 385);
+    REQUIRE(task.is_done());
+}
+
+static th::co_task<void> fan_out(th::JobSystem& js, std::vector<int>& results)
+{
+    // Children are started in parallel, then awaited in order
+    std::vector<th::co_task<int>> children;
+    for (int ii = 0; ii < int(results.size()); ++ii)
+    {
+        children.push_back(square(ii));
+        children.back().schedule(js);
+    }
+    for (size_t ii = 0; ii < children.size(); ++ii)
+    {
+        results[ii] = co_await children[ii];
+    }
+}
+
+TEST_CASE_METHOD(CoTaskFixture, "Coroutines can await scheduled coroutines", "[co_task]")
+{
+    std::vector<int> results(100, -1);
+    auto task = fan_out(js, results);
+    task.schedule(js);
+    task.wait();
+
+    for (int ii = 0; ii < int(results.size()); ++ii)
+    {
+        REQUIRE(results[size_t(ii)] == ii * ii);
+    }
+}
+
+static th::co_task<size_t> await_barrier(th::JobSystem& js, std::atomic<size_t>& counter)
+{
+    th::barrier_t barrier = js.create_barrier();
+    for (size_t ii = 0; ii < 200; ++ii)
+    {
+        auto task = js.create_task(th::detached, {}, [&counter]() { counter.fetch_add(1); });
+        task.schedule(barrier);
+    }
+    co_await barrier;
+    js.destroy_barrier(barrier);
+    co_return counter.load();
+}
+
+TEST_CASE_METHOD(CoTaskFixture, "Coroutines can await barriers", "[co_task]")
+{
+    std::atomic<size_t> counter{0};
+    auto task = await_barrier(js, counter);
+    task.schedule(js);
+    REQUIRE(task.wait() == 200);
+}
+
+TEST_CASE("Barrier waiters are taken with the last dependency", "[co_task]")
+{
+    th::Barrier barrier;
+    th::BarrierWaiter first;
+    th::BarrierWaiter second;
+    th::BarrierWaiter* waiters = nullptr;
+
+    barrier.add_dependencies(2);
+    REQUIRE(barrier.push_waiter(&first));
+    REQUIRE_FALSE(barrier.remove_dependency(waiters));
+    REQUIRE(waiters == nullptr);
+    REQUIRE(barrier.remove_dependency(waiters));
+    REQUIRE(waiters == &first);
+    REQUIRE_FALSE(barrier.push_waiter(&second));
+
+    // A reused barrier only holds the waiters of the new round
+    barrier.add_dependency();
+    REQUIRE(barrier.push_waiter(&second));
+    REQUIRE(barrier.remove_dependency(waiters));
+    REQUIRE(waiters == &second);
+    REQUIRE(second.next == nullptr);
+}
+
+static th::co_task<int> throwing()
+{
+    throw std::runtime_error("fail");
+    co_return 0;
+}
+
+static th::co_task<bool> catching()
+{
+    try
+    {
+        co_await throwing();
+    }
+    catch (const std::runtime_error&)
+    {
+        co_return true;
+    }
+    co_return false;
+}
+
+TEST_CASE_METHOD(CoTaskFixture, "Coroutine exceptions propagate to the awaiting coroutine", "[co_task]")
+{
+    auto task = catching();
+    task.schedule(js);
+    REQUIRE(task.wait());
+
+    auto failing = throwing();
+    failing.schedule(js);
+    REQUIRE_THROWS_AS(failing.wait(), std::runtime_error);
+}
+
+static th::co_task<void> sleepy(th::DaemonScheduler& ds, std::atomic<size_t>& counter)
+{
+    co_await th::delay(ds, std::chrono::milliseconds(5));
+    counter.fetch_add(1);
+    co_await th::delay(ds, std::chrono::milliseconds(5));
+    counter.fetch_add(1);
+}
+
+TEST_CASE_METHOD(CoTaskFixture, "Many coroutines can wait concurrently", "[co_task]")
+{
+    th::DaemonScheduler::Config config;
+    config.timer_thread = true;
+    th::DaemonScheduler ds(js, config);
+
+    // Way more delayed coroutines than workers
+    constexpr size_t k_count = 1000;
+    std::atomic<size_t> counter{0};
+    std::vector<th::co_task<void>> tasks;
+    for (size_t ii = 0; ii < k_count; ++ii)
+    {
+        tasks.push_back(sleepy(ds, counter));
+        tasks.back().schedule(js);
+    }
+    for (auto& task : tasks)
+    {
+        task.wait();
+    }
+
+    REQUIRE(counter.load() == 2 * k_count);
+}
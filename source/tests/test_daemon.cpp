@@ -0,0 +1,178 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/thread/job/daemon.h"
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <stdexcept>
+
+using namespace kb;
+
+/*
+    The wheel is advanced manually, one tick (1ms) at a time, and all jobs are waited on after each tick, so that a
+    daemon never skips a period because its previous execution is not over.
+*/
+class DaemonFixture
+{
+public:
+    DaemonFixture() : area(th::JobSystem::get_memory_requirements({})), js(area, {}), ds(js)
+    {
+    }
+
+protected:
+    void advance(size_t ticks)
+    {
+        for (size_t ii = 0; ii < ticks; ++ii)
+        {
+            ds.advance();
+            js.wait();
+        }
+    }
+
+    th::DaemonHandle create(std::atomic<size_t>& counter, th::SchedulingData&& scheduling_data)
+    {
+        return ds.create(
+            [&counter]() {
+                counter.fetch_add(1);
+                return true;
+            },
+            std::move(scheduling_data));
+    }
+
+    memory::HeapArea area;
+    th::JobSystem js;
+    th::DaemonScheduler ds;
+};
+
+TEST_CASE_METHOD(DaemonFixture, "Daemons are rescheduled at their interval", "[daemon]")
+{
+    std::atomic<size_t> counter{0};
+    th::SchedulingData sd;
+    sd.interval_ms = 10.f;
+    sd.cooldown_ms = 10.f;
+    create(counter, std::move(sd));
+
+    advance(9);
+    REQUIRE(counter.load() == 0);
+    advance(1);
+    REQUIRE(counter.load() == 1);
+    advance(90);
+    REQUIRE(counter.load() == 10);
+}
+
+TEST_CASE_METHOD(DaemonFixture, "Daemon cooldown delays the first execution", "[daemon]")
+{
+    std::atomic<size_t> counter{0};
+    th::SchedulingData sd;
+    sd.interval_ms = 10.f;
+    sd.cooldown_ms = 50.f;
+    create(counter, std::move(sd));
+
+    advance(49);
+    REQUIRE(counter.load() == 0);
+    advance(1);
+    REQUIRE(counter.load() == 1);
+    advance(10);
+    REQUIRE(counter.load() == 2);
+}
+
+TEST_CASE_METHOD(DaemonFixture, "Daemons with a ttl are killed automatically", "[daemon]")
+{
+    std::atomic<size_t> counter{0};
+    th::SchedulingData sd;
+    sd.interval_ms = 5.f;
+    sd.ttl = 3;
+    create(counter, std::move(sd));
+    REQUIRE(ds.size() == 1);
+
+    advance(100);
+    REQUIRE(counter.load() == 3);
+    REQUIRE(ds.size() == 0);
+}
+
+TEST_CASE_METHOD(DaemonFixture, "Killing daemons", "[daemon]")
+{
+    std::atomic<size_t> counter_a{0};
+    std::atomic<size_t> counter_b{0};
+    th::SchedulingData sd_a;
+    sd_a.interval_ms = 1.f;
+    th::SchedulingData sd_b;
+    sd_b.interval_ms = 1.f;
+    auto hnd_a = create(counter_a, std::move(sd_a));
+    create(counter_b, std::move(sd_b));
+
+    advance(10);
+    ds.kill(hnd_a);
+    advance(10);
+
+    REQUIRE(counter_a.load() == 10);
+    REQUIRE(counter_b.load() == 20);
+    REQUIRE(ds.size() == 1);
+}
+
+TEST_CASE_METHOD(DaemonFixture, "Daemons self-terminate", "[daemon]")
+{
+    size_t runs = 0;
+    th::SchedulingData sd_false;
+    sd_false.interval_ms = 1.f;
+    ds.create([&runs]() { return ++runs < 2; }, std::move(sd_false));
+
+    th::SchedulingData sd_throw;
+    sd_throw.interval_ms = 1.f;
+    ds.create([]() -> bool { throw std::runtime_error("fail"); }, std::move(sd_throw));
+
+    advance(10);
+    REQUIRE(runs == 2);
+    REQUIRE(ds.size() == 0);
+}
+
+TEST_CASE_METHOD(DaemonFixture, "Long intervals cascade through the wheel levels", "[daemon]")
+{
+    std::atomic<size_t> counter_short{0};
+    std::atomic<size_t> counter_long{0};
+    th::SchedulingData sd_short;
+    sd_short.interval_ms = 300.f;
+    sd_short.cooldown_ms = 300.f;
+    th::SchedulingData sd_long;
+    sd_long.interval_ms = 70'000.f;
+    sd_long.cooldown_ms = 70'000.f;
+    create(counter_short, std::move(sd_short));
+    create(counter_long, std::move(sd_long));
+
+    for (size_t ii = 0; ii < 233; ++ii)
+    {
+        advance(300);
+        REQUIRE(counter_short.load() == ii + 1);
+    }
+    // 69900 ticks elapsed
+    REQUIRE(counter_long.load() == 0);
+    ds.advance(99);
+    js.wait();
+    REQUIRE(counter_long.load() == 0);
+    advance(1);
+    REQUIRE(counter_long.load() == 1);
+}
+
+TEST_CASE("Daemons driven by a timer thread", "[daemon]")
+{
+    memory::HeapArea area(th::JobSystem::get_memory_requirements({}));
+    th::JobSystem js(area, {});
+
+    th::DaemonScheduler::Config config;
+    config.timer_thread = true;
+    th::DaemonScheduler ds(js, config);
+
+    std::atomic<size_t> counter{0};
+    th::SchedulingData sd;
+    sd.interval_ms = 2.f;
+    ds.create(
+        [&counter]() {
+            counter.fetch_add(1);
+            return true;
+        },
+        std::move(sd));
+
+    // No call to update() is needed
+    js.wait_until([&counter]() { return counter.load() < 5; });
+    REQUIRE(counter.load() >= 5);
+}
@@ -0,0 +1,145 @@
+#include "kibble/time/instrumentation.h"
+#include "kibble/time/trace_format.h"
+
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace kb;
+namespace fs = std::filesystem;
+
+class TraceFileFixture
+{
+public:
+    TraceFileFixture() : path(fs::temp_directory_path() / "kibble_test_instrumentation.ktrace")
+    {
+    }
+
+    ~TraceFileFixture()
+    {
+        fs::remove(path);
+    }
+
+protected:
+    trace::TraceData read()
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        trace::TraceData data;
+        REQUIRE(trace::read_trace(ifs, data));
+        return data;
+    }
+
+    fs::path path;
+};
+
+TEST_CASE("Interned strings have stable IDs", "[instrumentation]")
+{
+    uint32_t foo = InstrumentationSession::intern("foo");
+    uint32_t bar = InstrumentationSession::intern("bar");
+    REQUIRE(foo != bar);
+    REQUIRE(InstrumentationSession::intern(std::string("foo")) == foo);
+
+    // IDs are process-wide
+    uint32_t from_thread = 0;
+    std::thread thread([&from_thread]() { from_thread = InstrumentationSession::intern("bar"); });
+    thread.join();
+    REQUIRE(from_thread == bar);
+}
+
+TEST_CASE_METHOD(TraceFileFixture, "Events are streamed to a binary trace", "[instrumentation]")
+{
+    uint32_t name = InstrumentationSession::intern("work");
+    uint32_t category = InstrumentationSession::intern("test");
+    {
+        InstrumentationSession session(path);
+        session.push(0, {100, 200, name, category});
+        std::thread worker([&]() { session.push(1, {150, 300, name, category}); });
+        worker.join();
+        {
+            InstrumentationTimer timer(&session, "scope", "test", 0);
+        }
+        // Out of range thread IDs are ignored
+        session.push(0xffffffff, {0, 1, name, category});
+    }
+
+    auto data = read();
+    REQUIRE(data.events.size() == 3);
+    REQUIRE(data.dropped == 0);
+    for (const auto& [thread_id, event] : data.events)
+    {
+        REQUIRE(data.string(event.category_id) == "test");
+        REQUIRE(event.end_ns >= event.start_ns);
+    }
+    // Records from different threads may be interleaved in any order
+    std::sort(data.events.begin(), data.events.end(), [](const auto& a, const auto& b) {
+        return (a.thread_id != b.thread_id) ? a.thread_id < b.thread_id : a.event.start_ns < b.event.start_ns;
+    });
+    REQUIRE(data.events[0].thread_id == 0);
+    REQUIRE(data.string(data.events[0].event.name_id) == "work");
+    REQUIRE(data.string(data.events[1].event.name_id) == "scope");
+    REQUIRE(data.events[2].thread_id == 1);
+    REQUIRE(data.events[2].event.start_ns == 150);
+}
+
+TEST_CASE_METHOD(TraceFileFixture, "Events pushed to a full ring buffer are dropped", "[instrumentation]")
+{
+    uint32_t name = InstrumentationSession::intern("work");
+    constexpr size_t k_count = 10000;
+    {
+        InstrumentationSession session(path, 16);
+        for (size_t ii = 0; ii < k_count; ++ii)
+        {
+            session.push(0, {int64_t(ii), int64_t(ii + 1), name, name});
+        }
+    }
+
+    // Nothing is lost silently
+    auto data = read();
+    REQUIRE(data.dropped > 0);
+    REQUIRE(data.events.size() + data.dropped == k_count);
+}
+
+TEST_CASE("Binary trace conversion", "[instrumentation]")
+{
+    uint32_t name = InstrumentationSession::intern("say \"hi\"");
+    uint32_t category = InstrumentationSession::intern("test");
+
+    std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+    trace::write_header(ss, 1000);
+    trace::write_string(ss, name, "say \"hi\"");
+    trace::write_string(ss, category, "test");
+    TraceEvent events[] = {{1000, 3000, name, category}, {1500, 2000, name, category}};
+    trace::write_events(ss, 2, events, 2);
+    trace::write_dropped(ss, 2, 5);
+    // Truncated record
+    trace::write_string(ss, 42, "truncated");
+    std::string bytes = ss.str();
+    bytes.resize(bytes.size() - 4);
+
+    std::istringstream iss(bytes, std::ios::binary);
+    trace::TraceData data;
+    REQUIRE(trace::read_trace(iss, data));
+    REQUIRE(data.events.size() == 2);
+    REQUIRE(data.dropped == 5);
+    REQUIRE(data.string(42) == "<unknown>");
+
+    std::ostringstream json;
+    trace::write_chrome_json(data, json);
+    REQUIRE(json.str() ==
+            R"({"otherData":{"dropped":5},"traceEvents":[)"
+            R"({"cat":"test","dur":2.000,"name":"say \"hi\"","ph":"X","pid":0,"tid":3,"ts":0.000},)"
+            R"({"cat":"test","dur":0.500,"name":"say \"hi\"","ph":"X","pid":0,"tid":3,"ts":0.500}]})");
+
+    std::ostringstream perfetto;
+    trace::write_perfetto(data, perfetto);
+    REQUIRE(!perfetto.str().empty());
+
+    std::istringstream garbage("definitely not a trace");
+    trace::TraceData invalid;
+    REQUIRE(!trace::read_trace(garbage, invalid));
+}
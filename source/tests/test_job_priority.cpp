@@ -0,0 +1,92 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/thread/job/job_system.h"
+
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+#include <string>
+
+using namespace kb;
+
+/*
+    Jobs with main thread affinity are only executed when the main thread waits, so the execution order is fully
+    determined by the queues.
+*/
+class MainThreadFixture
+{
+public:
+    MainThreadFixture() : area(th::JobSystem::get_memory_requirements({})), js(area, {})
+    {
+    }
+
+protected:
+    void schedule(th::JobPriority priority, char label)
+    {
+        auto task = js.create_task(th::detached, {th::WORKER_AFFINITY_MAIN, "job", priority},
+                                   [this, label]() { order.push_back(label); });
+        task.schedule();
+    }
+
+    memory::HeapArea area;
+    th::JobSystem js;
+    std::string order;
+};
+
+TEST_CASE_METHOD(MainThreadFixture, "Lanes are drained from high to low priority", "[priority]")
+{
+    schedule(th::JobPriority::Low, 'l');
+    schedule(th::JobPriority::Normal, 'n');
+    schedule(th::JobPriority::Low, 'l');
+    schedule(th::JobPriority::High, 'h');
+    schedule(th::JobPriority::Normal, 'n');
+    schedule(th::JobPriority::High, 'h');
+    js.wait();
+
+    REQUIRE(order == "hhnnll");
+}
+
+TEST_CASE_METHOD(MainThreadFixture, "Jobs close to their deadline are promoted", "[priority]")
+{
+    schedule(th::JobPriority::Normal, 'n');
+
+    th::JobMetadata meta(th::WORKER_AFFINITY_MAIN, "urgent", th::JobPriority::Low);
+    meta.deadline = th::JobMetadata::clock::now() + std::chrono::microseconds(100);
+    auto urgent = js.create_task(th::detached, std::move(meta), [this]() { order.push_back('u'); });
+    urgent.schedule();
+
+    th::JobMetadata relaxed(th::WORKER_AFFINITY_MAIN, "relaxed", th::JobPriority::Low);
+    relaxed.deadline = th::JobMetadata::clock::now() + std::chrono::hours(1);
+    auto later = js.create_task(th::detached, std::move(relaxed), [this]() { order.push_back('r'); });
+    later.schedule();
+
+    js.wait();
+
+    REQUIRE(order == "unr");
+}
+
+TEST_CASE("Latency histogram percentiles", "[priority]")
+{
+    th::LatencyHistogram histogram;
+    REQUIRE(histogram.percentile_us(0.5) == 0);
+
+    // 90 samples under 1us, 9 around 100us, 1 around 5ms
+    for (size_t ii = 0; ii < 90; ++ii)
+    {
+        histogram.add(500);
+    }
+    for (size_t ii = 0; ii < 9; ++ii)
+    {
+        histogram.add(100'000);
+    }
+    histogram.add(5'000'000);
+
+    REQUIRE(histogram.total() == 100);
+    REQUIRE(histogram.percentile_us(0.5) == 1);
+    REQUIRE(histogram.percentile_us(0.99) == 128);
+    REQUIRE(histogram.percentile_us(1.0) == 8192);
+
+    th::LatencyHistogram other;
+    other.add(500);
+    histogram.merge(other);
+    REQUIRE(histogram.total() == 101);
+}
@@ -4,11 +4,23 @@
 #define K_DEBUG // For verbose / debug to actually do something
 #endif
 
+#include "kibble/logger/async_backend.h"
+#include "kibble/logger/binary_log.h"
+#include "kibble/logger/intern.h"
 #include "kibble/logger/logger.h"
+#include "kibble/logger/policies/rate_limit_policy.h"
 #include "kibble/logger/sink.h"
+#include "kibble/logger/sinks/binary_file_sink.h"
+#include "kibble/logger/sinks/net_sink.h"
+#include "kibble/logger/sinks/rotating_file_sink.h"
 #include "kibble/math/color_table.h"
+#include "kibble/net/tcp_acceptor.h"
 
 #include <catch2/catch_all.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
 
 using namespace kb::log;
 
@@ -84,4 +96,1006 @@ TEST_CASE_METHOD(SinkFixture, "Fatal test", "[sink]")
 {
     klog(chan).fatal("Message");
     REQUIRE(sink->e_.severity == Severity::Fatal);
-}
\ No newline at end of file
+}
+
+class CountingSink : public Sink
+{
+public:
+    void submit(const LogEntry& e, const ChannelPresentation&) override
+    {
+        // Gate closed: hold the backend thread inside the sink
+        entered.store(true);
+        while (!open.load())
+        {
+            std::this_thread::yield();
+        }
+        messages.push_back(e.message);
+    }
+
+    std::atomic<bool> open{true};
+    std::atomic<bool> entered{false};
+    std::vector<std::string> messages;
+};
+
+class AsyncFixture
+{
+public:
+    AsyncFixture() : chan(Severity::Verbose, "test", "tst", kb::col::aliceblue), sink(new CountingSink)
+    {
+        chan.attach_sink(sink);
+        Channel::exit_on_fatal_error(false);
+    }
+
+    // Block the backend thread in the sink on the first entry, so that the ring can be filled
+    void hold_backend()
+    {
+        sink->open.store(false);
+        klog(chan).info("0");
+        while (!sink->entered.load())
+        {
+            std::this_thread::yield();
+        }
+    }
+
+protected:
+    Channel chan;
+    std::shared_ptr<CountingSink> sink;
+};
+
+TEST_CASE_METHOD(AsyncFixture, "Async backend: entries from all threads are dispatched in order", "[async]")
+{
+    constexpr size_t k_threads = 4;
+    constexpr size_t k_per_thread = 2000;
+
+    AsyncBackend backend(64, OverflowPolicy::Block);
+    Channel::set_backend(&backend);
+
+    std::vector<std::thread> producers;
+    for (size_t tt = 0; tt < k_threads; ++tt)
+    {
+        producers.emplace_back([this, tt]() {
+            for (size_t ii = 0; ii < k_per_thread; ++ii)
+            {
+                klog(chan).uid("Async").info("{} {}", tt, ii);
+            }
+        });
+    }
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    chan.flush();
+
+    REQUIRE(backend.get_dropped_count() == 0);
+    REQUIRE(backend.get_dispatched_count() == k_threads * k_per_thread);
+    REQUIRE(sink->messages.size() == k_threads * k_per_thread);
+
+    // Entries of a given thread keep their submission order
+    std::vector<size_t> next(k_threads, 0);
+    bool ordered = true;
+    for (const auto& message : sink->messages)
+    {
+        size_t tt = 0, ii = 0;
+        REQUIRE(std::sscanf(message.c_str(), "%zu %zu", &tt, &ii) == 2);
+        ordered &= (ii == next[tt]++);
+    }
+    REQUIRE(ordered);
+}
+
+TEST_CASE_METHOD(AsyncFixture, "Async backend: drop newest on overflow", "[async]")
+{
+    AsyncBackend backend(4, OverflowPolicy::DropNewest);
+    Channel::set_backend(&backend);
+    hold_backend();
+
+    for (size_t ii = 1; ii <= 10; ++ii)
+    {
+        klog(chan).info("{}", ii);
+    }
+    sink->open.store(true);
+    chan.flush();
+    REQUIRE(backend.get_dropped_count() == 6);
+    REQUIRE(sink->messages == std::vector<std::string>{"0", "1", "2", "3", "4"});
+}
+
+TEST_CASE_METHOD(AsyncFixture, "Async backend: drop oldest on overflow", "[async]")
+{
+    AsyncBackend backend(4, OverflowPolicy::DropOldest);
+    Channel::set_backend(&backend);
+    hold_backend();
+
+    for (size_t ii = 1; ii <= 10; ++ii)
+    {
+        klog(chan).info("{}", ii);
+    }
+    sink->open.store(true);
+    chan.flush();
+    REQUIRE(backend.get_dropped_count() == 6);
+    REQUIRE(sink->messages == std::vector<std::string>{"0", "7", "8", "9", "10"});
+}
+
+TEST_CASE_METHOD(AsyncFixture, "Async backend: long messages and detach on destruction", "[async]")
+{
+    std::string long_message(1000, 'x');
+    {
+        AsyncBackend backend(8, OverflowPolicy::Block, 16);
+        Channel::set_backend(&backend);
+        for (size_t ii = 0; ii < 32; ++ii)
+        {
+            klog(chan).info(long_message);
+        }
+    }
+    // Pending entries were dispatched by the destructor, and the channel went back to synchronous mode
+    REQUIRE(Channel::get_backend() == nullptr);
+    REQUIRE(sink->messages.size() == 32);
+    REQUIRE(sink->messages.back() == long_message);
+
+    klog(chan).info("sync");
+    REQUIRE(sink->messages.back() == "sync");
+}
+
+class CapturePolicy : public Policy
+{
+public:
+    bool transform_filter(LogEntry& entry) const override
+    {
+        message = entry.message;
+        was_deferred = entry.deferred != nullptr;
+        return pass;
+    }
+
+    bool pass = true;
+    mutable std::string message;
+    mutable bool was_deferred = false;
+};
+
+class DeferredFixture : public SinkFixture
+{
+public:
+    DeferredFixture() : policy(new CapturePolicy)
+    {
+        chan.attach_policy(policy);
+        Channel::set_deferred_formatting(true);
+    }
+
+    ~DeferredFixture()
+    {
+        Channel::set_deferred_formatting(false);
+    }
+
+protected:
+    std::shared_ptr<CapturePolicy> policy;
+};
+
+struct NotDeferrable
+{
+    int value;
+};
+
+template <>
+struct fmt::formatter<NotDeferrable> : fmt::formatter<int>
+{
+    auto format(const NotDeferrable& x, fmt::format_context& ctx) const
+    {
+        return fmt::formatter<int>::format(x.value, ctx);
+    }
+};
+
+TEST_CASE_METHOD(DeferredFixture, "Deferred formatting gives the same message", "[deferred]")
+{
+    std::string str = "string";
+    std::string_view sv = "view";
+    const char* cstr = "cstring";
+    int ii = -42;
+    void* ptr = &ii;
+
+    klog(chan).info("{} {:.3f} {:>8} {} {} {} {} {:#x} {}", ii, 3.14159, str, sv, cstr, 'c', true, 255u, ptr);
+
+    REQUIRE(policy->was_deferred);
+    REQUIRE(policy->message.empty());
+    REQUIRE(sink->e_.message ==
+            fmt::format("{} {:.3f} {:>8} {} {} {} {} {:#x} {}", ii, 3.14159, str, sv, cstr, 'c', true, 255u, ptr));
+    REQUIRE(sink->e_.deferred == nullptr);
+
+    // C strings can also be formatted as pointers
+    klog(chan).info("{:p} {:>10}", cstr, cstr);
+    REQUIRE(policy->was_deferred);
+    REQUIRE(sink->e_.message == fmt::format("{:p} {:>10}", cstr, cstr));
+}
+
+TEST_CASE_METHOD(DeferredFixture, "Filtered deferred entries are never formatted", "[deferred]")
+{
+    policy->pass = false;
+    sink->e_.message = "untouched";
+    klog(chan).info("{} {}", 1, 2);
+    REQUIRE(policy->was_deferred);
+    REQUIRE(sink->e_.message == "untouched");
+}
+
+TEST_CASE_METHOD(DeferredFixture, "Deferred formatting falls back to eager formatting", "[deferred]")
+{
+    SECTION("Unsupported argument type")
+    {
+        klog(chan).info("value: {}", NotDeferrable{12});
+        REQUIRE_FALSE(policy->was_deferred);
+        REQUIRE(policy->message == "value: 12");
+        REQUIRE(sink->e_.message == "value: 12");
+    }
+
+    SECTION("Arguments too large")
+    {
+        std::string large(DeferredArgs::k_capacity, 'x');
+        klog(chan).info("{}", large);
+        REQUIRE_FALSE(policy->was_deferred);
+        REQUIRE(sink->e_.message == large);
+    }
+
+    SECTION("Null C string")
+    {
+        // The error is reported to the caller, as in eager mode
+        const char* null_str = nullptr;
+        REQUIRE_THROWS_AS(klog(chan).info("{}", null_str), fmt::format_error);
+        klog(chan).info("{:p}", null_str);
+        REQUIRE_FALSE(policy->was_deferred);
+        REQUIRE(sink->e_.message == fmt::format("{:p}", null_str));
+    }
+}
+
+TEST_CASE_METHOD(DeferredFixture, "Deferred formatting with the async backend", "[deferred]")
+{
+    AsyncBackend backend(16, OverflowPolicy::Block);
+    Channel::set_backend(&backend);
+
+    for (int ii = 0; ii < 100; ++ii)
+    {
+        // The string is destroyed right after the call, the record holds a copy
+        klog(chan).uid("Deferred").info("{} {}", ii, std::to_string(ii * 2));
+    }
+    chan.flush();
+
+    REQUIRE(sink->e_.message == "99 198");
+    REQUIRE(sink->e_.uid_text == "Deferred");
+    REQUIRE(sink->e_.uid_hash == "Deferred"_h);
+}
+
+TEST_CASE_METHOD(DeferredFixture, "Runtime format strings are never deferred", "[deferred]")
+{
+    AsyncBackend backend(16, OverflowPolicy::Block);
+    Channel::set_backend(&backend);
+
+    for (int ii = 0; ii < 100; ++ii)
+    {
+        // The format string is destroyed right after the call
+        klog(chan).info(fmt::runtime(std::string("runtime {} ") + std::to_string(ii)), ii);
+        REQUIRE_FALSE(policy->was_deferred);
+        REQUIRE(policy->message == fmt::format("runtime {} {}", ii, ii));
+    }
+    klog_info(chan).msg(fmt::runtime(std::string("macro {}")), 42);
+    chan.flush();
+
+    REQUIRE(sink->e_.message == "macro 42");
+}
+
+TEST_CASE("UIDs are interned", "[deferred]")
+{
+    std::string uid = "SomeSubsystem";
+    auto first = intern(uid);
+    auto second = intern(std::string_view("SomeSubsystem"));
+    REQUIRE(first.hash == "SomeSubsystem"_h);
+    REQUIRE(first.text.data() == second.text.data());
+    REQUIRE(find_interned(first.hash) == "SomeSubsystem");
+    REQUIRE(find_interned("NotInterned"_h).empty());
+}
+
+struct FormatCounter
+{
+    static inline int formatted = 0;
+};
+
+template <>
+struct fmt::formatter<FormatCounter> : fmt::formatter<int>
+{
+    auto format(const FormatCounter&, fmt::format_context& ctx) const
+    {
+        return fmt::formatter<int>::format(++FormatCounter::formatted, ctx);
+    }
+};
+
+TEST_CASE_METHOD(SinkFixture, "Severity macros do not evaluate arguments of rejected entries", "[filter]")
+{
+    int evaluated = 0;
+    auto expensive = [&evaluated]() { return ++evaluated; };
+
+    chan.set_severity_level(Severity::Info);
+    klog_debug(chan).msg("{}", expensive());
+    REQUIRE(evaluated == 0);
+    klog_info(chan).uid("Macro").msg("{}", expensive());
+    REQUIRE(evaluated == 1);
+    REQUIRE(sink->e_.severity == Severity::Info);
+    REQUIRE(sink->e_.uid_text == "Macro");
+    REQUIRE(sink->e_.message == "1");
+
+    // A null channel is accepted like with klog()
+    const Channel* null_channel = nullptr;
+    klog_error(null_channel).msg("{}", expensive());
+    REQUIRE(evaluated == 1);
+}
+
+TEST_CASE_METHOD(SinkFixture, "Entries rejected by the severity threshold are not formatted", "[filter]")
+{
+    FormatCounter::formatted = 0;
+    chan.set_severity_level(Severity::Warn);
+    REQUIRE(chan.get_severity_level() == Severity::Warn);
+    klog(chan).info("{}", FormatCounter{});
+    REQUIRE(FormatCounter::formatted == 0);
+    klog(chan).warn("{}", FormatCounter{});
+    REQUIRE(FormatCounter::formatted == 1);
+}
+
+TEST_CASE_METHOD(SinkFixture, "UID filtering", "[filter]")
+{
+    FormatCounter::formatted = 0;
+
+    SECTION("Whitelist")
+    {
+        chan.set_uid_filter_mode(UIDFilterMode::Whitelist);
+        chan.set_uid_filter("Allowed"_h);
+        REQUIRE(chan.accepts(Severity::Info, "Allowed"_h));
+        REQUIRE_FALSE(chan.accepts(Severity::Info, "Other"_h));
+        // Entries without UID or more severe than Info always pass
+        REQUIRE(chan.accepts(Severity::Info));
+        REQUIRE(chan.accepts(Severity::Warn, "Other"_h));
+
+        klog(chan).uid("Other").info("{}", FormatCounter{});
+        REQUIRE(FormatCounter::formatted == 0);
+        klog(chan).uid("Allowed").info("{}", FormatCounter{});
+        REQUIRE(FormatCounter::formatted == 1);
+        REQUIRE(sink->e_.uid_text == "Allowed");
+
+        chan.set_uid_filter("Allowed"_h, false);
+        REQUIRE_FALSE(chan.accepts(Severity::Info, "Allowed"_h));
+    }
+
+    SECTION("Blacklist")
+    {
+        chan.set_uid_filter_mode(UIDFilterMode::Blacklist);
+        chan.set_uid_filter("Noisy"_h);
+        REQUIRE_FALSE(chan.accepts(Severity::Debug, "Noisy"_h));
+        REQUIRE(chan.accepts(Severity::Debug, "Quiet"_h));
+
+        klog(chan).uid("Noisy").debug("{}", FormatCounter{});
+        REQUIRE(FormatCounter::formatted == 0);
+
+        chan.clear_uid_filter();
+        klog(chan).uid("Noisy").debug("{}", FormatCounter{});
+        REQUIRE(FormatCounter::formatted == 1);
+    }
+}
+
+class BinaryLogFixture
+{
+public:
+    BinaryLogFixture() : chan(Severity::Verbose, "binary", "bin", kb::col::aliceblue)
+    {
+        std::filesystem::remove_all(directory);
+        Channel::exit_on_fatal_error(false);
+    }
+
+    ~BinaryLogFixture()
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::vector<binlog::EntryView> query(const binlog::SegmentReader& reader, const binlog::Query& q = {})
+    {
+        std::vector<binlog::EntryView> entries;
+        reader.for_each(q, [&entries](const binlog::EntryView& e) { entries.push_back(e); });
+        return entries;
+    }
+
+protected:
+    const std::filesystem::path directory = "/tmp/kibble_test_binlog";
+    Channel chan;
+};
+
+TEST_CASE_METHOD(BinaryLogFixture, "Binary log round trip", "[binlog]")
+{
+    {
+        // The segment is closed when the sink is destroyed, along with the channel
+        Channel local(Severity::Verbose, "binary", "bin", kb::col::aliceblue);
+        local.attach_sink(std::make_shared<BinaryFileSink>(directory, "test"));
+        for (size_t ii = 0; ii < 1000; ++ii)
+        {
+            klog(local).uid(ii % 2 ? "Odd" : "Even").level(ii % 10 ? Severity::Info : Severity::Error).msg("#{}", ii);
+        }
+    }
+
+    auto segments = binlog::list_segments(directory);
+    REQUIRE(segments.size() == 1);
+
+    binlog::SegmentReader reader;
+    REQUIRE(reader.open(segments[0]));
+    REQUIRE(reader.has_index());
+    REQUIRE(reader.get_block_count() == 4);
+
+    auto entries = query(reader);
+    REQUIRE(entries.size() == 1000);
+    REQUIRE(entries[3].message == "#3");
+    REQUIRE(entries[3].header.severity == Severity::Info);
+    REQUIRE(reader.string(entries[3].header.uid) == "Odd");
+
+    const auto* channel = reader.channel(entries[3].header.channel);
+    REQUIRE(channel != nullptr);
+    REQUIRE(channel->name == "binary");
+    REQUIRE(channel->tag == "bin");
+    REQUIRE(channel->color == kb::col::aliceblue.value);
+
+    const auto* location = reader.location(entries[3].header.location);
+    REQUIRE(location != nullptr);
+    REQUIRE(std::string_view(location->file_name) == __FILE__);
+
+    binlog::Query q;
+    q.level = Severity::Error;
+    REQUIRE(query(reader, q).size() == 100);
+    q.uid = "Odd"_h;
+    REQUIRE(query(reader, q).empty());
+    q.uid = "Even"_h;
+    REQUIRE(query(reader, q).size() == 100);
+
+    binlog::Query time_range;
+    time_range.min_ns = entries[300].header.timestamp_ns;
+    time_range.max_ns = entries[310].header.timestamp_ns;
+    auto in_range = query(reader, time_range);
+    REQUIRE(in_range.size() >= 11);
+    for (const auto& e : in_range)
+    {
+        REQUIRE(e.header.timestamp_ns >= time_range.min_ns);
+        REQUIRE(e.header.timestamp_ns <= time_range.max_ns);
+    }
+
+    binlog::Query other_channel;
+    other_channel.channel = "other"_h;
+    REQUIRE(query(reader, other_channel).empty());
+}
+
+TEST_CASE_METHOD(BinaryLogFixture, "Binary log segments", "[binlog]")
+{
+    auto sink = std::make_shared<BinaryFileSink>(directory, "test", 4096);
+    chan.attach_sink(sink);
+    for (size_t ii = 0; ii < 500; ++ii)
+    {
+        klog(chan).uid("Segment").info("Message #{}", ii);
+    }
+    REQUIRE(sink->get_segment() > 1);
+
+    SECTION("Segments are self-contained")
+    {
+        // Only closed segments, the current one may not be flushed yet
+        size_t count = 0;
+        for (uint32_t segment = 0; segment < sink->get_segment(); ++segment)
+        {
+            binlog::SegmentReader reader;
+            REQUIRE(reader.open(binlog::segment_path(directory, "test", segment)));
+            REQUIRE(reader.has_index());
+            for (const auto& e : query(reader))
+            {
+                REQUIRE(e.message == fmt::format("Message #{}", count++));
+                REQUIRE(reader.string(e.header.uid) == "Segment");
+                REQUIRE(reader.channel(e.header.channel) != nullptr);
+            }
+        }
+        REQUIRE(count > 0);
+        REQUIRE(count < 500);
+    }
+
+    SECTION("A segment without trailer is readable")
+    {
+        sink->flush();
+        auto last = binlog::segment_path(directory, "test", sink->get_segment());
+        auto copy = directory / "truncated.klog";
+        std::filesystem::copy_file(last, copy);
+        // Cut the last record in the middle
+        std::filesystem::resize_file(copy, std::filesystem::file_size(copy) - 3);
+
+        binlog::SegmentReader reader;
+        REQUIRE(reader.open(copy));
+        REQUIRE_FALSE(reader.has_index());
+        auto entries = query(reader);
+        REQUIRE(!entries.empty());
+        REQUIRE(entries.back().message == "Message #498");
+    }
+
+    SECTION("A segment with an out of range location id is rejected")
+    {
+        sink->flush();
+        auto last = binlog::segment_path(directory, "test", sink->get_segment());
+        auto copy = directory / "corrupt.klog";
+        std::filesystem::copy_file(last, copy);
+
+        // Location record: id, line, file hash, function hash
+        std::ofstream ofs(copy, std::ios::binary | std::ios::app);
+        auto type = binlog::RecordType::Location;
+        uint32_t size = 2 * sizeof(uint32_t) + 2 * sizeof(kb::hash_t);
+        uint32_t id = 0xfffffff0;
+        uint32_t line = 42;
+        kb::hash_t hash = 0;
+        ofs.write(reinterpret_cast<const char*>(&type), sizeof(type));
+        ofs.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        ofs.write(reinterpret_cast<const char*>(&id), sizeof(id));
+        ofs.write(reinterpret_cast<const char*>(&line), sizeof(line));
+        ofs.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+        ofs.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+        ofs.close();
+
+        binlog::SegmentReader reader;
+        REQUIRE_FALSE(reader.open(copy));
+    }
+
+    SECTION("A segment with out of range index blocks is rejected")
+    {
+        auto first = binlog::segment_path(directory, "test", 0);
+        auto copy = directory / "corrupt.klog";
+        std::filesystem::copy_file(first, copy);
+
+        std::fstream fs(copy, std::ios::binary | std::ios::in | std::ios::out);
+        binlog::Trailer trailer;
+        fs.seekg(-std::streamoff(sizeof(trailer)), std::ios::end);
+        fs.read(reinterpret_cast<char*>(&trailer), sizeof(trailer));
+        binlog::IndexBlock block;
+        auto block_pos = std::streamoff(trailer.index_offset + binlog::k_record_prefix_size);
+        fs.seekg(block_pos);
+        fs.read(reinterpret_cast<char*>(&block), sizeof(block));
+        block.offset = uint64_t(1) << 40;
+        fs.seekp(block_pos);
+        fs.write(reinterpret_cast<const char*>(&block), sizeof(block));
+        fs.close();
+
+        binlog::SegmentReader reader;
+        REQUIRE_FALSE(reader.open(copy));
+    }
+
+    SECTION("Numbering continues after existing segments")
+    {
+        uint32_t segment = sink->get_segment();
+        BinaryFileSink other(directory, "test");
+        REQUIRE(other.get_segment() == segment + 1);
+    }
+}
+
+class RotatingFixture
+{
+public:
+    RotatingFixture() : chan(Severity::Verbose, "rotating", "rot", kb::col::aliceblue)
+    {
+        std::filesystem::remove_all(directory);
+        Channel::exit_on_fatal_error(false);
+        config.buffer_size = 1024;
+        config.buffer_count = 4;
+        config.flush_interval = std::chrono::milliseconds(10000);
+    }
+
+    ~RotatingFixture()
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::vector<std::filesystem::path> list_files()
+    {
+        std::vector<std::filesystem::path> files;
+        for (const auto& file : std::filesystem::directory_iterator(directory))
+        {
+            files.push_back(file.path());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::string read_all()
+    {
+        std::string content;
+        for (const auto& path : list_files())
+        {
+            std::ifstream ifs(path);
+            content.append(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        }
+        return content;
+    }
+
+protected:
+    const std::filesystem::path directory = "/tmp/kibble_test_rotating";
+    RotatingFileSink::Config config;
+    Channel chan;
+};
+
+TEST_CASE_METHOD(RotatingFixture, "Rotating file sink batches writes and rotates by size", "[rotating]")
+{
+    config.max_file_size = 8192;
+    auto sink = std::make_shared<RotatingFileSink>(directory, "test", config);
+    chan.attach_sink(sink);
+    for (size_t ii = 0; ii < 500; ++ii)
+    {
+        klog(chan).info("Message #{}", ii);
+    }
+
+    // Nothing is written until all the buffers are full
+    REQUIRE(sink->get_write_count() < 50);
+    sink->flush();
+    REQUIRE(read_all().size() == sink->get_bytes_written());
+
+    auto files = list_files();
+    REQUIRE(files.size() > 1);
+    for (const auto& path : files)
+    {
+        REQUIRE(std::filesystem::file_size(path) <= config.max_file_size);
+    }
+
+    auto content = read_all();
+    size_t pos = 0;
+    for (size_t ii = 0; ii < 500; ++ii)
+    {
+        pos = content.find(fmt::format("Message #{}\n", ii), pos);
+        REQUIRE(pos != std::string::npos);
+    }
+}
+
+TEST_CASE_METHOD(RotatingFixture, "Rotating file sink entries larger than a buffer", "[rotating]")
+{
+    auto sink = std::make_shared<RotatingFileSink>(directory, "test", config);
+    chan.attach_sink(sink);
+    std::string large(3000, 'x');
+    klog(chan).info("before");
+    klog(chan).info(large);
+    klog(chan).info("after");
+    sink->flush();
+
+    auto content = read_all();
+    REQUIRE(content.find(large + "\n") != std::string::npos);
+    REQUIRE(content.find("before") < content.find(large));
+    REQUIRE(content.find("after") > content.find(large));
+}
+
+TEST_CASE_METHOD(RotatingFixture, "Rotating file sink writes errors right away", "[rotating]")
+{
+    config.durability = Durability::OnError;
+    auto sink = std::make_shared<RotatingFileSink>(directory, "test", config);
+    chan.attach_sink(sink);
+    klog(chan).info("buffered");
+    REQUIRE(std::filesystem::file_size(sink->get_current_path()) == 0);
+    klog(chan).error("durable");
+    REQUIRE(std::filesystem::file_size(sink->get_current_path()) == sink->get_bytes_written());
+    REQUIRE(sink->get_write_error_count() == 0);
+}
+
+TEST_CASE_METHOD(RotatingFixture, "Rotating file sink flushes when idle", "[rotating]")
+{
+    config.flush_interval = std::chrono::milliseconds(200);
+    auto sink = std::make_shared<RotatingFileSink>(directory, "test", config);
+    chan.attach_sink(sink);
+    klog(chan).info("idle");
+    REQUIRE(std::filesystem::file_size(sink->get_current_path()) == 0);
+
+    // No other entry is submitted, the timer thread writes the buffers
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::filesystem::file_size(sink->get_current_path()) == 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE(std::filesystem::file_size(sink->get_current_path()) == sink->get_bytes_written());
+}
+
+TEST_CASE_METHOD(RotatingFixture, "Rotating file sink compresses closed files", "[rotating]")
+{
+    if (!RotatingFileSink::is_supported(Compression::Zstd))
+    {
+        WARN("Built without zstd");
+        return;
+    }
+
+    config.compression = Compression::Zstd;
+    {
+        auto sink = std::make_shared<RotatingFileSink>(directory, "test", config);
+        Channel local(Severity::Verbose, "rotating", "rot", kb::col::aliceblue);
+        local.attach_sink(sink);
+        klog(local).info("first file");
+        sink->rotate();
+        klog(local).info("second file");
+        // Destroying the sink closes the last file and waits for the compression thread
+    }
+
+    auto files = list_files();
+    REQUIRE(files.size() == 2);
+    for (const auto& path : files)
+    {
+        REQUIRE(path.extension() == ".zst");
+        std::ifstream ifs(path, std::ios::binary);
+        uint32_t magic = 0;
+        ifs.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        REQUIRE(magic == 0xfd2fb528);
+    }
+
+    // Numbering continues after the compressed files
+    RotatingFileSink sink(directory, "test", config);
+    REQUIRE(sink.get_current_path().filename() == "test.000002.log");
+}
+
+/*
+    Loopback log collector: accepts connections one after the other, and stores everything received on each of them.
+    The first connection can be closed by the collector as soon as it has received a given marker.
+*/
+class Collector
+{
+public:
+    Collector(uint16_t port, size_t connections, const std::string& close_marker = "") : acceptor_(port, "127.0.0.1")
+    {
+        REQUIRE(acceptor_.start());
+        thread_ = std::thread([this, connections, close_marker]() {
+            for (size_t ii = 0; ii < connections; ++ii)
+            {
+                std::unique_ptr<kb::net::TCPStream> stream(acceptor_.accept());
+                std::string data;
+                char buffer[4096];
+                ssize_t count = 0;
+                while ((count = stream->receive(buffer, sizeof(buffer))) > 0)
+                {
+                    data.append(buffer, size_t(count));
+                    if (ii == 0 && !close_marker.empty() && data.find(close_marker) != std::string::npos)
+                    {
+                        first_closed.store(true);
+                        break;
+                    }
+                }
+                received.push_back(data);
+            }
+        });
+    }
+
+    std::vector<std::string> join()
+    {
+        thread_.join();
+        return received;
+    }
+
+    std::atomic<bool> first_closed{false};
+
+private:
+    kb::net::TCPAcceptor acceptor_;
+    std::thread thread_;
+    std::vector<std::string> received;
+};
+
+template <typename PredicateT>
+static bool wait_until(PredicateT&& predicate)
+{
+    for (size_t ii = 0; ii < 500 && !predicate(); ++ii)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return predicate();
+}
+
+TEST_CASE("NetSink sends batches to a loopback collector", "[net]")
+{
+    constexpr uint16_t k_port = 45821;
+    Collector collector(k_port, 1);
+    std::string expected = "hello net\n";
+    {
+        Channel local(Severity::Verbose, "net", "net", kb::col::aliceblue);
+        auto sink = std::make_shared<NetSink>();
+        sink->set_on_attach_callback(
+            [](const Channel& chan) { return fmt::format("hello {}\n", chan.get_presentation().full_name); });
+        sink->set_on_destroy_callback([]() { return std::string("bye\n"); });
+        REQUIRE(sink->connect("127.0.0.1", k_port));
+        local.attach_sink(sink);
+
+        for (size_t ii = 0; ii < 1000; ++ii)
+        {
+            klog(local).info("Message #{}", ii);
+            expected += fmt::format("Message #{}\n", ii);
+        }
+        sink->flush();
+        REQUIRE(sink->get_queued_bytes() == 0);
+        REQUIRE(sink->get_dropped_bytes() == 0);
+        REQUIRE(sink->get_sent_bytes() == expected.size());
+    }
+    expected += "bye\n";
+
+    auto received = collector.join();
+    REQUIRE(received.size() == 1);
+    REQUIRE(received[0] == expected);
+}
+
+TEST_CASE("NetSink drops entries while disconnected and reconnects", "[net]")
+{
+    constexpr uint16_t k_port = 45822;
+    NetSink::Config config;
+    config.buffer_size = 1024;
+    config.min_backoff = std::chrono::milliseconds(10);
+    config.max_backoff = std::chrono::milliseconds(50);
+
+    std::unique_ptr<Collector> collector;
+    std::string expected;
+    {
+        Channel local(Severity::Verbose, "net", "net", kb::col::aliceblue);
+        auto sink = std::make_shared<NetSink>(config);
+        // Nobody is listening yet
+        REQUIRE_FALSE(sink->connect("127.0.0.1", k_port));
+        local.attach_sink(sink);
+
+        size_t total = 0;
+        for (size_t ii = 0; ii < 200; ++ii)
+        {
+            auto line = fmt::format("Message #{}\n", ii);
+            klog(local).info("Message #{}", ii);
+            total += line.size();
+            // New entries are dropped when the buffer is full
+            if (expected.size() + line.size() <= config.buffer_size)
+            {
+                expected += line;
+            }
+        }
+        REQUIRE(sink->get_dropped_count() > 0);
+        REQUIRE(sink->get_queued_bytes() == expected.size());
+        REQUIRE(sink->get_queued_bytes() + sink->get_dropped_bytes() == total);
+
+        // The I/O thread connects as soon as the collector is up, and sends the buffered entries
+        collector = std::make_unique<Collector>(k_port, 1);
+        REQUIRE(wait_until([&sink]() { return sink->get_connection_count() == 1; }));
+        sink->flush();
+        REQUIRE(sink->get_queued_bytes() == 0);
+    }
+
+    auto received = collector->join();
+    REQUIRE(received.size() == 1);
+    REQUIRE(received[0] == expected);
+}
+
+TEST_CASE("NetSink reconnects when the connection is closed by the server", "[net]")
+{
+    constexpr uint16_t k_port = 45823;
+    NetSink::Config config;
+    config.min_backoff = std::chrono::milliseconds(10);
+    config.max_backoff = std::chrono::milliseconds(50);
+    config.flush_interval = std::chrono::milliseconds(5);
+
+    Collector collector(k_port, 2, "close\n");
+    {
+        Channel local(Severity::Verbose, "net", "net", kb::col::aliceblue);
+        auto sink = std::make_shared<NetSink>(config);
+        sink->set_on_attach_callback([](const Channel&) { return std::string("hello\n"); });
+        REQUIRE(sink->connect("127.0.0.1", k_port));
+        local.attach_sink(sink);
+
+        klog(local).info("close");
+        sink->flush();
+        REQUIRE(wait_until([&collector]() { return collector.first_closed.load(); }));
+
+        // The I/O thread only notices the closed connection when a send fails
+        REQUIRE(wait_until([&]() {
+            klog(local).info("ping");
+            return sink->get_connection_count() == 2;
+        }));
+        klog(local).info("final");
+        sink->flush();
+    }
+
+    auto received = collector.join();
+    REQUIRE(received.size() == 2);
+    REQUIRE(received[0].starts_with("hello\nclose\n"));
+    // The handshake is sent again on the new connection, before any entry
+    REQUIRE(received[1].starts_with("hello\n"));
+    REQUIRE(received[1].ends_with("final\n"));
+}
+
+class RateLimitFixture
+{
+public:
+    RateLimitFixture() : chan(Severity::Verbose, "test", "tst", kb::col::aliceblue), sink(new CountingSink)
+    {
+        chan.attach_sink(sink);
+        Channel::exit_on_fatal_error(false);
+        FormatCounter::formatted = 0;
+    }
+
+    ~RateLimitFixture()
+    {
+        Channel::set_deferred_formatting(false);
+    }
+
+    void attach_policy(const RateLimitPolicy::Config& config)
+    {
+        policy = std::make_shared<RateLimitPolicy>(chan, config);
+        chan.attach_policy(policy);
+    }
+
+protected:
+    Channel chan;
+    std::shared_ptr<CountingSink> sink;
+    std::shared_ptr<RateLimitPolicy> policy;
+};
+
+TEST_CASE_METHOD(RateLimitFixture, "Rate limiting suppresses entries before formatting", "[ratelimit]")
+{
+    RateLimitPolicy::Config config;
+    config.rate = 1;
+    config.burst = 10;
+    config.summary_interval = std::chrono::milliseconds(0);
+    attach_policy(config);
+
+    for (size_t ii = 0; ii < 1000; ++ii)
+    {
+        klog(chan).info("{}", FormatCounter{});
+    }
+    // Only the burst gets through, suppressed entries are not formatted
+    REQUIRE(sink->messages.size() == 10);
+    REQUIRE(FormatCounter::formatted == 10);
+    REQUIRE(policy->get_suppressed_count() == 990);
+
+    // Other call sites have their own bucket
+    klog(chan).info("elsewhere");
+    REQUIRE(sink->messages.back() == "elsewhere");
+
+    policy->emit_summaries();
+    REQUIRE(sink->messages.back() == "990 entries suppressed by rate limiting");
+    policy->emit_summaries();
+    REQUIRE(sink->messages.size() == 12);
+}
+
+TEST_CASE_METHOD(RateLimitFixture, "Fatal entries are never suppressed", "[ratelimit]")
+{
+    RateLimitPolicy::Config config;
+    config.rate = 1;
+    config.burst = 1;
+    attach_policy(config);
+
+    for (size_t ii = 0; ii < 10; ++ii)
+    {
+        klog(chan).fatal("fatal");
+    }
+    REQUIRE(sink->messages.size() == 10);
+    REQUIRE(policy->get_suppressed_count() == 0);
+    REQUIRE(policy->get_repeat_count() == 0);
+}
+
+TEST_CASE_METHOD(RateLimitFixture, "Repeated messages are collapsed", "[ratelimit]")
+{
+    RateLimitPolicy::Config config;
+    config.burst = 1000;
+    config.summary_interval = std::chrono::milliseconds(0);
+    attach_policy(config);
+
+    bool deferred = GENERATE(false, true);
+    Channel::set_deferred_formatting(deferred);
+
+    for (int ii = 0; ii < 12; ++ii)
+    {
+        klog(chan).info("value: {}", ii < 5 ? 42 : ii);
+    }
+
+    std::vector<std::string> expected = {"value: 42", "last message repeated 4 times"};
+    for (int ii = 5; ii < 12; ++ii)
+    {
+        expected.push_back(fmt::format("value: {}", ii));
+    }
+    REQUIRE(sink->messages == expected);
+    REQUIRE(policy->get_repeat_count() == 4);
+}
+
+TEST_CASE_METHOD(RateLimitFixture, "Periodic suppression summaries", "[ratelimit]")
+{
+    RateLimitPolicy::Config config;
+    config.summary_interval = std::chrono::milliseconds(20);
+    attach_policy(config);
+
+    for (size_t ii = 0; ii < 10; ++ii)
+    {
+        klog(chan).warn("flood");
+    }
+    REQUIRE(sink->messages.size() == 1);
+
+    // The next entry that goes through the policy after the interval reports the pending repeats first
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    klog(chan).info("later");
+    REQUIRE(sink->messages.size() == 3);
+    REQUIRE(sink->messages[1] == "last message repeated 9 times");
+    REQUIRE(sink->messages[2] == "later");
+}
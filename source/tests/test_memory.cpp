@@ -1,20 +1,37 @@
 #include "fmt/core.h"
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "kibble/memory/allocator/linear_allocator.h"
 #include "kibble/memory/allocator/pool_allocator.h"
+#include "kibble/memory/allocator/slab_allocator.h"
+#include "kibble/memory/allocator/stack_allocator.h"
+#include "kibble/memory/allocator/thread_cached_tlsf_allocator.h"
 #include "kibble/memory/allocator/tlsf/impl/bit.h"
 #include "kibble/memory/allocator/tlsf_allocator.h"
 #include "kibble/memory/arena.h"
+#include "kibble/memory/arena_allocator.h"
+#include "kibble/memory/arena_stats.h"
+#include "kibble/memory/frame_arena.h"
 #include "kibble/memory/heap_area.h"
 #include "kibble/memory/policy/bounds_checking_simple.h"
+#include "kibble/memory/policy/memory_tracking_sampling.h"
 #include "kibble/memory/policy/memory_tracking_simple.h"
 #include "kibble/memory/policy/memory_tracking_verbose.h"
+#include "kibble/memory/policy/thread_guard_multi_thread.h"
+#include "kibble/memory/util/alignment.h"
 #include "kibble/memory/util/literals.h"
 #include "kibble/string/string.h"
+#include "kibble/thread/job/job_system.h"
+#include "kibble/util/unordered_dense.h"
 
 #include <catch2/catch_all.hpp>
 
@@ -86,6 +103,17 @@ using PoolArena =
 using TLSFArena =
     memory::MemoryArena<memory::TLSFAllocator, memory::policy::SingleThread, memory::policy::SimpleBoundsChecking,
                         memory::policy::NoMemoryTagging, memory::policy::SimpleMemoryTracking>;
+using LockFreePoolArena =
+    memory::MemoryArena<memory::LockFreePoolAllocator, memory::policy::MultiThread<std::mutex>,
+                        memory::policy::SimpleBoundsChecking, memory::policy::NoMemoryTagging,
+                        memory::policy::SimpleMemoryTracking>;
+using SlabArena =
+    memory::MemoryArena<memory::SlabAllocator, memory::policy::SingleThread, memory::policy::SimpleBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::SimpleMemoryTracking>;
+using ThreadCachedTLSFArena =
+    memory::MemoryArena<memory::ThreadCachedTLSFAllocator, memory::policy::MultiThread<std::mutex>,
+                        memory::policy::SimpleBoundsChecking, memory::policy::NoMemoryTagging,
+                        memory::policy::SimpleMemoryTracking>;
 #else
 using LinArena =
     memory::MemoryArena<memory::LinearAllocator, memory::policy::SingleThread, memory::policy::NoBoundsChecking,
@@ -96,6 +124,16 @@ using PoolArena =
 using TLSFArena =
     memory::MemoryArena<memory::TLSFAllocator, memory::policy::SingleThread, memory::policy::NoBoundsChecking,
                         memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+using LockFreePoolArena =
+    memory::MemoryArena<memory::LockFreePoolAllocator, memory::policy::SingleThread, memory::policy::NoBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+using SlabArena =
+    memory::MemoryArena<memory::SlabAllocator, memory::policy::SingleThread, memory::policy::NoBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+using ThreadCachedTLSFArena =
+    memory::MemoryArena<memory::ThreadCachedTLSFAllocator, memory::policy::SingleThread,
+                        memory::policy::NoBoundsChecking, memory::policy::NoMemoryTagging,
+                        memory::policy::NoMemoryTracking>;
 #endif
 
 class LinArenaFixture
@@ -354,6 +392,103 @@ TEST_CASE_METHOD(PoolArenaFixture, "Pool Arena: new/delete POD custom alignment"
     K_DELETE(some_pod, arena);
 }
 
+class LockFreePoolArenaFixture
+{
+public:
+    LockFreePoolArenaFixture() : area(3_kB), arena("LockFreePoolArena", area, 32u, sizeof(POD), 16u)
+    {
+    }
+
+protected:
+    memory::HeapArea area;
+    LockFreePoolArena arena;
+};
+
+TEST_CASE_METHOD(LockFreePoolArenaFixture, "Lock-free Pool Arena: nodes are reused in LIFO order", "[mem][pool]")
+{
+    POD* first = K_NEW(POD, arena);
+    POD* second = K_NEW(POD, arena);
+    REQUIRE(first != second);
+    const size_t node_size = arena.used_size() / 2;
+    REQUIRE(node_size >= sizeof(POD) + LockFreePoolArena::k_allocation_overhead);
+
+    K_DELETE(first, arena);
+    K_DELETE(second, arena);
+    REQUIRE(arena.used_size() == 0);
+
+    // Last released, first reused
+    POD* third = K_NEW(POD, arena);
+    POD* fourth = K_NEW(POD, arena);
+    REQUIRE(third == second);
+    REQUIRE(fourth == first);
+    REQUIRE(arena.used_size() == 2 * node_size);
+    K_DELETE(third, arena);
+    K_DELETE(fourth, arena);
+
+    // The whole capacity is available
+    std::vector<POD*> pods;
+    for (size_t ii = 0; ii < 32; ++ii)
+    {
+        pods.push_back(K_NEW(POD, arena));
+    }
+    std::sort(pods.begin(), pods.end());
+    REQUIRE(std::adjacent_find(pods.begin(), pods.end()) == pods.end());
+    REQUIRE(arena.used_size() == 32 * node_size);
+    for (POD* pod : pods)
+    {
+        K_DELETE(pod, arena);
+    }
+}
+
+TEST_CASE_METHOD(LockFreePoolArenaFixture, "Lock-free Pool Arena: concurrent allocations", "[mem][pool][mt]")
+{
+    constexpr size_t k_threads = 8;
+    constexpr size_t k_nodes_per_thread = 4;
+    constexpr size_t k_rounds = 2000;
+    std::vector<std::thread> threads;
+    std::vector<size_t> errors(k_threads, 0);
+
+    for (size_t tid = 0; tid < k_threads; ++tid)
+    {
+        threads.emplace_back([this, tid, &errors]() {
+            POD* pods[k_nodes_per_thread];
+            for (size_t round = 0; round < k_rounds; ++round)
+            {
+                // Nobody else may hold the same node at the same time
+                for (auto& pod : pods)
+                {
+                    pod = K_NEW(POD, arena);
+                    pod->a = uint32_t(tid);
+                    pod->b = round;
+                }
+                std::this_thread::yield();
+                for (auto& pod : pods)
+                {
+                    errors[tid] += size_t(pod->a != tid || pod->b != round);
+                    K_DELETE(pod, arena);
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (size_t err : errors)
+    {
+        REQUIRE(err == 0);
+    }
+    REQUIRE(arena.used_size() == 0);
+
+    // Counters are updated atomically when the allocator is not guarded
+    auto stats = arena.get_stats();
+    REQUIRE(stats.alloc_count == k_threads * k_nodes_per_thread * k_rounds);
+    REQUIRE(stats.free_count == stats.alloc_count);
+    REQUIRE(stats.live_size == 0);
+}
+
 class TLSFArenaFixture
 {
 public:
@@ -854,4 +989,982 @@ TEST_CASE_METHOD(TLSFArenaFixture, "non-POD array allocation / deallocation", "[
     check_integrity();
 
     REQUIRE(dtor_calls == N);
-}
\ No newline at end of file
+}
+
+TEST_CASE_METHOD(TLSFArenaFixture, "arena reallocation in place", "[mem][tlsf][realloc]")
+{
+    using SizeType = TLSFArena::SizeType;
+    auto* data = static_cast<uint8_t*>(arena.allocate(32, 8, 0, __FILE__, __LINE__));
+    std::iota(data, data + 32, uint8_t(0));
+
+    // Next block is free, grow in place
+    auto* grown = static_cast<uint8_t*>(arena.reallocate(data, 256, 8, __FILE__, __LINE__));
+    REQUIRE(grown == data);
+    REQUIRE(*(reinterpret_cast<SizeType*>(grown) - 1) == 256 + TLSFArena::k_allocation_overhead);
+    std::iota(grown + 32, grown + 256, uint8_t(32));
+
+    // Shrink in place
+    auto* shrunk = static_cast<uint8_t*>(arena.reallocate(grown, 64, 8, __FILE__, __LINE__));
+    REQUIRE(shrunk == data);
+    REQUIRE(*(reinterpret_cast<SizeType*>(shrunk) - 1) == 64 + TLSFArena::k_allocation_overhead);
+    for (size_t ii = 0; ii < 64; ++ii)
+    {
+        REQUIRE(shrunk[ii] == uint8_t(ii));
+    }
+    check_integrity();
+
+    // Sentinels were moved, this would trap with bounds checking otherwise
+    arena.deallocate(shrunk, __FILE__, __LINE__);
+    REQUIRE(arena.used_size() == 0);
+    check_integrity();
+}
+
+TEST_CASE_METHOD(TLSFArenaFixture, "arena reallocation with copy", "[mem][tlsf][realloc]")
+{
+    auto* data = static_cast<uint8_t*>(arena.allocate(32, 8, 0, __FILE__, __LINE__));
+    std::iota(data, data + 32, uint8_t(0));
+    // Block the way
+    POD* pod = K_NEW(POD, arena);
+
+    auto* moved = static_cast<uint8_t*>(arena.reallocate(data, 512, 8, __FILE__, __LINE__));
+    REQUIRE(moved != data);
+    for (size_t ii = 0; ii < 32; ++ii)
+    {
+        REQUIRE(moved[ii] == uint8_t(ii));
+    }
+
+    // Null pointer and zero size behave like realloc()
+    void* fresh = arena.reallocate(nullptr, 16, 8, __FILE__, __LINE__);
+    REQUIRE(fresh != nullptr);
+    REQUIRE(arena.reallocate(fresh, 0, 8, __FILE__, __LINE__) == nullptr);
+
+    arena.deallocate(moved, __FILE__, __LINE__);
+    K_DELETE(pod, arena);
+    REQUIRE(arena.used_size() == 0);
+    check_integrity();
+}
+
+// Fills allocated and deallocated memory with recognizable patterns
+struct PatternTagger
+{
+    void tag_allocation(void* begin, size_t size) const
+    {
+        std::memset(begin, 0xaa, size);
+    }
+    void tag_deallocation(void* begin, size_t size) const
+    {
+        std::memset(begin, 0xdd, size);
+    }
+};
+
+TEST_CASE("arena reallocation with memory tagging", "[mem][tlsf][realloc]")
+{
+    using TaggedArena = memory::MemoryArena<memory::TLSFAllocator, memory::policy::SingleThread,
+                                            memory::policy::NoBoundsChecking, PatternTagger,
+                                            memory::policy::NoMemoryTracking>;
+    memory::HeapArea area(10_kB);
+    TaggedArena arena("TaggedArena", area, 2_kB);
+
+    auto* data = static_cast<uint8_t*>(arena.allocate(32, 8, 0, __FILE__, __LINE__));
+    REQUIRE(std::all_of(data, data + 32, [](uint8_t x) { return x == 0xaa; }));
+    std::iota(data, data + 32, uint8_t(0));
+
+    // Grown in place: the data is preserved, only the new bytes are tagged
+    auto* grown = static_cast<uint8_t*>(arena.reallocate(data, 256, 8, __FILE__, __LINE__));
+    REQUIRE(grown == data);
+    for (size_t ii = 0; ii < 32; ++ii)
+    {
+        REQUIRE(grown[ii] == uint8_t(ii));
+    }
+    REQUIRE(std::all_of(grown + 32, grown + 256, [](uint8_t x) { return x == 0xaa; }));
+
+    // Shrunk in place
+    auto* shrunk = static_cast<uint8_t*>(arena.reallocate(grown, 16, 8, __FILE__, __LINE__));
+    REQUIRE(shrunk == data);
+    for (size_t ii = 0; ii < 16; ++ii)
+    {
+        REQUIRE(shrunk[ii] == uint8_t(ii));
+    }
+
+    // Moved
+    auto* blocker = arena.allocate(64, 8, 0, __FILE__, __LINE__);
+    auto* moved = static_cast<uint8_t*>(arena.reallocate(shrunk, 1024, 8, __FILE__, __LINE__));
+    REQUIRE(moved != shrunk);
+    for (size_t ii = 0; ii < 16; ++ii)
+    {
+        REQUIRE(moved[ii] == uint8_t(ii));
+    }
+    REQUIRE(std::all_of(moved + 16, moved + 1024, [](uint8_t x) { return x == 0xaa; }));
+
+    arena.deallocate(moved, __FILE__, __LINE__);
+    arena.deallocate(blocker, __FILE__, __LINE__);
+    REQUIRE(arena.used_size() == 0);
+}
+
+TEST_CASE_METHOD(LinArenaFixture, "arena reallocation fallback", "[mem][lin][realloc]")
+{
+    // The linear allocator can't reallocate, the arena allocates a new chunk and copies
+    auto* data = static_cast<uint8_t*>(arena.allocate(32, 8, 0, __FILE__, __LINE__));
+    std::iota(data, data + 32, uint8_t(0));
+    auto* moved = static_cast<uint8_t*>(arena.reallocate(data, 128, 8, __FILE__, __LINE__));
+    REQUIRE(moved != data);
+    for (size_t ii = 0; ii < 32; ++ii)
+    {
+        REQUIRE(moved[ii] == uint8_t(ii));
+    }
+    arena.deallocate(moved, __FILE__, __LINE__);
+}
+
+TEST_CASE_METHOD(TLSFArenaFixture, "standard containers in an arena", "[mem][tlsf][realloc]")
+{
+    {
+        std::vector<uint64_t, memory::ArenaAllocator<uint64_t>> vec{memory::ArenaAllocator<uint64_t>(arena)};
+        for (uint64_t ii = 0; ii < 32; ++ii)
+        {
+            vec.push_back(ii);
+        }
+        REQUIRE(vec[31] == 31);
+        REQUIRE(arena.used_size() > 32 * sizeof(uint64_t));
+
+        using Map = ankerl::unordered_dense::map<uint32_t, uint32_t, ankerl::unordered_dense::hash<uint32_t>,
+                                                 std::equal_to<uint32_t>,
+                                                 memory::ArenaAllocator<std::pair<uint32_t, uint32_t>>>;
+        Map map{memory::ArenaAllocator<std::pair<uint32_t, uint32_t>>(arena)};
+        for (uint32_t ii = 0; ii < 16; ++ii)
+        {
+            map[ii] = 2 * ii;
+        }
+        REQUIRE(map.at(12) == 24);
+    }
+    REQUIRE(arena.used_size() == 0);
+
+    // Growable buffer of trivial data
+    memory::ArenaAllocator<uint32_t> allocator(arena);
+    uint32_t* buffer = allocator.allocate(8);
+    std::iota(buffer, buffer + 8, 0u);
+    uint32_t* grown = allocator.reallocate(buffer, 64);
+    REQUIRE(grown == buffer);
+    REQUIRE(grown[7] == 7);
+    allocator.deallocate(grown, 64);
+
+    REQUIRE(arena.used_size() == 0);
+    check_integrity();
+}
+
+class SlabArenaFixture
+{
+public:
+    SlabArenaFixture() : area(4_MB), arena("SlabArena", area, 2_MB, 512_kB)
+    {
+    }
+
+protected:
+    memory::HeapArea area;
+    SlabArena arena;
+    size_t ctor_calls{0};
+    size_t dtor_calls{0};
+};
+
+TEST_CASE("Slab size classes", "[mem][slab]")
+{
+    using memory::SlabAllocator;
+    REQUIRE(SlabAllocator::size_class(0) == 0);
+    REQUIRE(SlabAllocator::size_class(8) == 0);
+    REQUIRE(SlabAllocator::size_class(9) == 1);
+    REQUIRE(SlabAllocator::size_class(40) == 4);
+    REQUIRE(SlabAllocator::size_class(4096) == SlabAllocator::k_class_count - 1);
+    REQUIRE(SlabAllocator::size_class(4097) == SlabAllocator::k_class_count);
+
+    // Smallest class that fits, for every size
+    for (size_t size = 1; size <= SlabAllocator::k_max_size; ++size)
+    {
+        uint32_t cls = SlabAllocator::size_class(size);
+        REQUIRE(SlabAllocator::k_class_sizes[cls] >= size);
+        REQUIRE((cls == 0 || SlabAllocator::k_class_sizes[cls - 1] < size));
+    }
+}
+
+TEST_CASE_METHOD(SlabArenaFixture, "Slab Arena: mixed size allocations", "[mem][slab]")
+{
+    std::vector<std::pair<uint8_t*, size_t>> blocks;
+    for (size_t ii = 0; ii < 500; ++ii)
+    {
+        size_t size = 1 + (ii * 97) % 3000;
+        auto* bytes = K_NEW_ARRAY_DYNAMIC(uint8_t, size, arena);
+        std::memset(bytes, int(ii & 0xff), size);
+        blocks.push_back({bytes, size});
+    }
+
+    for (size_t ii = 0; ii < blocks.size(); ++ii)
+    {
+        auto [bytes, size] = blocks[ii];
+        REQUIRE(std::count(bytes, bytes + size, uint8_t(ii & 0xff)) == std::ptrdiff_t(size));
+        K_DELETE_ARRAY(bytes, arena);
+    }
+    REQUIRE(arena.used_size() == 0);
+}
+
+TEST_CASE_METHOD(SlabArenaFixture, "Slab Arena: non-POD and aligned allocations", "[mem][slab]")
+{
+    NonPOD* obj = K_NEW(NonPOD, arena)(&ctor_calls, &dtor_calls, 8, 42);
+    REQUIRE(obj->data[7] == 42);
+    K_DELETE(obj, arena);
+    REQUIRE(ctor_calls == dtor_calls);
+
+    for (size_t alignment = 8; alignment <= 256; alignment *= 2)
+    {
+        POD* pod = K_NEW_ALIGN(POD, arena, alignment);
+        REQUIRE(size_t(pod) % alignment == 0);
+        set_POD(pod);
+        K_DELETE(pod, arena);
+    }
+    REQUIRE(arena.used_size() == 0);
+}
+
+TEST_CASE("Slab Arena: aligned allocations without fallback", "[mem][slab]")
+{
+    // No TLSF fallback, every aligned request must be served by the slab despite the arena front overhead
+    memory::HeapArea area(4_MB);
+    SlabArena arena("SlabArena", area, 2_MB);
+
+    std::vector<std::tuple<uint8_t*, size_t, uint8_t>> blocks;
+    for (size_t alignment : std::array<size_t, 4>{16, 32, 64, 256})
+    {
+        for (size_t size : std::array<size_t, 7>{1, 8, 16, 24, 40, 100, 1000})
+        {
+            auto* bytes = static_cast<uint8_t*>(arena.allocate(size, alignment, 0, __FILE__, __LINE__));
+            REQUIRE(bytes != nullptr);
+            REQUIRE(size_t(bytes) % alignment == 0);
+            auto pattern = uint8_t(blocks.size());
+            std::memset(bytes, pattern, size);
+            blocks.push_back({bytes, size, pattern});
+        }
+    }
+
+    for (auto [bytes, size, pattern] : blocks)
+    {
+        REQUIRE(std::count(bytes, bytes + size, pattern) == std::ptrdiff_t(size));
+        arena.deallocate(bytes, __FILE__, __LINE__);
+    }
+    REQUIRE(arena.used_size() == 0);
+}
+
+TEST_CASE_METHOD(SlabArenaFixture, "Slab Arena: zero-byte allocations", "[mem][slab]")
+{
+    auto& allocator = arena.get_allocator();
+    std::set<void*> blocks;
+    for (size_t ii = 0; ii < 64; ++ii)
+    {
+        void* block = allocator.allocate(0, 16, 0);
+        REQUIRE(size_t(block) % 16 == 0);
+        REQUIRE(blocks.insert(block).second);
+    }
+    for (void* block : blocks)
+    {
+        allocator.deallocate(block);
+    }
+    REQUIRE(allocator.used_size() == 0);
+}
+
+TEST_CASE_METHOD(SlabArenaFixture, "Slab Arena: pages are shared between size classes", "[mem][slab]")
+{
+    auto& allocator = arena.get_allocator();
+    const size_t free_pages = allocator.free_page_count();
+
+    // Fill the whole slab with small blocks
+    std::vector<POD*> pods;
+    while (allocator.free_page_count() > 0)
+    {
+        pods.push_back(K_NEW(POD, arena));
+    }
+
+    // Larger blocks can't get a page, they go to the TLSF fallback
+    const size_t used_size = allocator.used_size();
+    auto* bytes = K_NEW_ARRAY_DYNAMIC(uint8_t, 1000, arena);
+    REQUIRE(allocator.free_page_count() == 0);
+    REQUIRE(allocator.used_size() > used_size);
+    K_DELETE_ARRAY(bytes, arena);
+
+    // Empty pages go back to the free page stack, except for the last one of the class
+    for (POD* pod : pods)
+    {
+        K_DELETE(pod, arena);
+    }
+    REQUIRE(allocator.free_page_count() == free_pages - 1);
+    REQUIRE(arena.used_size() == 0);
+
+    // And they can be reused by another class
+    bytes = K_NEW_ARRAY_DYNAMIC(uint8_t, 1000, arena);
+    REQUIRE(allocator.free_page_count() == free_pages - 2);
+    K_DELETE_ARRAY(bytes, arena);
+}
+
+class ThreadCachedTLSFArenaFixture
+{
+public:
+    ThreadCachedTLSFArenaFixture() : area(2_MB), arena("ThreadCachedTLSFArena", area, 1_MB)
+    {
+    }
+
+    void check_integrity()
+    {
+        auto pool_report = arena.get_allocator().get_backend().check_pool();
+        auto consistency_report = arena.get_allocator().get_backend().check_consistency();
+        REQUIRE(pool_report.logs.empty());
+        REQUIRE(consistency_report.logs.empty());
+    }
+
+protected:
+    memory::HeapArea area;
+    ThreadCachedTLSFArena arena;
+};
+
+TEST_CASE_METHOD(ThreadCachedTLSFArenaFixture, "thread-cached allocations from multiple threads", "[mem][tlsf][mt]")
+{
+    constexpr size_t k_threads = 4;
+    constexpr size_t k_rounds = 50;
+    std::vector<std::thread> threads;
+    std::vector<size_t> errors(k_threads, 0);
+
+    for (size_t tid = 0; tid < k_threads; ++tid)
+    {
+        threads.emplace_back([this, tid, &errors]() {
+            std::vector<std::pair<uint8_t*, size_t>> blocks;
+            for (size_t round = 0; round < k_rounds; ++round)
+            {
+                // Small sizes are served by the thread cache, the largest ones by the TLSF pool directly
+                for (size_t size = 1; size < 1500; size += 37)
+                {
+                    auto* bytes = K_NEW_ARRAY_DYNAMIC(uint8_t, size, arena);
+                    std::memset(bytes, int(tid), size);
+                    blocks.push_back({bytes, size});
+                }
+                // Free every other block
+                for (size_t ii = round % 2; ii < blocks.size(); ii += 2)
+                {
+                    auto [bytes, size] = blocks[ii];
+                    errors[tid] += size_t(std::count(bytes, bytes + size, uint8_t(tid)) != std::ptrdiff_t(size));
+                    K_DELETE_ARRAY(bytes, arena);
+                    blocks[ii].first = nullptr;
+                }
+                std::erase_if(blocks, [](const auto& block) { return block.first == nullptr; });
+            }
+            for (auto [bytes, size] : blocks)
+            {
+                K_DELETE_ARRAY(bytes, arena);
+            }
+            arena.get_allocator().flush_thread_cache();
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (size_t err : errors)
+    {
+        REQUIRE(err == 0);
+    }
+    REQUIRE(arena.used_size() == 0);
+    check_integrity();
+}
+
+TEST_CASE_METHOD(ThreadCachedTLSFArenaFixture, "thread-cached blocks freed by another thread", "[mem][tlsf][mt]")
+{
+    constexpr size_t k_count = 200;
+    std::vector<POD*> pods;
+    for (size_t ii = 0; ii < k_count; ++ii)
+    {
+        POD* pod = K_NEW(POD, arena);
+        set_POD(pod);
+        pods.push_back(pod);
+    }
+    size_t used_size = arena.used_size();
+
+    std::thread consumer([this, &pods]() {
+        for (POD* pod : pods)
+        {
+            K_DELETE(pod, arena);
+        }
+    });
+    consumer.join();
+
+    // Blocks freed remotely stay in the owner thread cache, and are reused without touching the TLSF pool
+    REQUIRE(arena.used_size() == used_size);
+    pods.clear();
+    for (size_t ii = 0; ii < k_count; ++ii)
+    {
+        pods.push_back(K_NEW(POD, arena));
+    }
+    REQUIRE(arena.used_size() == used_size);
+
+    for (POD* pod : pods)
+    {
+        K_DELETE(pod, arena);
+    }
+    arena.get_allocator().flush_thread_cache();
+    REQUIRE(arena.used_size() == 0);
+    check_integrity();
+}
+
+TEST_CASE_METHOD(ThreadCachedTLSFArenaFixture, "thread-cached aligned allocations", "[mem][tlsf][mt]")
+{
+    // Stricter alignments bypass the cache
+    for (size_t alignment = 8; alignment <= 128; alignment *= 2)
+    {
+        POD* pod = K_NEW_ALIGN(POD, arena, alignment);
+        REQUIRE(size_t(pod) % alignment == 0);
+        set_POD(pod);
+        K_DELETE(pod, arena);
+    }
+    arena.get_allocator().flush_thread_cache();
+    REQUIRE(arena.used_size() == 0);
+    check_integrity();
+}
+
+TEST_CASE_METHOD(ThreadCachedTLSFArenaFixture, "thread-cached 16B aligned allocations", "[mem][tlsf][mt]")
+{
+    // The offset an arena without bounds checking passes, the block must be shifted to satisfy it
+    constexpr size_t k_offset = 8;
+    auto& allocator = arena.get_allocator();
+    std::vector<uint8_t*> blocks;
+    for (size_t size = 1; size < 1000; size += 37)
+    {
+        auto* block = static_cast<uint8_t*>(allocator.allocate(size, 16, k_offset));
+        REQUIRE(size_t(block + k_offset) % 16 == 0);
+        std::memset(block, 0x42, size);
+        blocks.push_back(block);
+    }
+    for (auto* block : blocks)
+    {
+        allocator.deallocate(block);
+    }
+
+    // The blocks went back to the thread cache, not to the TLSF pool
+    REQUIRE(allocator.used_size() > 0);
+    allocator.flush_thread_cache();
+    REQUIRE(allocator.used_size() == 0);
+    check_integrity();
+}
+
+TEST_CASE_METHOD(ThreadCachedTLSFArenaFixture, "thread-cached blocks of an exited thread", "[mem][tlsf][mt]")
+{
+    constexpr size_t k_count = 200;
+    std::vector<POD*> pods;
+
+    // The thread does not flush its cache, and frees only half of its blocks
+    std::thread producer([this, &pods]() {
+        for (size_t ii = 0; ii < 2 * k_count; ++ii)
+        {
+            POD* pod = K_NEW(POD, arena);
+            set_POD(pod);
+            pods.push_back(pod);
+        }
+        for (size_t ii = k_count; ii < 2 * k_count; ++ii)
+        {
+            K_DELETE(pods[ii], arena);
+        }
+        pods.resize(k_count);
+    });
+    producer.join();
+
+    // Blocks freed after the owner exited go straight back to the TLSF pool
+    for (POD* pod : pods)
+    {
+        K_DELETE(pod, arena);
+    }
+    REQUIRE(arena.used_size() == 0);
+    check_integrity();
+}
+
+TEST_CASE("Virtual memory area commits pages lazily", "[mem][area]")
+{
+    memory::HeapArea::Config config;
+    config.backend = memory::AreaBackend::VirtualMemory;
+    config.commit_granularity = 64_kB;
+    // Reserving a huge area is cheap, as long as it is not touched
+    memory::HeapArea area(8_GB, config);
+    REQUIRE(area.backend() == memory::AreaBackend::VirtualMemory);
+    REQUIRE(area.committed_size() == 0);
+
+    auto [begin, end] = area.require_slab(100_kB, "slab");
+    REQUIRE(area.committed_size() >= 100_kB);
+    REQUIRE(area.committed_size() < 200_kB);
+    std::memset(begin, 0x42, 100_kB);
+
+    // Arenas work the same way on top of it
+    LinArena arena("LinArena", area, 1_MB);
+    REQUIRE(area.committed_size() >= area.used_size());
+    POD* some_pod = K_NEW(POD, arena);
+    set_POD(some_pod);
+    REQUIRE(some_pod->b == 0x0123456789abcdef);
+    K_DELETE(some_pod, arena);
+}
+
+TEST_CASE("Virtual memory area with an out of range NUMA node", "[mem][area]")
+{
+    // The area is not bound, pages are allocated with the default policy
+    memory::HeapArea::Config config;
+    config.backend = memory::AreaBackend::VirtualMemory;
+    config.numa_node = 100;
+    config.populate = true;
+    memory::HeapArea area(1_MB, config);
+    auto [begin, end] = area.require_slab(64_kB, "slab");
+    std::memset(begin, 0x42, 64_kB);
+    REQUIRE(static_cast<uint8_t*>(begin)[64_kB - 1] == 0x42);
+}
+
+TEST_CASE("Virtual memory area releases pages", "[mem][area]")
+{
+    memory::HeapArea::Config config;
+    config.backend = memory::AreaBackend::VirtualMemory;
+    memory::HeapArea area(16_MB, config);
+    auto [begin, end] = area.require_slab(1_MB, "slab");
+    auto* bytes = static_cast<uint8_t*>(begin);
+    std::memset(bytes, 0x42, 1_MB);
+
+    size_t released = area.release(begin, end);
+    REQUIRE(released > 0);
+    REQUIRE(released <= 1_MB);
+    // Only whole pages were released, they read back as zeros
+    size_t offset = memory::alignment_padding(bytes, area.page_size());
+    REQUIRE(bytes[offset] == 0);
+    REQUIRE(bytes[offset + released - 1] == 0);
+    // Memory is still usable
+    bytes[offset] = 0x42;
+    REQUIRE(bytes[offset] == 0x42);
+
+    // Nothing to release on the heap
+    memory::HeapArea heap_area(1_MB);
+    auto [heap_begin, heap_end] = heap_area.require_slab(512_kB);
+    REQUIRE(heap_area.release(heap_begin, heap_end) == 0);
+    REQUIRE(heap_area.committed_size() == heap_area.total_size());
+}
+
+TEST_CASE("Virtual memory area with huge pages", "[mem][area]")
+{
+    memory::HeapArea::Config config;
+    config.backend = memory::AreaBackend::VirtualMemory;
+    config.populate = true;
+
+    // Explicit huge pages fall back to transparent huge pages if the pool is empty
+    for (auto policy : {memory::HugePages::Transparent, memory::HugePages::Explicit})
+    {
+        config.huge_pages = policy;
+        memory::HeapArea area(4_MB, config);
+        REQUIRE(reinterpret_cast<size_t>(area.begin()) % 2_MB == 0);
+        REQUIRE(area.committed_size() >= area.total_size());
+        auto [begin, end] = area.require_slab(3_MB, "slab");
+        std::memset(begin, 0x42, 3_MB);
+    }
+}
+
+TEST_CASE("Stack allocator: markers and nested scopes", "[mem][stack]")
+{
+    memory::HeapArea area(1_kB);
+    auto [begin, end] = area.require_slab(512, "stack");
+    memory::StackAllocator stack(begin, end);
+
+    void* a = stack.allocate(16, 16, 0);
+    REQUIRE(reinterpret_cast<size_t>(a) % 16 == 0);
+    auto marker = stack.get_marker();
+
+    {
+        memory::StackScope scope(stack);
+        void* b = stack.allocate(64, 8, 0);
+        REQUIRE(b != nullptr);
+        size_t inner_used = 0;
+        {
+            memory::StackScope inner(stack);
+            stack.allocate(128, 8, 0);
+            inner_used = stack.used_size();
+        }
+        REQUIRE(stack.used_size() < inner_used);
+        // Memory freed by the inner scope is reused
+        void* c = stack.allocate(64, 8, 0);
+        REQUIRE(c == static_cast<uint8_t*>(b) + 64);
+    }
+    REQUIRE(stack.get_marker() == marker);
+
+    stack.reset();
+    REQUIRE(stack.used_size() == 0);
+    REQUIRE(stack.allocate(16, 16, 0) == a);
+}
+
+using StackArena =
+    memory::MemoryArena<memory::StackAllocator, memory::policy::SingleThread, memory::policy::NoBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::NoMemoryTracking>;
+
+TEST_CASE("Stack arena: scopes over arena allocations", "[mem][stack]")
+{
+    memory::HeapArea area(2_kB);
+    StackArena arena("StackArena", area, 1_kB);
+
+    POD* outer = K_NEW(POD, arena);
+    set_POD(outer);
+    size_t used = arena.get_allocator().used_size();
+    {
+        memory::StackScope scope(arena.get_allocator());
+        POD* pods = K_NEW_ARRAY(POD[4], arena);
+        for (size_t ii = 0; ii < 4; ++ii)
+        {
+            set_POD(&pods[ii]);
+        }
+        REQUIRE(arena.get_allocator().used_size() > used);
+    }
+    REQUIRE(arena.get_allocator().used_size() == used);
+    REQUIRE(outer->b == 0x0123456789abcdef);
+}
+
+TEST_CASE("Frame arena: double buffering", "[mem][frame]")
+{
+    memory::HeapArea area(64_kB);
+    memory::FrameArena frame(area, 2, 4_kB);
+    REQUIRE(frame.get_region_size() == 4_kB);
+
+    // Thread regions are on separate cache lines
+    REQUIRE(frame.current(0).end() <= frame.current(1).begin());
+    REQUIRE(reinterpret_cast<size_t>(frame.current(1).begin()) % memory::k_cache_line_size == 0);
+
+    POD* pod = frame.create<POD>(0);
+    set_POD(pod);
+    int* ints = frame.allocate_array<int>(1, 16);
+    std::iota(ints, ints + 16, 0);
+    REQUIRE(frame.current(0).used_size() >= sizeof(POD));
+
+    // Last frame's data survives one frame
+    frame.swap_buffers();
+    REQUIRE(frame.get_frame_index() == 1);
+    REQUIRE(frame.current(0).used_size() == 0);
+    REQUIRE(frame.previous(0).used_size() >= sizeof(POD));
+    REQUIRE(pod->b == 0x0123456789abcdef);
+    REQUIRE(ints[15] == 15);
+    {
+        auto scope = frame.scope(0);
+        frame.allocate(0, 1_kB);
+        REQUIRE(frame.current(0).used_size() == 1_kB);
+    }
+    REQUIRE(frame.current(0).used_size() == 0);
+
+    // And is freed on the next swap
+    frame.swap_buffers();
+    REQUIRE(frame.current(0).used_size() == 0);
+    REQUIRE(frame.previous(0).used_size() == 0);
+    REQUIRE(frame.create<POD>(0) == pod);
+}
+
+TEST_CASE("Frame arena: per-worker scratch memory in jobs", "[mem][frame][mt]")
+{
+    memory::HeapArea js_area(th::JobSystem::get_memory_requirements({}));
+    th::JobSystem js(js_area, {});
+    memory::HeapArea area(js.get_threads_count() * 128_kB + 1_kB);
+    memory::FrameArena frame(area, js.get_threads_count(), 64_kB);
+
+    constexpr size_t k_jobs = 64;
+    constexpr size_t k_count = 256;
+    std::vector<size_t> sums(k_jobs, 0);
+
+    for (size_t frame_index = 0; frame_index < 3; ++frame_index)
+    {
+        for (size_t ii = 0; ii < k_jobs; ++ii)
+        {
+            auto task = js.create_task(th::detached, {}, [&js, &frame, &sums, ii]() {
+                auto tid = js.this_thread_id();
+                auto scope = frame.scope(tid);
+                size_t* values = frame.allocate_array<size_t>(tid, k_count);
+                std::iota(values, values + k_count, ii);
+                sums[ii] = std::accumulate(values, values + k_count, size_t(0));
+            });
+            task.schedule();
+        }
+        js.wait();
+        frame.swap_buffers();
+
+        for (size_t ii = 0; ii < k_jobs; ++ii)
+        {
+            REQUIRE(sums[ii] == k_count * ii + k_count * (k_count - 1) / 2);
+        }
+    }
+}
+
+using SampledTLSFArena =
+    memory::MemoryArena<memory::TLSFAllocator, memory::policy::SingleThread, memory::policy::NoBoundsChecking,
+                        memory::policy::NoMemoryTagging, memory::policy::SamplingMemoryTracking>;
+
+class SampledTLSFArenaFixture
+{
+public:
+    SampledTLSFArenaFixture() : area(8_MB), arena("SampledTLSFArena", area, 4_MB)
+    {
+    }
+
+protected:
+    static const memory::SiteStats* find_site(const memory::HeapProfile& profile, int line)
+    {
+        auto suffix = fmt::format(":{}", line);
+        for (const auto& site : profile.sites)
+        {
+            if (site.location.ends_with(suffix))
+            {
+                return &site;
+            }
+        }
+        return nullptr;
+    }
+
+    memory::HeapArea area;
+    SampledTLSFArena arena;
+};
+
+TEST_CASE_METHOD(SampledTLSFArenaFixture, "Sampling tracker: exact statistics with a null period", "[mem][tracking]")
+{
+    auto& tracker = arena.get_memory_tracker();
+    tracker.set_sample_period(0);
+
+    std::vector<POD*> pods;
+    std::vector<uint8_t*> buffers;
+    for (size_t ii = 0; ii < 10; ++ii)
+    {
+        pods.push_back(K_NEW(POD, arena));
+    }
+    const int pod_line = __LINE__ - 2;
+    for (size_t ii = 0; ii < 4; ++ii)
+    {
+        buffers.push_back(static_cast<uint8_t*>(arena.allocate(100, 8, 0, __FILE__, __LINE__)));
+    }
+    const int buffer_line = __LINE__ - 2;
+    for (size_t ii = 0; ii < 6; ++ii)
+    {
+        K_DELETE(pods[ii], arena);
+    }
+
+    REQUIRE(tracker.get_allocation_count() == 8);
+    REQUIRE(tracker.get_sample_count() == 14);
+
+    auto profile = tracker.snapshot();
+    REQUIRE(profile.arena == "SampledTLSFArena");
+    REQUIRE(profile.sample_period == 0);
+    const auto* pod_site = find_site(profile, pod_line);
+    const auto* buffer_site = find_site(profile, buffer_line);
+    REQUIRE(pod_site != nullptr);
+    REQUIRE(buffer_site != nullptr);
+    REQUIRE(pod_site->alloc_count == 10);
+    REQUIRE(pod_site->live_count == 4);
+    REQUIRE(pod_site->live_bytes == 4 * pod_site->alloc_bytes / 10);
+    REQUIRE(buffer_site->alloc_count == 4);
+    REQUIRE(buffer_site->live_count == 4);
+    // The site that retains the most memory comes first
+    REQUIRE(profile.sites[0].location == buffer_site->location);
+
+    for (size_t ii = 6; ii < 10; ++ii)
+    {
+        K_DELETE(pods[ii], arena);
+    }
+    for (auto* buffer : buffers)
+    {
+        arena.deallocate(buffer, __FILE__, __LINE__);
+    }
+    profile = tracker.snapshot();
+    REQUIRE(profile.live_bytes() == 0);
+    REQUIRE(tracker.get_allocation_count() == 0);
+}
+
+TEST_CASE_METHOD(SampledTLSFArenaFixture, "Sampling tracker: unbiased estimates", "[mem][tracking]")
+{
+    auto& tracker = arena.get_memory_tracker();
+    tracker.set_sample_period(4_kB);
+
+    constexpr size_t k_count = 8192;
+    std::vector<void*> blocks;
+    for (size_t ii = 0; ii < k_count; ++ii)
+    {
+        blocks.push_back(arena.allocate(232, 8, 0, __FILE__, __LINE__));
+    }
+    const int line = __LINE__ - 2;
+    // Free every other block
+    for (size_t ii = 0; ii < k_count; ii += 2)
+    {
+        arena.deallocate(blocks[ii], __FILE__, __LINE__);
+    }
+
+    // Roughly one sample every 16 allocations
+    REQUIRE(tracker.get_sample_count() > k_count / 32);
+    REQUIRE(tracker.get_sample_count() < k_count / 8);
+
+    auto profile = tracker.snapshot();
+    const auto* site = find_site(profile, line);
+    REQUIRE(site != nullptr);
+    const auto decorated_size = static_cast<double>(232 + SampledTLSFArena::k_allocation_overhead);
+    auto relative_error = [](int64_t estimate, double expected) {
+        return std::abs(static_cast<double>(estimate) / expected - 1.0);
+    };
+    REQUIRE(relative_error(site->alloc_bytes, k_count * decorated_size) < 0.2);
+    REQUIRE(relative_error(site->alloc_count, k_count) < 0.2);
+    REQUIRE(relative_error(site->live_bytes, k_count * decorated_size / 2) < 0.3);
+
+    for (size_t ii = 1; ii < k_count; ii += 2)
+    {
+        arena.deallocate(blocks[ii], __FILE__, __LINE__);
+    }
+    REQUIRE(tracker.snapshot().live_bytes() == 0);
+}
+
+TEST_CASE_METHOD(SampledTLSFArenaFixture, "Sampling tracker: snapshot serialization and diff", "[mem][tracking]")
+{
+    auto& tracker = arena.get_memory_tracker();
+    tracker.set_sample_period(0);
+
+    auto allocate_pods = [this](size_t count) {
+        std::vector<POD*> pods;
+        for (size_t ii = 0; ii < count; ++ii)
+        {
+            pods.push_back(K_NEW(POD, arena));
+        }
+        return pods;
+    };
+
+    auto first = allocate_pods(3);
+    auto before = tracker.snapshot();
+    auto second = allocate_pods(5);
+    K_DELETE(first[0], arena);
+
+    std::stringstream ss;
+    write_heap_profile(ss, tracker.snapshot());
+    memory::HeapProfile after;
+    REQUIRE(memory::read_heap_profile(ss, after));
+    REQUIRE(after.arena == before.arena);
+    REQUIRE(after.sites.size() == 1);
+    REQUIRE(after.sites[0].live_count == 7);
+
+    auto diff = memory::diff_heap_profiles(before, after);
+    REQUIRE(diff.sites.size() == 1);
+    REQUIRE(diff.sites[0].alloc_count == 5);
+    REQUIRE(diff.sites[0].live_count == 4);
+    REQUIRE(diff.live_bytes() == 4 * after.sites[0].alloc_bytes / 8);
+
+    // Invalid or truncated streams are rejected
+    std::stringstream garbage("not a profile at all, not a profile at all");
+    REQUIRE_FALSE(memory::read_heap_profile(garbage, after));
+
+    for (auto* pod : first)
+    {
+        if (pod != first[0])
+        {
+            K_DELETE(pod, arena);
+        }
+    }
+    for (auto* pod : second)
+    {
+        K_DELETE(pod, arena);
+    }
+}
+
+TEST_CASE_METHOD(TLSFArenaFixture, "Arena statistics: counters and high-water mark", "[mem][stats]")
+{
+    std::vector<POD*> pods;
+    for (size_t ii = 0; ii < 8; ++ii)
+    {
+        pods.push_back(K_NEW(POD, arena));
+    }
+    for (size_t ii = 0; ii < 6; ++ii)
+    {
+        K_DELETE(pods[ii], arena);
+    }
+
+    auto stats = arena.get_stats();
+    REQUIRE(std::string(stats.name) == "TLSFArena");
+    REQUIRE(stats.total_size == arena.total_size());
+    REQUIRE(stats.alloc_count == 8);
+    REQUIRE(stats.free_count == 6);
+    REQUIRE(stats.failed_alloc_count == 0);
+    REQUIRE(stats.live_size == 2 * stats.peak_live_size / 8);
+    // The allocator is not inspected outside of the thread guard
+    REQUIRE(stats.used_size == stats.live_size);
+    REQUIRE_FALSE(stats.detailed);
+
+    arena.reset_peak();
+    REQUIRE(arena.get_stats().peak_live_size == stats.live_size);
+
+    K_DELETE(pods[6], arena);
+    K_DELETE(pods[7], arena);
+    stats = arena.get_stats();
+    REQUIRE(stats.live_size == 0);
+    REQUIRE(stats.peak_live_size > 0);
+}
+
+TEST_CASE_METHOD(TLSFArenaFixture, "Arena statistics: fragmentation", "[mem][stats]")
+{
+    auto stats = arena.get_stats(memory::StatsScope::Full);
+    REQUIRE(stats.detailed);
+    REQUIRE(stats.largest_free_block > 0);
+    REQUIRE(stats.fragmentation < 0.05f);
+
+    // Free every other block: free memory is scattered
+    std::vector<void*> blocks;
+    for (size_t ii = 0; ii < 16; ++ii)
+    {
+        blocks.push_back(arena.allocate(64, 8, 0, __FILE__, __LINE__));
+    }
+    for (size_t ii = 0; ii < 16; ii += 2)
+    {
+        arena.deallocate(blocks[ii], __FILE__, __LINE__);
+    }
+    auto fragmented = arena.get_stats(memory::StatsScope::Full);
+    REQUIRE(fragmented.fragmentation > stats.fragmentation);
+    REQUIRE(fragmented.fragmentation <= 1.f);
+    REQUIRE(fragmented.largest_free_block < stats.largest_free_block);
+
+    for (size_t ii = 1; ii < 16; ii += 2)
+    {
+        arena.deallocate(blocks[ii], __FILE__, __LINE__);
+    }
+    REQUIRE(arena.get_stats(memory::StatsScope::Full).largest_free_block == stats.largest_free_block);
+}
+
+TEST_CASE_METHOD(PoolArenaFixture, "Arena statistics: pool arenas have no fragmentation index", "[mem][stats]")
+{
+    POD* pod = K_NEW(POD, arena);
+    auto stats = arena.get_stats(memory::StatsScope::Full);
+    REQUIRE(stats.used_size == arena.used_size());
+    REQUIRE_FALSE(stats.detailed);
+    K_DELETE(pod, arena);
+}
+
+TEST_CASE("Arena statistics: registry and export", "[mem][stats]")
+{
+    memory::HeapArea area(8_kB);
+    auto find = [](const std::vector<memory::ArenaStats>& stats, std::string_view name) {
+        return std::find_if(stats.begin(), stats.end(), [name](const auto& s) { return s.name == name; });
+    };
+
+    {
+        LinArena arena("RegisteredArena", area, 2_kB);
+        POD* pod = K_NEW(POD, arena);
+
+        auto snapshot = memory::ArenaRegistry::snapshot(memory::StatsScope::Full);
+        auto it = find(snapshot, "RegisteredArena");
+        REQUIRE(it != snapshot.end());
+        REQUIRE(it->alloc_count == 1);
+        REQUIRE(it->detailed);
+        REQUIRE(it->largest_free_block == it->total_size - it->used_size);
+
+        std::stringstream ss;
+        memory::write_arena_stats_csv(ss, snapshot, 42, true);
+        std::string line;
+        std::getline(ss, line);
+        REQUIRE(line.starts_with("time_ms,arena,"));
+        size_t rows = 0;
+        while (std::getline(ss, line))
+        {
+            REQUIRE(line.starts_with("42,"));
+            ++rows;
+        }
+        REQUIRE(rows == snapshot.size());
+
+        K_DELETE(pod, arena);
+    }
+
+    auto snapshot = memory::ArenaRegistry::snapshot();
+    REQUIRE(find(snapshot, "RegisteredArena") == snapshot.end());
+}
@@ -0,0 +1,145 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/random/xor_shift.h"
+#include "kibble/thread/job/parallel.h"
+
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace kb;
+
+class ParallelFixture
+{
+public:
+    ParallelFixture() : area(th::JobSystem::get_memory_requirements({})), js(area, {})
+    {
+    }
+
+protected:
+    memory::HeapArea area;
+    th::JobSystem js;
+};
+
+TEST_CASE_METHOD(ParallelFixture, "parallel_for visits each index exactly once", "[parallel]")
+{
+    std::vector<int> visits(100'000, 0);
+    th::parallel_for(js, size_t(0), visits.size(), [&visits](size_t idx) { ++visits[idx]; });
+    REQUIRE(std::all_of(visits.begin(), visits.end(), [](int count) { return count == 1; }));
+}
+
+TEST_CASE_METHOD(ParallelFixture, "parallel_for handles signed and offset ranges", "[parallel]")
+{
+    std::vector<int> values(2000, 0);
+    th::parallel_for(js, -1000, 1000, [&values](int idx) { values[size_t(idx + 1000)] = idx; }, {.grain_size = 7});
+    for (size_t ii = 0; ii < values.size(); ++ii)
+    {
+        REQUIRE(values[ii] == int(ii) - 1000);
+    }
+}
+
+TEST_CASE_METHOD(ParallelFixture, "parallel_for can be nested", "[parallel]")
+{
+    constexpr size_t k_rows = 64;
+    constexpr size_t k_cols = 1000;
+    std::vector<size_t> matrix(k_rows * k_cols, 0);
+    th::parallel_for(js, size_t(0), k_rows, [&](size_t row) {
+        th::parallel_for(js, size_t(0), k_cols, [&](size_t col) { matrix[row * k_cols + col] = row + col; });
+    });
+
+    bool ok = true;
+    for (size_t row = 0; row < k_rows; ++row)
+    {
+        for (size_t col = 0; col < k_cols; ++col)
+        {
+            ok &= (matrix[row * k_cols + col] == row + col);
+        }
+    }
+    REQUIRE(ok);
+}
+
+TEST_CASE_METHOD(ParallelFixture, "parallel_for rethrows the exception of a failed iteration", "[parallel]")
+{
+    REQUIRE_THROWS_AS(th::parallel_for(js, 0, 100'000,
+                                       [](int idx) {
+                                           if (idx == 54321)
+                                           {
+                                               throw std::runtime_error("fail");
+                                           }
+                                       }),
+                      std::runtime_error);
+}
+
+TEST_CASE_METHOD(ParallelFixture, "parallel_reduce computes a sum", "[parallel]")
+{
+    constexpr uint64_t k_count = 1'000'000;
+    uint64_t sum = th::parallel_reduce(
+        js, uint64_t(0), k_count, uint64_t(0), [](uint64_t idx) { return idx; },
+        [](uint64_t a, uint64_t b) { return a + b; });
+    REQUIRE(sum == k_count * (k_count - 1) / 2);
+}
+
+TEST_CASE_METHOD(ParallelFixture, "parallel_reduce on an empty range returns the identity", "[parallel]")
+{
+    int result = th::parallel_reduce(
+        js, 10, 10, 42, [](int) { return 1; }, [](int a, int b) { return a + b; });
+    REQUIRE(result == 42);
+}
+
+TEST_CASE_METHOD(ParallelFixture, "parallel_scan matches std::inclusive_scan", "[parallel]")
+{
+    std::vector<uint64_t> input(123'457);
+    std::iota(input.begin(), input.end(), uint64_t(1));
+    std::vector<uint64_t> expected(input.size());
+    std::inclusive_scan(input.begin(), input.end(), expected.begin());
+
+    SECTION("Out of place")
+    {
+        std::vector<uint64_t> output(input.size());
+        th::parallel_scan(js, input.begin(), input.end(), output.begin(), uint64_t(0));
+        REQUIRE(output == expected);
+    }
+
+    SECTION("In place, small blocks")
+    {
+        th::parallel_scan(js, input.begin(), input.end(), input.begin(), uint64_t(0), std::plus<>{},
+                          {.grain_size = 100});
+        REQUIRE(input == expected);
+    }
+}
+
+TEST_CASE_METHOD(ParallelFixture, "parallel_sort sorts integers", "[parallel]")
+{
+    rng::XorShiftEngine rng(uint64_t(42));
+    std::vector<uint32_t> values(500'003);
+    for (auto& value : values)
+    {
+        value = uint32_t(rng.rand64() % 1000);
+    }
+    auto expected = values;
+    std::sort(expected.begin(), expected.end());
+
+    th::parallel_sort(js, values.begin(), values.end());
+    REQUIRE(values == expected);
+
+    th::parallel_sort(js, values.begin(), values.end(), std::greater<>{});
+    REQUIRE(std::is_sorted(values.begin(), values.end(), std::greater<>{}));
+}
+
+TEST_CASE_METHOD(ParallelFixture, "parallel_sort sorts non-trivial types", "[parallel]")
+{
+    rng::XorShiftEngine rng(uint64_t(123));
+    std::vector<std::string> values(50'000);
+    for (auto& value : values)
+    {
+        value = "string_number_" + std::to_string(rng.rand64() % 100'000);
+    }
+    auto expected = values;
+    std::sort(expected.begin(), expected.end());
+
+    th::parallel_sort(js, values.begin(), values.end(), std::less<>{}, {.grain_size = 1000});
+    REQUIRE(values == expected);
+}
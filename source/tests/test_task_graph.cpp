@@ -0,0 +1,130 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/thread/job/task_graph.h"
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace kb;
+
+class TaskGraphFixture
+{
+public:
+    TaskGraphFixture() : area(th::JobSystem::get_memory_requirements({})), js(area, {})
+    {
+    }
+
+protected:
+    memory::HeapArea area;
+    th::JobSystem js;
+};
+
+TEST_CASE_METHOD(TaskGraphFixture, "Tasks can have many children and parents", "[task_graph]")
+{
+    constexpr size_t k_width = 300;
+    std::atomic<size_t> counter{0};
+    size_t seen_by_sink = 0;
+
+    th::barrier_t barrier = js.create_barrier();
+    auto root = js.create_task(th::detached, {}, []() {});
+    auto sink = js.create_task(th::detached, {}, [&]() { seen_by_sink = counter.load(); });
+    for (size_t ii = 0; ii < k_width; ++ii)
+    {
+        auto task = js.create_task(th::detached, {}, [&counter]() { counter.fetch_add(1); });
+        root.add_child(task);
+        sink.add_parent(task);
+    }
+    root.schedule(barrier);
+    js.wait_on_barrier(barrier);
+    js.destroy_barrier(barrier);
+
+    REQUIRE(seen_by_sink == k_width);
+}
+
+TEST_CASE_METHOD(TaskGraphFixture, "TaskGraph can be submitted repeatedly", "[task_graph]")
+{
+    constexpr size_t k_width = 100;
+    constexpr size_t k_frames = 50;
+    std::vector<size_t> values(k_width, 0);
+    size_t sum = 0;
+    std::vector<size_t> sums;
+
+    th::TaskGraph graph(js);
+    auto root = graph.add({}, [&values]() { std::fill(values.begin(), values.end(), 1); });
+    auto sink = graph.add({}, [&]() {
+        sum = 0;
+        for (size_t value : values)
+        {
+            sum += value;
+        }
+        sums.push_back(sum);
+    });
+    for (size_t ii = 0; ii < k_width; ++ii)
+    {
+        auto node = graph.add({}, [&values, ii]() { values[ii] += ii; });
+        graph.precede(root, node);
+        graph.precede(node, sink);
+    }
+    REQUIRE(graph.size() == k_width + 2);
+
+    for (size_t frame = 0; frame < k_frames; ++frame)
+    {
+        graph.submit();
+        graph.wait();
+        REQUIRE(graph.is_done());
+    }
+
+    REQUIRE(sums.size() == k_frames);
+    for (size_t value : sums)
+    {
+        REQUIRE(value == k_width + k_width * (k_width - 1) / 2);
+    }
+}
+
+TEST_CASE_METHOD(TaskGraphFixture, "TaskGraph with several roots", "[task_graph]")
+{
+    std::atomic<int> a{0};
+    std::atomic<int> b{0};
+    int c = 0;
+
+    th::TaskGraph graph(js);
+    auto na = graph.add({}, [&a]() { a.fetch_add(1); });
+    auto nb = graph.add({}, [&b]() { b.fetch_add(2); });
+    auto nc = graph.add({}, [&]() { c = a.load() + b.load(); });
+    graph.precede(na, nc);
+    graph.precede(nb, nc);
+
+    for (int frame = 1; frame <= 10; ++frame)
+    {
+        graph.submit();
+        graph.wait();
+        REQUIRE(c == 3 * frame);
+    }
+}
+
+TEST_CASE_METHOD(TaskGraphFixture, "TaskGraph rethrows kernel exceptions", "[task_graph]")
+{
+    bool fail = true;
+    bool after = false;
+
+    th::TaskGraph graph(js);
+    auto first = graph.add({}, [&fail]() {
+        if (fail)
+        {
+            throw std::runtime_error("fail");
+        }
+    });
+    auto second = graph.add({}, [&after]() { after = true; });
+    graph.precede(first, second);
+
+    graph.submit();
+    REQUIRE_THROWS_AS(graph.wait(), std::runtime_error);
+    // Dependents still run
+    REQUIRE(after);
+
+    fail = false;
+    graph.submit();
+    REQUIRE_NOTHROW(graph.wait());
+}
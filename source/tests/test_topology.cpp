@@ -0,0 +1,157 @@
+#include "kibble/memory/heap_area.h"
+#include "kibble/thread/job/job_system.h"
+#include "kibble/thread/topology.h"
+
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace kb;
+namespace fs = std::filesystem;
+
+TEST_CASE("Parsing CPU lists", "[topology]")
+{
+    REQUIRE(th::parse_cpu_list("0") == std::vector<uint32_t>{0});
+    REQUIRE(th::parse_cpu_list("0-3") == std::vector<uint32_t>{0, 1, 2, 3});
+    REQUIRE(th::parse_cpu_list("0-1,8,10-11\n") == std::vector<uint32_t>{0, 1, 8, 10, 11});
+    REQUIRE(th::parse_cpu_list("").empty());
+    REQUIRE(th::parse_cpu_list("0-4294967295,2") == std::vector<uint32_t>{2});
+    REQUIRE(th::parse_cpu_list("4294967296").empty());
+}
+
+/*
+    Fake dual-socket machine: 2 packages, 2 L3 domains per package, 2 cores per L3 and 2 hardware threads per core.
+    CPU n and n+8 are SMT siblings, like on Linux.
+*/
+class FakeSysfsFixture
+{
+public:
+    static constexpr uint32_t k_cpus = 16;
+
+    FakeSysfsFixture() : root(fs::temp_directory_path() / "kibble_test_topology")
+    {
+        fs::remove_all(root);
+        write(root / "online", "0-15");
+        for (uint32_t cpu = 0; cpu < k_cpus; ++cpu)
+        {
+            uint32_t core = cpu % 8;
+            uint32_t package = core / 4;
+            uint32_t l3 = core / 2;
+            auto cpu_dir = root / ("cpu" + std::to_string(cpu));
+            write(cpu_dir / "topology" / "thread_siblings_list", std::to_string(core) + "," + std::to_string(core + 8));
+            write(cpu_dir / "topology" / "physical_package_id", std::to_string(package));
+            write(cpu_dir / "cache" / "index2" / "level", "2");
+            write(cpu_dir / "cache" / "index2" / "shared_cpu_list",
+                  std::to_string(core) + "," + std::to_string(core + 8));
+            write(cpu_dir / "cache" / "index3" / "level", "3");
+            write(cpu_dir / "cache" / "index3" / "shared_cpu_list",
+                  std::to_string(2 * l3) + "-" + std::to_string(2 * l3 + 1) + "," + std::to_string(2 * l3 + 8) + "-" +
+                      std::to_string(2 * l3 + 9));
+            fs::create_directories(cpu_dir / ("node" + std::to_string(package)));
+        }
+    }
+
+    ~FakeSysfsFixture()
+    {
+        fs::remove_all(root);
+    }
+
+protected:
+    static void write(const fs::path& path, const std::string& content)
+    {
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << content << '\n';
+    }
+
+    fs::path root;
+};
+
+TEST_CASE_METHOD(FakeSysfsFixture, "Reading the topology from sysfs", "[topology]")
+{
+    auto topology = th::CpuTopology::from_sysfs(root.string());
+    REQUIRE(topology.is_detected());
+    REQUIRE(topology.size() == k_cpus);
+    REQUIRE(topology.core_count() == 8);
+    REQUIRE(topology.l3_count() == 4);
+    REQUIRE(topology.package_count() == 2);
+
+    const auto& cpus = topology.cpus();
+    REQUIRE(cpus[9].core == 1);
+    REQUIRE(cpus[9].l3 == 0);
+    REQUIRE(cpus[9].package == 0);
+    REQUIRE(cpus[13].node == 1);
+
+    using th::CpuDistance;
+    REQUIRE(th::CpuTopology::distance(cpus[0], cpus[0]) == CpuDistance::Self);
+    REQUIRE(th::CpuTopology::distance(cpus[0], cpus[8]) == CpuDistance::SameCore);
+    REQUIRE(th::CpuTopology::distance(cpus[0], cpus[1]) == CpuDistance::SameL3);
+    REQUIRE(th::CpuTopology::distance(cpus[0], cpus[3]) == CpuDistance::SamePackage);
+    REQUIRE(th::CpuTopology::distance(cpus[0], cpus[4]) == CpuDistance::Remote);
+}
+
+TEST_CASE_METHOD(FakeSysfsFixture, "Topology restricted to allowed CPUs", "[topology]")
+{
+    auto topology = th::CpuTopology::from_sysfs(root.string(), {4, 5, 12});
+    REQUIRE(topology.size() == 3);
+    REQUIRE(topology.core_count() == 2);
+    REQUIRE(topology.package_count() == 1);
+}
+
+TEST_CASE_METHOD(FakeSysfsFixture, "Placement fills physical cores first", "[topology]")
+{
+    auto topology = th::CpuTopology::from_sysfs(root.string());
+    auto order = topology.placement_order();
+    REQUIRE(order.size() == k_cpus);
+
+    // One thread per core, socket by socket, then SMT siblings
+    for (size_t ii = 0; ii < 8; ++ii)
+    {
+        REQUIRE(topology.cpus()[order[ii]].cpu == ii);
+        REQUIRE(topology.cpus()[order[ii + 8]].cpu == ii + 8);
+    }
+}
+
+TEST_CASE("Missing sysfs yields an empty topology", "[topology]")
+{
+    auto topology = th::CpuTopology::from_sysfs("/this/path/does/not/exist");
+    REQUIRE(topology.size() == 0);
+    REQUIRE(!topology.is_detected());
+
+    auto flat = th::CpuTopology::flat(4);
+    REQUIRE(flat.size() == 4);
+    REQUIRE(flat.core_count() == 4);
+    REQUIRE(flat.l3_count() == 1);
+}
+
+TEST_CASE("Job system with pinned workers and hierarchical stealing", "[topology]")
+{
+    th::JobSystem::Config config;
+    config.queue_mode = th::QueueMode::WorkStealing;
+    config.victim_selection = th::VictimSelection::Hierarchical;
+    config.pin_workers = true;
+    memory::HeapArea area(th::JobSystem::get_memory_requirements(config));
+    th::JobSystem js(area, config);
+
+    // Workers are placed on CPUs of the detected topology
+    REQUIRE(js.get_topology().size() > 0);
+    for (th::tid_t tid = 0; tid < js.get_threads_count(); ++tid)
+    {
+        const auto& cpu = js.get_worker_cpu(tid);
+        REQUIRE(std::any_of(js.get_topology().cpus().begin(), js.get_topology().cpus().end(),
+                            [&cpu](const th::CpuInfo& info) { return info.cpu == cpu.cpu; }));
+    }
+
+    std::atomic<size_t> counter{0};
+    for (size_t ii = 0; ii < 500; ++ii)
+    {
+        auto affinity = (ii % 2) ? th::WORKER_AFFINITY_LOCAL : th::WORKER_AFFINITY_ANY;
+        auto task = js.create_task(th::detached, {affinity, "job"}, [&counter]() { counter.fetch_add(1); });
+        task.schedule();
+    }
+    js.wait();
+    REQUIRE(counter.load() == 500);
+}
@@ -0,0 +1,125 @@
+#include "kibble/argparse/argparse.h"
+#include "kibble/logger/formatters/vscode_terminal_formatter.h"
+#include "kibble/logger/logger.h"
+#include "kibble/logger/sinks/console_sink.h"
+#include "kibble/math/color_table.h"
+#include "kibble/memory/heap_profile.h"
+#include "kibble/string/string.h"
+
+#include "fmt/format.h"
+#include "fmt/std.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+using namespace kb;
+using namespace kb::log;
+
+void show_error_and_die(ap::ArgParse& parser, const Channel& chan)
+{
+    for (const auto& msg : parser.get_errors())
+    {
+        klog(chan).warn(msg);
+    }
+
+    klog(chan).raw().info(parser.usage());
+    exit(0);
+}
+
+bool load_profile(const fs::path& path, memory::HeapProfile& profile, const Channel& chan)
+{
+    if (!fs::exists(path))
+    {
+        klog(chan).error("File does not exist:\n{}", path);
+        return false;
+    }
+
+    std::ifstream ifs(path, std::ios::binary);
+    if (!memory::read_heap_profile(ifs, profile))
+    {
+        klog(chan).error("Not a valid heap profile:\n{}", path);
+        return false;
+    }
+    return true;
+}
+
+std::string signed_size(int64_t bytes, bool show_sign)
+{
+    const char* sign = bytes < 0 ? "-" : (show_sign ? "+" : "");
+    return fmt::format("{}{}", sign, kb::su::human_size(size_t(std::abs(bytes))));
+}
+
+int main(int argc, char** argv)
+{
+    auto console_formatter = std::make_shared<VSCodeTerminalFormatter>();
+    auto console_sink = std::make_shared<ConsoleSink>();
+    console_sink->set_formatter(console_formatter);
+    Channel chan_kheap(Severity::Verbose, "kheap", "khp", kb::col::aliceblue);
+    chan_kheap.attach_sink(console_sink);
+
+    // * Argument parsing and sanity check
+    ap::ArgParse parser("kheap", "0.1");
+    parser.set_log_output([&chan_kheap](const std::string& str) { klog(chan_kheap).uid("ArgParse").info(str); });
+    const auto& a_input = parser.add_positional<std::string>("PROFILE", "Path to the heap profile");
+    const auto& a_baseline = parser.add_variable<std::string>(
+        'b', "baseline", "Older profile of the same arena, to show the evolution since then", "");
+    const auto& a_top = parser.add_variable<int>('n', "top", "Number of sites to display (default: 20)", 20);
+
+    bool success = parser.parse(argc, argv);
+    if (!success)
+    {
+        show_error_and_die(parser, chan_kheap);
+    }
+
+    memory::HeapProfile profile;
+    if (!load_profile(a_input(), profile, chan_kheap))
+    {
+        return 1;
+    }
+
+    bool is_diff = a_baseline.is_set;
+    if (is_diff)
+    {
+        memory::HeapProfile baseline;
+        if (!load_profile(a_baseline(), baseline, chan_kheap))
+        {
+            return 1;
+        }
+        if (baseline.arena != profile.arena)
+        {
+            klog(chan_kheap).warn("Comparing profiles of different arenas: {} and {}", baseline.arena, profile.arena);
+        }
+        double seconds = double(profile.timestamp_ns - baseline.timestamp_ns) * 1e-9;
+        profile = memory::diff_heap_profiles(baseline, profile);
+        klog(chan_kheap).info("Arena {}: evolution over {:.1f}s", profile.arena, seconds);
+    }
+    else
+    {
+        profile.sort_by_live_bytes();
+        klog(chan_kheap).info("Arena {}", profile.arena);
+    }
+
+    if (profile.sample_period > 0)
+    {
+        klog(chan_kheap).info("Sampled every {} on average, values are estimates",
+                              kb::su::human_size(profile.sample_period));
+    }
+    klog(chan_kheap).info("Live: {} in {} sites", signed_size(profile.live_bytes(), is_diff), profile.sites.size());
+
+    // * Display top sites
+    std::string table = fmt::format("{:>12} {:>10} {:>12} {:>10}  {}\n", "live", "count", "allocated", "count",
+                                    "location");
+    size_t count = std::min(profile.sites.size(), size_t(std::max(a_top(), 0)));
+    for (size_t ii = 0; ii < count; ++ii)
+    {
+        const auto& site = profile.sites[ii];
+        table += fmt::format("{:>12} {:>10} {:>12} {:>10}  {}\n", signed_size(site.live_bytes, is_diff),
+                             site.live_count, signed_size(site.alloc_bytes, is_diff), site.alloc_count,
+                             site.location);
+    }
+    klog(chan_kheap).raw().info(table);
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include "kibble/argparse/argparse.h"
+#include "kibble/logger/binary_log.h"
+#include "kibble/logger/formatters/monochrome_terminal_formatter.h"
+#include "kibble/logger/formatters/powerline_terminal_formatter.h"
+#include "kibble/logger/formatters/vscode_terminal_formatter.h"
+#include "kibble/logger/logger.h"
+#include "kibble/logger/sinks/console_sink.h"
+#include "kibble/math/color_table.h"
+#include "kibble/string/string.h"
+
+#include "fmt/std.h"
+#include <filesystem>
+#include <optional>
+
+namespace fs = std::filesystem;
+
+using namespace kb;
+using namespace kb::log;
+
+void show_error_and_die(ap::ArgParse& parser, const Channel& chan)
+{
+    for (const auto& msg : parser.get_errors())
+    {
+        klog(chan).warn(msg);
+    }
+
+    klog(chan).raw().info(parser.usage());
+    exit(0);
+}
+
+std::optional<Severity> parse_severity(std::string name)
+{
+    su::to_lower(name);
+    for (auto severity : {Severity::Fatal, Severity::Error, Severity::Warn, Severity::Info, Severity::Debug,
+                          Severity::Verbose})
+    {
+        std::string candidate(to_str(severity));
+        su::to_lower(candidate);
+        if (name == candidate)
+        {
+            return severity;
+        }
+    }
+    return std::nullopt;
+}
+
+int main(int argc, char** argv)
+{
+    auto console_formatter = std::make_shared<VSCodeTerminalFormatter>();
+    auto console_sink = std::make_shared<ConsoleSink>();
+    console_sink->set_formatter(console_formatter);
+    Channel chan_klogq(Severity::Verbose, "klogq", "klq", kb::col::aliceblue);
+    chan_klogq.attach_sink(console_sink);
+
+    // * Argument parsing and sanity check
+    ap::ArgParse parser("klogq", "0.1");
+    parser.set_log_output([&chan_klogq](const std::string& str) { klog(chan_klogq).uid("ArgParse").info(str); });
+    const auto& a_input =
+        parser.add_positional<std::string>("LOGS", "Path to a binary log segment, or to a directory of segments");
+    const auto& a_from = parser.add_variable<double>('f', "from", "Only show entries after this time (s)", 0.0);
+    const auto& a_to = parser.add_variable<double>('t', "to", "Only show entries before this time (s)", 0.0);
+    const auto& a_channel = parser.add_variable<std::string>('c', "channel", "Only show entries of this channel", "");
+    const auto& a_severity = parser.add_variable<std::string>(
+        's', "severity", "Least severe level to show [fatal|error|warn|info|debug|verbose]", "verbose");
+    const auto& a_uid = parser.add_variable<std::string>('u', "uid", "Only show entries with this UID", "");
+    const auto& a_powerline = parser.add_flag('p', "powerline", "Render entries with the powerline formatter");
+    const auto& a_monochrome = parser.add_flag('m', "monochrome", "Render entries with the monochrome formatter");
+    const auto& a_info = parser.add_flag('i', "info", "Only show segment statistics");
+
+    bool success = parser.parse(argc, argv);
+    if (!success)
+    {
+        show_error_and_die(parser, chan_klogq);
+    }
+
+    fs::path input(a_input());
+    if (!fs::exists(input))
+    {
+        klog(chan_klogq).fatal("File does not exist:\n{}", input);
+    }
+
+    // * Build query
+    binlog::Query query;
+    if (a_from.is_set)
+    {
+        query.min_ns = int64_t(a_from() * 1e9);
+    }
+    if (a_to.is_set)
+    {
+        query.max_ns = int64_t(a_to() * 1e9);
+    }
+    if (a_channel.is_set)
+    {
+        query.channel = H_(a_channel());
+    }
+    if (a_uid.is_set)
+    {
+        query.uid = H_(a_uid());
+    }
+    auto level = parse_severity(a_severity());
+    if (!level.has_value())
+    {
+        klog(chan_klogq).fatal("Unknown severity level: {}", a_severity());
+    }
+    query.level = *level;
+
+    std::shared_ptr<Formatter> formatter = std::make_shared<VSCodeTerminalFormatter>();
+    if (a_powerline())
+    {
+        formatter = std::make_shared<PowerlineTerminalFormatter>();
+    }
+    else if (a_monochrome())
+    {
+        formatter = std::make_shared<MonochromeTerminalFormatter>();
+    }
+
+    std::vector<fs::path> segments;
+    if (fs::is_directory(input))
+    {
+        segments = binlog::list_segments(input);
+    }
+    else
+    {
+        segments.push_back(input);
+    }
+
+    // * Query each segment
+    size_t match_count = 0;
+    for (const auto& path : segments)
+    {
+        binlog::SegmentReader reader;
+        if (!reader.open(path))
+        {
+            klog(chan_klogq).error("Not a valid binary log segment:\n{}", path);
+            continue;
+        }
+
+        if (a_info())
+        {
+            size_t entry_count = 0;
+            reader.for_each(binlog::Query{}, [&entry_count](const binlog::EntryView&) { ++entry_count; });
+            klog(chan_klogq).info("{}: segment #{}, {} entries from {:.6f}s to {:.6f}s, {}", path.filename(),
+                                  reader.get_header().segment, entry_count, double(reader.get_min_ns()) * 1e-9,
+                                  double(reader.get_max_ns()) * 1e-9,
+                                  reader.has_index() ? fmt::format("{} index blocks", reader.get_block_count())
+                                                     : std::string("not indexed"));
+            continue;
+        }
+
+        ankerl::unordered_dense::map<hash_t, ChannelPresentation> presentations;
+        LogEntry entry;
+        reader.for_each(query, [&](const binlog::EntryView& view) {
+            auto [it, inserted] = presentations.try_emplace(view.header.channel);
+            if (inserted)
+            {
+                const auto* channel = reader.channel(view.header.channel);
+                it->second = channel ? ChannelPresentation{channel->name, channel->tag, {channel->color}}
+                                     : ChannelPresentation{"unknown", "???", kb::col::white};
+            }
+
+            entry.severity = view.header.severity;
+            entry.source_location = {};
+            if (const auto* location = reader.location(view.header.location))
+            {
+                entry.source_location = {location->line, location->file_name, location->function_name};
+            }
+            entry.timestamp = TimeBase::TimeStamp(view.header.timestamp_ns);
+            entry.message.assign(view.message);
+            entry.uid_text = reader.string(view.header.uid);
+            entry.uid_hash = view.header.uid;
+            entry.thread_id = view.header.thread_id;
+            entry.raw_text = (view.header.flags & binlog::k_raw_text) != 0;
+            formatter->print(entry, it->second);
+            ++match_count;
+        });
+    }
+
+    if (!a_info() && match_count == 0)
+    {
+        klog(chan_klogq).info("No matching entry in {} segments.", segments.size());
+    }
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "kibble/argparse/argparse.h"
+#include "kibble/logger/formatters/vscode_terminal_formatter.h"
+#include "kibble/logger/logger.h"
+#include "kibble/logger/sinks/console_sink.h"
+#include "kibble/math/color_table.h"
+#include "kibble/time/trace_format.h"
+
+#include "fmt/std.h"
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+using namespace kb;
+using namespace kb::log;
+
+void show_error_and_die(ap::ArgParse& parser, const Channel& chan)
+{
+    for (const auto& msg : parser.get_errors())
+    {
+        klog(chan).warn(msg);
+    }
+
+    klog(chan).raw().info(parser.usage());
+    exit(0);
+}
+
+int main(int argc, char** argv)
+{
+    auto console_formatter = std::make_shared<VSCodeTerminalFormatter>();
+    auto console_sink = std::make_shared<ConsoleSink>();
+    console_sink->set_formatter(console_formatter);
+    Channel chan_ktrace(Severity::Verbose, "ktrace", "ktr", kb::col::aliceblue);
+    chan_ktrace.attach_sink(console_sink);
+
+    // * Argument parsing and sanity check
+    ap::ArgParse parser("ktrace", "0.1");
+    parser.set_log_output([&chan_ktrace](const std::string& str) { klog(chan_ktrace).uid("ArgParse").info(str); });
+    const auto& a_input = parser.add_positional<std::string>("TRACE", "Path to the binary trace file");
+    const auto& a_output = parser.add_variable<std::string>(
+        'o', "output", "Name of the output file (default: ${trace}.[json|pftrace])", "");
+    const auto& a_perfetto = parser.add_flag('p', "perfetto", "Export to Perfetto protobuf instead of Chrome JSON");
+
+    bool success = parser.parse(argc, argv);
+    if (!success)
+    {
+        show_error_and_die(parser, chan_ktrace);
+    }
+
+    fs::path input(a_input());
+    if (!fs::exists(input))
+    {
+        klog(chan_ktrace).fatal("File does not exist:\n{}", input);
+    }
+
+    fs::path output = input;
+    output.replace_extension(a_perfetto() ? "pftrace" : "json");
+    if (a_output.is_set)
+    {
+        output = a_output();
+    }
+
+    // * Parse trace
+    std::ifstream ifs(input, std::ios::binary);
+    trace::TraceData data;
+    if (!trace::read_trace(ifs, data))
+    {
+        klog(chan_ktrace).fatal("Not a valid trace file:\n{}", input);
+    }
+
+    klog(chan_ktrace).info("Read {} events and {} strings.", data.events.size(), data.strings.size());
+    if (data.dropped > 0)
+    {
+        klog(chan_ktrace).warn("{} events were dropped during the session.", data.dropped);
+    }
+
+    // * Export
+    std::ofstream ofs(output, std::ios::binary);
+    if (a_perfetto())
+    {
+        trace::write_perfetto(data, ofs);
+    }
+    else
+    {
+        trace::write_chrome_json(data, ofs);
+    }
+
+    klog(chan_ktrace).info("Exported to:\n{}", output);
+
+    return 0;
+}